@@ -0,0 +1,1713 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_markov.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Benchmark program for the Markov structure and its extensions. Each
+//   benchmark is a function below that builds its own synthetic chain, times
+//   the operation being measured and prints one line per measurement.
+//
+// Usage:
+//    - Compile by running `make bench_markov` in the root directory and run
+//      ./bench_markov to run every benchmark, or ./bench_markov <name> to run
+//      a single one (the names are listed in the table at the bottom of this
+//      file). `make bench` runs all of them and saves the report to
+//      bench_output.txt
+///////////////////////////////////////////////////////////////////////////////
+
+#include "markov.h"
+#include "markov_sparse.h"
+#include "markov_fixed.h"
+#include "markov_batch.h"
+#include "markov_power.h"
+#include "markov_snapshot.h"
+#include "markov_huge.h"
+#include "markov_absorb.h"
+#include "markov_quant.h"
+#include "markov_topk.h"
+#include "markov_cms.h"
+#include "markov_score.h"
+#include "markov_pipeline.h"
+#include "markov_train.h"
+#include "markov_mmap.h"
+#include "markov_ckpt.h"
+#include "markov_shm.h"
+#include "markov_registry.h"
+#include "markov_delta.h"
+#include "markov_reach.h"
+#include "markov_scc.h"
+#include "markov_order.h"
+#include "markov_export.h"
+#include "markov_prefetch.h"
+#include "markov_perf.h"
+#include "markov_stable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Returns a monotonic timestamp in seconds
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Small xorshift generator so every run uses the same synthetic chains
+static unsigned long long rng_state = 88172645463325252ULL;
+
+static unsigned long long next_rand(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Trains a dense chain of the given size from a random walk in which each
+// state has `fanout` preferred successors near itself
+static Markov* random_chain(int size, int fanout, long updates) {
+    Markov* M = initialize_M(size);
+    int state = 0;
+    for (long u = 0; u < updates; u++) {
+        int next = (state + 1 + (int)(next_rand() % fanout)) % size;
+        update_matrix(M, state, next);
+        state = next;
+    }
+    return M;
+}
+
+// Builds a sparse chain directly in CSR form with `fanout` successors per row,
+// for sizes where the dense structure would not fit in memory
+static SparseMarkov* random_sparse_chain(int size, int fanout) {
+    SparseMarkov* S = (SparseMarkov*)malloc(sizeof(SparseMarkov));
+    S->size = size;
+    S->nnz = (long)size * fanout;
+    S->row_ptr = (long*)malloc((size + 1) * sizeof(long));
+    S->col_idx = (int*)malloc(S->nnz * sizeof(int));
+    S->values = (double*)malloc(S->nnz * sizeof(double));
+    S->helper = (int*)malloc(size * sizeof(int));
+    for (int i = 0; i < size; i++) {
+        S->row_ptr[i] = (long)i * fanout;
+        S->helper[i] = fanout;
+        // successors are spread over a window after i, in column order
+        int col = i;
+        for (int f = 0; f < fanout; f++) {
+            col += 1 + (int)(next_rand() % 64);
+            S->col_idx[(long)i * fanout + f] = col % size;
+            S->values[(long)i * fanout + f] = 1.0 / fanout;
+        }
+        // wrapped columns break the ordering, so sort the (short) row
+        for (int a = 1; a < fanout; a++) {
+            int key = S->col_idx[(long)i * fanout + a];
+            int b = a - 1;
+            while (b >= 0 && S->col_idx[(long)i * fanout + b] > key) {
+                S->col_idx[(long)i * fanout + b + 1] = S->col_idx[(long)i * fanout + b];
+                b--;
+            }
+            S->col_idx[(long)i * fanout + b + 1] = key;
+        }
+    }
+    S->row_ptr[size] = S->nnz;
+    return S;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_sparse()
+//
+//  Compares the dense matrix_mult() against sparse_mult() on the same chain,
+//  then times two- and three-step products of a 100k-state sparse chain
+///////////////////////////////////////////////////////////////////////////////
+static void bench_sparse(void) {
+    int size = 512;
+    Markov* M = random_chain(size, 4, 200000);
+
+    double t0 = now_sec();
+    Markov* D2 = matrix_mult(M, M);
+    double dense = now_sec() - t0;
+
+    SparseMarkov* S = sparse_from_M(M);
+    t0 = now_sec();
+    SparseMarkov* S2 = sparse_mult(S, S, 0.0, 1);
+    double sparse = now_sec() - t0;
+
+    printf("sparse: n=%d dense matrix_mult %.3f ms, sparse_mult %.3f ms (nnz %ld -> %ld)\n",
+           size, dense * 1e3, sparse * 1e3, S->nnz, S2->nnz);
+    free_M(M);
+    free_M(D2);
+    free_sparse(S);
+    free_sparse(S2);
+
+    size = 100000;
+    S = random_sparse_chain(size, 4);
+    for (int threads = 1; threads <= 4; threads *= 2) {
+        t0 = now_sec();
+        S2 = sparse_mult(S, S, 0.0, threads);
+        double two = now_sec() - t0;
+        t0 = now_sec();
+        SparseMarkov* S3 = sparse_mult(S2, S, 1e-4, threads);
+        double three = now_sec() - t0;
+        printf("sparse: n=%d threads=%d M^2 %.3f ms (nnz %ld), M^3 drop 1e-4 %.3f ms (nnz %ld)\n",
+               size, threads, two * 1e3, S2->nnz, three * 1e3, S3->nnz);
+        free_sparse(S2);
+        free_sparse(S3);
+    }
+    free_sparse(S);
+}
+
+// Times `calls` update_matrix + max_prob_idx pairs on a generic chain and on
+// the fixed-size chain of the same size, printing the per-call latency of each
+#define BENCH_FIXED(N, calls)                                                  \
+    do {                                                                       \
+        Markov* G = initialize_M(N);                                           \
+        FixedMarkov##N F;                                                      \
+        initialize_fixed_M##N(&F);                                             \
+        volatile int sink = 0;                                                 \
+        int s = 0;                                                             \
+        double t0 = now_sec();                                                 \
+        for (long c = 0; c < (calls); c++) {                                   \
+            int nx = (int)((s * 5 + c) % (N));                                 \
+            update_matrix(G, s, nx);                                           \
+            s = max_prob_idx(G, nx);                                           \
+        }                                                                      \
+        double generic = now_sec() - t0;                                       \
+        sink += s;                                                             \
+        s = 0;                                                                 \
+        t0 = now_sec();                                                        \
+        for (long c = 0; c < (calls); c++) {                                   \
+            int nx = (int)((s * 5 + c) % (N));                                 \
+            update_fixed_matrix##N(&F, s, nx);                                 \
+            s = max_prob_idx_fixed##N(&F, nx);                                 \
+        }                                                                      \
+        double fixed = now_sec() - t0;                                         \
+        sink += s;                                                             \
+        printf("fixed: N=%d update+max generic %.1f ns/call, fixed %.1f ns/call\n", \
+               (N), generic * 1e9 / (calls), fixed * 1e9 / (calls));          \
+        free_M(G);                                                             \
+    } while (0)
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_fixed()
+//
+//  Compares the per-call latency of the generic and fixed-size chains for
+//  each of the generated sizes
+///////////////////////////////////////////////////////////////////////////////
+static void bench_fixed(void) {
+    BENCH_FIXED(8, 5000000L);
+    BENCH_FIXED(16, 5000000L);
+    BENCH_FIXED(32, 5000000L);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_batch()
+//
+//  Compares rows/s of one max_prob_idx() call per row against
+//  batch_prob_idx() on batches of random rows of a chain larger than cache
+///////////////////////////////////////////////////////////////////////////////
+static void bench_batch(void) {
+    int size = 2048;
+    int batch = 64;
+    int rounds = 2000;
+    Markov* M = random_chain(size, 16, 400000);
+    int* rows = (int*)malloc(batch * rounds * sizeof(int));
+    int* max_out = (int*)malloc(batch * sizeof(int));
+    int* min_out = (int*)malloc(batch * sizeof(int));
+    volatile long sink = 0;
+    for (int r = 0; r < batch * rounds; r++) {
+        rows[r] = (int)(next_rand() % size);
+    }
+
+    double t0 = now_sec();
+    for (int r = 0; r < batch * rounds; r++) {
+        sink += max_prob_idx(M, rows[r]);
+    }
+    double scalar_max = now_sec() - t0;
+
+    t0 = now_sec();
+    for (int r = 0; r < batch * rounds; r++) {
+        sink += max_prob_idx(M, rows[r]) + min_prob_idx(M, rows[r]);
+    }
+    double scalar_both = now_sec() - t0;
+
+    t0 = now_sec();
+    for (int b = 0; b < rounds; b++) {
+        batch_prob_idx(M, rows + b * batch, batch, max_out, NULL);
+        sink += max_out[0];
+    }
+    double batch_max = now_sec() - t0;
+
+    t0 = now_sec();
+    for (int b = 0; b < rounds; b++) {
+        batch_prob_idx(M, rows + b * batch, batch, max_out, min_out);
+        sink += max_out[0] + min_out[0];
+    }
+    double batch_both = now_sec() - t0;
+
+    double total = (double)batch * rounds;
+    printf("batch: n=%d argmax scalar %.2f Mrows/s, batch %.2f Mrows/s\n",
+           size, total / scalar_max * 1e-6, total / batch_max * 1e-6);
+    printf("batch: n=%d argmax+argmin scalar %.2f Mrows/s, batch %.2f Mrows/s\n",
+           size, total / scalar_both * 1e-6, total / batch_both * 1e-6);
+
+    free(rows);
+    free(max_out);
+    free(min_out);
+    free_M(M);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_power()
+//
+//  Compares recomputing M^3 with matrix_mult() after every batch of updates
+//  against the incrementally refreshed power cache, for several
+//  update/query ratios
+///////////////////////////////////////////////////////////////////////////////
+static void bench_power(void) {
+    int size = 384;
+    int queries = 10;
+    int ratios[] = { 1, 16, 256 };
+
+    for (int r = 0; r < 3; r++) {
+        Markov* M = random_chain(size, 4, 100000);
+        int state = 0;
+
+        double t0 = now_sec();
+        for (int q = 0; q < queries; q++) {
+            for (int u = 0; u < ratios[r]; u++) {
+                int next = (state + 1 + (int)(next_rand() % 4)) % size;
+                update_matrix(M, state, next);
+                state = next;
+            }
+            Markov* M2 = matrix_mult(M, M);
+            Markov* M3 = matrix_mult(M, M2);
+            free_M(M2);
+            free_M(M3);
+        }
+        double full = now_sec() - t0;
+
+        MarkovPower* P = power_cache_init(M, 3, 0);
+        long rows = 0;
+        t0 = now_sec();
+        for (int q = 0; q < queries; q++) {
+            for (int u = 0; u < ratios[r]; u++) {
+                int next = (state + 1 + (int)(next_rand() % 4)) % size;
+                update_matrix(M, state, next);
+                state = next;
+            }
+            rows += power_cache_refresh(P);
+            power_cache_get(P);
+        }
+        double cached = now_sec() - t0;
+
+        printf("power: n=%d k=3 %d updates/query full %.3f ms/query, cached %.3f ms/query (%ld rows/query)\n",
+               size, ratios[r], full * 1e3 / queries, cached * 1e3 / queries, rows / queries);
+        free_power_cache(P);
+        free_M(M);
+    }
+}
+
+// Shared state of the snapshot benchmark threads
+typedef struct SnapshotBench {
+    MarkovPublisher* P;        // publisher (snapshot mode)
+    Markov* M;                 // shared chain (lock mode)
+    pthread_mutex_t lock;      // global lock (lock mode)
+    atomic_int stop;           // set once the readers are done
+    int reader_queries;        // queries issued by each reader
+    double* latencies;         // per query latency in ns, per reader
+} SnapshotBench;
+
+typedef struct SnapshotReader {
+    SnapshotBench* B;
+    int slot;
+} SnapshotReader;
+
+static void* snapshot_writer(void* arg) {
+    SnapshotBench* B = (SnapshotBench*)arg;
+    int size = B->P != NULL ? B->P->writer->size : B->M->size;
+    int state = 0;
+    long u = 0;
+    while (!atomic_load(&B->stop)) {
+        int next = (state + 1 + (int)(next_rand() % 8)) % size;
+        if (B->P != NULL) {
+            publisher_update(B->P, state, next);
+            if (++u % 256 == 0) {
+                publisher_publish(B->P);
+            }
+        } else {
+            pthread_mutex_lock(&B->lock);
+            update_matrix(B->M, state, next);
+            pthread_mutex_unlock(&B->lock);
+        }
+        state = next;
+    }
+    return NULL;
+}
+
+static void* snapshot_bench_reader(void* arg) {
+    SnapshotReader* R = (SnapshotReader*)arg;
+    SnapshotBench* B = R->B;
+    volatile int sink = 0;
+    for (int q = 0; q < B->reader_queries; q++) {
+        int i = q % 1024;
+        double t0 = now_sec();
+        if (B->P != NULL) {
+            Markov* S = snapshot_acquire(B->P, R->slot);
+            sink += max_prob_idx(S, i);
+            snapshot_release(B->P, R->slot);
+        } else {
+            pthread_mutex_lock(&B->lock);
+            sink += max_prob_idx(B->M, i);
+            pthread_mutex_unlock(&B->lock);
+        }
+        B->latencies[(long)R->slot * B->reader_queries + q] = (now_sec() - t0) * 1e9;
+    }
+    return NULL;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_snapshot()
+//
+//  Measures max_prob_idx() latency of reader threads while a writer thread
+//  trains the chain nonstop, with a global mutex versus published snapshots
+///////////////////////////////////////////////////////////////////////////////
+static void bench_snapshot(void) {
+    int size = 1024;
+    int readers = 2;
+    const char* modes[] = { "mutex", "snapshot" };
+
+    for (int mode = 0; mode < 2; mode++) {
+        SnapshotBench B;
+        B.P = mode == 1 ? publisher_init(size, readers) : NULL;
+        B.M = mode == 0 ? initialize_M(size) : NULL;
+        pthread_mutex_init(&B.lock, NULL);
+        atomic_init(&B.stop, 0);
+        B.reader_queries = 20000;
+        B.latencies = (double*)malloc((long)readers * B.reader_queries * sizeof(double));
+
+        pthread_t writer;
+        pthread_t threads[2];
+        SnapshotReader R[2];
+        pthread_create(&writer, NULL, snapshot_writer, &B);
+        for (int r = 0; r < readers; r++) {
+            R[r].B = &B;
+            R[r].slot = r;
+            pthread_create(&threads[r], NULL, snapshot_bench_reader, &R[r]);
+        }
+        for (int r = 0; r < readers; r++) {
+            pthread_join(threads[r], NULL);
+        }
+        atomic_store(&B.stop, 1);
+        pthread_join(writer, NULL);
+
+        long total = (long)readers * B.reader_queries;
+        qsort(B.latencies, total, sizeof(double), compare_double);
+        printf("snapshot: n=%d %s reader latency p50 %.0f ns, p99 %.0f ns, p99.9 %.0f ns\n",
+               size, modes[mode], B.latencies[total / 2], B.latencies[total * 99 / 100],
+               B.latencies[total * 999 / 1000]);
+
+        free(B.latencies);
+        pthread_mutex_destroy(&B.lock);
+        free_publisher(B.P);
+        free_M(B.M);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_huge()
+//
+//  Compares the startup time of initialize_M() against the huge page
+//  allocation mode (with one and several zeroing threads), then the time and
+//  hardware counters (dTLB misses among them) of random row scans over each
+//  chain
+///////////////////////////////////////////////////////////////////////////////
+static void bench_huge(void) {
+    int size = 8192;
+    int scans = 20000;
+    const char* names[] = { "initialize_M", "huge none", "huge transparent", "huge explicit" };
+
+    for (int mode = 0; mode < 4; mode++) {
+        for (int threads = 1; threads <= (mode == 0 ? 1 : 4); threads *= 4) {
+            double t0 = now_sec();
+            Markov* M = mode == 0 ? initialize_M(size)
+                                  : initialize_M_huge(size, (HugeMode)(mode - 1), threads);
+            double startup = now_sec() - t0;
+
+            PerfCounters* C = perf_open();
+            volatile int sink = 0;
+            t0 = now_sec();
+            perf_start(C);
+            for (int s = 0; s < scans; s++) {
+                sink += max_prob_idx(M, (int)(next_rand() % size));
+            }
+            perf_stop(C, scans);
+            double scan = now_sec() - t0;
+            char counters[256];
+            perf_format(C, counters, sizeof(counters));
+
+            printf("huge: n=%d %s threads=%d startup %.1f ms, row scan %.2f us, per scan: %s\n",
+                   size, names[mode], threads, startup * 1e3, scan * 1e6 / scans, counters);
+            perf_close(C);
+            free_M(M);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_absorb()
+//
+//  Times expected hitting times of one target state with the blocked LU
+//  solver (one and several threads) and the Gauss-Seidel sparse solver
+///////////////////////////////////////////////////////////////////////////////
+static void bench_absorb(void) {
+    int size = 2000;
+    int target = 0;
+    Markov* M = random_chain(size, 8, 400000);
+    double* times = (double*)malloc(size * sizeof(double));
+
+    for (int threads = 1; threads <= 4; threads *= 4) {
+        double t0 = now_sec();
+        hitting_times(M, &target, 1, times, threads);
+        printf("absorb: n=%d blocked LU threads=%d %.1f ms (t[1] = %.1f)\n",
+               size, threads, (now_sec() - t0) * 1e3, times[1]);
+    }
+
+    SparseMarkov* S = sparse_from_M(M);
+    double t0 = now_sec();
+    int sweeps = hitting_times_iterative(S, &target, 1, times, 1e-9, 1000000);
+    printf("absorb: n=%d Gauss-Seidel %.1f ms, %d sweeps (t[1] = %.1f)\n",
+           size, (now_sec() - t0) * 1e3, sweeps, times[1]);
+
+    free(times);
+    free_sparse(S);
+    free_M(M);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_quant()
+//
+//  Trains a Markov structure and compressed chains (all rows cold, and rows
+//  hot after 64 updates) with the same walk, then reports memory per state,
+//  argmax time and how often the top-1 and top-5 successors agree
+///////////////////////////////////////////////////////////////////////////////
+static void bench_quant(void) {
+    int size = 4096;
+    long updates = 1000000;
+    int queries = 20000;
+    int thresholds[] = { 1 << 30, 64 };
+    const char* names[] = { "cold", "hot>=64" };
+
+    Markov* M = initialize_M(size);
+    QuantMarkov* Q[2] = { initialize_quant(size, thresholds[0]),
+                          initialize_quant(size, thresholds[1]) };
+    int state = 0;
+    for (long u = 0; u < updates; u++) {
+        int next = (state + 1 + (int)(next_rand() % 16)) % size;
+        update_matrix(M, state, next);
+        quant_update(Q[0], state, next);
+        quant_update(Q[1], state, next);
+        state = next;
+    }
+
+    int* rows = (int*)malloc(queries * sizeof(int));
+    for (int q = 0; q < queries; q++) {
+        rows[q] = (int)(next_rand() % size);
+    }
+    volatile long sink = 0;
+    double t0 = now_sec();
+    for (int q = 0; q < queries; q++) {
+        sink += max_prob_idx(M, rows[q]);
+    }
+    double dense = now_sec() - t0;
+    printf("quant: n=%d double %.0f bytes/state, argmax %.2f us\n",
+           size, (double)size * sizeof(double), dense * 1e6 / queries);
+
+    for (int v = 0; v < 2; v++) {
+        t0 = now_sec();
+        for (int q = 0; q < queries; q++) {
+            sink += quant_max_prob_idx(Q[v], rows[q]);
+        }
+        double quant = now_sec() - t0;
+
+        // agreement is measured on probabilities (to rounding) so ties count as
+        // agreeing
+        int top1 = 0;
+        int top5 = 0;
+        int top[5];
+        for (int i = 0; i < size; i++) {
+            double best = M->matrix[i][max_prob_idx(M, i)];
+            top1 += M->matrix[i][quant_max_prob_idx(Q[v], i)] >= best - 1e-12;
+
+            double exact[5] = { -1.0, -1.0, -1.0, -1.0, -1.0 };
+            for (int j = 0; j < size; j++) {
+                double p = M->matrix[i][j];
+                for (int k = 0; k < 5; k++) {
+                    if (p > exact[k]) {
+                        memmove(exact + k + 1, exact + k, (4 - k) * sizeof(double));
+                        exact[k] = p;
+                        break;
+                    }
+                }
+            }
+            quant_top_k(Q[v], i, 5, top);
+            for (int k = 0; k < 5; k++) {
+                top5 += M->matrix[i][top[k]] >= exact[4] - 1e-12;
+            }
+        }
+        printf("quant: n=%d %s %.0f bytes/state, argmax %.2f us, top-1 agree %.1f%%, top-5 agree %.1f%%\n",
+               size, names[v], (double)quant_memory(Q[v]) / size, quant * 1e6 / queries,
+               100.0 * top1 / size, 100.0 * top5 / (5.0 * size));
+    }
+
+    free(rows);
+    free_quant(Q[0]);
+    free_quant(Q[1]);
+    free_M(M);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_heavy()
+//
+//  Trains a Markov structure and heavy-hitter summaries on a chain with a few
+//  dispatcher states followed by thousands of pages, then reports memory per
+//  state, update and argmax time and how often the top-1 successor agrees
+///////////////////////////////////////////////////////////////////////////////
+static void bench_heavy(void) {
+    int size = 4096;
+    long updates = 1000000;
+    int queries = 20000;
+
+    Markov* M = initialize_M(size);
+    HeavyMarkov* H[3] = { initialize_heavy(size, 4), initialize_heavy(size, 16),
+                          initialize_heavy(size, 64) };
+    int* from = (int*)malloc(updates * sizeof(int));
+    int* to = (int*)malloc(updates * sizeof(int));
+    int state = 0;
+    for (long u = 0; u < updates; u++) {
+        // every 64th state is a dispatcher with a skewed, very wide fan-out
+        int next;
+        if (state % 64 == 0) {
+            unsigned long long r = next_rand();
+            next = r % 4 == 0 ? state + 1 : (int)((r >> 2) % size);
+        } else {
+            next = state + 1 + (int)(next_rand() % 8);
+        }
+        next %= size;
+        from[u] = state;
+        to[u] = next;
+        state = next;
+    }
+
+    double t0 = now_sec();
+    for (long u = 0; u < updates; u++) {
+        update_matrix(M, from[u], to[u]);
+    }
+    printf("heavy: n=%d dense %.0f bytes/state, update %.1f ns\n",
+           size, (double)size * sizeof(double), (now_sec() - t0) * 1e9 / updates);
+
+    int* rows = (int*)malloc(queries * sizeof(int));
+    for (int q = 0; q < queries; q++) {
+        rows[q] = (int)(next_rand() % size);
+    }
+    volatile long sink = 0;
+    for (int v = 0; v < 3; v++) {
+        t0 = now_sec();
+        for (long u = 0; u < updates; u++) {
+            heavy_update(H[v], from[u], to[u]);
+        }
+        double update = now_sec() - t0;
+
+        t0 = now_sec();
+        for (int q = 0; q < queries; q++) {
+            sink += heavy_max_prob_idx(H[v], rows[q]);
+        }
+        double query = now_sec() - t0;
+
+        int agree = 0;
+        for (int i = 0; i < size; i++) {
+            agree += M->matrix[i][heavy_max_prob_idx(H[v], i)] >=
+                     M->matrix[i][max_prob_idx(M, i)] - 1e-12;
+        }
+        double bytes = (double)H[v]->k * (sizeof(int) + 2 * sizeof(uint32_t)) + sizeof(int);
+        printf("heavy: n=%d K=%d %.0f bytes/state, update %.1f ns, argmax %.3f us, top-1 agree %.1f%%\n",
+               size, H[v]->k, bytes, update * 1e9 / updates, query * 1e6 / queries,
+               100.0 * agree / size);
+        free_heavy(H[v]);
+    }
+
+    free(rows);
+    free(from);
+    free(to);
+    free_M(M);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_sketch()
+//
+//  Trains a Markov structure and Count-Min sketched chains of several widths
+//  with the same walk (the sketches see scattered 64-bit ids), then reports
+//  memory, update throughput, top-1 agreement and the mean count overestimate
+///////////////////////////////////////////////////////////////////////////////
+static void bench_sketch(void) {
+    int size = 4096;
+    long updates = 1000000;
+    int widths[] = { 1 << 12, 1 << 15, 1 << 18 };
+
+    int* walk = (int*)malloc((updates + 1) * sizeof(int));
+    int64_t* ids = (int64_t*)malloc(size * sizeof(int64_t));
+    walk[0] = 0;
+    for (long u = 0; u < updates; u++) {
+        walk[u + 1] = (walk[u] + 1 + (int)(next_rand() % 16)) % size;
+    }
+    for (int i = 0; i < size; i++) {
+        ids[i] = (int64_t)(next_rand() >> 1);
+    }
+
+    Markov* M = initialize_M(size);
+    double t0 = now_sec();
+    for (long u = 0; u < updates; u++) {
+        update_matrix(M, walk[u], walk[u + 1]);
+    }
+    printf("sketch: n=%d exact %.1f MB, %.2f Mupdates/s\n", size,
+           (double)size * size * sizeof(double) / 1e6, updates / (now_sec() - t0) * 1e-6);
+
+    for (int v = 0; v < 3; v++) {
+        SketchMarkov* SK = initialize_sketch(widths[v], 4, 2 * size, 16);
+        t0 = now_sec();
+        for (long u = 0; u < updates; u++) {
+            sketch_update(SK, ids[walk[u]], ids[walk[u + 1]]);
+        }
+        double elapsed = now_sec() - t0;
+
+        int agree = 0;
+        double over = 0.0;
+        long pairs = 0;
+        for (int i = 0; i < size; i++) {
+            int64_t best = sketch_max_prob_idx(SK, ids[i]);
+            for (int j = 0; j < size; j++) {
+                if (ids[j] == best) {
+                    agree += M->matrix[i][j] >= M->matrix[i][max_prob_idx(M, i)] - 1e-12;
+                }
+                long truth = lround(M->matrix[i][j] * M->helper[i]);
+                if (truth > 0) {
+                    over += (double)sketch_count(SK, ids[i], ids[j]) - truth;
+                    pairs++;
+                }
+            }
+        }
+        printf("sketch: width=%d depth=4 %.1f MB, %.2f Mupdates/s, top-1 agree %.1f%%, mean overcount %.2f\n",
+               widths[v], sketch_memory(SK) / 1e6, updates / elapsed * 1e-6,
+               100.0 * agree / size, over / pairs);
+        free_sketch(SK);
+    }
+
+    free(walk);
+    free(ids);
+    free_M(M);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_score()
+//
+//  Scores many sequences against a trained chain, comparing a scalar loop
+//  taking log(M->matrix[i][j]) per transition against the cached, gathered
+//  scorer with one and several threads
+///////////////////////////////////////////////////////////////////////////////
+static void bench_score(void) {
+    int size = 1024;
+    int count = 1000;
+    int len = 10000;
+    Markov* M = random_chain(size, 16, 400000);
+
+    int* data = (int*)malloc((size_t)count * len * sizeof(int));
+    const int** seqs = (const int**)malloc(count * sizeof(int*));
+    int* lens = (int*)malloc(count * sizeof(int));
+    double* out = (double*)malloc(count * sizeof(double));
+    for (int k = 0; k < count; k++) {
+        int* seq = data + (size_t)k * len;
+        seq[0] = (int)(next_rand() % size);
+        for (int t = 1; t < len; t++) {
+            seq[t] = (seq[t - 1] + 1 + (int)(next_rand() % 16)) % size;
+        }
+        seqs[k] = seq;
+        lens[k] = len;
+    }
+    double transitions = (double)count * (len - 1);
+
+    double t0 = now_sec();
+    volatile double sink = 0.0;
+    for (int k = 0; k < count; k++) {
+        double sum = 0.0;
+        for (int t = 0; t + 1 < len; t++) {
+            sum += log(M->matrix[seqs[k][t]][seqs[k][t + 1]]);
+        }
+        sink += sum;
+    }
+    printf("score: n=%d scalar log %.1f Mtransitions/s\n",
+           size, transitions / (now_sec() - t0) * 1e-6);
+
+    t0 = now_sec();
+    MarkovScorer* S = scorer_init(M, 1.0);
+    printf("score: n=%d building log cache %.1f ms\n", size, (now_sec() - t0) * 1e3);
+    for (int threads = 1; threads <= 4; threads *= 2) {
+        t0 = now_sec();
+        score_sequences(S, seqs, lens, count, out, threads);
+        printf("score: n=%d cached gather threads=%d %.1f Mtransitions/s\n",
+               size, threads, transitions / (now_sec() - t0) * 1e-6);
+    }
+
+    free_scorer(S);
+    free(data);
+    free(seqs);
+    free(lens);
+    free(out);
+    free_M(M);
+}
+
+// Prints a log2 histogram of latencies (in ns) with its percentiles
+static void print_latency_histogram(const char* label, double* latencies, int count) {
+    long buckets[32] = { 0 };
+    for (int k = 0; k < count; k++) {
+        int b = 0;
+        while (b < 31 && latencies[k] >= (double)(2L << b)) {
+            b++;
+        }
+        buckets[b]++;
+    }
+    qsort(latencies, count, sizeof(double), compare_double);
+    printf("pipeline: %s fault path p50 %.0f ns, p99 %.0f ns, p99.9 %.0f ns, max %.0f ns\n",
+           label, latencies[count / 2], latencies[(long)count * 99 / 100],
+           latencies[(long)count * 999 / 1000], latencies[count - 1]);
+    for (int b = 0; b < 32; b++) {
+        if (buckets[b] > 0) {
+            printf("pipeline:   < %8ld ns %7ld\n", 2L << b, buckets[b]);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_pipeline()
+//
+//  Measures the time a simulated fault path spends on the chain: inline
+//  update_matrix + max_prob_idx versus pipeline_push + pipeline_predict
+//  (with the drop and block policies), printing latency histograms
+///////////////////////////////////////////////////////////////////////////////
+static void bench_pipeline(void) {
+    int size = 2048;
+    int faults = 200000;
+    const char* labels[] = { "inline", "pipeline drop", "pipeline block" };
+    double* latencies = (double*)malloc(faults * sizeof(double));
+
+    for (int mode = 0; mode < 3; mode++) {
+        Markov* M = initialize_M(size);
+        MarkovPipeline* P = mode == 0 ? NULL
+            : pipeline_start(M, 4096, 64, mode == 1 ? PIPELINE_DROP : PIPELINE_BLOCK);
+        volatile int sink = 0;
+        int state = 0;
+        double t0 = now_sec();
+        for (int f = 0; f < faults; f++) {
+            int next = (state + 1 + (int)(next_rand() % 16)) % size;
+            struct timespec a, b;
+            clock_gettime(CLOCK_MONOTONIC, &a);
+            if (P == NULL) {
+                update_matrix(M, state, next);
+                sink += max_prob_idx(M, next);
+            } else {
+                pipeline_push(P, state, next);
+                sink += pipeline_predict(P, next);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &b);
+            latencies[f] = (b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+            state = next;
+        }
+        double elapsed = now_sec() - t0;
+        unsigned long dropped = P != NULL ? pipeline_stop(P) : 0;
+
+        printf("pipeline: n=%d %s %.0f faults/s, %lu dropped\n",
+               size, labels[mode], faults / elapsed, dropped);
+        print_latency_histogram(labels[mode], latencies, faults);
+        free_M(M);
+    }
+    free(latencies);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_train()
+//
+//  Compares update_matrix() over a trace against the parallel trainers with
+//  1 to 8 threads, for a dense chain and a large sparse chain
+///////////////////////////////////////////////////////////////////////////////
+static void bench_train(void) {
+    int dense_size = 2048;
+    int sparse_size = 1 << 20;
+    long len = 20000000;
+    long chunk_len = 1 << 16;
+    int* trace = (int*)malloc(len * sizeof(int));
+
+    trace[0] = 0;
+    for (long t = 1; t < len; t++) {
+        trace[t] = (trace[t - 1] + 1 + (int)(next_rand() % 16)) % dense_size;
+    }
+    Markov* M = initialize_M(dense_size);
+    long sequential = 200000;
+    double t0 = now_sec();
+    for (long t = 0; t < sequential; t++) {
+        update_matrix(M, trace[t], trace[t + 1]);
+    }
+    printf("train: n=%d update_matrix %.2f Mtransitions/s\n",
+           dense_size, sequential / (now_sec() - t0) * 1e-6);
+    free_M(M);
+
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        M = initialize_M(dense_size);
+        t0 = now_sec();
+        train_dense(M, trace, len, chunk_len, threads);
+        printf("train: n=%d dense threads=%d %.1f Mtransitions/s\n",
+               dense_size, threads, (len - 1) / (now_sec() - t0) * 1e-6);
+        free_M(M);
+    }
+
+    for (long t = 1; t < len; t++) {
+        trace[t] = (trace[t - 1] + 1 + (int)(next_rand() % 16)) % sparse_size;
+    }
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        t0 = now_sec();
+        SparseMarkov* S = train_sparse(sparse_size, trace, len, chunk_len, threads);
+        printf("train: n=%d sparse threads=%d %.1f Mtransitions/s (%ld nonzeros)\n",
+               sparse_size, threads, (len - 1) / (now_sec() - t0) * 1e-6, S->nnz);
+        free_sparse(S);
+    }
+    free(trace);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_mmap()
+//
+//  Times random max_prob_idx() probes on a file-backed chain with each
+//  access hint, and compares matrix_mult() against the out-of-core multiply
+//  of file-backed chains with shrinking memory budgets
+///////////////////////////////////////////////////////////////////////////////
+static void bench_mmap(void) {
+    int size = 1024;
+    int probes = 20000;
+    char path_a[64];
+    char path_c[64];
+    snprintf(path_a, sizeof(path_a), "/tmp/bench_markov_a_%d", (int)getpid());
+    snprintf(path_c, sizeof(path_c), "/tmp/bench_markov_c_%d", (int)getpid());
+
+    Markov* M = random_chain(size, 16, 400000);
+    Markov* A = initialize_M_file(path_a, size);
+    Markov* C = initialize_M_file(path_c, size);
+    if (A == NULL || C == NULL) {
+        printf("mmap: could not create files in /tmp\n");
+        free_M(M);
+        free_M(A);
+        free_M(C);
+        return;
+    }
+    for (int i = 0; i < size; i++) {
+        memcpy(A->matrix[i], M->matrix[i], size * sizeof(double));
+        A->helper[i] = M->helper[i];
+    }
+
+    const char* hints[] = { "normal", "sequential", "random" };
+    volatile int sink = 0;
+    for (int h = 0; h < 3; h++) {
+        advise_M(A, (MarkovAccess)h);
+        double t0 = now_sec();
+        for (int p = 0; p < probes; p++) {
+            sink += max_prob_idx(A, (int)(next_rand() % size));
+        }
+        printf("mmap: n=%d file-backed %s hint, random probe %.2f us\n",
+               size, hints[h], (now_sec() - t0) * 1e6 / probes);
+    }
+    advise_M(A, ACCESS_NORMAL);
+
+    double t0 = now_sec();
+    Markov* P = matrix_mult(M, M);
+    printf("mmap: n=%d matrix_mult in memory %.1f ms\n", size, (now_sec() - t0) * 1e3);
+    size_t budgets[] = { (size_t)size * size * 16, (size_t)size * size, (size_t)size * 8 * 16 };
+    for (int b = 0; b < 3; b++) {
+        t0 = now_sec();
+        matrix_mult_ooc(A, A, C, budgets[b]);
+        printf("mmap: n=%d out-of-core file-backed budget %.1f MB %.1f ms (%s)\n",
+               size, budgets[b] / 1e6, (now_sec() - t0) * 1e3,
+               memcmp(C->matrix[size / 2], P->matrix[size / 2], size * sizeof(double)) == 0
+                   ? "matches" : "differs");
+    }
+
+    free_M(P);
+    free_M(A);
+    free_M(C);
+    free_M(M);
+    unlink(path_a);
+    unlink(path_c);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_checkpoint()
+//
+//  Compares the time and bytes of an incremental checkpoint, for several
+//  fractions of rows touched since the previous one, against writing the
+//  whole chain (a compaction), and times replaying the log
+///////////////////////////////////////////////////////////////////////////////
+static void bench_checkpoint(void) {
+    int size = 2048;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/bench_markov_log_%d", (int)getpid());
+
+    Markov* M = random_chain(size, 16, 400000);
+    MarkovCheckpoint* C = checkpoint_create(M, path);
+    if (C == NULL) {
+        printf("checkpoint: could not create a log in /tmp\n");
+        free_M(M);
+        return;
+    }
+    C->compact_factor = 1 << 20;   // compacted explicitly below
+
+    struct stat st;
+    stat(path, &st);
+    double t0 = now_sec();
+    checkpoint_compact(C);
+    printf("checkpoint: n=%d full write %.1f ms, %.1f MB\n",
+           size, (now_sec() - t0) * 1e3, st.st_size / 1e6);
+
+    double churns[] = { 0.001, 0.01, 0.1 };
+    for (int c = 0; c < 3; c++) {
+        int touched = (int)(size * churns[c]);
+        for (int r = 0; r < touched; r++) {
+            int row = (int)(next_rand() % size);
+            update_matrix(M, row, (int)(next_rand() % size));
+        }
+        off_t before = st.st_size;
+        t0 = now_sec();
+        long rows = checkpoint_save(C);
+        double elapsed = now_sec() - t0;
+        stat(path, &st);
+        printf("checkpoint: n=%d %.1f%% churn incremental %.2f ms, %.2f MB (%ld rows)\n",
+               size, churns[c] * 100, elapsed * 1e3, (st.st_size - before) / 1e6, rows);
+    }
+
+    t0 = now_sec();
+    MarkovCheckpoint* R = checkpoint_resume(path);
+    printf("checkpoint: n=%d replay of %ld records %.1f ms\n",
+           size, R->records, (now_sec() - t0) * 1e3);
+    free_M(R->M);
+    checkpoint_close(R);
+    checkpoint_close(C);
+    free_M(M);
+    unlink(path);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_shm()
+//
+//  Times shm_max_prob_idx() in reader processes while the trainer updates
+//  the shared chain nonstop, against max_prob_idx() on a private chain
+///////////////////////////////////////////////////////////////////////////////
+static void bench_shm(void) {
+    int size = 1024;
+    int readers = 2;
+    int queries = 200000;
+    char name[64];
+    snprintf(name, sizeof(name), "/bench_markov_%d", (int)getpid());
+
+    Markov* M = random_chain(size, 16, 400000);
+    volatile int sink = 0;
+    double t0 = now_sec();
+    for (int q = 0; q < queries; q++) {
+        sink += max_prob_idx(M, (int)(next_rand() % size));
+    }
+    printf("shm: n=%d private max_prob_idx %.0f ns\n", size, (now_sec() - t0) * 1e9 / queries);
+
+    SharedMarkov* S = initialize_M_shm(name, size);
+    if (S == NULL) {
+        printf("shm: could not create a shared segment\n");
+        free_M(M);
+        return;
+    }
+    for (int u = 0; u < 400000; u++) {
+        shm_update_matrix(S, (int)(next_rand() % size), (int)(next_rand() % 16));
+    }
+
+    fflush(stdout);
+    pid_t pids[2];
+    for (int r = 0; r < readers; r++) {
+        pids[r] = fork();
+        if (pids[r] == 0) {
+            SharedMarkov* R = attach_M_shm(name);
+            unsigned long before = shm_updates(R);
+            t0 = now_sec();
+            for (int q = 0; q < queries; q++) {
+                sink += shm_max_prob_idx(R, (int)((q * 2654435761u) % size));
+            }
+            printf("shm: n=%d reader process %d shm_max_prob_idx %.0f ns (%lu updates meanwhile)\n",
+                   size, r, (now_sec() - t0) * 1e9 / queries, shm_updates(R) - before);
+            fflush(stdout);
+            close_M_shm(R);
+            _exit(0);
+        }
+    }
+
+    // train until every reader is done
+    int done = 0;
+    while (done < readers) {
+        for (int u = 0; u < 1000; u++) {
+            shm_update_matrix(S, (int)(next_rand() % size), (int)(next_rand() % 16));
+        }
+        while (done < readers && waitpid(-1, NULL, WNOHANG) > 0) {
+            done++;
+        }
+    }
+
+    close_M_shm(S);
+    remove_M_shm(name);
+    free_M(M);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_registry()
+//
+//  Times per-tenant update (lookup plus update_matrix) through the registry,
+//  single and bulk, against an array of separately initialized chains, with
+//  a budget that fits every chain and one that fits a quarter of them
+///////////////////////////////////////////////////////////////////////////////
+static void bench_registry(void) {
+    int size = 16;
+    int tenants = 4096;
+    long events = 2000000;
+    uint64_t* ids = (uint64_t*)malloc(events * sizeof(uint64_t));
+    int* tenant = (int*)malloc(events * sizeof(int));
+    int* from = (int*)malloc(events * sizeof(int));
+    int* to = (int*)malloc(events * sizeof(int));
+    for (long e = 0; e < events; e++) {
+        tenant[e] = (int)(next_rand() % tenants);
+        ids[e] = 0x9e3779b97f4a7c15ULL * (uint64_t)(tenant[e] + 1);   // pid-like keys
+        from[e] = (int)(next_rand() % size);
+        to[e] = (int)(next_rand() % 4);
+    }
+
+    Markov** chains = (Markov**)malloc(tenants * sizeof(Markov*));
+    for (int t = 0; t < tenants; t++) {
+        chains[t] = initialize_M(size);
+    }
+    double t0 = now_sec();
+    for (long e = 0; e < events; e++) {
+        update_matrix(chains[tenant[e]], from[e], to[e]);
+    }
+    printf("registry: %d tenants n=%d separate chains %.1f ns/update\n",
+           tenants, size, (now_sec() - t0) * 1e9 / events);
+    for (int t = 0; t < tenants; t++) {
+        free_M(chains[t]);
+    }
+    free(chains);
+
+    size_t budgets[] = { (size_t)64 << 20, (size_t)tenants * 4096 / 4 };
+    for (int b = 0; b < 2; b++) {
+        TenantRegistry* R = registry_init(size, budgets[b]);
+        t0 = now_sec();
+        for (long e = 0; e < events; e++) {
+            registry_update(R, ids[e], from[e], to[e]);
+        }
+        double single = (now_sec() - t0) * 1e9 / events;
+        t0 = now_sec();
+        registry_update_bulk(R, ids, from, to, events);
+        double bulk = (now_sec() - t0) * 1e9 / events;
+        printf("registry: %d tenants n=%d budget %.1f MB registry_update %.1f ns, bulk %.1f ns "
+               "(%.1f MB held, %ld compactions, %ld evictions)\n",
+               tenants, size, budgets[b] / 1e6, single, bulk, registry_memory(R) / 1e6,
+               R->compactions, R->evictions);
+        free_registry(R);
+    }
+
+    free(ids);
+    free(tenant);
+    free(from);
+    free(to);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_delta()
+//
+//  Replays a scan-heavy trace (runs of strided accesses from random pages)
+//  through a page-indexed chain and a delta chain, comparing the share of
+//  next pages predicted, the memory of each chain and the time per access
+///////////////////////////////////////////////////////////////////////////////
+static void bench_delta(void) {
+    int pages = 2048;
+    long len = 1000000;
+    int strides[] = { 1, 1, 1, 2, 8, 64 };
+    int* trace = (int*)malloc(len * sizeof(int));
+    long a = 0;
+    while (a < len) {
+        int page = (int)(next_rand() % pages);
+        int stride = strides[next_rand() % 6];
+        int run = 50 + (int)(next_rand() % 450);
+        for (int r = 0; r < run && a < len; r++) {
+            trace[a++] = page;
+            page = (page + stride) % pages;
+        }
+    }
+
+    Markov* P = initialize_M(pages);
+    long hits = 0;
+    double t0 = now_sec();
+    for (a = 1; a < len; a++) {
+        if (P->helper[trace[a - 1]] > 0 && max_prob_idx(P, trace[a - 1]) == trace[a]) {
+            hits++;
+        }
+        update_matrix(P, trace[a - 1], trace[a]);
+    }
+    printf("delta: %d pages, page-indexed chain %d states (%.1f MB), %.1f%% predicted, %.0f ns/access\n",
+           pages, pages, (double)pages * pages * sizeof(double) / 1e6, 100.0 * hits / (len - 1),
+           (now_sec() - t0) * 1e9 / (len - 1));
+    free_M(P);
+
+    DeltaMarkov* D = initialize_delta(16);
+    hits = 0;
+    t0 = now_sec();
+    for (a = 0; a < len; a++) {
+        if (delta_predict(D) == trace[a]) {
+            hits++;
+        }
+        delta_observe(D, (uint64_t)trace[a]);
+    }
+    int size = D->M->size;
+    printf("delta: %d pages, delta chain %d states (%.2f MB), %.1f%% predicted, %.0f ns/access\n",
+           pages, size, (double)size * size * sizeof(double) / 1e6, 100.0 * hits / (len - 1),
+           (now_sec() - t0) * 1e9 / len);
+    free_delta(D);
+    free(trace);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_reach()
+//
+//  Compares the top 16 states within k = 3 steps from matrix_mult powers
+//  against beam searches of several widths over the dense and sparse chain,
+//  reporting the time per query and the overlap with the exact top 16
+///////////////////////////////////////////////////////////////////////////////
+static void bench_reach(void) {
+    int size = 1024;
+    int k = 3;
+    int top = 16;
+    int queries = 2000;
+    Markov* M = random_chain(size, 16, 400000);
+    SparseMarkov* S = sparse_from_M(M);
+    MarkovReach* R = reach_init(size);
+
+    double t0 = now_sec();
+    Markov* P2 = matrix_mult(M, M);
+    Markov* P3 = matrix_mult(P2, M);
+    printf("reach: n=%d k=%d M^2, M^3 with matrix_mult %.1f ms\n", size, k, (now_sec() - t0) * 1e3);
+
+    // exact top states of a few start states, from an unpruned search
+    int starts[32];
+    int exact[32][16];
+    for (int q = 0; q < 32; q++) {
+        starts[q] = (int)(next_rand() % size);
+        reach_top_n(R, M, starts[q], k, size, 0.0, top, exact[q], NULL);
+    }
+
+    int beams[] = { 8, 32, 128 };
+    int states[16];
+    for (int b = 0; b < 3; b++) {
+        for (int mode = 0; mode < 2; mode++) {
+            t0 = now_sec();
+            for (int q = 0; q < queries; q++) {
+                int start = starts[q % 32];
+                if (mode == 0) {
+                    reach_top_n(R, M, start, k, beams[b], 1e-4, top, states, NULL);
+                } else {
+                    reach_top_n_sparse(R, S, start, k, beams[b], 1e-4, top, states, NULL);
+                }
+            }
+            double elapsed = now_sec() - t0;
+
+            int overlap = 0;
+            for (int q = 0; q < 32; q++) {
+                if (mode == 0) {
+                    reach_top_n(R, M, starts[q], k, beams[b], 1e-4, top, states, NULL);
+                } else {
+                    reach_top_n_sparse(R, S, starts[q], k, beams[b], 1e-4, top, states, NULL);
+                }
+                for (int x = 0; x < top; x++) {
+                    for (int y = 0; y < top; y++) {
+                        overlap += states[x] == exact[q][y];
+                    }
+                }
+            }
+            printf("reach: n=%d k=%d %s beam %d: %.1f us/query, %.1f%% of the exact top %d\n",
+                   size, k, mode == 0 ? "dense" : "sparse", beams[b], elapsed * 1e6 / queries,
+                   100.0 * overlap / (32 * top), top);
+        }
+    }
+
+    free_reach(R);
+    free_M(P2);
+    free_M(P3);
+    free_sparse(S);
+    free_M(M);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_scc()
+//
+//  Builds a reducible chain of 24 closed clusters of 32 states fed by 128
+//  transient states, and compares M^2 with matrix_mult against
+//  scc_matrix_mult on the permuted chain, then times the stationary
+//  distributions of the clusters
+///////////////////////////////////////////////////////////////////////////////
+static void bench_scc(void) {
+    int clusters = 24;
+    int width = 32;
+    int transient = 128;
+    int size = transient + clusters * width;
+    Markov* M = initialize_M(size);
+    for (long u = 0; u < 100000; u++) {
+        // high bits of the draws, so that s and next are not correlated
+        int s = (int)((next_rand() >> 32) % size);
+        int next = (int)((next_rand() >> 32) % size);
+        if (s >= transient) {
+            next = transient + (s - transient) / width * width + next % width;
+        } else if (next % 4 != 0) {
+            next %= transient;
+        }
+        update_matrix(M, s, next);
+    }
+
+    double t0 = now_sec();
+    MarkovSCC* C = scc_decompose(M);
+    Markov* P = scc_permute(M, C);
+    double prep = now_sec() - t0;
+    t0 = now_sec();
+    Markov* D2 = matrix_mult(P, P);
+    double dense = now_sec() - t0;
+    printf("scc: n=%d %d classes, decompose + permute %.1f ms, matrix_mult %.1f ms\n",
+           size, C->num_classes, prep * 1e3, dense * 1e3);
+
+    int threads[] = { 1, 2, 4 };
+    for (int t = 0; t < 3; t++) {
+        t0 = now_sec();
+        Markov* B2 = scc_matrix_mult(P, P, C, threads[t]);
+        double elapsed = now_sec() - t0;
+        int same = 1;
+        for (int i = 0; i < size; i++) {
+            same &= memcmp(B2->matrix[i], D2->matrix[i], size * sizeof(double)) == 0;
+        }
+        printf("scc: n=%d scc_matrix_mult %d threads %.1f ms (%.1fx), identical %s\n",
+               size, threads[t], elapsed * 1e3, dense / elapsed, same ? "yes" : "no");
+        free_M(B2);
+    }
+
+    double* pi = (double*)malloc(size * sizeof(double));
+    for (int t = 0; t < 3; t++) {
+        t0 = now_sec();
+        int closed = scc_stationary(M, C, pi, threads[t]);
+        printf("scc: n=%d stationary of %d closed classes, %d threads %.1f ms\n",
+               size, closed, threads[t], (now_sec() - t0) * 1e3);
+    }
+
+    free(pi);
+    free_M(D2);
+    free_M(P);
+    free_scc(C);
+    free_M(M);
+}
+
+// Builds a random relabeling of size states, to scramble a chain built with
+// local structure
+static MarkovOrder* random_order(int size) {
+    MarkovOrder* O = (MarkovOrder*)malloc(sizeof(MarkovOrder));
+    O->size = size;
+    O->perm = (int*)malloc(size * sizeof(int));
+    O->pos = (int*)malloc(size * sizeof(int));
+    for (int p = 0; p < size; p++) {
+        O->perm[p] = p;
+    }
+    for (int p = size - 1; p > 0; p--) {
+        int q = (int)((next_rand() >> 16) % (p + 1));
+        int t = O->perm[p];
+        O->perm[p] = O->perm[q];
+        O->perm[q] = t;
+    }
+    for (int p = 0; p < size; p++) {
+        O->pos[O->perm[p]] = p;
+    }
+    return O;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_order()
+//
+//  Compares max_prob_idx on a chain whose hot successors are scattered over
+//  the columns against ordered_max_prob_idx under frequency and RCM orders,
+//  then sparse reachability queries on a scrambled banded chain against the
+//  same chain in RCM order, with the hardware counters that are available
+///////////////////////////////////////////////////////////////////////////////
+static void bench_order(void) {
+    int size = 4096;
+    int queries = 200000;
+
+    // each state mostly goes to one of 64 hot states, else to a neighbor,
+    // all under scrambled labels
+    MarkovOrder* scramble = random_order(size);
+    Markov* M = initialize_M(size);
+    for (long u = 0; u < 2000000; u++) {
+        int s = (int)((next_rand() >> 16) % size);
+        int next = next_rand() % 4 != 0 ? s % 64 : (s + 1 + (int)((next_rand() >> 16) % 8)) % size;
+        update_matrix(M, scramble->perm[s], scramble->perm[next]);
+    }
+    int* rows = (int*)malloc(queries * sizeof(int));
+    for (int q = 0; q < queries; q++) {
+        rows[q] = (int)((next_rand() >> 16) % size);
+    }
+
+    const char* names[] = { "original", "frequency", "rcm" };
+    for (int mode = 0; mode < 3; mode++) {
+        OrderedMarkov* OM = mode == 0 ? NULL
+                          : ordered_init(M, mode == 1 ? order_by_frequency(M) : order_rcm(M));
+        PerfCounters* C = perf_open();
+        volatile int sink = 0;
+        double t0 = now_sec();
+        perf_start(C);
+        for (int q = 0; q < queries; q++) {
+            sink += mode == 0 ? max_prob_idx(M, rows[q]) : ordered_max_prob_idx(OM, rows[q]);
+        }
+        perf_stop(C, queries);
+        double elapsed = now_sec() - t0;
+        char counters[256];
+        perf_format(C, counters, sizeof(counters));
+        printf("order: n=%d %s argmax %.0f ns/query (%.1f M/s), mean distance %.0f, per query: %s\n",
+               size, names[mode], elapsed * 1e9 / queries, queries / elapsed / 1e6,
+               order_mean_distance(M, mode == 0 ? NULL : OM->O), counters);
+        perf_close(C);
+        free_ordered(OM);
+    }
+    free(rows);
+    free_order(scramble);
+    free_M(M);
+
+    // sparse: a banded chain of 1M states under scrambled labels
+    int sparse_size = 1 << 20;
+    int reach_queries = 20000;
+    SparseMarkov* banded = random_sparse_chain(sparse_size, 8);
+    scramble = random_order(sparse_size);
+    SparseMarkov* S = order_apply_sparse(banded, scramble);
+    free_sparse(banded);
+    double t0 = now_sec();
+    MarkovOrder* R = order_rcm_sparse(S);
+    SparseMarkov* RS = order_apply_sparse(S, R);
+    printf("order: n=%d sparse rcm order + apply %.1f ms\n", sparse_size, (now_sec() - t0) * 1e3);
+
+    MarkovReach* reach = reach_init(sparse_size);
+    int states[16];
+    for (int mode = 0; mode < 2; mode++) {
+        PerfCounters* C = perf_open();
+        t0 = now_sec();
+        perf_start(C);
+        for (int q = 0; q < reach_queries; q++) {
+            int start = (int)((next_rand() >> 16) % sparse_size);
+            if (mode == 0) {
+                reach_top_n_sparse(reach, S, start, 4, 64, 1e-4, 16, states, NULL);
+            } else {
+                reach_top_n_sparse(reach, RS, R->pos[start], 4, 64, 1e-4, 16, states, NULL);
+            }
+        }
+        perf_stop(C, reach_queries);
+        double elapsed = now_sec() - t0;
+        char counters[256];
+        perf_format(C, counters, sizeof(counters));
+        printf("order: n=%d sparse %s reach k=4 beam 64 %.1f us/query, per query: %s\n",
+               sparse_size, mode == 0 ? "scrambled" : "rcm", elapsed * 1e6 / reach_queries,
+               counters);
+        perf_close(C);
+    }
+
+    free_reach(reach);
+    free_sparse(RS);
+    free_order(R);
+    free_sparse(S);
+    free_order(scramble);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_export()
+//
+//  Times print_M() on a 4096-state chain against export_M_fd() in each
+//  format with one and several threads, all written to /dev/null
+///////////////////////////////////////////////////////////////////////////////
+static void bench_export(void) {
+    int size = 4096;
+    Markov* M = random_chain(size, 16, 400000);
+    int devnull = open("/dev/null", O_WRONLY);
+
+    // print_M writes to stdout, so stdout is pointed at /dev/null meanwhile
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    dup2(devnull, STDOUT_FILENO);
+    double t0 = now_sec();
+    print_M(M);
+    fflush(stdout);
+    double printed = now_sec() - t0;
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    printf("export: n=%d print_M %.0f ms\n", size, printed * 1e3);
+
+    const char* names[] = { "text", "csv", "matrix market", "binary" };
+    for (int format = EXPORT_TEXT; format <= EXPORT_BINARY; format++) {
+        for (int threads = 1; threads <= (format == EXPORT_BINARY ? 1 : 4); threads *= 2) {
+            t0 = now_sec();
+            long bytes = export_M_fd(M, devnull, (ExportFormat)format, 3, threads);
+            double elapsed = now_sec() - t0;
+            printf("export: n=%d %s %d threads %.0f ms (%.1fx print_M), %.0f MB/s\n",
+                   size, names[format], threads, elapsed * 1e3, printed / elapsed,
+                   bytes / elapsed / 1e6);
+        }
+    }
+
+    close(devnull);
+    free_M(M);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_prefetch()
+//
+//  Replays a trace where half the states are followed by a predictable
+//  successor and the other half by one of 16, training the chain online.
+//  Compares prefetching max_prob_idx on every access against the gated,
+//  adaptive policy: prefetches issued, used and wasted, and the time per
+//  decision
+///////////////////////////////////////////////////////////////////////////////
+static void bench_prefetch(void) {
+    int size = 1024;
+    long accesses = 2000000;
+    const char* names[] = { "every max_prob_idx", "gated adaptive" };
+
+    for (int mode = 0; mode < 2; mode++) {
+        Markov* M = initialize_M(size);
+        // the ungated baseline: any nonzero cell, one successor, no feedback
+        PrefetchPolicy* P = mode == 0 ? prefetch_init(M, 1e-300, 0, 1, 2)
+                                      : prefetch_init(M, 0.3, 8, 4, 2);
+        int states[4];
+        int s = 0;
+        double decide = 0.0;
+        for (long a = 0; a < accesses; a++) {
+            int next;
+            if (s < size / 2) {
+                next = next_rand() % 10 != 0 ? s + 1 : (int)((next_rand() >> 16) % size);
+            } else {
+                next = (s + 1 + (int)((next_rand() >> 16) % 16)) % size;
+            }
+            prefetch_observe(P, next);
+            update_matrix(M, s, next);
+            double t0 = now_sec();
+            prefetch_predict(P, next, states);
+            decide += now_sec() - t0;
+            s = next;
+        }
+        printf("prefetch: n=%d %s: issued %lu, used %lu (%.1f%% of accesses), wasted %lu "
+               "(%.1f%% of issued), suppressed %lu, degree %d, %.0f ns/decision\n",
+               size, names[mode], P->issued, P->used, 100.0 * P->used / accesses, P->wasted,
+               100.0 * P->wasted / (P->issued > 0 ? P->issued : 1), P->suppressed, P->degree,
+               decide * 1e9 / accesses);
+        free_prefetch(P);
+        free_M(M);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_perf()
+//
+//  Profiles the core operations on the double** layout: update_matrix and
+//  max_prob_idx on random rows of a 4096-state chain, and matrix_mult on a
+//  256-state chain, reporting the time and every available hardware
+//  counter per operation
+///////////////////////////////////////////////////////////////////////////////
+static void bench_perf(void) {
+    int size = 4096;
+    int ops = 50000;
+    Markov* M = random_chain(size, 16, 200000);
+    int* rows = (int*)malloc(2 * ops * sizeof(int));
+    for (int o = 0; o < 2 * ops; o++) {
+        rows[o] = (int)((next_rand() >> 16) % size);
+    }
+
+    for (int op = 0; op < 3; op++) {
+        Markov* small = op == 2 ? random_chain(256, 16, 100000) : NULL;
+        int count = op == 2 ? 4 : ops;
+        PerfCounters* C = perf_open();
+        volatile int sink = 0;
+        double t0 = now_sec();
+        perf_start(C);
+        for (int o = 0; o < count; o++) {
+            if (op == 0) {
+                update_matrix(M, rows[2 * o], rows[2 * o + 1]);
+            } else if (op == 1) {
+                sink += max_prob_idx(M, rows[o]);
+            } else {
+                free_M(matrix_mult(small, small));
+            }
+        }
+        perf_stop(C, count);
+        double elapsed = now_sec() - t0;
+        char counters[256];
+        perf_format(C, counters, sizeof(counters));
+        const char* names[] = { "update_matrix", "max_prob_idx", "matrix_mult" };
+        printf("perf: n=%d %s %.2f us/op, per op: %s\n", op == 2 ? 256 : size, names[op],
+               elapsed * 1e6 / count, counters);
+        perf_close(C);
+        free_M(small);
+    }
+
+    free(rows);
+    free_M(M);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bench_stable()
+//
+//  Trains 8 rows of a 64-state chain with 40M transitions through
+//  update_matrix and through the stable mode, reporting the time per update
+//  and the row sum drift, then compares matrix_mult with the compensated
+//  product (time and largest relative error against a long double
+//  reference) on a 256-state chain
+///////////////////////////////////////////////////////////////////////////////
+static void bench_stable(void) {
+    int size = 64;
+    long updates = 40000000;
+    Markov* plain = initialize_M(size);
+    Markov* stable = initialize_M(size);
+    StableMarkov* S = stable_init(stable, 1 << 16);
+    int* next = (int*)malloc(4096 * sizeof(int));
+    for (int t = 0; t < 4096; t++) {
+        next[t] = (int)((next_rand() >> 32) % size);
+    }
+
+    for (int mode = 0; mode < 2; mode++) {
+        double t0 = now_sec();
+        for (long u = 0; u < updates; u++) {
+            int i = (int)(u & 7);
+            int j = next[u & 4095];
+            if (mode == 0) {
+                update_matrix(plain, i, j);
+            } else {
+                stable_update(S, i, j);
+            }
+        }
+        double elapsed = now_sec() - t0;
+        printf("stable: %s %ld updates %.1f ns/update, row sum drift %.3g\n",
+               mode == 0 ? "update_matrix" : "stable_update", updates,
+               elapsed * 1e9 / updates, row_sum_drift(mode == 0 ? plain : stable));
+    }
+    printf("stable: %lu row renormalizations\n", S->renormalized);
+    free(next);
+    free_stable(S);
+    free_M(plain);
+    free_M(stable);
+
+    int n = 256;
+    Markov* M = random_chain(n, 64, 400000);
+    for (int mode = 0; mode < 2; mode++) {
+        double t0 = now_sec();
+        Markov* R = mode == 0 ? matrix_mult(M, M) : matrix_mult_compensated(M, M);
+        double elapsed = now_sec() - t0;
+        double worst = 0.0;
+        for (int i = 0; i < n; i += 16) {
+            for (int j = 0; j < n; j++) {
+                long double ref = 0.0L;
+                for (int k = 0; k < n; k++) {
+                    ref += (long double)M->matrix[i][k] * (long double)M->matrix[k][j];
+                }
+                if (ref > 0.0L && fabsl(R->matrix[i][j] - ref) / ref > worst) {
+                    worst = (double)(fabsl(R->matrix[i][j] - ref) / ref);
+                }
+            }
+        }
+        printf("stable: n=%d %s %.1f ms, largest relative error %.3g\n", n,
+               mode == 0 ? "matrix_mult" : "matrix_mult_compensated", elapsed * 1e3, worst);
+        free_M(R);
+    }
+    free_M(M);
+}
+
+// Table of the available benchmarks, in the order they run
+typedef struct Benchmark {
+    const char* name;
+    void (*run)(void);
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+    { "sparse", bench_sparse },
+    { "fixed", bench_fixed },
+    { "batch", bench_batch },
+    { "power", bench_power },
+    { "snapshot", bench_snapshot },
+    { "huge", bench_huge },
+    { "absorb", bench_absorb },
+    { "quant", bench_quant },
+    { "heavy", bench_heavy },
+    { "sketch", bench_sketch },
+    { "score", bench_score },
+    { "pipeline", bench_pipeline },
+    { "train", bench_train },
+    { "mmap", bench_mmap },
+    { "checkpoint", bench_checkpoint },
+    { "shm", bench_shm },
+    { "registry", bench_registry },
+    { "delta", bench_delta },
+    { "reach", bench_reach },
+    { "scc", bench_scc },
+    { "order", bench_order },
+    { "export", bench_export },
+    { "prefetch", bench_prefetch },
+    { "perf", bench_perf },
+    { "stable", bench_stable },
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// main(int argc, char** argv)
+//
+//  Runs every benchmark, or only the ones named on the command line
+//
+// Returns:
+//    - 0 on success, 1 if an unknown benchmark was named
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv) {
+    int count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+    if (argc < 2) {
+        for (int b = 0; b < count; b++) {
+            benchmarks[b].run();
+        }
+        return 0;
+    }
+
+    for (int a = 1; a < argc; a++) {
+        int found = 0;
+        for (int b = 0; b < count; b++) {
+            if (strcmp(argv[a], benchmarks[b].name) == 0) {
+                benchmarks[b].run();
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "Unknown benchmark: %s\n", argv[a]);
+            return 1;
+        }
+    }
+    return 0;
+}
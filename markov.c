@@ -38,6 +38,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <sys/mman.h>
 #include "markov.h"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -68,6 +70,8 @@ Markov* initialize_M(int size) {
     //   updated in the matrix, which is important for the arithmetic that
     //   calculates the new values for a row given a state change from row i to 
     //   column j (see "update_matrix" for more info on this)
+    //   The version array counts every change to a row; unlike the helper it
+    //   wraps instead of saturating, so caches compare it to detect changes
     
     Markov* M = (Markov*)malloc(sizeof(Markov));
     if (M == NULL) {
@@ -78,6 +82,11 @@ Markov* initialize_M(int size) {
     // set the size
     M->size = size;
 
+    // every row gets its own allocation
+    M->storage = MARKOV_ROWS;
+    M->block = NULL;
+    M->block_len = 0;
+
     // Allocate memory for the matrix (2D array)
     M->matrix = (double**)malloc(size * sizeof(double*));
     if (M->matrix == NULL) {
@@ -99,9 +108,10 @@ Markov* initialize_M(int size) {
         }
     }
 
-    // Allocate memory for the helper array
+    // Allocate memory for the helper array and the row versions
     M->helper = (int*)calloc(size, sizeof(int)); // Initialize to 0
-    if (M->helper == NULL) {
+    M->version = (unsigned int*)calloc(size > 0 ? size : 1, sizeof(unsigned int));
+    if (M->helper == NULL || M->version == NULL) {
         perror("Failed to allocate memory for helper array");
         for (int i = 0; i < size; i++) {
             free(M->matrix[i]);
@@ -127,6 +137,10 @@ Markov* initialize_M(int size) {
 //
 // Returns:
 //    - 0 on success, -1 for invalid parameters
+//
+// NOTE:
+//    The helper count of a row stops at INT_MAX; markov_stable.h keeps
+//    64-bit counts for longer runs. M->version[i] advances on every update
 ///////////////////////////////////////////////////////////////////////////////
 int update_matrix(Markov* M, int i, int j) {
     // Step 1.
@@ -154,8 +168,12 @@ int update_matrix(Markov* M, int i, int j) {
     }
     
     // capture the current number of updates to the row in alpha before incrementing
-    // this value in the helper array
-    int alpha = M->helper[i]++;   
+    // this value in the helper array (which saturates instead of overflowing)
+    int alpha = M->helper[i];
+    if (alpha < INT_MAX) {
+        M->helper[i]++;
+    }
+    M->version[i]++;
     
     // multiply by the number of updates to have each cell represent the total
     // number of transitions from state i to state j (instead of probabilities)
@@ -168,7 +186,7 @@ int update_matrix(Markov* M, int i, int j) {
         }
         // divide by the new number of updates to have each index in the row
         // represent probabily of moving from state i to state j
-        M->matrix[i][k] = M->matrix[i][k] / (alpha + 1);
+        M->matrix[i][k] = M->matrix[i][k] / (alpha + 1.0);
     }
     return 0;
 }
@@ -300,14 +318,21 @@ Markov* matrix_mult(Markov* M1, Markov* M2) {
 void free_M(Markov* M) {
     if (M == NULL) return;
 
-    // Free the matrix
-    for (int i = 0; i < M->size; i++) {
-        free(M->matrix[i]);
+    // Free the matrix (rows that share one mapped block are unmapped at once)
+    if (M->storage == MARKOV_ROWS) {
+        for (int i = 0; i < M->size; i++) {
+            free(M->matrix[i]);
+        }
+    } else {
+        munmap(M->block, M->block_len);
     }
     free(M->matrix);
 
-    // Free the helper array
-    free(M->helper);
+    // Free the helper array (a mapped file holds its own, unmapped above)
+    if (M->storage != MARKOV_FILE) {
+        free(M->helper);
+    }
+    free(M->version);
 
     // Free the structure itself
     free(M);
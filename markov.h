@@ -30,13 +30,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+// How the rows of the matrix were allocated, so free_M knows how to release
+// them
+typedef enum MarkovStorage {
+    MARKOV_ROWS = 0, // each row allocated separately (initialize_M)
+    MARKOV_BLOCK,    // all rows in one mmap'd block (see markov_huge.h)
+    MARKOV_HUGETLB,  // all rows in one block of explicit huge pages
+    MARKOV_FILE,     // helper and rows in a mapped file (see markov_mmap.h,
+                     // markov_shm.h)
+    MARKOV_POOLED    // helper and rows in a registry slot, owned by the
+                     // registry and never passed to free_M (markov_registry.h)
+} MarkovStorage;
+
 // The Markov structure contains the probability matrix, the helper array
 // to keep track of the number of updates for each row, and the size as an
 // attribute
 typedef struct Markov {
     double** matrix; // 2D array for Markov Chain matrix
     int* helper;     // 1D array to track the number of updates to each row
+    unsigned int* version; // Per-row change counter (wraps, never saturates)
     int size;        // The size of the matrix (Markov matrix will be size x size)
+    MarkovStorage storage; // How the rows of the matrix were allocated
+    void* block;     // Block holding every row (NULL for MARKOV_ROWS)
+    size_t block_len; // Length of the block in bytes
 } Markov;
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -67,6 +83,10 @@ Markov* initialize_M(int size);
 //
 // Returns:
 //    - 0 on success, -1 for invalid parameters
+//
+// NOTE:
+//    The helper count of a row stops at INT_MAX; markov_stable.h keeps
+//    64-bit counts for longer runs. M->version[i] advances on every update
 ///////////////////////////////////////////////////////////////////////////////
 int update_matrix(Markov* M, int i, int j);
 
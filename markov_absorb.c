@@ -0,0 +1,619 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_absorb.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the absorbing chain analysis.
+//
+//   The solvers first restrict the problem to the transient states that can
+//   reach a target (a reverse search over the nonzero entries), so the system
+//   I - Q is nonsingular. For hitting times the states that can also reach a
+//   state with no path to a target are removed too (a second reverse search):
+//   they miss the targets with positive probability, so their expected
+//   hitting time is infinite. The remaining states reach a target with
+//   probability 1 and only move between themselves and the targets.
+//
+//   The LU factorization is right-looking and blocked by LU_BLOCK columns. A
+//   panel of columns is factored with partial pivoting (swapping whole rows),
+//   the matching block row of U is solved, and the remaining rows are updated
+//   with the panel in column tiles that stay in cache. The trailing update is
+//   where nearly all of the work is, and it is split by rows across threads.
+//
+// Usage:
+//   Include this source code by using #include "markov_absorb.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "markov_absorb.h"
+
+#define LU_BLOCK 64      // columns per panel
+#define LU_TILE 256      // columns per tile of the trailing update
+
+// Allocates memory or exits the program, the same way initialize_M handles a
+// failed allocation
+static void* absorb_alloc(size_t bytes) {
+    void* ptr = calloc(bytes > 0 ? bytes : 1, 1);
+    if (ptr == NULL) {
+        perror("Failed to allocate memory for absorbing chain analysis");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+// Fills is_target from the target list, returning -1 on an invalid index
+static int mark_targets(int n, const int* targets, int n_targets, char* is_target) {
+    if (targets == NULL || n_targets < 1) {
+        fprintf(stderr, "At least one target state is required.\n");
+        return -1;
+    }
+    for (int k = 0; k < n_targets; k++) {
+        if (targets[k] < 0 || targets[k] >= n) {
+            fprintf(stderr, "invalid target index %d given size of %d.\n", targets[k], n);
+            return -1;
+        }
+        is_target[targets[k]] = 1;
+    }
+    return 0;
+}
+
+// Searches backwards over the nonzero entries from the states marked in
+// `mark`, marking every state with a path into them. States flagged in
+// `skip` (may be NULL) are never marked, so paths cannot pass through them
+static void search_back_dense(Markov* M, const char* skip, char* mark) {
+    int n = M->size;
+    int* queue = (int*)absorb_alloc(n * sizeof(int));
+    int head = 0;
+    int tail = 0;
+    for (int i = 0; i < n; i++) {
+        if (mark[i]) {
+            queue[tail++] = i;
+        }
+    }
+    while (head < tail) {
+        int t = queue[head++];
+        for (int i = 0; i < n; i++) {
+            if (!mark[i] && (skip == NULL || !skip[i]) && M->matrix[i][t] != 0.0) {
+                mark[i] = 1;
+                queue[tail++] = i;
+            }
+        }
+    }
+    free(queue);
+}
+
+// Work of one thread in the trailing update of the LU factorization
+typedef struct LuUpdate {
+    double* A;
+    int n;
+    int kb;          // first column of the panel
+    int nb;          // width of the panel
+    int row_begin;
+    int row_end;
+} LuUpdate;
+
+// A[r][c] -= sum over the panel columns k of A[r][k] * A[k][c], for the rows
+// of this thread and every column right of the panel, one tile at a time so
+// the block row of U being read stays in cache
+static void* lu_update_rows(void* arg) {
+    LuUpdate* w = (LuUpdate*)arg;
+    int n = w->n;
+    int c0 = w->kb + w->nb;
+    for (int cb = c0; cb < n; cb += LU_TILE) {
+        int ce = cb + LU_TILE < n ? cb + LU_TILE : n;
+        for (int r = w->row_begin; r < w->row_end; r++) {
+            double* ar = w->A + (size_t)r * n;
+            for (int k = w->kb; k < c0; k++) {
+                double l = ar[k];
+                if (l == 0.0) {
+                    continue;
+                }
+                const double* ak = w->A + (size_t)k * n;
+                for (int c = cb; c < ce; c++) {
+                    ar[c] -= l * ak[c];
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+// Factors the n x n row major matrix A in place into P A = L U (L unit lower
+// triangular), recording the row swapped with row k in piv[k]. Returns -1 if
+// a zero pivot is found
+static int lu_factor(double* A, int n, int* piv, int num_threads) {
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    LuUpdate* work = (LuUpdate*)absorb_alloc(num_threads * sizeof(LuUpdate));
+    pthread_t* threads = (pthread_t*)absorb_alloc(num_threads * sizeof(pthread_t));
+
+    for (int kb = 0; kb < n; kb += LU_BLOCK) {
+        int nb = kb + LU_BLOCK < n ? LU_BLOCK : n - kb;
+        int ke = kb + nb;
+
+        // factor the panel (columns kb .. ke - 1) with partial pivoting
+        for (int k = kb; k < ke; k++) {
+            int p = k;
+            double best = fabs(A[(size_t)k * n + k]);
+            for (int r = k + 1; r < n; r++) {
+                double v = fabs(A[(size_t)r * n + k]);
+                if (v > best) {
+                    best = v;
+                    p = r;
+                }
+            }
+            piv[k] = p;
+            if (best == 0.0) {
+                free(work);
+                free(threads);
+                return -1;
+            }
+            if (p != k) {
+                double* rk = A + (size_t)k * n;
+                double* rp = A + (size_t)p * n;
+                for (int c = 0; c < n; c++) {
+                    double tmp = rk[c];
+                    rk[c] = rp[c];
+                    rp[c] = tmp;
+                }
+            }
+            const double* ak = A + (size_t)k * n;
+            for (int r = k + 1; r < n; r++) {
+                double* ar = A + (size_t)r * n;
+                ar[k] /= ak[k];
+                double l = ar[k];
+                for (int c = k + 1; c < ke; c++) {
+                    ar[c] -= l * ak[c];
+                }
+            }
+        }
+        if (ke == n) {
+            break;
+        }
+
+        // block row of U: solve L11 U12 = A12
+        for (int k = kb; k < ke; k++) {
+            const double* ak = A + (size_t)k * n;
+            for (int r = k + 1; r < ke; r++) {
+                double* ar = A + (size_t)r * n;
+                double l = ar[k];
+                for (int c = ke; c < n; c++) {
+                    ar[c] -= l * ak[c];
+                }
+            }
+        }
+
+        // trailing update A22 -= L21 U12, split by rows; small updates are
+        // not worth starting threads for
+        int rows = n - ke;
+        int nt = (long)rows * (n - ke) < 128L * 128 ? 1 : num_threads;
+        if (nt > rows) {
+            nt = rows;
+        }
+        for (int t = 0; t < nt; t++) {
+            work[t].A = A;
+            work[t].n = n;
+            work[t].kb = kb;
+            work[t].nb = nb;
+            work[t].row_begin = ke + (int)((long)rows * t / nt);
+            work[t].row_end = ke + (int)((long)rows * (t + 1) / nt);
+        }
+        for (int t = 1; t < nt; t++) {
+            if (pthread_create(&threads[t], NULL, lu_update_rows, &work[t]) != 0) {
+                perror("Failed to create worker thread");
+                exit(EXIT_FAILURE);
+            }
+        }
+        lu_update_rows(&work[0]);
+        for (int t = 1; t < nt; t++) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+
+    free(work);
+    free(threads);
+    return 0;
+}
+
+// Solves A X = B in place for the n x nrhs row major B, given the factors of
+// lu_factor
+static void lu_solve(const double* A, int n, const int* piv, double* B, int nrhs) {
+    for (int k = 0; k < n; k++) {
+        if (piv[k] != k) {
+            double* bk = B + (size_t)k * nrhs;
+            double* bp = B + (size_t)piv[k] * nrhs;
+            for (int c = 0; c < nrhs; c++) {
+                double tmp = bk[c];
+                bk[c] = bp[c];
+                bp[c] = tmp;
+            }
+        }
+    }
+    // forward substitution with the unit lower triangle
+    for (int r = 1; r < n; r++) {
+        double* br = B + (size_t)r * nrhs;
+        const double* ar = A + (size_t)r * n;
+        for (int k = 0; k < r; k++) {
+            double l = ar[k];
+            if (l == 0.0) {
+                continue;
+            }
+            const double* bk = B + (size_t)k * nrhs;
+            for (int c = 0; c < nrhs; c++) {
+                br[c] -= l * bk[c];
+            }
+        }
+    }
+    // back substitution with the upper triangle
+    for (int r = n - 1; r >= 0; r--) {
+        double* br = B + (size_t)r * nrhs;
+        const double* ar = A + (size_t)r * n;
+        for (int k = r + 1; k < n; k++) {
+            double u = ar[k];
+            if (u == 0.0) {
+                continue;
+            }
+            const double* bk = B + (size_t)k * nrhs;
+            for (int c = 0; c < nrhs; c++) {
+                br[c] -= u * bk[c];
+            }
+        }
+        for (int c = 0; c < nrhs; c++) {
+            br[c] /= ar[r];
+        }
+    }
+}
+
+// Builds I - Q for the states in list (m of them, in order) and solves
+// (I - Q) X = B in place. Returns -1 if the system is singular
+static int solve_transient(Markov* M, const int* list, int m, double* B, int nrhs, int num_threads) {
+    double* A = (double*)absorb_alloc((size_t)m * m * sizeof(double));
+    int* piv = (int*)absorb_alloc(m * sizeof(int));
+    for (int a = 0; a < m; a++) {
+        const double* row = M->matrix[list[a]];
+        double* ar = A + (size_t)a * m;
+        for (int b = 0; b < m; b++) {
+            ar[b] = -row[list[b]];
+        }
+        ar[a] += 1.0;
+    }
+
+    int status = lu_factor(A, m, piv, num_threads);
+    if (status == 0) {
+        lu_solve(A, m, piv, B, nrhs);
+    }
+    free(A);
+    free(piv);
+    return status;
+}
+
+// Marks the starting points of the second search: states with no path to a
+// target
+static void mark_unreachable(int n, const char* reach, char* bad) {
+    for (int i = 0; i < n; i++) {
+        bad[i] = !reach[i];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// hitting_times(Markov* M, const int* targets, int n_targets, double* times,
+//               int num_threads)
+//
+//  Computes the expected number of steps from every state until one of the
+//  target states is first reached
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - targets: Array of n_targets target state indices
+//    - n_targets: Number of target states
+//    - times: Array of M->size entries receiving the expected steps (0 for a
+//             target, INFINITY if the targets may never be reached)
+//    - num_threads: number of threads used by the LU factorization
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int hitting_times(Markov* M, const int* targets, int n_targets, double* times, int num_threads) {
+    // Step 1.
+    //   Mark the targets and the states that can reach them
+    // Step 2.
+    //   Mark the states that can reach a state with no path to a target
+    //   without passing through a target first
+    // Step 3.
+    //   Solve (I - Q) t = 1 on the remaining transient states
+    // Step 4.
+    //   Fill in 0 for targets and INFINITY for every other state
+
+    if (M == NULL || M->matrix == NULL || times == NULL) {
+        fprintf(stderr, "Invalid Markov structure.\n");
+        return -1;
+    }
+
+    int n = M->size;
+    char* is_target = (char*)absorb_alloc(n);
+    char* reach = (char*)absorb_alloc(n);
+    char* bad = (char*)absorb_alloc(n);
+    int* list = (int*)absorb_alloc(n * sizeof(int));
+    double* x = (double*)absorb_alloc(n * sizeof(double));
+    if (mark_targets(n, targets, n_targets, is_target) != 0) {
+        free(is_target);
+        free(reach);
+        free(bad);
+        free(list);
+        free(x);
+        return -1;
+    }
+    memcpy(reach, is_target, n);
+    search_back_dense(M, NULL, reach);
+    mark_unreachable(n, reach, bad);
+    search_back_dense(M, is_target, bad);
+
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        if (reach[i] && !bad[i] && !is_target[i]) {
+            list[m] = i;
+            x[m] = 1.0;
+            m++;
+        }
+    }
+    int status = solve_transient(M, list, m, x, 1, num_threads);
+
+    for (int i = 0; i < n; i++) {
+        times[i] = is_target[i] ? 0.0 : INFINITY;
+    }
+    for (int a = 0; a < m && status == 0; a++) {
+        times[list[a]] = x[a];
+    }
+
+    free(is_target);
+    free(reach);
+    free(bad);
+    free(list);
+    free(x);
+    if (status != 0) {
+        fprintf(stderr, "Singular system while computing hitting times.\n");
+    }
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// absorption_probs(Markov* M, const int* targets, int n_targets,
+//                  double* probs, int num_threads)
+//
+//  Computes, for every state, the probability that each target is the first
+//  target reached
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - targets: Array of n_targets target state indices
+//    - n_targets: Number of target states
+//    - probs: Array of M->size * n_targets entries (row major) receiving the
+//             probability that state i first reaches targets[k] at
+//             probs[i * n_targets + k]
+//    - num_threads: number of threads used by the LU factorization
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int absorption_probs(Markov* M, const int* targets, int n_targets, double* probs, int num_threads) {
+    if (M == NULL || M->matrix == NULL || probs == NULL) {
+        fprintf(stderr, "Invalid Markov structure.\n");
+        return -1;
+    }
+
+    int n = M->size;
+    char* is_target = (char*)absorb_alloc(n);
+    char* reach = (char*)absorb_alloc(n);
+    int* list = (int*)absorb_alloc(n * sizeof(int));
+    if (mark_targets(n, targets, n_targets, is_target) != 0) {
+        free(is_target);
+        free(reach);
+        free(list);
+        return -1;
+    }
+    memcpy(reach, is_target, n);
+    search_back_dense(M, NULL, reach);
+
+    // one right hand side per target: B[:, k] = M[list][targets[k]], over the
+    // transient states that can reach a target
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        if (reach[i] && !is_target[i]) {
+            list[m++] = i;
+        }
+    }
+    double* B = (double*)absorb_alloc((size_t)m * n_targets * sizeof(double));
+    for (int a = 0; a < m; a++) {
+        for (int k = 0; k < n_targets; k++) {
+            B[(size_t)a * n_targets + k] = M->matrix[list[a]][targets[k]];
+        }
+    }
+    int status = solve_transient(M, list, m, B, n_targets, num_threads);
+
+    memset(probs, 0, (size_t)n * n_targets * sizeof(double));
+    for (int k = 0; k < n_targets; k++) {
+        probs[(size_t)targets[k] * n_targets + k] = 1.0;
+    }
+    for (int a = 0; a < m && status == 0; a++) {
+        memcpy(probs + (size_t)list[a] * n_targets, B + (size_t)a * n_targets,
+               n_targets * sizeof(double));
+    }
+
+    free(is_target);
+    free(reach);
+    free(list);
+    free(B);
+    if (status != 0) {
+        fprintf(stderr, "Singular system while computing absorption probabilities.\n");
+    }
+    return status;
+}
+
+// Transposed nonzero structure of a sparse chain: the predecessors of state
+// j are row_idx[col_ptr[j] .. col_ptr[j + 1] - 1]
+typedef struct Predecessors {
+    long* col_ptr;
+    int* row_idx;
+} Predecessors;
+
+static Predecessors build_predecessors(SparseMarkov* S) {
+    int n = S->size;
+    Predecessors P;
+    P.col_ptr = (long*)absorb_alloc((n + 1) * sizeof(long));
+    P.row_idx = (int*)absorb_alloc(S->nnz * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        for (long p = S->row_ptr[i]; p < S->row_ptr[i + 1]; p++) {
+            if (S->values[p] != 0.0) {
+                P.col_ptr[S->col_idx[p] + 1]++;
+            }
+        }
+    }
+    for (int j = 0; j < n; j++) {
+        P.col_ptr[j + 1] += P.col_ptr[j];
+    }
+    long* fill = (long*)absorb_alloc(n * sizeof(long));
+    memcpy(fill, P.col_ptr, n * sizeof(long));
+    for (int i = 0; i < n; i++) {
+        for (long p = S->row_ptr[i]; p < S->row_ptr[i + 1]; p++) {
+            if (S->values[p] != 0.0) {
+                P.row_idx[fill[S->col_idx[p]]++] = i;
+            }
+        }
+    }
+    free(fill);
+    return P;
+}
+
+// Same as search_back_dense, using the predecessor lists of a sparse chain
+static void search_back_sparse(int n, Predecessors* P, const char* skip, char* mark) {
+    int* queue = (int*)absorb_alloc(n * sizeof(int));
+    int head = 0;
+    int tail = 0;
+    for (int i = 0; i < n; i++) {
+        if (mark[i]) {
+            queue[tail++] = i;
+        }
+    }
+    while (head < tail) {
+        int t = queue[head++];
+        for (long p = P->col_ptr[t]; p < P->col_ptr[t + 1]; p++) {
+            int i = P->row_idx[p];
+            if (!mark[i] && (skip == NULL || !skip[i])) {
+                mark[i] = 1;
+                queue[tail++] = i;
+            }
+        }
+    }
+    free(queue);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// hitting_times_iterative(SparseMarkov* S, const int* targets, int n_targets,
+//                         double* times, double tol, int max_iter)
+//
+//  Same as hitting_times for a sparse chain, using Gauss-Seidel iteration
+//  instead of a factorization. Each sweep costs one pass over the nonzeros.
+//
+// Parameters:
+//    - S: Pointer to the SparseMarkov structure
+//    - targets: Array of n_targets target state indices
+//    - n_targets: Number of target states
+//    - times: Array of S->size entries receiving the expected steps
+//    - tol: Iteration stops when no estimate changes by more than tol
+//    - max_iter: Maximum number of sweeps
+//
+// Returns:
+//    - The number of sweeps performed on success, -1 for invalid parameters
+//      or if the iteration did not converge within max_iter sweeps (times
+//      then holds the last estimates)
+///////////////////////////////////////////////////////////////////////////////
+int hitting_times_iterative(SparseMarkov* S, const int* targets, int n_targets,
+                            double* times, double tol, int max_iter) {
+    // Step 1.
+    //   Mark the states that reach a target with probability 1, exactly like
+    //   hitting_times, using the transposed nonzero structure
+    // Step 2.
+    //   Sweep t_i = (1 + sum_{j != i} S[i][j] t_j) / (1 - S[i][i]) over those
+    //   states (t = 0 on targets) until no estimate changes by more than tol
+
+    if (S == NULL || times == NULL) {
+        fprintf(stderr, "Invalid SparseMarkov structure.\n");
+        return -1;
+    }
+
+    int n = S->size;
+    char* is_target = (char*)absorb_alloc(n);
+    char* reach = (char*)absorb_alloc(n);
+    char* bad = (char*)absorb_alloc(n);
+    int* list = (int*)absorb_alloc(n * sizeof(int));
+    if (mark_targets(n, targets, n_targets, is_target) != 0) {
+        free(is_target);
+        free(reach);
+        free(bad);
+        free(list);
+        return -1;
+    }
+    Predecessors P = build_predecessors(S);
+    memcpy(reach, is_target, n);
+    search_back_sparse(n, &P, NULL, reach);
+    mark_unreachable(n, reach, bad);
+    search_back_sparse(n, &P, is_target, bad);
+
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        times[i] = 0.0;
+        if (reach[i] && !bad[i] && !is_target[i]) {
+            list[m++] = i;
+        }
+    }
+
+    int sweeps = -1;
+    for (int iter = 1; iter <= max_iter && sweeps < 0; iter++) {
+        double change = 0.0;
+        for (int a = 0; a < m; a++) {
+            int i = list[a];
+            double sum = 1.0;
+            double diag = 0.0;
+            for (long p = S->row_ptr[i]; p < S->row_ptr[i + 1]; p++) {
+                int j = S->col_idx[p];
+                if (j == i) {
+                    diag = S->values[p];
+                } else {
+                    sum += S->values[p] * times[j];  // 0 for targets
+                }
+            }
+            double v = sum / (1.0 - diag);
+            if (fabs(v - times[i]) > change) {
+                change = fabs(v - times[i]);
+            }
+            times[i] = v;
+        }
+        if (change <= tol) {
+            sweeps = iter;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (!is_target[i] && (!reach[i] || bad[i])) {
+            times[i] = INFINITY;
+        }
+    }
+
+    free(is_target);
+    free(reach);
+    free(bad);
+    free(list);
+    free(P.col_ptr);
+    free(P.row_idx);
+    if (sweeps < 0) {
+        fprintf(stderr, "Gauss-Seidel did not converge within %d sweeps.\n", max_iter);
+    }
+    return sweeps;
+}
@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_absorb.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_absorb.c absorbing chain analysis. Given a set
+//   of target states (e.g. the page a process is waiting to reach), the
+//   targets are treated as absorbing and the remaining states as transient.
+//   With Q the transient part of the matrix:
+//
+//      expected steps to reach a target:   (I - Q) t = 1
+//      probability of ending in target k:  (I - Q) B = R[:, k]
+//
+//   where R holds the one-step probabilities from transient states into the
+//   targets. The dense solvers use a cache-blocked LU factorization with
+//   partial pivoting whose trailing updates are split across threads; the
+//   sparse solver uses Gauss-Seidel iteration on the CSR view.
+//
+// Usage:
+//   Include this header by using #include "markov_absorb.h" and use the
+//   functions below
+//
+// NOTE:
+//   A state that can fail to reach the targets (it may end up in a closed set
+//   of states without targets, or in a row that was never updated) has an
+//   infinite expected hitting time, reported as INFINITY
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_ABSORB
+#define MARKOV_ABSORB
+
+#include "markov.h"
+#include "markov_sparse.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// hitting_times(Markov* M, const int* targets, int n_targets, double* times,
+//               int num_threads)
+//
+//  Computes the expected number of steps from every state until one of the
+//  target states is first reached
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - targets: Array of n_targets target state indices
+//    - n_targets: Number of target states
+//    - times: Array of M->size entries receiving the expected steps (0 for a
+//             target, INFINITY if the targets may never be reached)
+//    - num_threads: number of threads used by the LU factorization
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int hitting_times(Markov* M, const int* targets, int n_targets, double* times, int num_threads);
+
+///////////////////////////////////////////////////////////////////////////////
+// absorption_probs(Markov* M, const int* targets, int n_targets,
+//                  double* probs, int num_threads)
+//
+//  Computes, for every state, the probability that each target is the first
+//  target reached
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - targets: Array of n_targets target state indices
+//    - n_targets: Number of target states
+//    - probs: Array of M->size * n_targets entries (row major) receiving the
+//             probability that state i first reaches targets[k] at
+//             probs[i * n_targets + k]
+//    - num_threads: number of threads used by the LU factorization
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int absorption_probs(Markov* M, const int* targets, int n_targets, double* probs, int num_threads);
+
+///////////////////////////////////////////////////////////////////////////////
+// hitting_times_iterative(SparseMarkov* S, const int* targets, int n_targets,
+//                         double* times, double tol, int max_iter)
+//
+//  Same as hitting_times for a sparse chain, using Gauss-Seidel iteration
+//  instead of a factorization. Each sweep costs one pass over the nonzeros.
+//
+// Parameters:
+//    - S: Pointer to the SparseMarkov structure
+//    - targets: Array of n_targets target state indices
+//    - n_targets: Number of target states
+//    - times: Array of S->size entries receiving the expected steps
+//    - tol: Iteration stops when no estimate changes by more than tol
+//    - max_iter: Maximum number of sweeps
+//
+// Returns:
+//    - The number of sweeps performed on success, -1 for invalid parameters
+//      or if the iteration did not converge within max_iter sweeps (times
+//      then holds the last estimates)
+///////////////////////////////////////////////////////////////////////////////
+int hitting_times_iterative(SparseMarkov* S, const int* targets, int n_targets,
+                            double* times, double tol, int max_iter);
+
+#endif
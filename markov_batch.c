@@ -0,0 +1,218 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_batch.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the batched prediction query. Each
+//   requested row is scanned once with AVX2 compare/blend kernels that track
+//   the best value and its index in four lanes (the first best value wins in
+//   each lane, then the lanes are reduced with ties going to the smallest
+//   index, which keeps the "leftmost on tie" rule of max_prob_idx). While a
+//   row is scanned, the matching cache lines of the next requested row are
+//   prefetched, so the rows of a batch stream from memory back to back.
+//
+// Usage:
+//   Include this source code by using #include "markov_batch.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "markov_batch.h"
+#include "markov_simd.h"
+
+// number of doubles in a 64 byte cache line
+#define LINE_DOUBLES 8
+
+#ifdef __AVX2__
+
+// Reduces the four lanes of a max (sign = 1) or min (sign = -1) search to a
+// single index, preferring the smallest index among equal values
+static inline int reduce_lanes(__m256d best, __m256d best_i, int sign, double* out_val) {
+    double vals[4];
+    double idxs[4];
+    _mm256_storeu_pd(vals, best);
+    _mm256_storeu_pd(idxs, best_i);
+    double v = vals[0];
+    int idx = (int)idxs[0];
+    for (int l = 1; l < 4; l++) {
+        int better = sign > 0 ? vals[l] > v : vals[l] < v;
+        if (better || (vals[l] == v && (int)idxs[l] < idx)) {
+            v = vals[l];
+            idx = (int)idxs[l];
+        }
+    }
+    *out_val = v;
+    return idx;
+}
+
+// Scans one row for its argmax, prefetching the same offsets of `next`
+static int scan_max(const double* row, const double* next, int n) {
+    if (n < 8) {
+        return simd_argmax(row, n);
+    }
+    __m256d best = _mm256_loadu_pd(row);
+    __m256d idx = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+    __m256d best_i = idx;
+    const __m256d step = _mm256_set1_pd(4.0);
+    if (next != NULL) {
+        __builtin_prefetch(next, 0, 3);
+    }
+    int j;
+    for (j = 4; j + 4 <= n; j += 4) {
+        if (next != NULL && (j & (LINE_DOUBLES - 1)) == 0) {
+            __builtin_prefetch(next + j, 0, 3);
+        }
+        __m256d v = _mm256_loadu_pd(row + j);
+        idx = _mm256_add_pd(idx, step);
+        __m256d gt = _mm256_cmp_pd(v, best, _CMP_GT_OQ);
+        best = _mm256_blendv_pd(best, v, gt);
+        best_i = _mm256_blendv_pd(best_i, idx, gt);
+    }
+    double best_val;
+    int best_idx = reduce_lanes(best, best_i, 1, &best_val);
+    for (; j < n; j++) {
+        if (row[j] > best_val) {
+            best_val = row[j];
+            best_idx = j;
+        }
+    }
+    if (next != NULL) {
+        __builtin_prefetch(next + n - 1, 0, 3);
+    }
+    return best_idx;
+}
+
+// Scans one row for both its argmax and argmin in a single pass
+static void scan_max_min(const double* row, const double* next, int n, int* max_idx, int* min_idx) {
+    if (n < 8) {
+        *max_idx = simd_argmax(row, n);
+        *min_idx = simd_argmin(row, n);
+        return;
+    }
+    __m256d first = _mm256_loadu_pd(row);
+    __m256d idx = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+    __m256d hi = first;
+    __m256d lo = first;
+    __m256d hi_i = idx;
+    __m256d lo_i = idx;
+    const __m256d step = _mm256_set1_pd(4.0);
+    if (next != NULL) {
+        __builtin_prefetch(next, 0, 3);
+    }
+    int j;
+    for (j = 4; j + 4 <= n; j += 4) {
+        if (next != NULL && (j & (LINE_DOUBLES - 1)) == 0) {
+            __builtin_prefetch(next + j, 0, 3);
+        }
+        __m256d v = _mm256_loadu_pd(row + j);
+        idx = _mm256_add_pd(idx, step);
+        __m256d gt = _mm256_cmp_pd(v, hi, _CMP_GT_OQ);
+        __m256d lt = _mm256_cmp_pd(v, lo, _CMP_LT_OQ);
+        hi = _mm256_blendv_pd(hi, v, gt);
+        hi_i = _mm256_blendv_pd(hi_i, idx, gt);
+        lo = _mm256_blendv_pd(lo, v, lt);
+        lo_i = _mm256_blendv_pd(lo_i, idx, lt);
+    }
+    double hi_val;
+    double lo_val;
+    int hi_idx = reduce_lanes(hi, hi_i, 1, &hi_val);
+    int lo_idx = reduce_lanes(lo, lo_i, -1, &lo_val);
+    for (; j < n; j++) {
+        if (row[j] > hi_val) {
+            hi_val = row[j];
+            hi_idx = j;
+        }
+        if (row[j] < lo_val) {
+            lo_val = row[j];
+            lo_idx = j;
+        }
+    }
+    if (next != NULL) {
+        __builtin_prefetch(next + n - 1, 0, 3);
+    }
+    *max_idx = hi_idx;
+    *min_idx = lo_idx;
+}
+
+#else
+
+// Without AVX2 the scalar kernels are used, with a prefetch of the next row
+static int scan_max(const double* row, const double* next, int n) {
+    if (next != NULL) {
+        for (int j = 0; j < n; j += LINE_DOUBLES) {
+            __builtin_prefetch(next + j, 0, 3);
+        }
+    }
+    return simd_argmax(row, n);
+}
+
+static void scan_max_min(const double* row, const double* next, int n, int* max_idx, int* min_idx) {
+    *max_idx = scan_max(row, next, n);
+    *min_idx = simd_argmin(row, n);
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// batch_prob_idx(Markov* M, const int* rows, int count, int* max_out,
+//                int* min_out)
+//
+//  Finds the index of the maximum (and optionally minimum) probability in
+//  each of the requested rows of the Markov matrix.
+//
+// Parameters:
+//    - M: Pointer to the Markov structure.
+//    - rows: Array of `count` row indices to search.
+//    - count: Number of rows in the batch.
+//    - max_out: Array of `count` entries receiving max_prob_idx(M, rows[r])
+//    - min_out: Array of `count` entries receiving min_prob_idx(M, rows[r]),
+//               or NULL if only the maximum is needed
+//
+// Returns:
+//    - 0 on success
+//    - -1 if the input is invalid or any row index is out of bounds (the
+//      outputs for out of bounds rows are set to -1, the others are valid)
+//
+// NOTE:
+//    Returns the leftmost index in the event of a tie, like max_prob_idx and
+//    min_prob_idx
+///////////////////////////////////////////////////////////////////////////////
+int batch_prob_idx(Markov* M, const int* rows, int count, int* max_out, int* min_out) {
+    if (M == NULL || M->matrix == NULL || rows == NULL || max_out == NULL || count < 0) {
+        fprintf(stderr, "Invalid input for batch query.\n");
+        return -1;
+    }
+
+    int status = 0;
+    for (int r = 0; r < count; r++) {
+        int i = rows[r];
+        if (i < 0 || i >= M->size) {
+            max_out[r] = -1;
+            if (min_out != NULL) {
+                min_out[r] = -1;
+            }
+            status = -1;
+            continue;
+        }
+
+        // the next valid row of the batch is prefetched during this scan
+        const double* next = NULL;
+        if (r + 1 < count && rows[r + 1] >= 0 && rows[r + 1] < M->size) {
+            next = M->matrix[rows[r + 1]];
+        }
+
+        if (min_out != NULL) {
+            scan_max_min(M->matrix[i], next, M->size, &max_out[r], &min_out[r]);
+        } else {
+            max_out[r] = scan_max(M->matrix[i], next, M->size);
+        }
+    }
+
+    if (status != 0) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+    }
+    return status;
+}
@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_batch.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_batch.c batched prediction queries. When many
+//   states need a predicted successor at once (e.g. a burst of page faults),
+//   answering them in one call lets the rows be scanned with vectorized
+//   compare/blend kernels while the next requested row is prefetched.
+//
+// Usage:
+//   Include this header by using #include "markov_batch.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_BATCH
+#define MARKOV_BATCH
+
+#include "markov.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// batch_prob_idx(Markov* M, const int* rows, int count, int* max_out,
+//                int* min_out)
+//
+//  Finds the index of the maximum (and optionally minimum) probability in
+//  each of the requested rows of the Markov matrix.
+//
+// Parameters:
+//    - M: Pointer to the Markov structure.
+//    - rows: Array of `count` row indices to search.
+//    - count: Number of rows in the batch.
+//    - max_out: Array of `count` entries receiving max_prob_idx(M, rows[r])
+//    - min_out: Array of `count` entries receiving min_prob_idx(M, rows[r]),
+//               or NULL if only the maximum is needed
+//
+// Returns:
+//    - 0 on success
+//    - -1 if the input is invalid or any row index is out of bounds (the
+//      outputs for out of bounds rows are set to -1, the others are valid)
+//
+// NOTE:
+//    Returns the leftmost index in the event of a tie, like max_prob_idx and
+//    min_prob_idx
+///////////////////////////////////////////////////////////////////////////////
+int batch_prob_idx(Markov* M, const int* rows, int count, int* max_out, int* min_out);
+
+#endif
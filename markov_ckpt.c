@@ -0,0 +1,427 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_ckpt.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the incremental checkpoints. The log is
+//   a header (magic, size) followed by records:
+//
+//      int32 row | int32 helper | uint64 checksum | size doubles
+//
+//   The checksum covers the row index, the helper count and the contents, so
+//   a torn or garbled record is detected on replay. Checkpoints append with
+//   buffered writes and one fdatasync. A new or compacted log is written to
+//   "<path>.tmp", synced and renamed over the log (and the directory is
+//   synced), so a crash during compaction leaves either the old or the new
+//   log. A checkpoint whose append fails is cut back off the log, so a torn
+//   record never sits in front of later good ones.
+//
+// Usage:
+//   Include this source code by using #include "markov_ckpt.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "markov_ckpt.h"
+
+#define LOG_MAGIC "MARKOVL1"
+#define DEFAULT_COMPACT_FACTOR 4
+
+typedef struct LogHeader {
+    char magic[8];
+    int32_t size;
+    int32_t version;
+} LogHeader;
+
+typedef struct RecordHeader {
+    int32_t row;
+    int32_t helper;
+    uint64_t checksum;
+} RecordHeader;
+
+// Hashes a record one 64-bit word at a time
+static uint64_t record_checksum(int row, int helper, const double* values, int n) {
+    uint64_t h = 0xcbf29ce484222325ULL ^ ((uint64_t)(uint32_t)row << 32 | (uint32_t)helper);
+    h *= 0x100000001b3ULL;
+    for (int j = 0; j < n; j++) {
+        uint64_t word;
+        memcpy(&word, &values[j], sizeof(word));
+        h = (h ^ word) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+// Appends the record of row i. Returns 0 on success
+static int write_record(FILE* f, Markov* M, int i) {
+    RecordHeader r;
+    r.row = i;
+    r.helper = M->helper[i];
+    r.checksum = record_checksum(i, r.helper, M->matrix[i], M->size);
+    if (fwrite(&r, sizeof(r), 1, f) != 1 ||
+        fwrite(M->matrix[i], sizeof(double), M->size, f) != (size_t)M->size) {
+        return -1;
+    }
+    return 0;
+}
+
+// Flushes a stream all the way to the disk. Returns 0 on success
+static int flush_to_disk(FILE* f) {
+    if (fflush(f) != 0 || fdatasync(fileno(f)) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Syncs the directory holding path, so a rename into it is durable. Returns
+// 0 on success
+static int sync_parent_dir(const char* path) {
+    const char* slash = strrchr(path, '/');
+    char* dir = slash == NULL ? strdup(".") : strndup(path, slash == path ? 1 : slash - path);
+    if (dir == NULL) {
+        perror("Failed to allocate memory for log directory");
+        exit(EXIT_FAILURE);
+    }
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    free(dir);
+    if (fd < 0) {
+        return -1;
+    }
+    int status = fsync(fd);
+    close(fd);
+    return status;
+}
+
+// Writes a log holding every updated row to "<path>.tmp" and renames it over
+// the log, then reopens the log for appending. Returns 0 on success. Once the
+// rename is done the old stream points at an unlinked file, so it is closed
+// even on failure, and C->log stays NULL until a later call succeeds
+static int write_full_log(MarkovCheckpoint* C) {
+    Markov* M = C->M;
+    size_t len = strlen(C->path) + 5;
+    char* tmp = (char*)malloc(len);
+    if (tmp == NULL) {
+        perror("Failed to allocate memory for log path");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(tmp, len, "%s.tmp", C->path);
+
+    FILE* f = fopen(tmp, "wb");
+    if (f == NULL) {
+        perror("Failed to create checkpoint log");
+        free(tmp);
+        return -1;
+    }
+    LogHeader header;
+    memcpy(header.magic, LOG_MAGIC, 8);
+    header.size = M->size;
+    header.version = 1;
+    int status = fwrite(&header, sizeof(header), 1, f) == 1 ? 0 : -1;
+    long records = 0;
+    for (int i = 0; i < M->size && status == 0; i++) {
+        if (M->helper[i] > 0) {
+            status = write_record(f, M, i);
+            records++;
+        }
+    }
+    if (status == 0) {
+        status = flush_to_disk(f);
+    }
+    fclose(f);
+    if (status != 0 || rename(tmp, C->path) != 0) {
+        perror("Failed to write checkpoint log");
+        remove(tmp);
+        free(tmp);
+        return -1;
+    }
+    free(tmp);
+    if (C->log != NULL) {
+        fclose(C->log);
+        C->log = NULL;
+    }
+    if (sync_parent_dir(C->path) != 0) {
+        perror("Failed to sync checkpoint directory");
+        return -1;
+    }
+
+    C->log = fopen(C->path, "ab");
+    if (C->log == NULL) {
+        perror("Failed to reopen checkpoint log");
+        return -1;
+    }
+    for (int i = 0; i < M->size; i++) {
+        C->saved[i] = M->version[i];
+    }
+    C->records = records;
+    return 0;
+}
+
+static MarkovCheckpoint* alloc_checkpoint(Markov* M, const char* path) {
+    MarkovCheckpoint* C = (MarkovCheckpoint*)malloc(sizeof(MarkovCheckpoint));
+    if (C == NULL) {
+        perror("Failed to allocate memory for MarkovCheckpoint structure");
+        exit(EXIT_FAILURE);
+    }
+    C->M = M;
+    C->log = NULL;
+    C->path = strdup(path);
+    C->saved = (unsigned int*)calloc(M->size + 1, sizeof(unsigned int));
+    if (C->path == NULL || C->saved == NULL) {
+        perror("Failed to allocate memory for checkpoint");
+        exit(EXIT_FAILURE);
+    }
+    C->records = 0;
+    C->compact_factor = DEFAULT_COMPACT_FACTOR;
+    C->compact_failures = 0;
+    return C;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint_create(Markov* M, const char* path)
+//
+//  Starts a new log for M, replacing any existing file, and writes every
+//  row updated so far
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - path: Path of the log
+//
+// Returns:
+//    Pointer to the newly allocated MarkovCheckpoint structure, or NULL if
+//    the log could not be written
+///////////////////////////////////////////////////////////////////////////////
+MarkovCheckpoint* checkpoint_create(Markov* M, const char* path) {
+    if (M == NULL || M->matrix == NULL || path == NULL) {
+        fprintf(stderr, "Invalid Markov structure or log path.\n");
+        return NULL;
+    }
+
+    MarkovCheckpoint* C = alloc_checkpoint(M, path);
+    if (write_full_log(C) != 0) {
+        checkpoint_close(C);
+        return NULL;
+    }
+    return C;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint_resume(const char* path)
+//
+//  Rebuilds a chain from a log and continues appending to it. A torn record
+//  at the end of the log is discarded
+//
+// Parameters:
+//    - path: Path of the log
+//
+// Returns:
+//    Pointer to the newly allocated MarkovCheckpoint structure (the chain is
+//    C->M), or NULL if the log is missing or is not a checkpoint log
+///////////////////////////////////////////////////////////////////////////////
+MarkovCheckpoint* checkpoint_resume(const char* path) {
+    // Step 1.
+    //   Check the header and create an empty chain of the logged size
+    // Step 2.
+    //   Apply the records in order until the end of the log or the first
+    //   record that is incomplete or fails its checksum
+    // Step 3.
+    //   Cut the log after the last good record and reopen it for appending
+
+    if (path == NULL) {
+        fprintf(stderr, "Invalid log path.\n");
+        return NULL;
+    }
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        perror("Failed to open checkpoint log");
+        return NULL;
+    }
+    LogHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, LOG_MAGIC, 8) != 0 ||
+        header.version != 1 || header.size < 1) {
+        fprintf(stderr, "%s is not a checkpoint log.\n", path);
+        fclose(f);
+        return NULL;
+    }
+
+    Markov* M = initialize_M(header.size);
+    MarkovCheckpoint* C = alloc_checkpoint(M, path);
+    double* row = (double*)malloc(header.size * sizeof(double));
+    if (row == NULL) {
+        perror("Failed to allocate memory for log record");
+        exit(EXIT_FAILURE);
+    }
+
+    long good = (long)sizeof(header);
+    RecordHeader r;
+    while (fread(&r, sizeof(r), 1, f) == 1) {
+        if (r.row < 0 || r.row >= header.size ||
+            fread(row, sizeof(double), header.size, f) != (size_t)header.size ||
+            r.checksum != record_checksum(r.row, r.helper, row, header.size)) {
+            break;  // torn or garbled tail
+        }
+        memcpy(M->matrix[r.row], row, header.size * sizeof(double));
+        M->helper[r.row] = r.helper;
+        M->version[r.row]++;
+        C->saved[r.row] = M->version[r.row];
+        C->records++;
+        good = ftell(f);
+    }
+    free(row);
+    fclose(f);
+
+    if (truncate(path, good) != 0) {
+        perror("Failed to discard torn checkpoint record");
+    }
+    C->log = fopen(path, "ab");
+    if (C->log == NULL) {
+        perror("Failed to reopen checkpoint log");
+        checkpoint_close(C);
+        free_M(M);
+        return NULL;
+    }
+    return C;
+}
+
+// Cuts the log back to the length it had before a failed checkpoint and
+// reopens it for appending, dropping whatever part of the checkpoint was
+// buffered or written. Falls back to rewriting the whole log if the cut
+// fails. Returns 0 if the log ends on a good record again
+static int rollback_log(MarkovCheckpoint* C, off_t start) {
+    fclose(C->log);   // may still write part of the buffer, cut below
+    C->log = NULL;
+    if (truncate(C->path, start) == 0) {
+        C->log = fopen(C->path, "ab");
+        if (C->log != NULL && flush_to_disk(C->log) == 0) {
+            return 0;
+        }
+        if (C->log != NULL) {
+            fclose(C->log);
+            C->log = NULL;
+        }
+    }
+    return write_full_log(C);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint_save(MarkovCheckpoint* C)
+//
+//  Appends the rows updated since the last checkpoint and flushes the log to
+//  disk, compacting it if it has grown past compact_factor
+//
+// Returns:
+//    - The number of rows written, or -1 if the log could not be written
+//
+// NOTE:
+//    A failed checkpoint is cut back off the log (or, if that fails, the log
+//    is rewritten whole), so no torn record is left in front of later ones.
+//    A failed compaction after a successful append does not fail the save;
+//    it adds one to C->compact_failures and is retried by the next save
+///////////////////////////////////////////////////////////////////////////////
+long checkpoint_save(MarkovCheckpoint* C) {
+    // Step 1.
+    //   Remember where the log ends (a log left closed by an earlier failure
+    //   is rewritten first)
+    // Step 2.
+    //   Append a record for every row whose version differs from the saved
+    //   one, and flush the log to disk
+    // Step 3.
+    //   On any failure, cut the log back to where it ended. Only once the
+    //   flush succeeded, record the new versions as saved
+    // Step 4.
+    //   Compact the log if it has grown past compact_factor (a failure is
+    //   counted in compact_failures, not returned)
+
+    if (C == NULL) {
+        fprintf(stderr, "Invalid checkpoint.\n");
+        return -1;
+    }
+    if (C->log == NULL && write_full_log(C) != 0) {
+        return -1;
+    }
+
+    Markov* M = C->M;
+    off_t start = lseek(fileno(C->log), 0, SEEK_END);
+    if (start < 0) {
+        perror("Failed to find the end of the checkpoint log");
+        return -1;
+    }
+    long written = 0;
+    long logged = 0;
+    int status = 0;
+    for (int i = 0; i < M->size; i++) {
+        if (status == 0 && M->version[i] != C->saved[i]) {
+            status = write_record(C->log, M, i);
+            written++;
+        }
+        if (M->helper[i] > 0) {
+            logged++;
+        }
+    }
+    if (status == 0) {
+        status = flush_to_disk(C->log);
+    }
+    if (status != 0) {
+        perror("Failed to append to checkpoint log");
+        rollback_log(C, start);
+        return -1;
+    }
+    for (int i = 0; i < M->size; i++) {
+        C->saved[i] = M->version[i];
+    }
+    C->records += written;
+
+    // the appended rows are on disk either way, so a failed compaction is
+    // only counted (the next save retries it)
+    if (C->records > (long)C->compact_factor * logged && checkpoint_compact(C) != 0) {
+        fprintf(stderr, "Checkpoint log compaction failed, keeping the appended rows.\n");
+        C->compact_failures++;
+    }
+    return written;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint_compact(MarkovCheckpoint* C)
+//
+//  Rewrites the log with one record per updated row (the current contents
+//  of the chain) and atomically replaces the old log
+//
+// Returns:
+//    - 0 on success, -1 if the new log could not be written or synced. If
+//      the new log was not yet renamed over the old one, the old log is kept
+//      and still appended to; otherwise the log is left closed and the next
+//      checkpoint_save rewrites it whole
+///////////////////////////////////////////////////////////////////////////////
+int checkpoint_compact(MarkovCheckpoint* C) {
+    if (C == NULL) {
+        fprintf(stderr, "Invalid checkpoint.\n");
+        return -1;
+    }
+    return write_full_log(C);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint_close(MarkovCheckpoint* C)
+//
+//  Closes the log and frees the MarkovCheckpoint structure. Rows updated
+//  since the last checkpoint_save are not written. The chain is not freed
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void checkpoint_close(MarkovCheckpoint* C) {
+    if (C == NULL) return;
+
+    if (C->log != NULL) {
+        fclose(C->log);
+    }
+    free(C->path);
+    free(C->saved);
+    free(C);
+}
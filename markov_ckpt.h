@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_ckpt.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_ckpt.c incremental checkpoints. Instead of
+//   writing the whole chain at every checkpoint, only the rows updated since
+//   the previous checkpoint are appended to a log, so the cost of a
+//   checkpoint follows the churn rather than the size of the model. A row is
+//   dirty when its version (M->version, which keeps advancing after the
+//   helper count saturates) differs from the one it had when it was last
+//   written.
+//
+//   Each record holds the row index, its helper count, its contents and a
+//   checksum. Replaying the log from the start, the last record of each row
+//   wins. A record cut short by a crash fails its checksum and ends the
+//   replay; every complete record before it is kept (rows of an unfinished
+//   checkpoint may thus be newer than others, but each row is intact).
+//
+//   When the log grows past compact_factor records per updated row, it is
+//   compacted: one record per updated row is written to a temporary file,
+//   which then atomically replaces the log.
+//
+// Usage:
+//   Include this header by using #include "markov_ckpt.h" and use the
+//   functions below:
+//
+//      MarkovCheckpoint* C = checkpoint_create(M, "model.log");
+//      ... update_matrix(M, i, j) ...
+//      checkpoint_save(C);               // appends the dirty rows
+//
+//   and on restart:
+//
+//      MarkovCheckpoint* C = checkpoint_resume("model.log");
+//      Markov* M = C->M;
+//
+// NOTE:
+//   checkpoint_close() does not free the chain, including a chain created by
+//   checkpoint_resume(), which then belongs to the caller
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_CKPT
+#define MARKOV_CKPT
+
+#include <stdio.h>
+#include "markov.h"
+
+// The MarkovCheckpoint structure holds the log being appended to and the
+// version each row had when it was last written
+typedef struct MarkovCheckpoint {
+    Markov* M;              // chain being checkpointed
+    FILE* log;              // log file, positioned at its end (NULL until rewritten)
+    char* path;             // path of the log
+    unsigned int* saved;    // version of each row in the log
+    long records;           // row records in the log
+    int compact_factor;     // compact when records > factor * logged rows
+    long compact_failures;  // compactions that failed after a successful save
+} MarkovCheckpoint;
+
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint_create(Markov* M, const char* path)
+//
+//  Starts a new log for M, replacing any existing file, and writes every
+//  row updated so far
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - path: Path of the log
+//
+// Returns:
+//    Pointer to the newly allocated MarkovCheckpoint structure, or NULL if
+//    the log could not be written
+///////////////////////////////////////////////////////////////////////////////
+MarkovCheckpoint* checkpoint_create(Markov* M, const char* path);
+
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint_resume(const char* path)
+//
+//  Rebuilds a chain from a log and continues appending to it. A torn record
+//  at the end of the log is discarded
+//
+// Parameters:
+//    - path: Path of the log
+//
+// Returns:
+//    Pointer to the newly allocated MarkovCheckpoint structure (the chain is
+//    C->M), or NULL if the log is missing or is not a checkpoint log
+///////////////////////////////////////////////////////////////////////////////
+MarkovCheckpoint* checkpoint_resume(const char* path);
+
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint_save(MarkovCheckpoint* C)
+//
+//  Appends the rows updated since the last checkpoint and flushes the log to
+//  disk, compacting it if it has grown past compact_factor
+//
+// Returns:
+//    - The number of rows written, or -1 if the log could not be written
+//
+// NOTE:
+//    A failed checkpoint is cut back off the log (or, if that fails, the log
+//    is rewritten whole), so no torn record is left in front of later ones.
+//    A failed compaction after a successful append does not fail the save;
+//    it adds one to C->compact_failures and is retried by the next save
+///////////////////////////////////////////////////////////////////////////////
+long checkpoint_save(MarkovCheckpoint* C);
+
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint_compact(MarkovCheckpoint* C)
+//
+//  Rewrites the log with one record per updated row (the current contents
+//  of the chain) and atomically replaces the old log
+//
+// Returns:
+//    - 0 on success, -1 if the new log could not be written or synced. If
+//      the new log was not yet renamed over the old one, the old log is kept
+//      and still appended to; otherwise the log is left closed and the next
+//      checkpoint_save rewrites it whole
+///////////////////////////////////////////////////////////////////////////////
+int checkpoint_compact(MarkovCheckpoint* C);
+
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint_close(MarkovCheckpoint* C)
+//
+//  Closes the log and frees the MarkovCheckpoint structure. Rows updated
+//  since the last checkpoint_save are not written. The chain is not freed
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void checkpoint_close(MarkovCheckpoint* C);
+
+#endif
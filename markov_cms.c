@@ -0,0 +1,399 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_cms.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the sketched chain. A transition (i, j)
+//   is hashed once into a 64-bit key, and each sketch row d maps the key
+//   mixed with its own seed to a counter with a multiply-shift range
+//   reduction (no division, any width). A conservative update reads the d
+//   counters, and raises to min + 1 only those still below it.
+//
+//   The new estimate of (i, j) is then offered to the candidates of the
+//   bucket owned by i: an existing candidate just records it, a free slot
+//   takes j, and otherwise j replaces the candidate with the smallest
+//   recorded estimate if its own estimate is larger. Recorded estimates only go stale
+//   downwards (sketch counters never decrease), so a query re-reads the
+//   sketch for each candidate before choosing.
+//
+//   A state that gives up its bucket leaves its transitions in the sketch.
+//   Its total goes into a second, smaller Count-Min sketch (depth rows of
+//   `buckets` counters, raised to at least the total), and the state takes
+//   that estimate back as its starting total when it claims a bucket again,
+//   so counts and total keep covering the same updates.
+//
+// Usage:
+//   Include this source code by using #include "markov_cms.h" and use the
+//   functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the allocated memory for the
+//   sketch (see the function "free_sketch" below)
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "markov_cms.h"
+
+#define BUCKET_SEED 0x243f6a8885a308d3ULL
+#define PAST_SEED 0x13198a2e03707344ULL
+
+// splitmix64 finalizer
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Maps a hash uniformly onto [0, n)
+static inline uint32_t reduce(uint64_t h, uint32_t n) {
+    return (uint32_t)(((h >> 32) * n) >> 32);
+}
+
+static inline uint64_t pair_key(int64_t i, int64_t j) {
+    return mix64((uint64_t)i ^ mix64((uint64_t)j + 0x9e3779b97f4a7c15ULL));
+}
+
+// First bucket of the set state i hashes to
+static inline int set_of(const SketchMarkov* SK, int64_t i) {
+    uint32_t sets = (uint32_t)(SK->buckets / SKETCH_WAYS);
+    return (int)reduce(mix64((uint64_t)i ^ BUCKET_SEED), sets) * SKETCH_WAYS;
+}
+
+// Returns the bucket owned by state i, or -1
+static inline int find_bucket(const SketchMarkov* SK, int64_t i) {
+    int set = set_of(SK, i);
+    for (int w = 0; w < SKETCH_WAYS; w++) {
+        if (SK->row_id[set + w] == i) {
+            return set + w;
+        }
+    }
+    return -1;
+}
+
+// Counter of sketch row d holding the past total of state i
+static inline uint32_t* past_slot(const SketchMarkov* SK, int d, int64_t i) {
+    uint64_t h = mix64((uint64_t)i ^ PAST_SEED ^ SK->seeds[d]);
+    return &SK->past_total[(size_t)d * SK->buckets + reduce(h, (uint32_t)SK->buckets)];
+}
+
+// Records the total of a state giving up its bucket, raising its counters
+// to at least that total (the total already counts any earlier ones)
+static void save_past_total(SketchMarkov* SK, int64_t i, uint32_t total) {
+    for (int d = 0; d < SK->depth; d++) {
+        uint32_t* c = past_slot(SK, d, i);
+        if (*c < total) {
+            *c = total;
+        }
+    }
+}
+
+// Estimated updates of state i before it last gave up a bucket (0 if it
+// never did, up to collisions)
+static uint32_t past_total(const SketchMarkov* SK, int64_t i) {
+    uint32_t min = UINT32_MAX;
+    for (int d = 0; d < SK->depth; d++) {
+        uint32_t c = *past_slot(SK, d, i);
+        if (c < min) {
+            min = c;
+        }
+    }
+    return min;
+}
+
+// Current estimate of a transition from its hashed key
+static uint32_t estimate(const SketchMarkov* SK, uint64_t key) {
+    uint32_t min = UINT32_MAX;
+    for (int d = 0; d < SK->depth; d++) {
+        uint32_t c = SK->table[(size_t)d * SK->width + reduce(mix64(key ^ SK->seeds[d]), SK->width)];
+        if (c < min) {
+            min = c;
+        }
+    }
+    return min;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_sketch(int width, int depth, int buckets, int candidates)
+//
+//  Initializes an empty sketched chain. Memory is fixed by the parameters:
+//  4 * width * depth bytes for the sketch plus 12 * (1 + candidates) +
+//  4 * depth bytes per bucket
+//
+// Parameters:
+//    - width: counters per sketch row (larger = fewer collisions)
+//    - depth: number of hash functions (larger = lower failure probability)
+//    - buckets: number of states whose candidates are kept at once (rounded
+//               up to a multiple of SKETCH_WAYS)
+//    - candidates: candidate successors kept per state
+//
+// Returns:
+//    Pointer to the newly allocated SketchMarkov structure, or NULL if a
+//    parameter is < 1
+///////////////////////////////////////////////////////////////////////////////
+SketchMarkov* initialize_sketch(int width, int depth, int buckets, int candidates) {
+    if (width < 1 || depth < 1 || buckets < 1 || candidates < 1) {
+        fprintf(stderr, "Invalid sketch dimensions (width %d, depth %d, buckets %d, candidates %d).\n",
+                width, depth, buckets, candidates);
+        return NULL;
+    }
+
+    SketchMarkov* SK = (SketchMarkov*)malloc(sizeof(SketchMarkov));
+    if (SK == NULL) {
+        perror("Failed to allocate memory for SketchMarkov structure");
+        exit(EXIT_FAILURE);
+    }
+    SK->width = width;
+    SK->depth = depth;
+    SK->buckets = (buckets + SKETCH_WAYS - 1) / SKETCH_WAYS * SKETCH_WAYS;
+    buckets = SK->buckets;
+    SK->candidates = candidates;
+
+    size_t slots = (size_t)buckets * candidates;
+    SK->table = (uint32_t*)calloc((size_t)width * depth, sizeof(uint32_t));
+    SK->seeds = (uint64_t*)malloc(depth * sizeof(uint64_t));
+    SK->row_id = (int64_t*)malloc(buckets * sizeof(int64_t));
+    SK->row_total = (uint32_t*)calloc(buckets, sizeof(uint32_t));
+    SK->past_total = (uint32_t*)calloc((size_t)depth * buckets, sizeof(uint32_t));
+    SK->cand = (int64_t*)malloc(slots * sizeof(int64_t));
+    SK->cand_est = (uint32_t*)calloc(slots, sizeof(uint32_t));
+    if (SK->table == NULL || SK->seeds == NULL || SK->row_id == NULL ||
+        SK->row_total == NULL || SK->past_total == NULL || SK->cand == NULL ||
+        SK->cand_est == NULL) {
+        perror("Failed to allocate memory for sketch");
+        exit(EXIT_FAILURE);
+    }
+
+    // fixed seeds keep the estimates reproducible from run to run
+    for (int d = 0; d < depth; d++) {
+        SK->seeds[d] = mix64(BUCKET_SEED + (uint64_t)(d + 1) * 0x9e3779b97f4a7c15ULL);
+    }
+    for (int b = 0; b < buckets; b++) {
+        SK->row_id[b] = -1;
+    }
+    for (size_t s = 0; s < slots; s++) {
+        SK->cand[s] = -1;
+    }
+    return SK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sketch_update(SketchMarkov* SK, int64_t i, int64_t j)
+//
+//  Records a transition from state i to state j, like update_matrix
+//
+// Returns:
+//    - 0 on success, -1 for negative state ids
+///////////////////////////////////////////////////////////////////////////////
+int sketch_update(SketchMarkov* SK, int64_t i, int64_t j) {
+    // Step 1.
+    //   Conservative update of the sketch counters of (i, j)
+    // Step 2.
+    //   Find the bucket of i, or claim a free one of its set, or the one of
+    //   the set whose state has the fewest updates. The state giving it up
+    //   saves its total, and i starts from its own saved total, since the
+    //   sketch counters of its transitions still hold those updates
+    // Step 3.
+    //   Offer j and its new estimate to the candidates of the bucket
+
+    if (SK == NULL || i < 0 || j < 0) {
+        fprintf(stderr, "invalid i, j state ids ( %lld, %lld ).\n", (long long)i, (long long)j);
+        return -1;
+    }
+
+    uint64_t key = pair_key(i, j);
+    uint32_t* slot[SK->depth];
+    uint32_t min = UINT32_MAX;
+    for (int d = 0; d < SK->depth; d++) {
+        slot[d] = &SK->table[(size_t)d * SK->width + reduce(mix64(key ^ SK->seeds[d]), SK->width)];
+        if (*slot[d] < min) {
+            min = *slot[d];
+        }
+    }
+    uint32_t est = min < UINT32_MAX ? min + 1 : min;
+    for (int d = 0; d < SK->depth; d++) {
+        if (*slot[d] < est) {
+            *slot[d] = est;
+        }
+    }
+
+    int b = find_bucket(SK, i);
+    if (b < 0) {
+        int set = set_of(SK, i);
+        b = set;
+        for (int w = 0; w < SKETCH_WAYS; w++) {
+            if (SK->row_id[set + w] < 0) {
+                b = set + w;
+                break;
+            }
+            if (SK->row_total[set + w] < SK->row_total[b]) {
+                b = set + w;
+            }
+        }
+        if (SK->row_id[b] >= 0) {
+            save_past_total(SK, SK->row_id[b], SK->row_total[b]);
+        }
+        SK->row_id[b] = i;
+        SK->row_total[b] = past_total(SK, i);
+        for (int c = 0; c < SK->candidates; c++) {
+            SK->cand[(size_t)b * SK->candidates + c] = -1;
+            SK->cand_est[(size_t)b * SK->candidates + c] = 0;
+        }
+    }
+    int64_t* cand = SK->cand + (size_t)b * SK->candidates;
+    uint32_t* cand_est = SK->cand_est + (size_t)b * SK->candidates;
+    if (SK->row_total[b] < UINT32_MAX) {
+        SK->row_total[b]++;
+    }
+
+    int weakest = 0;
+    for (int c = 0; c < SK->candidates; c++) {
+        if (cand[c] == j) {
+            cand_est[c] = est;
+            return 0;
+        }
+        if (cand[c] < 0) {
+            cand[c] = j;
+            cand_est[c] = est;
+            return 0;
+        }
+        if (cand_est[c] < cand_est[weakest]) {
+            weakest = c;
+        }
+    }
+    if (est > cand_est[weakest]) {
+        cand[weakest] = j;
+        cand_est[weakest] = est;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sketch_count(SketchMarkov* SK, int64_t i, int64_t j)
+//
+//  Estimates the number of transitions from state i to state j
+//
+// Returns:
+//    - The estimated count (never below the true count), or 0 for invalid ids
+///////////////////////////////////////////////////////////////////////////////
+uint32_t sketch_count(SketchMarkov* SK, int64_t i, int64_t j) {
+    if (SK == NULL || i < 0 || j < 0) {
+        fprintf(stderr, "Invalid input or negative state id.\n");
+        return 0;
+    }
+    return estimate(SK, pair_key(i, j));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sketch_prob(SketchMarkov* SK, int64_t i, int64_t j)
+//
+//  Estimates the probability of the transition from state i to state j
+//
+// Returns:
+//    - The estimated probability, 0 if state i does not own its bucket, or
+//      -1 for invalid ids
+//
+// NOTE:
+//    After a state claims a bucket again its total restarts from the saved
+//    estimate, which collisions can only raise: its probabilities may then
+//    be slightly low, never inflated by its earlier transitions
+///////////////////////////////////////////////////////////////////////////////
+double sketch_prob(SketchMarkov* SK, int64_t i, int64_t j) {
+    if (SK == NULL || i < 0 || j < 0) {
+        fprintf(stderr, "Invalid input or negative state id.\n");
+        return -1.0;
+    }
+
+    int b = find_bucket(SK, i);
+    if (b < 0) {
+        return 0.0;
+    }
+    // collisions may push a count above the row total (exact while the
+    // state has kept its bucket)
+    uint32_t count = estimate(SK, pair_key(i, j));
+    uint32_t total = SK->row_total[b];
+    return count >= total ? 1.0 : (double)count / total;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sketch_max_prob_idx(SketchMarkov* SK, int64_t i)
+//
+//  Finds the candidate successor of state i with the largest estimated count
+//
+// Returns:
+//    - The successor id, like max_prob_idx
+//    - -1 if the id is invalid or state i has no candidates (never updated,
+//      or its bucket was taken over by another state)
+//
+// NOTE:
+//    Returns the earliest candidate in the event of a tie
+///////////////////////////////////////////////////////////////////////////////
+int64_t sketch_max_prob_idx(SketchMarkov* SK, int64_t i) {
+    if (SK == NULL || i < 0) {
+        fprintf(stderr, "Invalid input or negative state id.\n");
+        return -1;
+    }
+
+    int b = find_bucket(SK, i);
+    if (b < 0) {
+        return -1;
+    }
+    const int64_t* cand = SK->cand + (size_t)b * SK->candidates;
+    int64_t best = -1;
+    uint32_t best_est = 0;
+    for (int c = 0; c < SK->candidates && cand[c] >= 0; c++) {
+        uint32_t est = estimate(SK, pair_key(i, cand[c]));
+        if (best < 0 || est > best_est) {
+            best = cand[c];
+            best_est = est;
+        }
+    }
+    return best;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sketch_memory(SketchMarkov* SK)
+//
+//  Counts the bytes used by the sketched chain
+//
+// Returns:
+//    - The number of bytes allocated for the structure and its arrays
+///////////////////////////////////////////////////////////////////////////////
+size_t sketch_memory(SketchMarkov* SK) {
+    if (SK == NULL) {
+        return 0;
+    }
+    size_t slots = (size_t)SK->buckets * SK->candidates;
+    return sizeof(SketchMarkov) +
+           (size_t)SK->width * SK->depth * sizeof(uint32_t) +
+           (size_t)SK->depth * sizeof(uint64_t) +
+           (size_t)SK->buckets * (sizeof(int64_t) + sizeof(uint32_t)) +
+           (size_t)SK->depth * SK->buckets * sizeof(uint32_t) +
+           slots * (sizeof(int64_t) + sizeof(uint32_t));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_sketch(SketchMarkov* SK)
+//
+//  Frees the memory allocated for the SketchMarkov structure.
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_sketch(SketchMarkov* SK) {
+    if (SK == NULL) return;
+
+    free(SK->table);
+    free(SK->seeds);
+    free(SK->row_id);
+    free(SK->row_total);
+    free(SK->past_total);
+    free(SK->cand);
+    free(SK->cand_est);
+    free(SK);
+}
@@ -0,0 +1,150 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_cms.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_cms.c sketched chain, an approximate
+//   transition model of fixed size for state ids that have no upper bound
+//   (any nonnegative 64-bit id). Transition counts (i -> j) are estimated by
+//   a Count-Min sketch of `depth` rows of `width` counters updated
+//   conservatively (only the counters holding the current minimum are
+//   raised), which never undercounts and overcounts by a few collisions.
+//
+//   To answer "most likely successor of i" without enumerating every j, each
+//   state owns one of `buckets` row buckets holding its id, its number of
+//   updates and up to `candidates` candidate successors. A successor whose
+//   estimate beats the weakest candidate replaces it. Buckets are grouped in
+//   sets of SKETCH_WAYS; a state hashes to one set, and when the set is full
+//   the state with the fewest updates gives up its bucket. Its total is kept
+//   in a small sketch of its own, and restored when the state claims a
+//   bucket again, so its probabilities stay count / total over all of its
+//   updates (its candidates start over).
+//
+// Usage:
+//   Include this header by using #include "markov_cms.h" and use the
+//   functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the allocated memory for the
+//   sketch (see the function "free_sketch" below)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_CMS
+#define MARKOV_CMS
+
+#include <stdint.h>
+#include <stddef.h>
+
+// number of buckets a state may use (buckets of a set)
+#define SKETCH_WAYS 4
+
+// The SketchMarkov structure holds the counters of the sketch and the row
+// buckets with their candidate successors
+typedef struct SketchMarkov {
+    uint32_t* table;      // depth x width counters, row major
+    uint64_t* seeds;      // hash seed of each sketch row
+    int64_t* row_id;      // state owning each bucket (-1 if unused)
+    uint32_t* row_total;  // updates to the owning state of each bucket
+    uint32_t* past_total; // depth x buckets counters, totals of states that gave up a bucket
+    int64_t* cand;        // buckets x candidates successor ids (-1 if unused)
+    uint32_t* cand_est;   // estimated count of each candidate when last seen
+    int width;            // counters per sketch row
+    int depth;            // number of sketch rows (hash functions)
+    int buckets;          // number of row buckets
+    int candidates;       // candidate successors per bucket
+} SketchMarkov;
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_sketch(int width, int depth, int buckets, int candidates)
+//
+//  Initializes an empty sketched chain. Memory is fixed by the parameters:
+//  4 * width * depth bytes for the sketch plus 12 * (1 + candidates) +
+//  4 * depth bytes per bucket
+//
+// Parameters:
+//    - width: counters per sketch row (larger = fewer collisions)
+//    - depth: number of hash functions (larger = lower failure probability)
+//    - buckets: number of states whose candidates are kept at once (rounded
+//               up to a multiple of SKETCH_WAYS)
+//    - candidates: candidate successors kept per state
+//
+// Returns:
+//    Pointer to the newly allocated SketchMarkov structure, or NULL if a
+//    parameter is < 1
+///////////////////////////////////////////////////////////////////////////////
+SketchMarkov* initialize_sketch(int width, int depth, int buckets, int candidates);
+
+///////////////////////////////////////////////////////////////////////////////
+// sketch_update(SketchMarkov* SK, int64_t i, int64_t j)
+//
+//  Records a transition from state i to state j, like update_matrix
+//
+// Returns:
+//    - 0 on success, -1 for negative state ids
+///////////////////////////////////////////////////////////////////////////////
+int sketch_update(SketchMarkov* SK, int64_t i, int64_t j);
+
+///////////////////////////////////////////////////////////////////////////////
+// sketch_count(SketchMarkov* SK, int64_t i, int64_t j)
+//
+//  Estimates the number of transitions from state i to state j
+//
+// Returns:
+//    - The estimated count (never below the true count), or 0 for invalid ids
+///////////////////////////////////////////////////////////////////////////////
+uint32_t sketch_count(SketchMarkov* SK, int64_t i, int64_t j);
+
+///////////////////////////////////////////////////////////////////////////////
+// sketch_prob(SketchMarkov* SK, int64_t i, int64_t j)
+//
+//  Estimates the probability of the transition from state i to state j
+//
+// Returns:
+//    - The estimated probability, 0 if state i does not own a bucket, or
+//      -1 for invalid ids
+//
+// NOTE:
+//    After a state claims a bucket again its total restarts from the saved
+//    estimate, which collisions can only raise: its probabilities may then
+//    be slightly low, never inflated by its earlier transitions
+///////////////////////////////////////////////////////////////////////////////
+double sketch_prob(SketchMarkov* SK, int64_t i, int64_t j);
+
+///////////////////////////////////////////////////////////////////////////////
+// sketch_max_prob_idx(SketchMarkov* SK, int64_t i)
+//
+//  Finds the candidate successor of state i with the largest estimated count
+//
+// Returns:
+//    - The successor id, like max_prob_idx
+//    - -1 if the id is invalid or state i has no candidates (never updated,
+//      or its bucket was given to another state)
+//
+// NOTE:
+//    Returns the earliest candidate in the event of a tie
+///////////////////////////////////////////////////////////////////////////////
+int64_t sketch_max_prob_idx(SketchMarkov* SK, int64_t i);
+
+///////////////////////////////////////////////////////////////////////////////
+// sketch_memory(SketchMarkov* SK)
+//
+//  Counts the bytes used by the sketched chain
+//
+// Returns:
+//    - The number of bytes allocated for the structure and its arrays
+///////////////////////////////////////////////////////////////////////////////
+size_t sketch_memory(SketchMarkov* SK);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_sketch(SketchMarkov* SK)
+//
+//  Frees the memory allocated for the SketchMarkov structure.
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_sketch(SketchMarkov* SK);
+
+#endif
@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_delta.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the delta-encoded chains. With E the
+//   exact range, the states are laid out as:
+//
+//      0 .. 2E                 deltas -E .. +E
+//      2E + 1 + (b - 1)        positive deltas of bit length b (> E)
+//      2E + 1 + 64 + (b - 1)   negative deltas of magnitude bit length b
+//
+//   Deltas are taken modulo 2^64, so any two pages have a delta.
+//
+// Usage:
+//   Include this source code by using #include "markov_delta.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "markov_delta.h"
+
+#define MAX_EXACT_RANGE (1 << 12)
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_delta(int exact_range)
+//
+//  Creates an empty delta chain
+//
+// Parameters:
+//    - exact_range: Largest delta (in pages, either direction) given a state
+//                   of its own
+//
+// Returns:
+//    Pointer to the newly allocated DeltaMarkov structure, or NULL if
+//    exact_range is negative or too large
+///////////////////////////////////////////////////////////////////////////////
+DeltaMarkov* initialize_delta(int exact_range) {
+    if (exact_range < 0 || exact_range > MAX_EXACT_RANGE) {
+        fprintf(stderr, "Invalid exact range %d.\n", exact_range);
+        return NULL;
+    }
+
+    DeltaMarkov* D = (DeltaMarkov*)malloc(sizeof(DeltaMarkov));
+    if (D == NULL) {
+        perror("Failed to allocate memory for DeltaMarkov structure");
+        exit(EXIT_FAILURE);
+    }
+    int exact_states = 2 * exact_range + 1;
+    int size = exact_states + 2 * DELTA_BUCKETS;
+    D->M = initialize_M(size);
+    D->exact_range = exact_range;
+    D->predicted = (int64_t*)malloc(size * sizeof(int64_t));
+    if (D->predicted == NULL) {
+        perror("Failed to allocate memory for predicted deltas");
+        exit(EXIT_FAILURE);
+    }
+
+    // until a bucket sees a delta, it predicts the middle of its range
+    for (int s = 0; s < exact_states; s++) {
+        D->predicted[s] = s - exact_range;
+    }
+    for (int b = 1; b <= DELTA_BUCKETS; b++) {
+        uint64_t middle = b == 1 ? 1 : (uint64_t)3 << (b - 2);
+        D->predicted[exact_states + b - 1] = (int64_t)middle;
+        D->predicted[exact_states + DELTA_BUCKETS + b - 1] = -(int64_t)middle;
+    }
+    D->last_page = 0;
+    D->last_state = -1;
+    D->pages = 0;
+    return D;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// delta_state(DeltaMarkov* D, int64_t delta)
+//
+// Returns:
+//    - The state of a delta: its own state if it is small, else the state of
+//      its sign and bit length
+///////////////////////////////////////////////////////////////////////////////
+int delta_state(DeltaMarkov* D, int64_t delta) {
+    int exact = D->exact_range;
+    if (delta >= -exact && delta <= exact) {
+        return (int)delta + exact;
+    }
+    uint64_t magnitude = delta > 0 ? (uint64_t)delta : 0 - (uint64_t)delta;
+    int bits = 64 - __builtin_clzll(magnitude);
+    return 2 * exact + 1 + (delta > 0 ? 0 : DELTA_BUCKETS) + bits - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// delta_observe(DeltaMarkov* D, uint64_t page)
+//
+//  Records an access: the delta from the previous page selects the current
+//  state, and the transition from the previous delta state is added to the
+//  chain with update_matrix
+//
+// Returns:
+//    - The state of the new delta, or -1 for the first page
+///////////////////////////////////////////////////////////////////////////////
+int delta_observe(DeltaMarkov* D, uint64_t page) {
+    if (D == NULL) {
+        fprintf(stderr, "Invalid DeltaMarkov structure.\n");
+        return -1;
+    }
+
+    if (D->pages++ == 0) {
+        D->last_page = page;
+        return -1;
+    }
+    int64_t delta = (int64_t)(page - D->last_page);
+    int state = delta_state(D, delta);
+    D->predicted[state] = delta;   // a bucket predicts its latest delta
+    if (D->last_state >= 0) {
+        update_matrix(D->M, D->last_state, state);
+    }
+    D->last_state = state;
+    D->last_page = page;
+    return state;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// delta_predict(DeltaMarkov* D)
+//
+//  Predicts the next page: the most probable next delta state (max_prob_idx
+//  of the current state) translated back to a page
+//
+// Returns:
+//    - The predicted page, or -1 if the current state has no transitions yet
+///////////////////////////////////////////////////////////////////////////////
+int64_t delta_predict(DeltaMarkov* D) {
+    if (D == NULL || D->last_state < 0 || D->M->helper[D->last_state] == 0) {
+        return -1;
+    }
+    int next = max_prob_idx(D->M, D->last_state);
+    return (int64_t)(D->last_page + (uint64_t)D->predicted[next]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_delta(DeltaMarkov* D)
+//
+//  Frees the chain and the DeltaMarkov structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_delta(DeltaMarkov* D) {
+    if (D == NULL) return;
+
+    free_M(D->M);
+    free(D->predicted);
+    free(D);
+}
@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_delta.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_delta.c delta-encoded chains. Instead of one
+//   state per page, the states are the deltas between consecutive pages, so
+//   a sequential or strided scan over millions of pages is a single state
+//   ("+1 page") that predicts itself.
+//
+//   Small deltas, up to exact_range pages in either direction, each have
+//   their own state. Larger deltas are bucketed by sign and bit length
+//   (e.g. +4096..+8191 pages); a bucket predicts the last delta that fell
+//   into it, so a repeated large stride is still predicted exactly. The
+//   chain has 2 * exact_range + 1 + 128 states whatever the address range.
+//
+//   The transitions between delta states are kept in an ordinary Markov
+//   structure (D->M), updated with update_matrix and usable with every
+//   query of markov.h.
+//
+// Usage:
+//   Include this header by using #include "markov_delta.h" and use the
+//   functions below:
+//
+//      DeltaMarkov* D = initialize_delta(16);
+//      delta_observe(D, page);                  // on every access
+//      int64_t next = delta_predict(D);         // page to prefetch
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_DELTA
+#define MARKOV_DELTA
+
+#include <stdint.h>
+#include "markov.h"
+
+#define DELTA_BUCKETS 64   // bit lengths of a large delta, per sign
+
+// The DeltaMarkov structure holds the chain over delta states, the delta
+// each state predicts, and the last page and delta observed
+typedef struct DeltaMarkov {
+    Markov* M;            // transitions between delta states
+    int exact_range;      // deltas in [-exact_range, exact_range] are exact
+    int64_t* predicted;   // delta predicted by each state
+    uint64_t last_page;   // most recent page (valid once pages > 0)
+    int last_state;       // state of the most recent delta (-1 if none)
+    long pages;           // pages observed
+} DeltaMarkov;
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_delta(int exact_range)
+//
+//  Creates an empty delta chain
+//
+// Parameters:
+//    - exact_range: Largest delta (in pages, either direction) given a state
+//                   of its own
+//
+// Returns:
+//    Pointer to the newly allocated DeltaMarkov structure, or NULL if
+//    exact_range is negative or too large
+///////////////////////////////////////////////////////////////////////////////
+DeltaMarkov* initialize_delta(int exact_range);
+
+///////////////////////////////////////////////////////////////////////////////
+// delta_state(DeltaMarkov* D, int64_t delta)
+//
+// Returns:
+//    - The state of a delta: its own state if it is small, else the state of
+//      its sign and bit length
+///////////////////////////////////////////////////////////////////////////////
+int delta_state(DeltaMarkov* D, int64_t delta);
+
+///////////////////////////////////////////////////////////////////////////////
+// delta_observe(DeltaMarkov* D, uint64_t page)
+//
+//  Records an access: the delta from the previous page selects the current
+//  state, and the transition from the previous delta state is added to the
+//  chain with update_matrix
+//
+// Returns:
+//    - The state of the new delta, or -1 for the first page
+///////////////////////////////////////////////////////////////////////////////
+int delta_observe(DeltaMarkov* D, uint64_t page);
+
+///////////////////////////////////////////////////////////////////////////////
+// delta_predict(DeltaMarkov* D)
+//
+//  Predicts the next page: the most probable next delta state (max_prob_idx
+//  of the current state) translated back to a page
+//
+// Returns:
+//    - The predicted page, or -1 if the current state has no transitions yet
+///////////////////////////////////////////////////////////////////////////////
+int64_t delta_predict(DeltaMarkov* D);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_delta(DeltaMarkov* D)
+//
+//  Frees the chain and the DeltaMarkov structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_delta(DeltaMarkov* D);
+
+#endif
@@ -0,0 +1,404 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_export.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the bulk export. A value v in [0, 1e9)
+//   is formatted from v * 10^decimals, which is at most one rounding away
+//   from the exact product, so its rounded integer is the one printf gives
+//   unless the product is within 1e-6 of a half; those, and values outside
+//   the fast range, are formatted with snprintf.
+//
+//   The rows are cut into blocks of about EXPORT_BLOCK_BYTES of output. In
+//   each round, thread t formats block t into its own growing buffer, and
+//   once all threads are joined the buffers are written in order.
+//
+// Usage:
+//   Include this source code by using #include "markov_export.h" and use
+//   the functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "markov_export.h"
+
+#define EXPORT_BLOCK_BYTES (1 << 20)   // output formatted per block
+#define CELL_BOUND 512                 // room kept free for one cell
+#define BINARY_MAGIC "MARKOVB1"
+
+typedef struct BinaryHeader {
+    char magic[8];
+    int32_t size;
+    int32_t version;
+} BinaryHeader;
+
+static const double pow10_double[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+static const uint64_t pow10_int[] = { 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL,
+                                      1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL };
+
+// Destination of the export: a stream, or a file descriptor if out is NULL
+typedef struct ExportSink {
+    FILE* out;
+    int fd;
+} ExportSink;
+
+// A growing output buffer
+typedef struct ExportBuffer {
+    char* data;
+    size_t len;
+    size_t cap;
+} ExportBuffer;
+
+// Writes len bytes to the sink. Returns 0 on success, -1 on a write error
+static int sink_write(ExportSink* sink, const void* data, size_t len) {
+    if (sink->out != NULL) {
+        return fwrite(data, 1, len, sink->out) == len ? 0 : -1;
+    }
+    const char* p = (const char*)data;
+    while (len > 0) {
+        ssize_t n = write(sink->fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Makes room for at least `more` bytes after the current end
+static inline void buffer_reserve(ExportBuffer* b, size_t more) {
+    if (b->cap - b->len >= more) {
+        return;
+    }
+    size_t cap = b->cap > 0 ? b->cap : EXPORT_BLOCK_BYTES;
+    while (cap - b->len < more) {
+        cap *= 2;
+    }
+    b->data = (char*)realloc(b->data, cap);
+    if (b->data == NULL) {
+        perror("Failed to allocate memory for export buffer");
+        exit(EXIT_FAILURE);
+    }
+    b->cap = cap;
+}
+
+// Writes the decimal digits of n and returns the new end
+static inline char* put_uint(char* out, uint64_t n) {
+    char digits[20];
+    int d = 0;
+    do {
+        digits[d++] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n > 0);
+    while (d > 0) {
+        *out++ = digits[--d];
+    }
+    return out;
+}
+
+// Writes v as printf("%.*f", decimals, v) would and returns the new end
+static inline char* put_fixed(char* out, double v, int decimals) {
+    if (v == 0.0 && !signbit(v)) {
+        // most cells of a large chain, "0.000..." copied whole
+        memcpy(out, "0.000000000", 11);
+        return out + (decimals > 0 ? decimals + 2 : 1);
+    }
+    if (v >= 0.0 && v < 1e9 && !signbit(v)) {
+        double scaled = v * pow10_double[decimals];
+        double whole = floor(scaled);
+        double frac = scaled - whole;
+        if (scaled < 1e9 && fabs(frac - 0.5) > 1e-6) {
+            uint64_t n = (uint64_t)whole + (frac > 0.5);
+            out = put_uint(out, n / pow10_int[decimals]);
+            if (decimals > 0) {
+                uint64_t f = n % pow10_int[decimals];
+                *out++ = '.';
+                for (int d = decimals - 1; d >= 0; d--) {
+                    out[d] = (char)('0' + f % 10);
+                    f /= 10;
+                }
+                out += decimals;
+            }
+            return out;
+        }
+    }
+    return out + snprintf(out, CELL_BOUND, "%.*f", decimals, v);
+}
+
+// Formats rows [r0, r1) of M into b
+static void format_rows(Markov* M, ExportFormat format, int decimals, int r0, int r1,
+                        ExportBuffer* b) {
+    int n = M->size;
+    for (int i = r0; i < r1; i++) {
+        const double* row = M->matrix[i];
+        for (int j = 0; j < n; j++) {
+            double v = row[j];
+            if (format == EXPORT_MATRIX_MARKET && v == 0.0) {
+                continue;
+            }
+            buffer_reserve(b, CELL_BOUND + 64);
+            char* out = b->data + b->len;
+            if (format == EXPORT_MATRIX_MARKET) {
+                out = put_uint(out, (uint64_t)i + 1);
+                *out++ = ' ';
+                out = put_uint(out, (uint64_t)j + 1);
+                *out++ = ' ';
+            }
+            out = put_fixed(out, v, decimals);
+            if (format == EXPORT_TEXT) {
+                *out++ = ' ';
+            } else if (format == EXPORT_MATRIX_MARKET) {
+                *out++ = '\n';
+            } else if (j + 1 < n) {
+                *out++ = ',';
+            }
+            b->len = (size_t)(out - b->data);
+        }
+        if (format != EXPORT_MATRIX_MARKET) {
+            buffer_reserve(b, 1);
+            b->data[b->len++] = '\n';
+        }
+    }
+}
+
+// Work of one thread in a round of formatting
+typedef struct ExportWork {
+    Markov* M;
+    ExportFormat format;
+    int decimals;
+    int r0;
+    int r1;
+    ExportBuffer buffer;
+} ExportWork;
+
+static void* export_worker(void* arg) {
+    ExportWork* W = (ExportWork*)arg;
+    W->buffer.len = 0;
+    format_rows(W->M, W->format, W->decimals, W->r0, W->r1, &W->buffer);
+    return NULL;
+}
+
+// Writes the binary export. Returns the bytes written or -1
+static long export_binary(Markov* M, ExportSink* sink) {
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+    header.size = M->size;
+    header.version = 1;
+    if (sink_write(sink, &header, sizeof(header)) != 0) {
+        return -1;
+    }
+    int32_t* helper = (int32_t*)malloc(M->size * sizeof(int32_t));
+    if (helper == NULL) {
+        perror("Failed to allocate memory for export buffer");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < M->size; i++) {
+        helper[i] = M->helper[i];
+    }
+    int status = sink_write(sink, helper, M->size * sizeof(int32_t));
+    free(helper);
+    for (int i = 0; i < M->size && status == 0; i++) {
+        status = sink_write(sink, M->matrix[i], M->size * sizeof(double));
+    }
+    if (status != 0) {
+        return -1;
+    }
+    return (long)sizeof(header) + (long)M->size * sizeof(int32_t) +
+           (long)M->size * M->size * sizeof(double);
+}
+
+// Writes the chain to the sink. Returns the bytes written or -1
+static long export_sink(Markov* M, ExportSink* sink, ExportFormat format, int decimals,
+                        int num_threads) {
+    // Step 1.
+    //   Check the parameters and write the binary format directly
+    // Step 2.
+    //   Write the Matrix Market header, which needs the number of nonzeros
+    // Step 3.
+    //   Format rounds of blocks, one block per thread, and write the blocks
+    //   in order
+
+    if (M == NULL || M->matrix == NULL || format < EXPORT_TEXT || format > EXPORT_BINARY ||
+        decimals < 0 || decimals > EXPORT_MAX_DECIMALS) {
+        fprintf(stderr, "Invalid export parameters.\n");
+        return -1;
+    }
+    if (format == EXPORT_BINARY) {
+        return export_binary(M, sink);
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+
+    int n = M->size;
+    long written = 0;
+    if (format == EXPORT_MATRIX_MARKET) {
+        long nnz = 0;
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                nnz += M->matrix[i][j] != 0.0;
+            }
+        }
+        char header[128];
+        int len = snprintf(header, sizeof(header),
+                           "%%%%MatrixMarket matrix coordinate real general\n%d %d %ld\n", n, n, nnz);
+        if (sink_write(sink, header, len) != 0) {
+            return -1;
+        }
+        written += len;
+    }
+
+    // rows per block, from the width of a formatted cell
+    long row_bytes = (long)n * (decimals + (format == EXPORT_MATRIX_MARKET ? 4 : 3));
+    int block = (int)(EXPORT_BLOCK_BYTES / (row_bytes > 0 ? row_bytes : 1));
+    block = block < 1 ? 1 : block;
+
+    ExportWork* work = (ExportWork*)calloc(num_threads, sizeof(ExportWork));
+    pthread_t* threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    if (work == NULL || threads == NULL) {
+        perror("Failed to allocate memory for export threads");
+        exit(EXIT_FAILURE);
+    }
+    int status = 0;
+    for (int r = 0; r < n && status == 0; r += block * num_threads) {
+        for (int t = 0; t < num_threads; t++) {
+            work[t].M = M;
+            work[t].format = format;
+            work[t].decimals = decimals;
+            work[t].r0 = r + t * block < n ? r + t * block : n;
+            work[t].r1 = work[t].r0 + block < n ? work[t].r0 + block : n;
+        }
+        for (int t = 1; t < num_threads; t++) {
+            if (pthread_create(&threads[t], NULL, export_worker, &work[t]) != 0) {
+                perror("Failed to create worker thread");
+                exit(EXIT_FAILURE);
+            }
+        }
+        export_worker(&work[0]);
+        for (int t = 1; t < num_threads; t++) {
+            pthread_join(threads[t], NULL);
+        }
+        for (int t = 0; t < num_threads && status == 0; t++) {
+            status = sink_write(sink, work[t].buffer.data, work[t].buffer.len);
+            written += (long)work[t].buffer.len;
+        }
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        free(work[t].buffer.data);
+    }
+    free(work);
+    free(threads);
+    return status == 0 ? written : -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// export_M(Markov* M, FILE* out, ExportFormat format, int decimals,
+//          int num_threads)
+//
+//  Writes the chain to a stream in the given format. Pending output of the
+//  stream is written first, and the blocks then go through fwrite
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - out: Stream to write to
+//    - format: Output format
+//    - decimals: Digits after the decimal point of text values
+//                (0 .. EXPORT_MAX_DECIMALS, ignored for EXPORT_BINARY)
+//    - num_threads: Number of threads formatting rows
+//
+// Returns:
+//    - The number of bytes written, or -1 on invalid parameters or a write
+//      error
+///////////////////////////////////////////////////////////////////////////////
+long export_M(Markov* M, FILE* out, ExportFormat format, int decimals, int num_threads) {
+    if (out == NULL || fflush(out) != 0) {
+        fprintf(stderr, "Invalid export stream.\n");
+        return -1;
+    }
+    ExportSink sink = { out, -1 };
+    return export_sink(M, &sink, format, decimals, num_threads);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// export_M_fd(Markov* M, int fd, ExportFormat format, int decimals,
+//             int num_threads)
+//
+//  Same as export_M, writing to a file descriptor with write()
+///////////////////////////////////////////////////////////////////////////////
+long export_M_fd(Markov* M, int fd, ExportFormat format, int decimals, int num_threads) {
+    if (fd < 0) {
+        fprintf(stderr, "Invalid export file descriptor.\n");
+        return -1;
+    }
+    ExportSink sink = { NULL, fd };
+    return export_sink(M, &sink, format, decimals, num_threads);
+}
+
+// Reads exactly len bytes. Returns 0 on success, -1 on a short read
+static int read_full(int fd, void* data, size_t len) {
+    char* p = (char*)data;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// import_M_binary(int fd)
+//
+//  Reads a chain written with EXPORT_BINARY
+//
+// Returns:
+//    - Pointer to the newly allocated Markov structure, or NULL if the data
+//      is not a complete binary export
+///////////////////////////////////////////////////////////////////////////////
+Markov* import_M_binary(int fd) {
+    BinaryHeader header;
+    if (read_full(fd, &header, sizeof(header)) != 0 ||
+        memcmp(header.magic, BINARY_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != 1 || header.size < 1) {
+        fprintf(stderr, "Not a binary chain export.\n");
+        return NULL;
+    }
+
+    Markov* M = initialize_M(header.size);
+    int32_t* helper = (int32_t*)malloc(header.size * sizeof(int32_t));
+    if (helper == NULL) {
+        perror("Failed to allocate memory for import buffer");
+        exit(EXIT_FAILURE);
+    }
+    int status = read_full(fd, helper, header.size * sizeof(int32_t));
+    for (int i = 0; i < header.size && status == 0; i++) {
+        M->helper[i] = helper[i];
+        status = read_full(fd, M->matrix[i], header.size * sizeof(double));
+    }
+    free(helper);
+    if (status != 0) {
+        fprintf(stderr, "Truncated binary chain export.\n");
+        free_M(M);
+        return NULL;
+    }
+    return M;
+}
@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_export.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_export.c bulk export of a chain. print_M()
+//   makes one printf call per cell, which takes minutes for the 16M cells of
+//   a 4096-state chain. The export functions format whole blocks of rows
+//   into large buffers with a fixed-point formatter and write each block
+//   with one call, to a FILE* or a file descriptor. The formats are:
+//   - EXPORT_TEXT: the layout of print_M (each cell followed by a space,
+//     one line per row)
+//   - EXPORT_CSV: one line per row, cells separated by commas
+//   - EXPORT_MATRIX_MARKET: the Matrix Market sparse coordinate format
+//     ("i j value" lines, 1-based, for the nonzero cells only)
+//   - EXPORT_BINARY: a small header, the helper counts and the raw rows,
+//     read back with import_M_binary()
+//
+//   Text values are printed with a fixed number of decimals and are
+//   identical to printf("%.*f"); the few values too large for the fast path
+//   or too close to a rounding tie are handed to snprintf. With several
+//   threads, each thread formats its own block of rows and the blocks are
+//   written in order.
+//
+// Usage:
+//   Include this header by using #include "markov_export.h" and use the
+//   functions below:
+//
+//      export_M(M, stdout, EXPORT_TEXT, 3, 1);   // same output as print_M
+//      export_M_fd(M, fd, EXPORT_MATRIX_MARKET, 9, 8);
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_EXPORT
+#define MARKOV_EXPORT
+
+#include <stdio.h>
+#include "markov.h"
+
+#define EXPORT_MAX_DECIMALS 9
+
+typedef enum ExportFormat {
+    EXPORT_TEXT,            // print_M layout
+    EXPORT_CSV,             // comma separated rows
+    EXPORT_MATRIX_MARKET,   // sparse coordinate format, nonzeros only
+    EXPORT_BINARY           // header, helper counts and raw rows
+} ExportFormat;
+
+///////////////////////////////////////////////////////////////////////////////
+// export_M(Markov* M, FILE* out, ExportFormat format, int decimals,
+//          int num_threads)
+//
+//  Writes the chain to a stream in the given format. Pending output of the
+//  stream is written first, and the blocks then go through fwrite
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - out: Stream to write to
+//    - format: Output format
+//    - decimals: Digits after the decimal point of text values
+//                (0 .. EXPORT_MAX_DECIMALS, ignored for EXPORT_BINARY)
+//    - num_threads: Number of threads formatting rows
+//
+// Returns:
+//    - The number of bytes written, or -1 on invalid parameters or a write
+//      error
+///////////////////////////////////////////////////////////////////////////////
+long export_M(Markov* M, FILE* out, ExportFormat format, int decimals, int num_threads);
+
+///////////////////////////////////////////////////////////////////////////////
+// export_M_fd(Markov* M, int fd, ExportFormat format, int decimals,
+//             int num_threads)
+//
+//  Same as export_M, writing to a file descriptor with write()
+///////////////////////////////////////////////////////////////////////////////
+long export_M_fd(Markov* M, int fd, ExportFormat format, int decimals, int num_threads);
+
+///////////////////////////////////////////////////////////////////////////////
+// import_M_binary(int fd)
+//
+//  Reads a chain written with EXPORT_BINARY
+//
+// Returns:
+//    - Pointer to the newly allocated Markov structure, or NULL if the data
+//      is not a complete binary export
+///////////////////////////////////////////////////////////////////////////////
+Markov* import_M_binary(int fd);
+
+#endif
@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_fixed.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Fixed-size variants of the Markov structure for chains with a small number
+//   of states that is known at compile time. The matrix and helper array are
+//   stored inline in the structure (no double** indirection or heap rows), the
+//   row loops have a constant trip count so the compiler fully unrolls them,
+//   and the argmax/argmin use the vectorized kernels from markov_simd.h.
+//
+//   DEFINE_FIXED_MARKOV(N) generates, for a given N:
+//
+//      FixedMarkovN                  the structure
+//      initialize_fixed_MN(M)        zero a structure (no allocation)
+//      update_fixed_matrixN(M, i, j) same semantics as update_matrix
+//      max_prob_idx_fixedN(M, i)     same semantics as max_prob_idx
+//      min_prob_idx_fixedN(M, i)     same semantics as min_prob_idx
+//      print_fixed_MN(M)             same output as print_M
+//
+//   Sizes 8, 16 and 32 are generated below; other sizes can be generated by
+//   invoking the macro in a source file.
+//
+// Usage:
+//   Include this header by using #include "markov_fixed.h" and use the
+//   functions below, e.g.
+//
+//      FixedMarkov16 M;
+//      initialize_fixed_M16(&M);
+//      update_fixed_matrix16(&M, 0, 3);
+//      int next = max_prob_idx_fixed16(&M, 0);
+//
+// NOTE:
+//   The row updates perform exactly the same floating point operations as
+//   update_matrix, so a fixed-size chain and a Markov structure trained with
+//   the same transitions hold identical values
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_FIXED
+#define MARKOV_FIXED
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include "markov_simd.h"
+
+#define DEFINE_FIXED_MARKOV(N)                                                 \
+typedef struct FixedMarkov##N {                                                \
+    double matrix[N][N]; /* inline N x N Markov Chain matrix */                \
+    int helper[N];       /* number of updates to each row */                   \
+} FixedMarkov##N;                                                              \
+                                                                               \
+static inline void initialize_fixed_M##N(FixedMarkov##N* M) {                  \
+    memset(M, 0, sizeof(*M));                                                  \
+}                                                                              \
+                                                                               \
+static inline int update_fixed_matrix##N(FixedMarkov##N* M, int i, int j) {    \
+    /* one unsigned comparison per index covers both bounds */                 \
+    if ((unsigned)i >= (unsigned)(N) || (unsigned)j >= (unsigned)(N)) {        \
+        fprintf(stderr, "invalid i, j indices ( %d, %d ) given size of %d.\n", \
+                i, j, (N));                                                    \
+        return -1;                                                             \
+    }                                                                          \
+    /* the count saturates at INT_MAX like update_matrix */                   \
+    int alpha = M->helper[i];                                                  \
+    if (alpha < INT_MAX) {                                                     \
+        M->helper[i]++;                                                        \
+    }                                                                          \
+    double* row = M->matrix[i];                                                \
+    _Pragma("GCC unroll 64")                                                   \
+    for (int k = 0; k < (N); k++) {                                            \
+        /* scale to counts, add the transition, scale back to probabilities */ \
+        row[k] = (row[k] * alpha + (double)(k == j)) / (alpha + 1.0);          \
+    }                                                                          \
+    return 0;                                                                  \
+}                                                                              \
+                                                                               \
+static inline int max_prob_idx_fixed##N(FixedMarkov##N* M, int i) {           \
+    if (M == NULL || (unsigned)i >= (unsigned)(N)) {                           \
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");        \
+        return -1;                                                             \
+    }                                                                          \
+    return simd_argmax(M->matrix[i], (N));                                     \
+}                                                                              \
+                                                                               \
+static inline int min_prob_idx_fixed##N(FixedMarkov##N* M, int i) {           \
+    if (M == NULL || (unsigned)i >= (unsigned)(N)) {                           \
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");        \
+        return -1;                                                             \
+    }                                                                          \
+    return simd_argmin(M->matrix[i], (N));                                     \
+}                                                                              \
+                                                                               \
+static inline void print_fixed_M##N(FixedMarkov##N* M) {                       \
+    for (int i = 0; i < (N); i++) {                                            \
+        for (int k = 0; k < (N); k++) {                                        \
+            printf("%.3f ", M->matrix[i][k]);                                  \
+        }                                                                      \
+        printf("\n");                                                          \
+    }                                                                          \
+}
+
+DEFINE_FIXED_MARKOV(8)
+DEFINE_FIXED_MARKOV(16)
+DEFINE_FIXED_MARKOV(32)
+
+#endif
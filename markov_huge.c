@@ -0,0 +1,183 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_huge.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the huge page allocation mode. The matrix
+//   rows are carved out of one anonymous mapping aligned to the 2 MB huge page
+//   size. Explicit huge pages (MAP_HUGETLB) are tried first when requested;
+//   if the system has none reserved, the mapping falls back to regular pages
+//   with a transparent huge page hint, and if the hint is not supported the
+//   block is simply used with regular pages.
+//
+// Usage:
+//   Include this source code by using #include "markov_huge.h" and use the
+//   functions below
+//
+// NOTE:
+//   The block is released by free_M, which unmaps it in one call
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "markov_huge.h"
+
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+
+// Per-thread range of rows to zero
+typedef struct TouchWork {
+    Markov* M;
+    size_t stride;  // doubles per (padded) row
+    int row_begin;
+    int row_end;
+} TouchWork;
+
+static void* touch_rows(void* arg) {
+    TouchWork* w = (TouchWork*)arg;
+    if (w->row_end > w->row_begin) {
+        memset(w->M->matrix[w->row_begin], 0,
+               (size_t)(w->row_end - w->row_begin) * w->stride * sizeof(double));
+    }
+    return NULL;
+}
+
+// Maps `len` bytes of regular pages aligned to the huge page size, trimming
+// the unaligned head and tail of a slightly larger mapping
+static void* map_aligned(size_t len) {
+    size_t padded = len + HUGE_PAGE_SIZE;
+    char* base = (char*)mmap(NULL, padded, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    char* aligned = (char*)(((uintptr_t)base + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+    if (aligned > base) {
+        munmap(base, aligned - base);
+    }
+    size_t tail = (base + padded) - (aligned + len);
+    if (tail > 0) {
+        munmap(aligned + len, tail);
+    }
+    return aligned;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_M_huge(int size, HugeMode mode, int num_threads)
+//
+//  Initializes a new Markov structure whose rows are carved out of a single
+//  huge page backed block. Rows are padded to a multiple of 64 bytes so
+//  every row starts on a cache line.
+//
+// Parameters:
+//    - size: The number of rows and columns in the transition matrix
+//    - mode: The kind of huge pages to request (see HugeMode above)
+//    - num_threads: Number of threads zeroing the block (values < 1 use one)
+//
+// Returns:
+//    Pointer to the newly allocated Markov structure. M->storage is
+//    MARKOV_HUGETLB if explicit huge pages were obtained, MARKOV_BLOCK
+//    otherwise
+///////////////////////////////////////////////////////////////////////////////
+Markov* initialize_M_huge(int size, HugeMode mode, int num_threads) {
+    // Step 1.
+    //   Allocate the Markov structure, the row pointers and the helper array
+    // Step 2.
+    //   Map one block for every row, rounded up to whole huge pages, trying
+    //   explicit huge pages, then transparent huge pages, then regular pages
+    // Step 3.
+    //   Point each row into the block
+    // Step 4.
+    //   Zero the block in parallel so pages are first touched by the threads
+
+    Markov* M = (Markov*)malloc(sizeof(Markov));
+    if (M == NULL) {
+        perror("Failed to allocate memory for Markov structure");
+        exit(EXIT_FAILURE);
+    }
+    M->size = size;
+    M->matrix = (double**)malloc((size > 0 ? size : 1) * sizeof(double*));
+    M->helper = (int*)calloc(size > 0 ? size : 1, sizeof(int));
+    M->version = (unsigned int*)calloc(size > 0 ? size : 1, sizeof(unsigned int));
+    if (M->matrix == NULL || M->helper == NULL || M->version == NULL) {
+        perror("Failed to allocate memory for matrix");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t stride = ((size_t)size + 7) & ~(size_t)7;
+    size_t len = stride * size * sizeof(double);
+    len = (len + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (len == 0) {
+        len = HUGE_PAGE_SIZE;
+    }
+
+    void* block = NULL;
+    M->storage = MARKOV_BLOCK;
+    if (mode == HUGE_EXPLICIT) {
+        block = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block == MAP_FAILED) {
+            block = NULL;   // no reserved huge pages, fall back below
+        } else {
+            M->storage = MARKOV_HUGETLB;
+        }
+    }
+    if (block == NULL) {
+        block = map_aligned(len);
+        if (block == NULL) {
+            perror("Failed to map memory for matrix");
+            free(M->matrix);
+            free(M->helper);
+            free(M->version);
+            free(M);
+            exit(EXIT_FAILURE);
+        }
+        // the hint is best effort: without THP support the block simply
+        // keeps regular pages
+        madvise(block, len, mode == HUGE_NONE ? MADV_NOHUGEPAGE : MADV_HUGEPAGE);
+    }
+    M->block = block;
+    M->block_len = len;
+
+    for (int i = 0; i < size; i++) {
+        M->matrix[i] = (double*)block + (size_t)i * stride;
+    }
+
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    if (num_threads > size && size > 0) {
+        num_threads = size;
+    }
+    TouchWork* work = (TouchWork*)malloc(num_threads * sizeof(TouchWork));
+    pthread_t* threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    if (work == NULL || threads == NULL) {
+        perror("Failed to allocate memory for worker threads");
+        exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < num_threads; t++) {
+        work[t].M = M;
+        work[t].stride = stride;
+        work[t].row_begin = (int)((long)size * t / num_threads);
+        work[t].row_end = (int)((long)size * (t + 1) / num_threads);
+    }
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, touch_rows, &work[t]) != 0) {
+            perror("Failed to create worker thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+    touch_rows(&work[0]);
+    for (int t = 1; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    free(work);
+    free(threads);
+    return M;
+}
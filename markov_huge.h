@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_huge.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_huge.c allocation mode for large dense chains.
+//   Instead of one calloc per row, every row lives in a single mapped block
+//   backed by huge pages, which cuts the number of TLB entries needed to scan
+//   rows or run matrix_mult(). The block is zeroed by several threads in
+//   parallel, so startup is faster and each page is first touched (and
+//   placed in memory) by the thread that zeroes it.
+//
+// Usage:
+//   Include this header by using #include "markov_huge.h" and use the
+//   functions below. The returned structure is used (and freed with free_M)
+//   like any other Markov structure
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_HUGE
+#define MARKOV_HUGE
+
+#include "markov.h"
+
+// Which kind of huge pages to request for the matrix block
+typedef enum HugeMode {
+    HUGE_NONE = 0,     // one mapped block of regular pages
+    HUGE_TRANSPARENT,  // transparent huge pages (madvise(MADV_HUGEPAGE))
+    HUGE_EXPLICIT      // reserved huge pages (MAP_HUGETLB), falling back to
+                       // transparent huge pages when none are available
+} HugeMode;
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_M_huge(int size, HugeMode mode, int num_threads)
+//
+//  Initializes a new Markov structure whose rows are carved out of a single
+//  huge page backed block. Rows are padded to a multiple of 64 bytes so
+//  every row starts on a cache line.
+//
+// Parameters:
+//    - size: The number of rows and columns in the transition matrix
+//    - mode: The kind of huge pages to request (see HugeMode above)
+//    - num_threads: Number of threads zeroing the block (values < 1 use one)
+//
+// Returns:
+//    Pointer to the newly allocated Markov structure. M->storage is
+//    MARKOV_HUGETLB if explicit huge pages were obtained, MARKOV_BLOCK
+//    otherwise
+///////////////////////////////////////////////////////////////////////////////
+Markov* initialize_M_huge(int size, HugeMode mode, int num_threads);
+
+#endif
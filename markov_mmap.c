@@ -0,0 +1,321 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_mmap.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the file-backed storage mode. The whole
+//   file is mapped shared, M->helper points at the helper section and each
+//   M->matrix[i] at its row, so the rest of the library works unchanged. A
+//   new file is sized with ftruncate and starts as a sparse file of zeros,
+//   which is exactly an empty chain.
+//
+//   Unlike initialize_M, running out of disk space or address space is
+//   reported by returning NULL instead of exiting, since these chains are
+//   expected to be very large.
+//
+// Usage:
+//   Include this source code by using #include "markov_mmap.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "markov_mmap.h"
+
+#define FILE_MAGIC "MARKOVM1"
+#define FILE_VERSION 1
+#define PAGE_ALIGN(x) (((x) + 4095) & ~(size_t)4095)
+
+// First page of a chain file
+typedef struct MarkovFileHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t size;
+    uint64_t stride;       // doubles per row
+    uint64_t helper_off;   // byte offset of the helper section
+    uint64_t matrix_off;   // byte offset of the first row
+} MarkovFileHeader;
+
+// Computes the layout of a chain file of the given size
+static void file_layout(int size, MarkovFileHeader* h, size_t* len) {
+    memset(h, 0, sizeof(MarkovFileHeader));
+    memcpy(h->magic, FILE_MAGIC, 8);
+    h->version = FILE_VERSION;
+    h->size = size;
+    h->stride = ((uint64_t)size + 7) & ~(uint64_t)7;
+    h->helper_off = PAGE_ALIGN(sizeof(MarkovFileHeader));
+    h->matrix_off = h->helper_off + PAGE_ALIGN((size_t)size * sizeof(int));
+    *len = h->matrix_off + (size_t)size * h->stride * sizeof(double);
+}
+
+// Builds the Markov structure over a mapped file
+static Markov* wrap_mapping(void* base, size_t len) {
+    const MarkovFileHeader* h = (const MarkovFileHeader*)base;
+    Markov* M = (Markov*)malloc(sizeof(Markov));
+    double** rows = (double**)malloc((h->size > 0 ? h->size : 1) * sizeof(double*));
+    // row versions only matter to this process, so they are not in the file
+    unsigned int* version = (unsigned int*)calloc(h->size > 0 ? h->size : 1,
+                                                  sizeof(unsigned int));
+    if (M == NULL || rows == NULL || version == NULL) {
+        perror("Failed to allocate memory for Markov structure");
+        exit(EXIT_FAILURE);
+    }
+    M->size = h->size;
+    M->matrix = rows;
+    M->helper = (int*)((char*)base + h->helper_off);
+    M->version = version;
+    M->storage = MARKOV_FILE;
+    M->block = base;
+    M->block_len = len;
+    double* first = (double*)((char*)base + h->matrix_off);
+    for (int i = 0; i < h->size; i++) {
+        M->matrix[i] = first + (size_t)i * h->stride;
+    }
+    return M;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_M_file(const char* path, int size)
+//
+//  Creates (or truncates) a file holding an empty chain and maps it
+//
+// Parameters:
+//    - path: Path of the backing file
+//    - size: The number of rows and columns in the transition matrix
+//
+// Returns:
+//    Pointer to the newly allocated Markov structure, or NULL if the file
+//    could not be created or mapped
+///////////////////////////////////////////////////////////////////////////////
+Markov* initialize_M_file(const char* path, int size) {
+    if (path == NULL || size < 1) {
+        fprintf(stderr, "Invalid path or size %d.\n", size);
+        return NULL;
+    }
+
+    MarkovFileHeader header;
+    size_t len;
+    file_layout(size, &header, &len);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Failed to create chain file");
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)len) != 0) {
+        perror("Failed to size chain file");
+        close(fd);
+        return NULL;
+    }
+    void* base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map chain file");
+        return NULL;
+    }
+    memcpy(base, &header, sizeof(header));
+    return wrap_mapping(base, len);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// open_M_file(const char* path)
+//
+//  Maps a chain previously created with initialize_M_file
+//
+// Parameters:
+//    - path: Path of the backing file
+//
+// Returns:
+//    Pointer to the newly allocated Markov structure, or NULL if the file
+//    could not be opened or is not a chain file
+///////////////////////////////////////////////////////////////////////////////
+Markov* open_M_file(const char* path) {
+    if (path == NULL) {
+        fprintf(stderr, "Invalid path.\n");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open chain file");
+        return NULL;
+    }
+    struct stat st;
+    MarkovFileHeader header;
+    if (fstat(fd, &st) != 0 || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        fprintf(stderr, "Failed to read chain file header.\n");
+        close(fd);
+        return NULL;
+    }
+
+    // the stored layout must be the one this size produces
+    MarkovFileHeader expected;
+    size_t len;
+    if (memcmp(header.magic, FILE_MAGIC, 8) != 0 || header.version != FILE_VERSION ||
+        header.size < 1) {
+        fprintf(stderr, "%s is not a chain file.\n", path);
+        close(fd);
+        return NULL;
+    }
+    file_layout(header.size, &expected, &len);
+    if (memcmp(&header, &expected, sizeof(header)) != 0 || (size_t)st.st_size < len) {
+        fprintf(stderr, "%s has an invalid layout or is truncated.\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    void* base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map chain file");
+        return NULL;
+    }
+    return wrap_mapping(base, len);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sync_M_file(Markov* M)
+//
+//  Writes the modified pages of a file-backed chain to the file and waits
+//  for the write to complete
+//
+// Returns:
+//    - 0 on success, -1 if M is not file-backed or the write failed
+///////////////////////////////////////////////////////////////////////////////
+int sync_M_file(Markov* M) {
+    if (M == NULL || M->storage != MARKOV_FILE) {
+        fprintf(stderr, "Markov structure is not file-backed.\n");
+        return -1;
+    }
+    if (msync(M->block, M->block_len, MS_SYNC) != 0) {
+        perror("Failed to write chain file");
+        return -1;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// advise_M(Markov* M, MarkovAccess access)
+//
+//  Tells the kernel how the rows of a mapped chain (file-backed or huge page
+//  block) are about to be accessed
+//
+// Returns:
+//    - 0 on success, -1 if the rows are not mapped or the hint failed
+///////////////////////////////////////////////////////////////////////////////
+int advise_M(Markov* M, MarkovAccess access) {
+    if (M == NULL || M->block == NULL) {
+        fprintf(stderr, "Markov structure is not mapped.\n");
+        return -1;
+    }
+    int advice = access == ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL
+               : access == ACCESS_RANDOM ? MADV_RANDOM : MADV_NORMAL;
+    if (madvise(M->block, M->block_len, advice) != 0) {
+        perror("Failed to set access hint");
+        return -1;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// matrix_mult_ooc(Markov* M1, Markov* M2, Markov* result, size_t mem_budget)
+//
+//  Multiplies two chains like matrix_mult, into a caller-provided result
+//  (e.g. from initialize_M_file), keeping at most about mem_budget bytes of
+//  working set. Result rows are computed in blocks that fit the budget; for
+//  each block, M2 is read once from top to bottom. The sums are taken in
+//  the same order as matrix_mult, so the results are identical
+//
+// Parameters:
+//    - M1: Pointer to the first Markov structure
+//    - M2: Pointer to the second Markov structure
+//    - result: Pointer to a Markov structure of the same size receiving the
+//              product (its helper counts are reset to 0, and the version of
+//              every row advances)
+//    - mem_budget: Bytes of memory the multiply may keep resident
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int matrix_mult_ooc(Markov* M1, Markov* M2, Markov* result, size_t mem_budget) {
+    // Step 1.
+    //   Size the block of result rows: its accumulators plus the matching
+    //   rows of M1 must fit the budget
+    // Step 2.
+    //   For each block, stream the rows of M2 in order; row k of M2 is
+    //   scaled by M1[i][k] and added to accumulator row i, so every sum runs
+    //   over k in increasing order, as in matrix_mult
+    // Step 3.
+    //   Copy the finished block into the result rows
+
+    if (M1 == NULL || M2 == NULL || result == NULL || M1->size != M2->size ||
+        result->size != M1->size || result == M1 || result == M2) {
+        fprintf(stderr, "Invalid or mismatched Markov structures.\n");
+        return -1;
+    }
+
+    int n = M1->size;
+    size_t row_bytes = (size_t)n * sizeof(double);
+    long block = (long)(mem_budget / (2 * row_bytes));
+    if (block < 1) {
+        block = 1;
+    }
+    if (block > n) {
+        block = n;
+    }
+    double* acc = (double*)malloc((size_t)block * row_bytes);
+    if (acc == NULL) {
+        perror("Failed to allocate memory for result block");
+        exit(EXIT_FAILURE);
+    }
+
+    // the hints are best effort (rows may not be mapped)
+    if (M1->block != NULL) {
+        madvise(M1->block, M1->block_len, MADV_SEQUENTIAL);
+    }
+    if (M2->block != NULL) {
+        madvise(M2->block, M2->block_len, MADV_SEQUENTIAL);
+    }
+
+    for (int i0 = 0; i0 < n; i0 += (int)block) {
+        int rows = n - i0 < block ? n - i0 : (int)block;
+        memset(acc, 0, (size_t)rows * row_bytes);
+        for (int k = 0; k < n; k++) {
+            const double* b = M2->matrix[k];
+            for (int r = 0; r < rows; r++) {
+                double a = M1->matrix[i0 + r][k];
+                if (a == 0.0) {
+                    continue;   // adds exact zeros only
+                }
+                double* c = acc + (size_t)r * n;
+                for (int j = 0; j < n; j++) {
+                    c[j] += a * b[j];
+                }
+            }
+        }
+        for (int r = 0; r < rows; r++) {
+            memcpy(result->matrix[i0 + r], acc + (size_t)r * n, row_bytes);
+            result->version[i0 + r]++;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        result->helper[i] = 0;
+    }
+    if (M1->block != NULL) {
+        madvise(M1->block, M1->block_len, MADV_NORMAL);
+    }
+    if (M2->block != NULL) {
+        madvise(M2->block, M2->block_len, MADV_NORMAL);
+    }
+    free(acc);
+    return 0;
+}
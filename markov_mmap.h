@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_mmap.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_mmap.c file-backed storage mode, for dense
+//   chains larger than memory. The helper array and the rows of the matrix
+//   live in a memory-mapped file, so rows are paged in and out by the kernel
+//   and the chain persists across runs. The result is an ordinary Markov*
+//   (M->storage == MARKOV_FILE) usable with every function of markov.h.
+//
+//   File layout (all offsets page aligned):
+//      header   magic, version, size and row stride
+//      helper   size ints
+//      matrix   size rows of stride doubles (rows padded to 64 bytes)
+//
+//   Access hints tell the kernel whether the rows are about to be swept in
+//   order (read ahead, drop behind) or probed at random (no read ahead).
+//   matrix_mult_ooc() multiplies chains of any storage within a memory
+//   budget, streaming the second operand once per block of result rows.
+//
+// Usage:
+//   Include this header by using #include "markov_mmap.h" and use the
+//   functions below. free_M() unmaps the file; changes are written back by
+//   the kernel, or immediately with sync_M_file()
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_MMAP
+#define MARKOV_MMAP
+
+#include <stddef.h>
+#include "markov.h"
+
+// Expected access pattern of a mapped chain
+typedef enum MarkovAccess {
+    ACCESS_NORMAL = 0,  // default kernel read ahead
+    ACCESS_SEQUENTIAL,  // row sweeps, e.g. matrix_mult
+    ACCESS_RANDOM       // scattered probes, e.g. max_prob_idx
+} MarkovAccess;
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_M_file(const char* path, int size)
+//
+//  Creates (or truncates) a file holding an empty chain and maps it
+//
+// Parameters:
+//    - path: Path of the backing file
+//    - size: The number of rows and columns in the transition matrix
+//
+// Returns:
+//    Pointer to the newly allocated Markov structure, or NULL if the file
+//    could not be created or mapped
+///////////////////////////////////////////////////////////////////////////////
+Markov* initialize_M_file(const char* path, int size);
+
+///////////////////////////////////////////////////////////////////////////////
+// open_M_file(const char* path)
+//
+//  Maps a chain previously created with initialize_M_file
+//
+// Parameters:
+//    - path: Path of the backing file
+//
+// Returns:
+//    Pointer to the newly allocated Markov structure, or NULL if the file
+//    could not be opened or is not a chain file
+///////////////////////////////////////////////////////////////////////////////
+Markov* open_M_file(const char* path);
+
+///////////////////////////////////////////////////////////////////////////////
+// sync_M_file(Markov* M)
+//
+//  Writes the modified pages of a file-backed chain to the file and waits
+//  for the write to complete
+//
+// Returns:
+//    - 0 on success, -1 if M is not file-backed or the write failed
+///////////////////////////////////////////////////////////////////////////////
+int sync_M_file(Markov* M);
+
+///////////////////////////////////////////////////////////////////////////////
+// advise_M(Markov* M, MarkovAccess access)
+//
+//  Tells the kernel how the rows of a mapped chain (file-backed or huge page
+//  block) are about to be accessed
+//
+// Returns:
+//    - 0 on success, -1 if the rows are not mapped or the hint failed
+///////////////////////////////////////////////////////////////////////////////
+int advise_M(Markov* M, MarkovAccess access);
+
+///////////////////////////////////////////////////////////////////////////////
+// matrix_mult_ooc(Markov* M1, Markov* M2, Markov* result, size_t mem_budget)
+//
+//  Multiplies two chains like matrix_mult, into a caller-provided result
+//  (e.g. from initialize_M_file), keeping at most about mem_budget bytes of
+//  working set. Result rows are computed in blocks that fit the budget; for
+//  each block, M2 is read once from top to bottom. The sums are taken in
+//  the same order as matrix_mult, so the results are identical
+//
+// Parameters:
+//    - M1: Pointer to the first Markov structure
+//    - M2: Pointer to the second Markov structure
+//    - result: Pointer to a Markov structure of the same size receiving the
+//              product (its helper counts are reset to 0, and the version of
+//              every row advances)
+//    - mem_budget: Bytes of memory the multiply may keep resident
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int matrix_mult_ooc(Markov* M1, Markov* M2, Markov* result, size_t mem_budget);
+
+#endif
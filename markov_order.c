@@ -0,0 +1,631 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_order.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the state reordering. Reverse
+//   Cuthill-McKee runs on the transitions made symmetric (i -> j or
+//   j -> i), as an adjacency list without duplicates or self loops. The
+//   breadth first search uses the output array as its queue and queues the
+//   neighbors of each state by increasing degree; the order is reversed at
+//   the end.
+//
+// Usage:
+//   Include this source code by using #include "markov_order.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "markov_order.h"
+
+// Relative slack on the probability left in a row, for the rounding of the
+// running sum against the stored row sum
+#define ROW_SUM_SLACK 1e-9
+
+// A state and the key it is sorted by
+typedef struct OrderKey {
+    double key;
+    int state;
+} OrderKey;
+
+// Sorts by decreasing key, then increasing state
+static int compare_desc(const void* a, const void* b) {
+    const OrderKey* x = (const OrderKey*)a;
+    const OrderKey* y = (const OrderKey*)b;
+    if (x->key != y->key) {
+        return x->key > y->key ? -1 : 1;
+    }
+    return (x->state > y->state) - (x->state < y->state);
+}
+
+// Sorts by increasing key, then increasing state
+static int compare_asc(const void* a, const void* b) {
+    const OrderKey* x = (const OrderKey*)a;
+    const OrderKey* y = (const OrderKey*)b;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return (x->state > y->state) - (x->state < y->state);
+}
+
+// A column and its value, to sort the cells of a sparse row
+typedef struct OrderCell {
+    int col;
+    double value;
+} OrderCell;
+
+static int compare_cells(const void* a, const void* b) {
+    const OrderCell* x = (const OrderCell*)a;
+    const OrderCell* y = (const OrderCell*)b;
+    return (x->col > y->col) - (x->col < y->col);
+}
+
+// Allocates an order of the given size
+static MarkovOrder* new_order(int size) {
+    MarkovOrder* O = (MarkovOrder*)malloc(sizeof(MarkovOrder));
+    if (O == NULL) {
+        perror("Failed to allocate memory for MarkovOrder structure");
+        exit(EXIT_FAILURE);
+    }
+    O->size = size;
+    O->perm = (int*)malloc(size * sizeof(int));
+    O->pos = (int*)malloc(size * sizeof(int));
+    if (O->perm == NULL || O->pos == NULL) {
+        perror("Failed to allocate memory for state order");
+        exit(EXIT_FAILURE);
+    }
+    return O;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// order_by_frequency(Markov* M)
+//
+//  Orders the states by the number of observed transitions into them
+//  (the sum over i of helper[i] * M[i][j]), most visited first, ties by
+//  increasing state
+//
+// Returns:
+//    Pointer to the newly allocated MarkovOrder structure, or NULL if M is
+//    invalid
+///////////////////////////////////////////////////////////////////////////////
+MarkovOrder* order_by_frequency(Markov* M) {
+    if (M == NULL || M->matrix == NULL || M->size < 1) {
+        fprintf(stderr, "Invalid Markov structure.\n");
+        return NULL;
+    }
+
+    int n = M->size;
+    OrderKey* keys = (OrderKey*)malloc(n * sizeof(OrderKey));
+    if (keys == NULL) {
+        perror("Failed to allocate memory for state order");
+        exit(EXIT_FAILURE);
+    }
+    for (int j = 0; j < n; j++) {
+        keys[j].key = 0.0;
+        keys[j].state = j;
+    }
+    // rows are read in order, adding each row's counts to its columns
+    for (int i = 0; i < n; i++) {
+        double count = M->helper[i];
+        if (count == 0.0) {
+            continue;
+        }
+        const double* row = M->matrix[i];
+        for (int j = 0; j < n; j++) {
+            keys[j].key += count * row[j];
+        }
+    }
+    qsort(keys, n, sizeof(OrderKey), compare_desc);
+
+    MarkovOrder* O = new_order(n);
+    for (int p = 0; p < n; p++) {
+        O->perm[p] = keys[p].state;
+        O->pos[keys[p].state] = p;
+    }
+    free(keys);
+    return O;
+}
+
+// Orders the graph whose edges out of state v are adj[ptr[v] .. ptr[v + 1])
+static MarkovOrder* rcm(int n, const long* ptr, const int* adj) {
+    // Step 1.
+    //   Build the symmetric adjacency lists, dropping self loops and
+    //   duplicate edges
+    // Step 2.
+    //   Breadth first search from a least degree state of each connected
+    //   part, queueing neighbors by increasing degree
+    // Step 3.
+    //   Reverse the order of the search
+
+    long* sym_ptr = (long*)calloc(n + 1, sizeof(long));
+    int* mark = (int*)malloc(n * sizeof(int));
+    if (sym_ptr == NULL || mark == NULL) {
+        perror("Failed to allocate memory for state order");
+        exit(EXIT_FAILURE);
+    }
+    for (int v = 0; v < n; v++) {
+        for (long e = ptr[v]; e < ptr[v + 1]; e++) {
+            if (adj[e] != v) {
+                sym_ptr[v + 1]++;
+                sym_ptr[adj[e] + 1]++;
+            }
+        }
+    }
+    for (int v = 0; v < n; v++) {
+        sym_ptr[v + 1] += sym_ptr[v];
+    }
+    int* sym = (int*)malloc((sym_ptr[n] > 0 ? sym_ptr[n] : 1) * sizeof(int));
+    long* fill = (long*)malloc(n * sizeof(long));
+    if (sym == NULL || fill == NULL) {
+        perror("Failed to allocate memory for state order");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(fill, sym_ptr, n * sizeof(long));
+    for (int v = 0; v < n; v++) {
+        for (long e = ptr[v]; e < ptr[v + 1]; e++) {
+            int w = adj[e];
+            if (w != v) {
+                sym[fill[v]++] = w;
+                sym[fill[w]++] = v;
+            }
+        }
+    }
+    // compact each list in place, keeping the first copy of each neighbor
+    int* degree = (int*)malloc(n * sizeof(int));
+    if (degree == NULL) {
+        perror("Failed to allocate memory for state order");
+        exit(EXIT_FAILURE);
+    }
+    memset(mark, -1, n * sizeof(int));
+    for (int v = 0; v < n; v++) {
+        long out = sym_ptr[v];
+        for (long e = sym_ptr[v]; e < fill[v]; e++) {
+            if (mark[sym[e]] != v) {
+                mark[sym[e]] = v;
+                sym[out++] = sym[e];
+            }
+        }
+        degree[v] = (int)(out - sym_ptr[v]);
+    }
+
+    // states by increasing degree, to pick the start of each part
+    OrderKey* keys = (OrderKey*)malloc(n * sizeof(OrderKey));
+    if (keys == NULL) {
+        perror("Failed to allocate memory for state order");
+        exit(EXIT_FAILURE);
+    }
+    for (int v = 0; v < n; v++) {
+        keys[v].key = degree[v];
+        keys[v].state = v;
+    }
+    qsort(keys, n, sizeof(OrderKey), compare_asc);
+
+    int* queue = (int*)malloc(n * sizeof(int));
+    OrderKey* next = (OrderKey*)malloc(n * sizeof(OrderKey));
+    char* visited = (char*)calloc(n, 1);
+    if (queue == NULL || next == NULL || visited == NULL) {
+        perror("Failed to allocate memory for state order");
+        exit(EXIT_FAILURE);
+    }
+    int tail = 0;
+    for (int s = 0; s < n; s++) {
+        int root = keys[s].state;
+        if (visited[root]) {
+            continue;
+        }
+        visited[root] = 1;
+        int head = tail;
+        queue[tail++] = root;
+        while (head < tail) {
+            int v = queue[head++];
+            int found = 0;
+            for (long e = sym_ptr[v]; e < sym_ptr[v] + degree[v]; e++) {
+                int w = sym[e];
+                if (!visited[w]) {
+                    visited[w] = 1;
+                    next[found].key = degree[w];
+                    next[found].state = w;
+                    found++;
+                }
+            }
+            qsort(next, found, sizeof(OrderKey), compare_asc);
+            for (int f = 0; f < found; f++) {
+                queue[tail++] = next[f].state;
+            }
+        }
+    }
+
+    MarkovOrder* O = new_order(n);
+    for (int p = 0; p < n; p++) {
+        O->perm[p] = queue[n - 1 - p];
+        O->pos[O->perm[p]] = p;
+    }
+
+    free(sym_ptr);
+    free(sym);
+    free(fill);
+    free(mark);
+    free(degree);
+    free(keys);
+    free(queue);
+    free(next);
+    free(visited);
+    return O;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// order_rcm(Markov* M)
+//
+//  Orders the states with Reverse Cuthill-McKee over the nonzero transitions
+//  of M taken in both directions. Each connected part starts from a state of
+//  least degree
+//
+// Returns:
+//    Pointer to the newly allocated MarkovOrder structure, or NULL if M is
+//    invalid
+///////////////////////////////////////////////////////////////////////////////
+MarkovOrder* order_rcm(Markov* M) {
+    if (M == NULL || M->matrix == NULL || M->size < 1) {
+        fprintf(stderr, "Invalid Markov structure.\n");
+        return NULL;
+    }
+
+    // the nonzero entries as adjacency lists
+    SparseMarkov* S = sparse_from_M(M);
+    if (S == NULL) {
+        return NULL;
+    }
+    MarkovOrder* O = rcm(S->size, S->row_ptr, S->col_idx);
+    free_sparse(S);
+    return O;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// order_rcm_sparse(SparseMarkov* S)
+//
+//  Same as order_rcm over the nonzeros of a sparse chain
+///////////////////////////////////////////////////////////////////////////////
+MarkovOrder* order_rcm_sparse(SparseMarkov* S) {
+    if (S == NULL || S->row_ptr == NULL || S->size < 1) {
+        fprintf(stderr, "Invalid SparseMarkov structure.\n");
+        return NULL;
+    }
+    return rcm(S->size, S->row_ptr, S->col_idx);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// permute_M(Markov* M, const int* perm_src)
+//
+//  Copies M into a new chain, moving state perm_src[p] to position p (rows,
+//  columns and helper counts)
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - perm_src: Array of M->size distinct states
+//
+// Returns:
+//    - A pointer to the new Markov structure
+///////////////////////////////////////////////////////////////////////////////
+Markov* permute_M(Markov* M, const int* perm_src) {
+    int n = M->size;
+    Markov* R = initialize_M(n);
+    for (int p = 0; p < n; p++) {
+        const double* src = M->matrix[perm_src[p]];
+        double* dst = R->matrix[p];
+        for (int q = 0; q < n; q++) {
+            dst[q] = src[perm_src[q]];
+        }
+        R->helper[p] = M->helper[perm_src[p]];
+    }
+    return R;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// order_apply(Markov* M, MarkovOrder* O)
+//
+// Returns:
+//    - A new chain with rows, columns and helper counts in the order of O,
+//      or NULL if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* order_apply(Markov* M, MarkovOrder* O) {
+    if (M == NULL || O == NULL || M->size != O->size) {
+        fprintf(stderr, "Invalid or mismatched Markov structure and order.\n");
+        return NULL;
+    }
+    return permute_M(M, O->perm);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// order_restore(Markov* P, MarkovOrder* O)
+//
+// Returns:
+//    - A new chain in the original order from one in the order of O, or NULL
+//      if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* order_restore(Markov* P, MarkovOrder* O) {
+    if (P == NULL || O == NULL || P->size != O->size) {
+        fprintf(stderr, "Invalid or mismatched Markov structure and order.\n");
+        return NULL;
+    }
+    return permute_M(P, O->pos);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// order_apply_sparse(SparseMarkov* S, MarkovOrder* O)
+//
+// Returns:
+//    - A new sparse chain in the order of O (columns sorted within each
+//      row), or NULL if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+SparseMarkov* order_apply_sparse(SparseMarkov* S, MarkovOrder* O) {
+    if (S == NULL || O == NULL || S->size != O->size) {
+        fprintf(stderr, "Invalid or mismatched SparseMarkov structure and order.\n");
+        return NULL;
+    }
+
+    int n = S->size;
+    SparseMarkov* R = (SparseMarkov*)malloc(sizeof(SparseMarkov));
+    if (R == NULL) {
+        perror("Failed to allocate memory for SparseMarkov structure");
+        exit(EXIT_FAILURE);
+    }
+    R->size = n;
+    R->nnz = S->nnz;
+    R->row_ptr = (long*)malloc((n + 1) * sizeof(long));
+    R->col_idx = (int*)malloc((S->nnz > 0 ? S->nnz : 1) * sizeof(int));
+    R->values = (double*)malloc((S->nnz > 0 ? S->nnz : 1) * sizeof(double));
+    R->helper = (int*)malloc(n * sizeof(int));
+    if (R->row_ptr == NULL || R->col_idx == NULL || R->values == NULL || R->helper == NULL) {
+        perror("Failed to allocate memory for sparse matrix");
+        exit(EXIT_FAILURE);
+    }
+
+    long longest = 0;
+    for (int i = 0; i < n; i++) {
+        long len = S->row_ptr[i + 1] - S->row_ptr[i];
+        longest = len > longest ? len : longest;
+    }
+    OrderCell* cells = (OrderCell*)malloc((longest > 0 ? longest : 1) * sizeof(OrderCell));
+    if (cells == NULL) {
+        perror("Failed to allocate memory for sparse matrix");
+        exit(EXIT_FAILURE);
+    }
+
+    long out = 0;
+    for (int p = 0; p < n; p++) {
+        int i = O->perm[p];
+        long begin = S->row_ptr[i];
+        long len = S->row_ptr[i + 1] - begin;
+        for (long c = 0; c < len; c++) {
+            cells[c].col = O->pos[S->col_idx[begin + c]];
+            cells[c].value = S->values[begin + c];
+        }
+        qsort(cells, len, sizeof(OrderCell), compare_cells);
+        R->row_ptr[p] = out;
+        for (long c = 0; c < len; c++) {
+            R->col_idx[out] = cells[c].col;
+            R->values[out++] = cells[c].value;
+        }
+        R->helper[p] = S->helper[i];
+    }
+    R->row_ptr[n] = out;
+    free(cells);
+    return R;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// order_mean_distance(Markov* M, MarkovOrder* O)
+//
+//  Measures how far transitions land from the diagonal under an order
+//
+// Returns:
+//    - The mean |pos[i] - pos[j]| over the observed transitions i -> j
+//      (O == NULL for the original order), or NAN if M is invalid or empty
+///////////////////////////////////////////////////////////////////////////////
+double order_mean_distance(Markov* M, MarkovOrder* O) {
+    if (M == NULL || M->matrix == NULL || (O != NULL && O->size != M->size)) {
+        fprintf(stderr, "Invalid or mismatched Markov structure and order.\n");
+        return NAN;
+    }
+
+    double distance = 0.0;
+    double total = 0.0;
+    for (int i = 0; i < M->size; i++) {
+        if (M->helper[i] == 0) {
+            continue;
+        }
+        int pi = O != NULL ? O->pos[i] : i;
+        double row_distance = 0.0;
+        for (int j = 0; j < M->size; j++) {
+            if (M->matrix[i][j] != 0.0) {
+                int pj = O != NULL ? O->pos[j] : j;
+                row_distance += M->matrix[i][j] * abs(pi - pj);
+            }
+        }
+        distance += M->helper[i] * row_distance;
+        total += M->helper[i];
+    }
+    return total > 0.0 ? distance / total : NAN;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_order(MarkovOrder* O)
+//
+//  Frees the MarkovOrder structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_order(MarkovOrder* O) {
+    if (O == NULL) return;
+
+    free(O->perm);
+    free(O->pos);
+    free(O);
+}
+
+// Sum of a stored row, or INFINITY if a cell is negative (nothing can then
+// be said about the cells not yet scanned)
+static double stored_row_sum(const double* row, int n) {
+    double sum = 0.0;
+    for (int q = 0; q < n; q++) {
+        if (row[q] < 0.0) {
+            return INFINITY;
+        }
+        sum += row[q];
+    }
+    return sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ordered_init(Markov* M, MarkovOrder* O)
+//
+//  Copies M into a chain stored in the order of O and takes the sum of each
+//  row. The structure takes ownership of O; M is left unchanged
+//
+// Returns:
+//    Pointer to the newly allocated OrderedMarkov structure, or NULL if the
+//    sizes differ
+///////////////////////////////////////////////////////////////////////////////
+OrderedMarkov* ordered_init(Markov* M, MarkovOrder* O) {
+    Markov* P = order_apply(M, O);
+    if (P == NULL) {
+        return NULL;
+    }
+
+    OrderedMarkov* OM = (OrderedMarkov*)malloc(sizeof(OrderedMarkov));
+    if (OM == NULL) {
+        perror("Failed to allocate memory for OrderedMarkov structure");
+        exit(EXIT_FAILURE);
+    }
+    OM->M = P;
+    OM->O = O;
+    OM->row_sum = (double*)malloc((P->size > 0 ? P->size : 1) * sizeof(double));
+    if (OM->row_sum == NULL) {
+        perror("Failed to allocate memory for the row sums");
+        exit(EXIT_FAILURE);
+    }
+    for (int p = 0; p < P->size; p++) {
+        OM->row_sum[p] = stored_row_sum(P->matrix[p], P->size);
+    }
+    return OM;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ordered_update(OrderedMarkov* OM, int i, int j)
+//
+//  Same as update_matrix(M, i, j) on the original states i and j, and
+//  takes the new sum of the row
+//
+// Returns:
+//    - 0 on success, -1 if i or j is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+int ordered_update(OrderedMarkov* OM, int i, int j) {
+    int size = OM->M->size;
+    if (i < 0 || j < 0 || i >= size || j >= size) {
+        fprintf(stderr, "invalid i, j indices ( %d, %d ) given size of %d.\n", i, j, size);
+        return -1;
+    }
+    int p = OM->O->pos[i];
+    if (update_matrix(OM->M, p, OM->O->pos[j]) != 0) {
+        return -1;
+    }
+    OM->row_sum[p] = stored_row_sum(OM->M->matrix[p], size);
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ordered_prob(OrderedMarkov* OM, int i, int j)
+//
+// Returns:
+//    - The probability of the transition i -> j between original states, or
+//      NAN if i or j is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+double ordered_prob(OrderedMarkov* OM, int i, int j) {
+    int size = OM->M->size;
+    if (i < 0 || j < 0 || i >= size || j >= size) {
+        fprintf(stderr, "invalid i, j indices ( %d, %d ) given size of %d.\n", i, j, size);
+        return NAN;
+    }
+    return OM->M->matrix[OM->O->pos[i]][OM->O->pos[j]];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ordered_max_prob_idx(OrderedMarkov* OM, int i)
+//
+//  Same as max_prob_idx(M, i) on the original chain, including its ties
+//  (the lowest original state wins). The row is scanned in the stored order
+//  and the scan stops once what is left of the row sum cannot beat the best
+//  cell so far; under order_by_frequency the hot columns come first and most
+//  rows stop within their first cache lines
+//
+// Returns:
+//    - The original state with the highest probability, or -1 if i is out
+//      of bounds
+///////////////////////////////////////////////////////////////////////////////
+int ordered_max_prob_idx(OrderedMarkov* OM, int i) {
+    if (OM == NULL || i < 0 || i >= OM->M->size) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+        return -1;
+    }
+
+    int p = OM->O->pos[i];
+    double sum = OM->row_sum[p];
+    if (sum == 0.0) {
+        return 0;   // every cell is 0, so the first original state wins
+    }
+
+    // the cells are not negative, so once what is left of the row sum (with
+    // some slack for rounding) is below the best cell, no later cell can
+    // reach it
+    const double* row = OM->M->matrix[p];
+    const int* perm = OM->O->perm;
+    double best = row[0];
+    int best_state = perm[0];
+    double seen = row[0];
+    double slack = ROW_SUM_SLACK * sum;
+    for (int q = 1; q < OM->M->size; q++) {
+        if (sum - seen + slack < best) {
+            break;
+        }
+        double v = row[q];
+        if (v > best || (v == best && perm[q] < best_state)) {
+            best = v;
+            best_state = perm[q];
+        }
+        seen += v;
+    }
+    return best_state;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ordered_to_M(OrderedMarkov* OM)
+//
+// Returns:
+//    - A new chain in the original order
+///////////////////////////////////////////////////////////////////////////////
+Markov* ordered_to_M(OrderedMarkov* OM) {
+    return order_restore(OM->M, OM->O);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_ordered(OrderedMarkov* OM)
+//
+//  Frees the chain, its order and the OrderedMarkov structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_ordered(OrderedMarkov* OM) {
+    if (OM == NULL) return;
+
+    free_M(OM->M);
+    free_order(OM->O);
+    free(OM->row_sum);
+    free(OM);
+}
@@ -0,0 +1,220 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_order.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_order.c state reordering. State indices are
+//   whatever the caller used, so the heavy successors of a row are scattered
+//   over its columns and the rows reached from one state are far apart in
+//   memory. A MarkovOrder relabels the states to bring them together:
+//   - order_by_frequency() puts the most visited states first, so the hot
+//     columns of every row share the first cache lines.
+//   - order_rcm() (Reverse Cuthill-McKee) numbers the states breadth first
+//     over the transition graph, so transitions stay close to the diagonal
+//     and the rows, columns and per-state arrays a walk touches are close
+//     together.
+//
+//   The order keeps both directions of the permutation, and an OrderedMarkov
+//   holds a chain stored in the new order behind an API that still takes
+//   and returns the caller's indices. Its probabilities are the same values
+//   as in the original chain, only moved.
+//
+// Usage:
+//   Include this header by using #include "markov_order.h" and use the
+//   functions below:
+//
+//      OrderedMarkov* OM = ordered_init(M, order_by_frequency(M));
+//      ordered_update(OM, i, j);
+//      int next = ordered_max_prob_idx(OM, i);
+//
+// NOTE:
+//   An order describes the chain it was computed from; after the traffic
+//   shifts it can be recomputed from ordered_to_M() and a new OrderedMarkov
+//   built from it. The row sums are kept by ordered_update(), so the stored
+//   chain should not be written to directly
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_ORDER
+#define MARKOV_ORDER
+
+#include "markov.h"
+#include "markov_sparse.h"
+
+// The MarkovOrder structure holds a relabeling of the states
+typedef struct MarkovOrder {
+    int size;
+    int* perm;   // perm[p] = original state placed at position p
+    int* pos;    // pos[i] = position of original state i (inverse of perm)
+} MarkovOrder;
+
+// The OrderedMarkov structure holds a chain stored in a new order
+typedef struct OrderedMarkov {
+    Markov* M;        // the chain, rows and columns in the new order
+    MarkovOrder* O;   // its order, owned by the structure
+    double* row_sum;  // sum of each stored row (INFINITY if a cell is negative)
+} OrderedMarkov;
+
+///////////////////////////////////////////////////////////////////////////////
+// order_by_frequency(Markov* M)
+//
+//  Orders the states by the number of observed transitions into them
+//  (the sum over i of helper[i] * M[i][j]), most visited first, ties by
+//  increasing state
+//
+// Returns:
+//    Pointer to the newly allocated MarkovOrder structure, or NULL if M is
+//    invalid
+///////////////////////////////////////////////////////////////////////////////
+MarkovOrder* order_by_frequency(Markov* M);
+
+///////////////////////////////////////////////////////////////////////////////
+// order_rcm(Markov* M)
+//
+//  Orders the states with Reverse Cuthill-McKee over the nonzero transitions
+//  of M taken in both directions. Each connected part starts from a state of
+//  least degree
+//
+// Returns:
+//    Pointer to the newly allocated MarkovOrder structure, or NULL if M is
+//    invalid
+///////////////////////////////////////////////////////////////////////////////
+MarkovOrder* order_rcm(Markov* M);
+
+///////////////////////////////////////////////////////////////////////////////
+// order_rcm_sparse(SparseMarkov* S)
+//
+//  Same as order_rcm over the nonzeros of a sparse chain
+///////////////////////////////////////////////////////////////////////////////
+MarkovOrder* order_rcm_sparse(SparseMarkov* S);
+
+///////////////////////////////////////////////////////////////////////////////
+// permute_M(Markov* M, const int* perm_src)
+//
+//  Copies M into a new chain, moving state perm_src[p] to position p (rows,
+//  columns and helper counts)
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - perm_src: Array of M->size distinct states
+//
+// Returns:
+//    - A pointer to the new Markov structure
+///////////////////////////////////////////////////////////////////////////////
+Markov* permute_M(Markov* M, const int* perm_src);
+
+///////////////////////////////////////////////////////////////////////////////
+// order_apply(Markov* M, MarkovOrder* O)
+//
+// Returns:
+//    - A new chain with rows, columns and helper counts in the order of O,
+//      or NULL if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* order_apply(Markov* M, MarkovOrder* O);
+
+///////////////////////////////////////////////////////////////////////////////
+// order_restore(Markov* P, MarkovOrder* O)
+//
+// Returns:
+//    - A new chain in the original order from one in the order of O, or NULL
+//      if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* order_restore(Markov* P, MarkovOrder* O);
+
+///////////////////////////////////////////////////////////////////////////////
+// order_apply_sparse(SparseMarkov* S, MarkovOrder* O)
+//
+// Returns:
+//    - A new sparse chain in the order of O (columns sorted within each
+//      row), or NULL if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+SparseMarkov* order_apply_sparse(SparseMarkov* S, MarkovOrder* O);
+
+///////////////////////////////////////////////////////////////////////////////
+// order_mean_distance(Markov* M, MarkovOrder* O)
+//
+//  Measures how far transitions land from the diagonal under an order
+//
+// Returns:
+//    - The mean |pos[i] - pos[j]| over the observed transitions i -> j
+//      (O == NULL for the original order), or NAN if M is invalid or empty
+///////////////////////////////////////////////////////////////////////////////
+double order_mean_distance(Markov* M, MarkovOrder* O);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_order(MarkovOrder* O)
+//
+//  Frees the MarkovOrder structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_order(MarkovOrder* O);
+
+///////////////////////////////////////////////////////////////////////////////
+// ordered_init(Markov* M, MarkovOrder* O)
+//
+//  Copies M into a chain stored in the order of O and takes the sum of each
+//  row. The structure takes ownership of O; M is left unchanged
+//
+// Returns:
+//    Pointer to the newly allocated OrderedMarkov structure, or NULL if the
+//    sizes differ
+///////////////////////////////////////////////////////////////////////////////
+OrderedMarkov* ordered_init(Markov* M, MarkovOrder* O);
+
+///////////////////////////////////////////////////////////////////////////////
+// ordered_update(OrderedMarkov* OM, int i, int j)
+//
+//  Same as update_matrix(M, i, j) on the original states i and j, and
+//  takes the new sum of the row
+//
+// Returns:
+//    - 0 on success, -1 if i or j is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+int ordered_update(OrderedMarkov* OM, int i, int j);
+
+///////////////////////////////////////////////////////////////////////////////
+// ordered_prob(OrderedMarkov* OM, int i, int j)
+//
+// Returns:
+//    - The probability of the transition i -> j between original states, or
+//      NAN if i or j is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+double ordered_prob(OrderedMarkov* OM, int i, int j);
+
+///////////////////////////////////////////////////////////////////////////////
+// ordered_max_prob_idx(OrderedMarkov* OM, int i)
+//
+//  Same as max_prob_idx(M, i) on the original chain, including its ties
+//  (the lowest original state wins). The row is scanned in the stored order
+//  and the scan stops once what is left of the row sum cannot beat the best
+//  cell so far; under order_by_frequency the hot columns come first and most
+//  rows stop within their first cache lines
+//
+// Returns:
+//    - The original state with the highest probability, or -1 if i is out
+//      of bounds
+///////////////////////////////////////////////////////////////////////////////
+int ordered_max_prob_idx(OrderedMarkov* OM, int i);
+
+///////////////////////////////////////////////////////////////////////////////
+// ordered_to_M(OrderedMarkov* OM)
+//
+// Returns:
+//    - A new chain in the original order
+///////////////////////////////////////////////////////////////////////////////
+Markov* ordered_to_M(OrderedMarkov* OM);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_ordered(OrderedMarkov* OM)
+//
+//  Frees the chain, its order and the OrderedMarkov structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_ordered(OrderedMarkov* OM);
+
+#endif
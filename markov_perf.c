@@ -0,0 +1,238 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_perf.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the hardware counters. Every counter is
+//   read with PERF_FORMAT_TOTAL_TIME_ENABLED and _RUNNING, and its value is
+//   scaled by enabled / running so that multiplexed counters estimate the
+//   full count.
+//
+// Usage:
+//   Include this source code by using #include "markov_perf.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "markov_perf.h"
+
+static const char* event_names[PERF_EVENTS] = {
+    "cycles", "instructions", "l1d-misses", "llc-misses", "dtlb-misses", "page-faults"
+};
+
+// Fills the type and config of an event
+static void event_attr(PerfEvent e, struct perf_event_attr* attr) {
+    const uint64_t read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    switch (e) {
+    case PERF_CYCLES:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PERF_INSTRUCTIONS:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PERF_L1D_MISSES:
+        attr->type = PERF_TYPE_HW_CACHE;
+        attr->config = PERF_COUNT_HW_CACHE_L1D | read_miss;
+        break;
+    case PERF_LLC_MISSES:
+        attr->type = PERF_TYPE_HW_CACHE;
+        attr->config = PERF_COUNT_HW_CACHE_LL | read_miss;
+        break;
+    case PERF_DTLB_MISSES:
+        attr->type = PERF_TYPE_HW_CACHE;
+        attr->config = PERF_COUNT_HW_CACHE_DTLB | read_miss;
+        break;
+    default:
+        attr->type = PERF_TYPE_SOFTWARE;
+        attr->config = PERF_COUNT_SW_PAGE_FAULTS;
+        break;
+    }
+}
+
+// Reads the scaled value of an open counter
+static double read_scaled(int fd) {
+    uint64_t values[3];   // value, time enabled, time running
+    if (read(fd, values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+        return 0.0;
+    }
+    return (double)values[0] * ((double)values[1] / (double)values[2]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_open(void)
+//
+//  Opens the counters of the calling thread, counting from now on
+//
+// Returns:
+//    Pointer to the newly allocated PerfCounters structure (with every
+//    event unavailable if the kernel offers none of them)
+///////////////////////////////////////////////////////////////////////////////
+PerfCounters* perf_open(void) {
+    PerfCounters* C = (PerfCounters*)malloc(sizeof(PerfCounters));
+    if (C == NULL) {
+        perror("Failed to allocate memory for PerfCounters structure");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        event_attr((PerfEvent)e, &attr);
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        C->fd[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (C->fd[e] < 0) {
+            C->fd[e] = -1;
+        }
+    }
+    perf_reset(C);
+    return C;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_available(PerfCounters* C, PerfEvent e)
+//
+// Returns:
+//    - 1 if the event is counted, 0 if it is not
+///////////////////////////////////////////////////////////////////////////////
+int perf_available(PerfCounters* C, PerfEvent e) {
+    return C != NULL && e >= 0 && e < PERF_EVENTS && C->fd[e] >= 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_start(PerfCounters* C)
+//
+//  Starts a measured section
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void perf_start(PerfCounters* C) {
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        if (C->fd[e] >= 0) {
+            C->start[e] = read_scaled(C->fd[e]);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_stop(PerfCounters* C, long ops)
+//
+//  Ends a measured section of ops operations, adding its counts to the
+//  totals
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void perf_stop(PerfCounters* C, long ops) {
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        if (C->fd[e] >= 0) {
+            C->total[e] += read_scaled(C->fd[e]) - C->start[e];
+        }
+    }
+    C->ops += ops;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_reset(PerfCounters* C)
+//
+//  Clears the totals and the number of operations
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void perf_reset(PerfCounters* C) {
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        C->start[e] = 0.0;
+        C->total[e] = 0.0;
+    }
+    C->ops = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_per_op(PerfCounters* C, PerfEvent e)
+//
+// Returns:
+//    - The count of the event per operation over the sections so far, or
+//      NAN if the event is unavailable or no operation was measured
+///////////////////////////////////////////////////////////////////////////////
+double perf_per_op(PerfCounters* C, PerfEvent e) {
+    if (!perf_available(C, e) || C->ops <= 0) {
+        return NAN;
+    }
+    return C->total[e] / C->ops;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_event_name(PerfEvent e)
+//
+// Returns:
+//    - The short name of the event used in reports (e.g. "llc-misses")
+///////////////////////////////////////////////////////////////////////////////
+const char* perf_event_name(PerfEvent e) {
+    return e >= 0 && e < PERF_EVENTS ? event_names[e] : "unknown";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_format(PerfCounters* C, char* out, size_t len)
+//
+//  Formats the counts per operation as "name value" pairs, with "n/a" for
+//  the unavailable events (and IPC when both cycles and instructions are
+//  counted)
+//
+// Returns:
+//    - The number of characters written, as snprintf
+///////////////////////////////////////////////////////////////////////////////
+int perf_format(PerfCounters* C, char* out, size_t len) {
+    int written = 0;
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        double v = perf_per_op(C, (PerfEvent)e);
+        char* at = (size_t)written < len ? out + written : NULL;
+        size_t room = at != NULL ? len - written : 0;
+        if (isnan(v)) {
+            written += snprintf(at, room, "%s%s n/a", e > 0 ? " " : "", event_names[e]);
+        } else {
+            written += snprintf(at, room, "%s%s %.2f", e > 0 ? " " : "", event_names[e], v);
+        }
+    }
+    double cycles = perf_per_op(C, PERF_CYCLES);
+    double instructions = perf_per_op(C, PERF_INSTRUCTIONS);
+    if (!isnan(cycles) && !isnan(instructions) && cycles > 0.0) {
+        char* at = (size_t)written < len ? out + written : NULL;
+        written += snprintf(at, at != NULL ? len - written : 0, " ipc %.2f", instructions / cycles);
+    }
+    return written;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_close(PerfCounters* C)
+//
+//  Closes the counters and frees the PerfCounters structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void perf_close(PerfCounters* C) {
+    if (C == NULL) return;
+
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        if (C->fd[e] >= 0) {
+            close(C->fd[e]);
+        }
+    }
+    free(C);
+}
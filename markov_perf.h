@@ -0,0 +1,149 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_perf.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_perf.c hardware counters. To reason about
+//   layout changes to the chain (the double** rows, the helper array), wall
+//   time is not enough. A PerfCounters structure opens Linux perf_event_open
+//   counters for the calling thread (user space only) and accumulates them
+//   over measured sections, to be reported per operation:
+//   - cycles and instructions
+//   - L1 data cache, last level cache and dTLB read misses
+//   - page faults (a software event, usually available even where the
+//     hardware counters are not)
+//
+//   Each counter is opened on its own, so a counter the machine or the
+//   kernel does not provide (e.g. inside a VM) is simply unavailable and
+//   the others still count. Counts are scaled by the time each counter was
+//   actually scheduled when the kernel multiplexes them.
+//
+// Usage:
+//   Include this header by using #include "markov_perf.h" and use the
+//   functions below:
+//
+//      PerfCounters* C = perf_open();
+//      perf_start(C);
+//      for (...) max_prob_idx(M, i);
+//      perf_stop(C, ops);
+//      perf_format(C, line, sizeof(line));   // "cycles 812.4 instructions ..."
+//      perf_close(C);
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_PERF
+#define MARKOV_PERF
+
+#include <stddef.h>
+
+// The counted events
+typedef enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_PAGE_FAULTS,
+    PERF_EVENTS          // number of events
+} PerfEvent;
+
+// The PerfCounters structure holds the counters of one thread and the
+// totals accumulated over its measured sections
+typedef struct PerfCounters {
+    int fd[PERF_EVENTS];              // -1 if the event is unavailable
+    double start[PERF_EVENTS];        // scaled values at perf_start
+    double total[PERF_EVENTS];        // accumulated over the sections
+    long ops;                         // operations in the sections
+} PerfCounters;
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_open(void)
+//
+//  Opens the counters of the calling thread, counting from now on
+//
+// Returns:
+//    Pointer to the newly allocated PerfCounters structure (with every
+//    event unavailable if the kernel offers none of them)
+///////////////////////////////////////////////////////////////////////////////
+PerfCounters* perf_open(void);
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_available(PerfCounters* C, PerfEvent e)
+//
+// Returns:
+//    - 1 if the event is counted, 0 if it is not
+///////////////////////////////////////////////////////////////////////////////
+int perf_available(PerfCounters* C, PerfEvent e);
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_start(PerfCounters* C)
+//
+//  Starts a measured section
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void perf_start(PerfCounters* C);
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_stop(PerfCounters* C, long ops)
+//
+//  Ends a measured section of ops operations, adding its counts to the
+//  totals
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void perf_stop(PerfCounters* C, long ops);
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_reset(PerfCounters* C)
+//
+//  Clears the totals and the number of operations
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void perf_reset(PerfCounters* C);
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_per_op(PerfCounters* C, PerfEvent e)
+//
+// Returns:
+//    - The count of the event per operation over the sections so far, or
+//      NAN if the event is unavailable or no operation was measured
+///////////////////////////////////////////////////////////////////////////////
+double perf_per_op(PerfCounters* C, PerfEvent e);
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_event_name(PerfEvent e)
+//
+// Returns:
+//    - The short name of the event used in reports (e.g. "llc-misses")
+///////////////////////////////////////////////////////////////////////////////
+const char* perf_event_name(PerfEvent e);
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_format(PerfCounters* C, char* out, size_t len)
+//
+//  Formats the counts per operation as "name value" pairs, with "n/a" for
+//  the unavailable events (and IPC when both cycles and instructions are
+//  counted)
+//
+// Returns:
+//    - The number of characters written, as snprintf
+///////////////////////////////////////////////////////////////////////////////
+int perf_format(PerfCounters* C, char* out, size_t len);
+
+///////////////////////////////////////////////////////////////////////////////
+// perf_close(PerfCounters* C)
+//
+//  Closes the counters and frees the PerfCounters structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void perf_close(PerfCounters* C);
+
+#endif
@@ -0,0 +1,259 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_pipeline.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the training pipeline. The ring is a
+//   bounded queue in which every slot carries a sequence number:
+//
+//     - a producer reads head, and if the slot at head has seq == head it
+//       claims the position with a compare-and-swap on head, fills the slot
+//       and releases it with seq = head + 1
+//     - seq < head means the worker has not consumed the slot from the
+//       previous lap yet: the ring is full
+//     - the worker consumes position pos once seq == pos + 1 and hands the
+//       slot to the next lap with seq = pos + capacity
+//
+//   Producers never wait on each other except to retry a lost CAS, and the
+//   worker never takes a lock. When the ring is empty the worker sleeps
+//   briefly instead of spinning.
+//
+// Usage:
+//   Include this source code by using #include "markov_pipeline.h" and use
+//   the functions below
+//
+// NOTE:
+//   While the pipeline runs, the chain belongs to the worker and must not be
+//   used directly. pipeline_stop() frees the pipeline but not the chain
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <time.h>
+#include "markov_pipeline.h"
+
+// worker sleep when the ring is empty
+#define IDLE_NS 20000
+
+static void idle_sleep(void) {
+    struct timespec ts = { 0, IDLE_NS };
+    nanosleep(&ts, NULL);
+}
+
+// Applies up to P->batch queued events and publishes the predictions of the
+// rows they touched. Returns the number of events applied
+static int drain_batch(MarkovPipeline* P, unsigned long batch_id) {
+    unsigned long pos = atomic_load_explicit(&P->applied, memory_order_relaxed);
+    int count = 0;
+    int touched = 0;
+    while (count < P->batch) {
+        PipelineSlot* slot = &P->ring[pos & P->mask];
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + 1) {
+            break;  // not filled yet
+        }
+        int prev = slot->prev;
+        int next = slot->next;
+        atomic_store_explicit(&slot->seq, pos + P->mask + 1, memory_order_release);
+        pos++;
+        count++;
+
+        update_matrix(P->M, prev, next);
+        if (P->stamp[prev] != batch_id) {
+            P->stamp[prev] = batch_id;
+            P->touched[touched++] = prev;
+        }
+    }
+
+    for (int t = 0; t < touched; t++) {
+        int row = P->touched[t];
+        atomic_store_explicit(&P->predictions[row], max_prob_idx(P->M, row), memory_order_release);
+    }
+    // published after the predictions, so pipeline_flush sees both
+    atomic_store_explicit(&P->applied, pos, memory_order_release);
+    return count;
+}
+
+static void* pipeline_worker(void* arg) {
+    MarkovPipeline* P = (MarkovPipeline*)arg;
+    unsigned long batch_id = 0;
+    for (;;) {
+        if (drain_batch(P, ++batch_id) > 0) {
+            continue;
+        }
+        // stop only once every claimed position has been consumed
+        if (!atomic_load(&P->running) &&
+            atomic_load(&P->applied) == atomic_load(&P->head)) {
+            break;
+        }
+        idle_sleep();
+    }
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// pipeline_start(Markov* M, int capacity, int batch, PipelinePolicy policy)
+//
+//  Starts a worker thread training M from a new ring buffer
+//
+// Parameters:
+//    - M: Pointer to the Markov structure to train
+//    - capacity: number of ring slots (rounded up to a power of two)
+//    - batch: maximum number of events applied before publishing predictions
+//    - policy: behavior of pipeline_push when the ring is full
+//
+// Returns:
+//    Pointer to the newly allocated MarkovPipeline structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+MarkovPipeline* pipeline_start(Markov* M, int capacity, int batch, PipelinePolicy policy) {
+    if (M == NULL || M->matrix == NULL || capacity < 1 || batch < 1) {
+        fprintf(stderr, "Invalid Markov structure or pipeline sizes.\n");
+        return NULL;
+    }
+
+    MarkovPipeline* P = (MarkovPipeline*)malloc(sizeof(MarkovPipeline));
+    if (P == NULL) {
+        perror("Failed to allocate memory for MarkovPipeline structure");
+        exit(EXIT_FAILURE);
+    }
+    unsigned long slots = 1;
+    while (slots < (unsigned long)capacity) {
+        slots <<= 1;
+    }
+    P->M = M;
+    P->mask = slots - 1;
+    P->batch = batch;
+    P->policy = policy;
+    P->ring = (PipelineSlot*)malloc(slots * sizeof(PipelineSlot));
+    P->predictions = (atomic_int*)malloc((M->size + 1) * sizeof(atomic_int));
+    P->touched = (int*)malloc(batch * sizeof(int));
+    P->stamp = (unsigned long*)calloc(M->size + 1, sizeof(unsigned long));
+    if (P->ring == NULL || P->predictions == NULL || P->touched == NULL || P->stamp == NULL) {
+        perror("Failed to allocate memory for pipeline");
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned long s = 0; s < slots; s++) {
+        atomic_init(&P->ring[s].seq, s);
+    }
+    for (int i = 0; i < M->size; i++) {
+        atomic_init(&P->predictions[i], max_prob_idx(M, i));
+    }
+    atomic_init(&P->head, 0);
+    atomic_init(&P->applied, 0);
+    atomic_init(&P->dropped, 0);
+    atomic_init(&P->running, 1);
+
+    if (pthread_create(&P->worker, NULL, pipeline_worker, P) != 0) {
+        perror("Failed to create worker thread");
+        exit(EXIT_FAILURE);
+    }
+    return P;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// pipeline_push(MarkovPipeline* P, int prev, int next)
+//
+//  Queues a transition from state prev to state next. Safe to call from any
+//  number of threads
+//
+// Returns:
+//    - 0 if the event was queued
+//    - -1 for invalid parameters, or if the ring was full with PIPELINE_DROP
+///////////////////////////////////////////////////////////////////////////////
+int pipeline_push(MarkovPipeline* P, int prev, int next) {
+    if (P == NULL || prev < 0 || next < 0 || prev >= P->M->size || next >= P->M->size) {
+        fprintf(stderr, "invalid prev, next indices ( %d, %d ).\n", prev, next);
+        return -1;
+    }
+
+    unsigned long pos = atomic_load_explicit(&P->head, memory_order_relaxed);
+    for (;;) {
+        PipelineSlot* slot = &P->ring[pos & P->mask];
+        unsigned long seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        long diff = (long)(seq - pos);
+        if (diff == 0) {
+            // the slot is free for position pos: try to claim it
+            if (atomic_compare_exchange_weak_explicit(&P->head, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                slot->prev = prev;
+                slot->next = next;
+                atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+                return 0;
+            }
+            // pos was reloaded by the failed CAS
+        } else if (diff < 0) {
+            // the worker has not consumed this slot from the previous lap
+            if (P->policy == PIPELINE_DROP) {
+                atomic_fetch_add_explicit(&P->dropped, 1, memory_order_relaxed);
+                return -1;
+            }
+            sched_yield();
+            pos = atomic_load_explicit(&P->head, memory_order_relaxed);
+        } else {
+            // another producer claimed pos
+            pos = atomic_load_explicit(&P->head, memory_order_relaxed);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// pipeline_predict(MarkovPipeline* P, int i)
+//
+//  Returns the most likely successor of state i as last published by the
+//  worker (max_prob_idx of the chain at the end of a batch)
+//
+// Returns:
+//    - The predicted state, or -1 if the input is invalid
+///////////////////////////////////////////////////////////////////////////////
+int pipeline_predict(MarkovPipeline* P, int i) {
+    if (P == NULL || i < 0 || i >= P->M->size) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+        return -1;
+    }
+    return atomic_load_explicit(&P->predictions[i], memory_order_acquire);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// pipeline_flush(MarkovPipeline* P)
+//
+//  Waits until every event queued before the call has been applied and its
+//  predictions published
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void pipeline_flush(MarkovPipeline* P) {
+    if (P == NULL) return;
+
+    unsigned long target = atomic_load(&P->head);
+    while (atomic_load_explicit(&P->applied, memory_order_acquire) < target) {
+        idle_sleep();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// pipeline_stop(MarkovPipeline* P)
+//
+//  Applies the queued events, stops the worker and frees the pipeline. The
+//  chain is not freed and may be used directly again
+//
+// Returns:
+//    - The number of events dropped since the pipeline started
+///////////////////////////////////////////////////////////////////////////////
+unsigned long pipeline_stop(MarkovPipeline* P) {
+    if (P == NULL) return 0;
+
+    atomic_store(&P->running, 0);
+    pthread_join(P->worker, NULL);
+    unsigned long dropped = atomic_load(&P->dropped);
+
+    free(P->ring);
+    free(P->predictions);
+    free(P->touched);
+    free(P->stamp);
+    free(P);
+    return dropped;
+}
@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_pipeline.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_pipeline.c training pipeline, which takes
+//   update_matrix() and max_prob_idx() off the page fault path. Faulting
+//   threads push (prev, next) events into a bounded lock-free ring buffer
+//   (any number of producers, one consumer). A background worker drains the
+//   ring in batches, applies the events to the chain and publishes the new
+//   most likely successor of every row it touched. A prediction is then a
+//   single atomic load.
+//
+//   When the ring is full the push either fails and counts a drop
+//   (PIPELINE_DROP, the fault path never waits) or waits for the worker to
+//   make room (PIPELINE_BLOCK, no event is lost).
+//
+// Usage:
+//   Include this header by using #include "markov_pipeline.h" and use the
+//   functions below:
+//
+//      MarkovPipeline* P = pipeline_start(M, 4096, 64, PIPELINE_DROP);
+//      pipeline_push(P, prev, next);     // on the fault path
+//      int guess = pipeline_predict(P, next);
+//      pipeline_stop(P);                 // M is up to date again
+//
+// NOTE:
+//   While the pipeline runs, the chain belongs to the worker and must not be
+//   used directly. pipeline_stop() frees the pipeline but not the chain
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_PIPELINE
+#define MARKOV_PIPELINE
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include "markov.h"
+
+// What pipeline_push does when the ring is full
+typedef enum PipelinePolicy {
+    PIPELINE_DROP = 0,  // drop the event and return -1
+    PIPELINE_BLOCK      // wait until the worker frees a slot
+} PipelinePolicy;
+
+// One ring slot. seq tells whose turn it is: pos when free for the producer
+// claiming position pos, pos + 1 once that producer has filled it
+typedef struct PipelineSlot {
+    atomic_ulong seq;
+    int prev;
+    int next;
+} PipelineSlot;
+
+// The MarkovPipeline structure holds the ring, the published predictions and
+// the worker thread
+typedef struct MarkovPipeline {
+    Markov* M;                  // chain trained by the worker
+    PipelineSlot* ring;         // capacity slots (a power of two)
+    unsigned long mask;         // capacity - 1
+    atomic_ulong head;          // next position claimed by a producer
+    atomic_ulong applied;       // positions consumed by the worker
+    atomic_ulong dropped;       // events dropped because the ring was full
+    atomic_int* predictions;    // max_prob_idx of each row, as last published
+    int* touched;               // worker's per-batch list of updated rows
+    unsigned long* stamp;       // batch in which each row was last listed
+    int batch;                  // maximum events applied per batch
+    PipelinePolicy policy;
+    atomic_int running;
+    pthread_t worker;
+} MarkovPipeline;
+
+///////////////////////////////////////////////////////////////////////////////
+// pipeline_start(Markov* M, int capacity, int batch, PipelinePolicy policy)
+//
+//  Starts a worker thread training M from a new ring buffer
+//
+// Parameters:
+//    - M: Pointer to the Markov structure to train
+//    - capacity: number of ring slots (rounded up to a power of two)
+//    - batch: maximum number of events applied before publishing predictions
+//    - policy: behavior of pipeline_push when the ring is full
+//
+// Returns:
+//    Pointer to the newly allocated MarkovPipeline structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+MarkovPipeline* pipeline_start(Markov* M, int capacity, int batch, PipelinePolicy policy);
+
+///////////////////////////////////////////////////////////////////////////////
+// pipeline_push(MarkovPipeline* P, int prev, int next)
+//
+//  Queues a transition from state prev to state next. Safe to call from any
+//  number of threads
+//
+// Returns:
+//    - 0 if the event was queued
+//    - -1 for invalid parameters, or if the ring was full with PIPELINE_DROP
+///////////////////////////////////////////////////////////////////////////////
+int pipeline_push(MarkovPipeline* P, int prev, int next);
+
+///////////////////////////////////////////////////////////////////////////////
+// pipeline_predict(MarkovPipeline* P, int i)
+//
+//  Returns the most likely successor of state i as last published by the
+//  worker (max_prob_idx of the chain at the end of a batch)
+//
+// Returns:
+//    - The predicted state, or -1 if the input is invalid
+///////////////////////////////////////////////////////////////////////////////
+int pipeline_predict(MarkovPipeline* P, int i);
+
+///////////////////////////////////////////////////////////////////////////////
+// pipeline_flush(MarkovPipeline* P)
+//
+//  Waits until every event queued before the call has been applied and its
+//  predictions published
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void pipeline_flush(MarkovPipeline* P);
+
+///////////////////////////////////////////////////////////////////////////////
+// pipeline_stop(MarkovPipeline* P)
+//
+//  Applies the queued events, stops the worker and frees the pipeline. The
+//  chain is not freed and may be used directly again
+//
+// Returns:
+//    - The number of events dropped since the pipeline started
+///////////////////////////////////////////////////////////////////////////////
+unsigned long pipeline_stop(MarkovPipeline* P);
+
+#endif
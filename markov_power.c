@@ -0,0 +1,249 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_power.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the incrementally maintained cache of
+//   k-step transition matrices (M^2 .. M^k).
+//
+//   Row i of M^m is the sum over l of M[i][l] * M^(m-1)[l], so it only
+//   changes if row i of M changed or if one of the rows of M^(m-1) it draws
+//   from changed. Starting from the dirty rows of M, the affected rows of each
+//   power are found level by level and only those rows are recomputed. The
+//   recomputation adds the terms in the same order as matrix_mult(), so the
+//   refreshed cache holds exactly the values a full recomputation would.
+//
+// Usage:
+//   Include this source code by using #include "markov_power.h" and use the
+//   functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the cache (see the function
+//   "free_power_cache" below)
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "markov_power.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// power_cache_init(Markov* M, int k, long max_stale)
+//
+//  Creates a cache of M^2 .. M^k, computing every power once
+//
+// Parameters:
+//    - M: Pointer to the Markov structure being learned
+//    - k: The highest power to keep (k >= 1)
+//    - max_stale: The number of update_matrix() calls on M that
+//                 power_cache_get() tolerates before refreshing (0 to always
+//                 return an up to date M^k)
+//
+// Returns:
+//    - Pointer to the newly allocated MarkovPower structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+MarkovPower* power_cache_init(Markov* M, int k, long max_stale) {
+    if (M == NULL || M->matrix == NULL || k < 1) {
+        fprintf(stderr, "Invalid Markov structure or power %d.\n", k);
+        return NULL;
+    }
+
+    MarkovPower* P = (MarkovPower*)malloc(sizeof(MarkovPower));
+    if (P == NULL) {
+        perror("Failed to allocate memory for MarkovPower structure");
+        exit(EXIT_FAILURE);
+    }
+    P->base = M;
+    P->k = k;
+    P->max_stale = max_stale;
+
+    P->powers = (Markov**)calloc(k + 1, sizeof(Markov*));
+    P->seen = (unsigned int*)malloc((M->size > 0 ? M->size : 1) * sizeof(unsigned int));
+    if (P->powers == NULL || P->seen == NULL) {
+        perror("Failed to allocate memory for power cache");
+        exit(EXIT_FAILURE);
+    }
+
+    // M^m = M x M^(m-1), starting from M^1 = M
+    for (int m = 2; m <= k; m++) {
+        P->powers[m] = matrix_mult(M, m == 2 ? M : P->powers[m - 1]);
+    }
+    memcpy(P->seen, M->version, M->size * sizeof(unsigned int));
+    return P;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// power_cache_pending(MarkovPower* P)
+//
+//  Counts the update_matrix() calls made on the base chain since the last
+//  refresh
+//
+// Parameters:
+//    - P: Pointer to the MarkovPower structure
+//
+// Returns:
+//    - The number of pending updates, or -1 if the input is invalid
+///////////////////////////////////////////////////////////////////////////////
+long power_cache_pending(MarkovPower* P) {
+    if (P == NULL) {
+        return -1;
+    }
+
+    long pending = 0;
+    for (int i = 0; i < P->base->size; i++) {
+        pending += (unsigned int)(P->base->version[i] - P->seen[i]);
+    }
+    return pending;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// power_cache_refresh(MarkovPower* P)
+//
+//  Brings every cached power up to date with the base chain. Only the rows of
+//  M^m that depend on an updated row of M are recomputed: row i of M^m is
+//  affected if row i of M was updated or if M[i][l] != 0 for a row l that is
+//  affected in M^(m-1).
+//
+// Parameters:
+//    - P: Pointer to the MarkovPower structure
+//
+// Returns:
+//    - The number of rows recomputed across all powers, or -1 on error
+///////////////////////////////////////////////////////////////////////////////
+long power_cache_refresh(MarkovPower* P) {
+    // Step 1.
+    //   Collect the dirty rows of M (version changed since last refresh)
+    // Step 2.
+    //   For each power m = 2 .. k, find the affected rows: the dirty rows plus
+    //   every row with a nonzero in a column that was affected in M^(m-1)
+    // Step 3.
+    //   Recompute each affected row of M^m as M[i] x M^(m-1)
+    // Step 4.
+    //   Record the current row versions as seen
+
+    if (P == NULL) {
+        fprintf(stderr, "Invalid MarkovPower structure.\n");
+        return -1;
+    }
+
+    Markov* M = P->base;
+    int n = M->size;
+    char* dirty = (char*)calloc(n > 0 ? n : 1, sizeof(char));
+    int* prev_list = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+    int* next_list = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+    double* row = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+    if (dirty == NULL || prev_list == NULL || next_list == NULL || row == NULL) {
+        perror("Failed to allocate memory for power cache refresh");
+        exit(EXIT_FAILURE);
+    }
+
+    int prev_count = 0;
+    for (int i = 0; i < n; i++) {
+        if (M->version[i] != P->seen[i]) {
+            dirty[i] = 1;
+            prev_list[prev_count++] = i;
+        }
+    }
+
+    long recomputed = 0;
+    for (int m = 2; m <= P->k && prev_count > 0; m++) {
+        Markov* prev = (m == 2) ? M : P->powers[m - 1];
+        Markov* cur = P->powers[m];
+
+        // affected rows of M^m: dirty rows, plus rows reaching an affected
+        // row of M^(m-1) in one step
+        int next_count = 0;
+        for (int i = 0; i < n; i++) {
+            int hit = dirty[i];
+            for (int a = 0; a < prev_count && !hit; a++) {
+                hit = M->matrix[i][prev_list[a]] != 0.0;
+            }
+            if (hit) {
+                next_list[next_count++] = i;
+            }
+        }
+
+        // recompute the affected rows, summing over l in increasing order
+        // exactly like matrix_mult()
+        for (int a = 0; a < next_count; a++) {
+            int i = next_list[a];
+            memset(row, 0, n * sizeof(double));
+            for (int l = 0; l < n; l++) {
+                double w = M->matrix[i][l];
+                if (w == 0.0) {
+                    continue;
+                }
+                for (int j = 0; j < n; j++) {
+                    row[j] += w * prev->matrix[l][j];
+                }
+            }
+            memcpy(cur->matrix[i], row, n * sizeof(double));
+            cur->version[i]++;
+        }
+        recomputed += next_count;
+
+        // the affected rows of this power drive the next one
+        int* swap = prev_list;
+        prev_list = next_list;
+        next_list = swap;
+        prev_count = next_count;
+    }
+
+    memcpy(P->seen, M->version, n * sizeof(unsigned int));
+    free(dirty);
+    free(prev_list);
+    free(next_list);
+    free(row);
+    return recomputed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// power_cache_get(MarkovPower* P)
+//
+//  Returns M^k, refreshing the cache first if more than max_stale updates are
+//  pending
+//
+// Parameters:
+//    - P: Pointer to the MarkovPower structure
+//
+// Returns:
+//    - Pointer to M^k (owned by the cache, valid until the cache is freed;
+//      the base chain itself when k is 1), or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+Markov* power_cache_get(MarkovPower* P) {
+    if (P == NULL) {
+        fprintf(stderr, "Invalid MarkovPower structure.\n");
+        return NULL;
+    }
+    if (P->k == 1) {
+        return P->base;
+    }
+    if (power_cache_pending(P) > P->max_stale) {
+        power_cache_refresh(P);
+    }
+    return P->powers[P->k];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_power_cache(MarkovPower* P)
+//
+//  Frees the cached powers and the MarkovPower structure (not the base chain)
+//
+// Parameters:
+//    - P: Pointer to the MarkovPower structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_power_cache(MarkovPower* P) {
+    if (P == NULL) return;
+
+    for (int m = 2; m <= P->k; m++) {
+        free_M(P->powers[m]);
+    }
+    free(P->powers);
+    free(P->seen);
+    free(P);
+}
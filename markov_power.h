@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_power.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_power.c cache of k-step transition matrices.
+//   The cache keeps M^2 .. M^k of a chain that is still being updated and,
+//   when asked for M^k, only recomputes the rows that can have changed since
+//   the last refresh instead of calling matrix_mult() from scratch.
+//
+//   Rows of M that were updated are detected through the version array:
+//   every call to update_matrix(M, i, j) increments M->version[i] (which,
+//   unlike the helper count, never saturates), so a row whose version
+//   differs from the one recorded at the last refresh is dirty. No change to
+//   the way the chain is updated is needed.
+//
+// Usage:
+//   Include this header by using #include "markov_power.h" and use the
+//   functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the cache (see the function
+//   "free_power_cache" below). The cache does not own the base chain, which
+//   must outlive it
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_POWER
+#define MARKOV_POWER
+
+#include "markov.h"
+
+// The MarkovPower structure holds the cached powers of a chain together with
+// the row versions of the chain at the time of the last refresh
+typedef struct MarkovPower {
+    Markov* base;     // The chain being learned (not owned by the cache)
+    Markov** powers;  // powers[m] = M^m for 2 <= m <= k (entries 0, 1 unused)
+    unsigned int* seen; // base->version at the time of the last refresh
+    int k;            // The highest power kept
+    long max_stale;   // Number of row updates a query may lag behind
+} MarkovPower;
+
+///////////////////////////////////////////////////////////////////////////////
+// power_cache_init(Markov* M, int k, long max_stale)
+//
+//  Creates a cache of M^2 .. M^k, computing every power once
+//
+// Parameters:
+//    - M: Pointer to the Markov structure being learned
+//    - k: The highest power to keep (k >= 1)
+//    - max_stale: The number of update_matrix() calls on M that
+//                 power_cache_get() tolerates before refreshing (0 to always
+//                 return an up to date M^k)
+//
+// Returns:
+//    - Pointer to the newly allocated MarkovPower structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+MarkovPower* power_cache_init(Markov* M, int k, long max_stale);
+
+///////////////////////////////////////////////////////////////////////////////
+// power_cache_pending(MarkovPower* P)
+//
+//  Counts the update_matrix() calls made on the base chain since the last
+//  refresh
+//
+// Parameters:
+//    - P: Pointer to the MarkovPower structure
+//
+// Returns:
+//    - The number of pending updates, or -1 if the input is invalid
+///////////////////////////////////////////////////////////////////////////////
+long power_cache_pending(MarkovPower* P);
+
+///////////////////////////////////////////////////////////////////////////////
+// power_cache_refresh(MarkovPower* P)
+//
+//  Brings every cached power up to date with the base chain. Only the rows of
+//  M^m that depend on an updated row of M are recomputed: row i of M^m is
+//  affected if row i of M was updated or if M[i][l] != 0 for a row l that is
+//  affected in M^(m-1).
+//
+// Parameters:
+//    - P: Pointer to the MarkovPower structure
+//
+// Returns:
+//    - The number of rows recomputed across all powers, or -1 on error
+///////////////////////////////////////////////////////////////////////////////
+long power_cache_refresh(MarkovPower* P);
+
+///////////////////////////////////////////////////////////////////////////////
+// power_cache_get(MarkovPower* P)
+//
+//  Returns M^k, refreshing the cache first if more than max_stale updates are
+//  pending
+//
+// Parameters:
+//    - P: Pointer to the MarkovPower structure
+//
+// Returns:
+//    - Pointer to M^k (owned by the cache, valid until the cache is freed;
+//      the base chain itself when k is 1), or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+Markov* power_cache_get(MarkovPower* P);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_power_cache(MarkovPower* P)
+//
+//  Frees the cached powers and the MarkovPower structure (not the base chain)
+//
+// Parameters:
+//    - P: Pointer to the MarkovPower structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_power_cache(MarkovPower* P);
+
+#endif
@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_prefetch.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the prefetch policy. Outstanding
+//   prefetches are kept twice: expires[state] answers in O(1) whether an
+//   access was prefetched, and a ring in issue order (so in deadline order)
+//   finds the prefetches that expire. A ring entry whose state was used, or
+//   prefetched again with a later deadline, no longer matches expires[] and
+//   is skipped when it leaves the ring.
+//
+// Usage:
+//   Include this source code by using #include "markov_prefetch.h" and use
+//   the functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "markov_prefetch.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// prefetch_init(Markov* M, double min_prob, int min_samples,
+//               int max_degree, int horizon)
+//
+//  Creates a policy over a chain, starting at degree 1
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - min_prob: Least probability of a prefetched successor (> 0)
+//    - min_samples: Least number of updates of a row that predicts
+//    - max_degree: Most successors named per prediction
+//    - horizon: Number of accesses within which a prefetch counts as used
+//
+// Returns:
+//    Pointer to the newly allocated PrefetchPolicy structure, or NULL for
+//    invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+PrefetchPolicy* prefetch_init(Markov* M, double min_prob, int min_samples, int max_degree,
+                              int horizon) {
+    if (M == NULL || M->matrix == NULL || !(min_prob > 0.0) || min_samples < 0 ||
+        max_degree < 1 || horizon < 1) {
+        fprintf(stderr, "Invalid prefetch policy parameters.\n");
+        return NULL;
+    }
+
+    PrefetchPolicy* P = (PrefetchPolicy*)malloc(sizeof(PrefetchPolicy));
+    if (P == NULL) {
+        perror("Failed to allocate memory for PrefetchPolicy structure");
+        exit(EXIT_FAILURE);
+    }
+    P->M = M;
+    P->min_prob = min_prob;
+    P->min_samples = min_samples;
+    P->max_degree = max_degree;
+    P->degree = 1;
+    P->horizon = horizon;
+    P->tick = 0;
+    // every access can issue max_degree prefetches, each outstanding for
+    // horizon accesses
+    P->ring_cap = max_degree * (horizon + 1);
+    P->ring_head = 0;
+    P->ring_count = 0;
+    P->expires = (unsigned long*)calloc(M->size, sizeof(unsigned long));
+    P->ring = (PrefetchEntry*)malloc(P->ring_cap * sizeof(PrefetchEntry));
+    P->scratch = (double*)malloc(max_degree * sizeof(double));
+    if (P->expires == NULL || P->ring == NULL || P->scratch == NULL) {
+        perror("Failed to allocate memory for outstanding prefetches");
+        exit(EXIT_FAILURE);
+    }
+    P->window_used = 0;
+    P->window_wasted = 0;
+    P->issued = 0;
+    P->used = 0;
+    P->wasted = 0;
+    P->suppressed = 0;
+    return P;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// prefetch_predict(PrefetchPolicy* P, int i, int* states)
+//
+//  Names the successors of state i worth prefetching: up to `degree` of the
+//  most probable successors with at least min_prob, if row i has at least
+//  min_samples updates. Successors already outstanding are not named again
+//
+// Parameters:
+//    - P: Pointer to the PrefetchPolicy structure
+//    - i: Current state
+//    - states: Array of max_degree entries receiving the successors, best
+//              first
+//
+// Returns:
+//    - The number of successors written, or -1 if i is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+int prefetch_predict(PrefetchPolicy* P, int i, int* states) {
+    // Step 1.
+    //   Hold back rows with too few updates
+    // Step 2.
+    //   Keep the `degree` best cells of the row with at least min_prob,
+    //   sorted by decreasing probability (ties by increasing state)
+    // Step 3.
+    //   Name the ones not already outstanding, each due within horizon
+    //   accesses
+
+    if (P == NULL || i < 0 || i >= P->M->size || states == NULL) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+        return -1;
+    }
+    if (P->M->helper[i] < P->min_samples || P->M->helper[i] == 0) {
+        P->suppressed++;
+        return 0;
+    }
+
+    const double* row = P->M->matrix[i];
+    double* best = P->scratch;
+    int found = 0;
+    for (int j = 0; j < P->M->size; j++) {
+        double v = row[j];
+        if (v < P->min_prob || (found == P->degree && v <= best[found - 1])) {
+            continue;
+        }
+        int k = found < P->degree ? found++ : found - 1;
+        while (k > 0 && best[k - 1] < v) {
+            best[k] = best[k - 1];
+            states[k] = states[k - 1];
+            k--;
+        }
+        best[k] = v;
+        states[k] = j;
+    }
+    if (found == 0) {
+        P->suppressed++;
+        return 0;
+    }
+
+    unsigned long deadline = P->tick + P->horizon;
+    int count = 0;
+    for (int f = 0; f < found && P->ring_count < P->ring_cap; f++) {
+        int j = states[f];
+        if (P->expires[j] != 0) {
+            continue;
+        }
+        P->expires[j] = deadline;
+        int slot = (P->ring_head + P->ring_count++) % P->ring_cap;
+        P->ring[slot].state = j;
+        P->ring[slot].deadline = deadline;
+        states[count++] = j;
+        P->issued++;
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// prefetch_observe(PrefetchPolicy* P, int state)
+//
+//  Records an access to state: it uses an outstanding prefetch of state,
+//  prefetches outside their horizon are counted as wasted, and the degree
+//  is adjusted once a window of prefetches has been resolved
+//
+// Returns:
+//    - 1 if the access was prefetched, 0 if not, -1 if state is out of
+//      bounds
+///////////////////////////////////////////////////////////////////////////////
+int prefetch_observe(PrefetchPolicy* P, int state) {
+    if (P == NULL || state < 0 || state >= P->M->size) {
+        fprintf(stderr, "Invalid input or state out of bounds.\n");
+        return -1;
+    }
+
+    P->tick++;
+    while (P->ring_count > 0 && P->ring[P->ring_head].deadline < P->tick) {
+        PrefetchEntry* e = &P->ring[P->ring_head];
+        if (P->expires[e->state] == e->deadline) {
+            P->expires[e->state] = 0;
+            P->wasted++;
+            P->window_wasted++;
+        }
+        P->ring_head = (P->ring_head + 1) % P->ring_cap;
+        P->ring_count--;
+    }
+
+    int hit = P->expires[state] != 0;
+    if (hit) {
+        P->expires[state] = 0;
+        P->used++;
+        P->window_used++;
+    }
+
+    unsigned long resolved = P->window_used + P->window_wasted;
+    if (resolved >= PREFETCH_WINDOW) {
+        double accuracy = (double)P->window_used / resolved;
+        if (accuracy >= PREFETCH_RAISE && P->degree < P->max_degree) {
+            P->degree++;
+        } else if (accuracy < PREFETCH_LOWER && P->degree > 1) {
+            P->degree--;
+        }
+        P->window_used = 0;
+        P->window_wasted = 0;
+    }
+    return hit;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_prefetch(PrefetchPolicy* P)
+//
+//  Frees the PrefetchPolicy structure (not the chain)
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_prefetch(PrefetchPolicy* P) {
+    if (P == NULL) return;
+
+    free(P->expires);
+    free(P->ring);
+    free(P->scratch);
+    free(P);
+}
@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_prefetch.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_prefetch.c prefetch policy. max_prob_idx()
+//   names a best successor even for a row updated once, or one whose best
+//   cell is 0.1, and prefetching on every such guess wastes I/O bandwidth.
+//   A PrefetchPolicy only names successors when the row has at least
+//   min_samples updates (helper[i]) and the successor has at least min_prob,
+//   and names at most `degree` of them, best first.
+//
+//   The policy also learns whether its prefetches pay off. Each prefetched
+//   state stays outstanding for the next `horizon` accesses: it is used if
+//   it is accessed within them, and wasted otherwise. After every
+//   PREFETCH_WINDOW resolved prefetches the degree is raised by one if at
+//   least PREFETCH_RAISE of them were used, and lowered by one (down to 1)
+//   if fewer than PREFETCH_LOWER were. The counters issued, used, wasted and
+//   suppressed (predictions held back by the thresholds) report the spend.
+//
+// Usage:
+//   Include this header by using #include "markov_prefetch.h" and use the
+//   functions below:
+//
+//      PrefetchPolicy* P = prefetch_init(M, 0.3, 8, 4, 2);
+//      // on every access to state s following state prev:
+//      prefetch_observe(P, s);
+//      update_matrix(M, prev, s);
+//      int count = prefetch_predict(P, s, states);   // prefetch states[0..count)
+//
+// NOTE:
+//   The policy reads the chain but does not own or update it
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_PREFETCH
+#define MARKOV_PREFETCH
+
+#include "markov.h"
+
+#define PREFETCH_WINDOW 64      // resolved prefetches between degree changes
+#define PREFETCH_RAISE 0.75     // fraction used above which the degree grows
+#define PREFETCH_LOWER 0.40     // fraction used below which the degree shrinks
+
+// A prefetched state and the access count after which it is wasted
+typedef struct PrefetchEntry {
+    int state;
+    unsigned long deadline;
+} PrefetchEntry;
+
+// The PrefetchPolicy structure holds the thresholds, the outstanding
+// prefetches and the feedback counters
+typedef struct PrefetchPolicy {
+    Markov* M;                 // chain the predictions come from
+    double min_prob;           // least probability of a prefetched successor
+    int min_samples;           // least helper count of a predicting row
+    int max_degree;            // most successors per prediction
+    int degree;                // current degree (1 .. max_degree)
+    int horizon;               // accesses a prefetch stays useful for
+    unsigned long tick;        // accesses observed so far
+    unsigned long* expires;    // deadline of each outstanding state, 0 if none
+    PrefetchEntry* ring;       // outstanding prefetches in issue order
+    int ring_cap;
+    int ring_head;
+    int ring_count;
+    double* scratch;           // probabilities of the best candidates
+    unsigned long window_used;
+    unsigned long window_wasted;
+    unsigned long issued;      // prefetches named by prefetch_predict
+    unsigned long used;        // accessed within their horizon
+    unsigned long wasted;      // expired without an access
+    unsigned long suppressed;  // predictions held back by the thresholds
+} PrefetchPolicy;
+
+///////////////////////////////////////////////////////////////////////////////
+// prefetch_init(Markov* M, double min_prob, int min_samples,
+//               int max_degree, int horizon)
+//
+//  Creates a policy over a chain, starting at degree 1
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - min_prob: Least probability of a prefetched successor (> 0)
+//    - min_samples: Least number of updates of a row that predicts
+//    - max_degree: Most successors named per prediction
+//    - horizon: Number of accesses within which a prefetch counts as used
+//
+// Returns:
+//    Pointer to the newly allocated PrefetchPolicy structure, or NULL for
+//    invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+PrefetchPolicy* prefetch_init(Markov* M, double min_prob, int min_samples, int max_degree,
+                              int horizon);
+
+///////////////////////////////////////////////////////////////////////////////
+// prefetch_predict(PrefetchPolicy* P, int i, int* states)
+//
+//  Names the successors of state i worth prefetching: up to `degree` of the
+//  most probable successors with at least min_prob, if row i has at least
+//  min_samples updates. Successors already outstanding are not named again
+//
+// Parameters:
+//    - P: Pointer to the PrefetchPolicy structure
+//    - i: Current state
+//    - states: Array of max_degree entries receiving the successors, best
+//              first
+//
+// Returns:
+//    - The number of successors written, or -1 if i is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+int prefetch_predict(PrefetchPolicy* P, int i, int* states);
+
+///////////////////////////////////////////////////////////////////////////////
+// prefetch_observe(PrefetchPolicy* P, int state)
+//
+//  Records an access to state: it uses an outstanding prefetch of state,
+//  prefetches outside their horizon are counted as wasted, and the degree
+//  is adjusted once a window of prefetches has been resolved
+//
+// Returns:
+//    - 1 if the access was prefetched, 0 if not, -1 if state is out of
+//      bounds
+///////////////////////////////////////////////////////////////////////////////
+int prefetch_observe(PrefetchPolicy* P, int state);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_prefetch(PrefetchPolicy* P)
+//
+//  Frees the PrefetchPolicy structure (not the chain)
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_prefetch(PrefetchPolicy* P);
+
+#endif
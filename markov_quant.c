@@ -0,0 +1,481 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_quant.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the compressed (8-bit) chain.
+//
+//   A cold row stores code_k = round(255 * p_k / max_p) and scale = max_p. An
+//   update decodes p_k = code_k * scale / 255, applies the same rescale as
+//   update_matrix() ((p_k * alpha + [k == j]) / (alpha + 1)) and encodes the
+//   row again; the new maximum is found in a first pass so no temporary row
+//   is needed. Once a row has been updated hot_threshold times its counts are
+//   recovered (round(p_k * helper)) and kept exactly from then on, with the
+//   total of the counts stored after the last column.
+//
+//   The codes are monotonic in the probability within a row, so the largest
+//   probability is always among the columns holding the largest code. The
+//   argmax finds that code with unsigned byte max instructions, then finds
+//   the first column holding it with byte compares and a movemask (32 columns
+//   per instruction with AVX2).
+//
+// Usage:
+//   Include this source code by using #include "markov_quant.h" and use the
+//   functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the allocated memory for the
+//   compressed chain (see the function "free_quant" below)
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "markov_quant.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#define CODE_MAX 255
+
+// Returns the codes of row i
+static inline uint8_t* row_codes(QuantMarkov* Q, int i) {
+    return Q->codes + (size_t)i * Q->stride;
+}
+
+// Encodes row i from its exact counts
+static void encode_counts(QuantMarkov* Q, int i) {
+    uint32_t* c = Q->counts[i];
+    uint8_t* codes = row_codes(Q, i);
+    uint32_t cmax = 0;
+    for (int k = 0; k < Q->size; k++) {
+        if (c[k] > cmax) {
+            cmax = c[k];
+        }
+    }
+    uint32_t total = c[Q->size];
+    Q->scale[i] = total > 0 ? (float)cmax / (float)total : 0.0f;
+    for (int k = 0; k < Q->size; k++) {
+        // integer rounding keeps the codes monotonic in the counts
+        codes[k] = cmax > 0 ? (uint8_t)(((uint64_t)c[k] * CODE_MAX + cmax / 2) / cmax) : 0;
+    }
+}
+
+// Halves the exact counts of row i (rounding up, so no observed successor
+// drops to 0), keeping their ratios, before the total would wrap
+static void halve_counts(QuantMarkov* Q, int i) {
+    uint32_t* c = Q->counts[i];
+    uint32_t total = 0;
+    for (int k = 0; k < Q->size; k++) {
+        c[k] = c[k] / 2 + (c[k] & 1);
+        total += c[k];
+    }
+    c[Q->size] = total;
+}
+
+// Switches row i to exact counts, recovering them from its probabilities
+static void promote_row(QuantMarkov* Q, int i) {
+    uint32_t* c = (uint32_t*)calloc(Q->size + 1, sizeof(uint32_t));
+    if (c == NULL) {
+        perror("Failed to allocate memory for row counts");
+        exit(EXIT_FAILURE);
+    }
+    uint8_t* codes = row_codes(Q, i);
+    uint32_t total = 0;
+    for (int k = 0; k < Q->size; k++) {
+        double p = codes[k] * (double)Q->scale[i] / CODE_MAX;
+        c[k] = (uint32_t)lrint(p * Q->helper[i]);
+        total += c[k];
+    }
+    c[Q->size] = total;
+    Q->counts[i] = c;
+    encode_counts(Q, i);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_quant(int size, int hot_threshold)
+//
+//  Initializes an empty compressed chain
+//
+// Parameters:
+//    - size: The number of states
+//    - hot_threshold: number of updates after which a row keeps exact counts
+//                     (0 keeps exact counts for every updated row)
+//
+// Returns:
+//    Pointer to the newly allocated QuantMarkov structure
+///////////////////////////////////////////////////////////////////////////////
+QuantMarkov* initialize_quant(int size, int hot_threshold) {
+    QuantMarkov* Q = (QuantMarkov*)malloc(sizeof(QuantMarkov));
+    if (Q == NULL) {
+        perror("Failed to allocate memory for QuantMarkov structure");
+        exit(EXIT_FAILURE);
+    }
+    Q->size = size;
+    Q->stride = (size + 31) & ~31;
+    Q->hot_threshold = hot_threshold;
+
+    // padding codes stay 0, after every real column, so they never change the
+    // leftmost maximum
+    Q->codes = (uint8_t*)calloc((size_t)size * Q->stride + 1, 1);
+    Q->scale = (float*)calloc(size + 1, sizeof(float));
+    Q->helper = (int*)calloc(size + 1, sizeof(int));
+    Q->counts = (uint32_t**)calloc(size + 1, sizeof(uint32_t*));
+    if (Q->codes == NULL || Q->scale == NULL || Q->helper == NULL || Q->counts == NULL) {
+        perror("Failed to allocate memory for compressed rows");
+        exit(EXIT_FAILURE);
+    }
+    return Q;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// quantize_M(Markov* M, int hot_threshold)
+//
+//  Compresses a Markov structure. Rows with at least hot_threshold updates
+//  get exact counts recovered from their probabilities and helper counts
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - hot_threshold: see initialize_quant
+//
+// Returns:
+//    Pointer to the newly allocated QuantMarkov structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+QuantMarkov* quantize_M(Markov* M, int hot_threshold) {
+    if (M == NULL || M->matrix == NULL) {
+        fprintf(stderr, "Invalid Markov structure.\n");
+        return NULL;
+    }
+
+    QuantMarkov* Q = initialize_quant(M->size, hot_threshold);
+    for (int i = 0; i < M->size; i++) {
+        const double* row = M->matrix[i];
+        uint8_t* codes = row_codes(Q, i);
+        double max = 0.0;
+        for (int k = 0; k < M->size; k++) {
+            if (row[k] > max) {
+                max = row[k];
+            }
+        }
+        Q->scale[i] = (float)max;
+        for (int k = 0; k < M->size; k++) {
+            codes[k] = max > 0.0 ? (uint8_t)lrint(row[k] / max * CODE_MAX) : 0;
+        }
+        Q->helper[i] = M->helper[i];
+
+        if (M->helper[i] > 0 && M->helper[i] >= hot_threshold) {
+            // recover the counts from the full precision row
+            uint32_t* c = (uint32_t*)calloc(M->size + 1, sizeof(uint32_t));
+            if (c == NULL) {
+                perror("Failed to allocate memory for row counts");
+                exit(EXIT_FAILURE);
+            }
+            uint32_t total = 0;
+            for (int k = 0; k < M->size; k++) {
+                c[k] = (uint32_t)lrint(row[k] * M->helper[i]);
+                total += c[k];
+            }
+            c[M->size] = total;
+            Q->counts[i] = c;
+            encode_counts(Q, i);
+        }
+    }
+    return Q;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// quant_update(QuantMarkov* Q, int i, int j)
+//
+//  Updates the compressed chain to reflect a state transition from state i
+//  to state j, like update_matrix
+//
+// Parameters:
+//    - Q: Pointer to the QuantMarkov structure
+//    - i: index of the previous state (row)
+//    - j: index of the next state (column)
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+//
+// NOTE:
+//    The helper count saturates at INT_MAX, as in update_matrix. The exact
+//    counts of a hot row are halved when their total reaches UINT32_MAX
+///////////////////////////////////////////////////////////////////////////////
+int quant_update(QuantMarkov* Q, int i, int j) {
+    if (Q == NULL || i >= Q->size || j >= Q->size || i < 0 || j < 0) {
+        fprintf(stderr, "invalid i, j indices ( %d, %d ) given size of %d.\n", i, j,
+                Q != NULL ? Q->size : 0);
+        return -1;
+    }
+
+    if (Q->counts[i] == NULL && Q->helper[i] >= Q->hot_threshold) {
+        promote_row(Q, i);
+    }
+
+    // the count saturates at INT_MAX, as in update_matrix
+    int alpha = Q->helper[i];
+    if (alpha < INT_MAX) {
+        Q->helper[i]++;
+    }
+    if (Q->counts[i] != NULL) {
+        if (Q->counts[i][Q->size] == UINT32_MAX) {
+            halve_counts(Q, i);
+        }
+        Q->counts[i][j]++;
+        Q->counts[i][Q->size]++;
+        encode_counts(Q, i);
+        return 0;
+    }
+
+    // cold row: decode, rescale like update_matrix and encode again
+    uint8_t* codes = row_codes(Q, i);
+    double unit = (double)Q->scale[i] / CODE_MAX;
+    double max = 0.0;
+    for (int k = 0; k < Q->size; k++) {
+        double p = (codes[k] * unit * alpha + (k == j)) / (alpha + 1.0);
+        if (p > max) {
+            max = p;
+        }
+    }
+    for (int k = 0; k < Q->size; k++) {
+        double p = (codes[k] * unit * alpha + (k == j)) / (alpha + 1.0);
+        codes[k] = (uint8_t)lrint(p / max * CODE_MAX);
+    }
+    Q->scale[i] = (float)max;
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// quant_prob(QuantMarkov* Q, int i, int j)
+//
+//  Decodes the probability of the transition from state i to state j
+//
+// Returns:
+//    - The (approximate for cold rows) probability, or -1 for invalid indices
+///////////////////////////////////////////////////////////////////////////////
+double quant_prob(QuantMarkov* Q, int i, int j) {
+    if (Q == NULL || i >= Q->size || j >= Q->size || i < 0 || j < 0) {
+        fprintf(stderr, "Invalid input or index out of bounds.\n");
+        return -1.0;
+    }
+    if (Q->counts[i] != NULL) {
+        uint32_t total = Q->counts[i][Q->size];
+        return total > 0 ? (double)Q->counts[i][j] / total : 0.0;
+    }
+    return row_codes(Q, i)[j] * (double)Q->scale[i] / CODE_MAX;
+}
+
+// Returns the largest code of a row
+static uint8_t max_code(const uint8_t* codes, int stride) {
+#ifdef __AVX2__
+    __m256i mx = _mm256_setzero_si256();
+    for (int b = 0; b < stride; b += 32) {
+        mx = _mm256_max_epu8(mx, _mm256_loadu_si256((const __m256i*)(codes + b)));
+    }
+    // fold the 32 bytes down to one
+    __m128i m = _mm_max_epu8(_mm256_castsi256_si128(mx), _mm256_extracti128_si256(mx, 1));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 8));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 2));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 1));
+    return (uint8_t)_mm_cvtsi128_si32(m);
+#else
+    uint8_t mx = 0;
+    for (int b = 0; b < stride; b++) {
+        if (codes[b] > mx) {
+            mx = codes[b];
+        }
+    }
+    return mx;
+#endif
+}
+
+// Returns a bit mask of the columns b .. b + 31 whose code is >= c
+static inline uint32_t mask_at_least(const uint8_t* codes, int b, uint8_t c) {
+#ifdef __AVX2__
+    __m256i v = _mm256_loadu_si256((const __m256i*)(codes + b));
+    __m256i ge = _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8((char)c)), v);
+    return (uint32_t)_mm256_movemask_epi8(ge);
+#else
+    uint32_t mask = 0;
+    for (int l = 0; l < 32; l++) {
+        if (codes[b + l] >= c) {
+            mask |= 1u << l;
+        }
+    }
+    return mask;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// quant_max_prob_idx(QuantMarkov* Q, int i)
+//
+//  Finds the index of the maximum probability in row `i`, working directly on
+//  the codes with vector byte compares
+//
+// Returns:
+//    - The column index of the maximum code in the row (exact maximum
+//      probability for hot rows)
+//    - -1 if the input is invalid or the row index is out of bounds.
+//
+// NOTE:
+//    Returns the leftmost index in the event of a tie
+///////////////////////////////////////////////////////////////////////////////
+int quant_max_prob_idx(QuantMarkov* Q, int i) {
+    if (Q == NULL || i < 0 || i >= Q->size) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+        return -1; // Return an error indicator
+    }
+
+    const uint8_t* codes = row_codes(Q, i);
+    uint8_t mx = max_code(codes, Q->stride);
+    const uint32_t* c = Q->counts[i];
+    int best = -1;
+
+    // only columns holding the top code can hold the largest probability;
+    // for hot rows the counts break ties between them
+    for (int b = 0; b < Q->stride; b += 32) {
+        uint32_t mask = mask_at_least(codes, b, mx);
+        while (mask != 0) {
+            int k = b + __builtin_ctz(mask);
+            mask &= mask - 1;
+            if (k >= Q->size) {
+                break;
+            }
+            if (c == NULL) {
+                return k;
+            }
+            if (best < 0 || c[k] > c[best]) {
+                best = k;
+            }
+        }
+    }
+    return best < 0 ? 0 : best;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// quant_top_k(QuantMarkov* Q, int i, int k, int* out)
+//
+//  Finds the k most probable successors of state i from the codes
+//
+// Parameters:
+//    - Q: Pointer to the QuantMarkov structure
+//    - i: Index of the row to search
+//    - k: Number of successors wanted
+//    - out: Array of at least k entries receiving the column indices, most
+//           probable first (ties in column order)
+//
+// Returns:
+//    - The number of indices written (min(k, size)), or -1 on invalid input
+///////////////////////////////////////////////////////////////////////////////
+int quant_top_k(QuantMarkov* Q, int i, int k, int* out) {
+    // Step 1.
+    //   Histogram the codes of the row and find the cutoff code: the largest
+    //   code c such that at least k columns hold a code >= c
+    // Step 2.
+    //   Give each code >= c its slot range in the output (larger codes first)
+    // Step 3.
+    //   Scan the row with byte compares against c and place each candidate in
+    //   its slot, taking only as many columns with the cutoff code as needed
+
+    if (Q == NULL || out == NULL || i < 0 || i >= Q->size || k < 0) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+        return -1;
+    }
+    if (k > Q->size) {
+        k = Q->size;
+    }
+    if (k == 0) {
+        return 0;
+    }
+
+    const uint8_t* codes = row_codes(Q, i);
+    int hist[CODE_MAX + 1] = { 0 };
+    for (int col = 0; col < Q->size; col++) {
+        hist[codes[col]]++;
+    }
+
+    int cut = CODE_MAX;
+    int above = 0;   // columns with a code > cut
+    while (above + hist[cut] < k) {
+        above += hist[cut];
+        cut--;
+    }
+
+    int slot[CODE_MAX + 1];
+    int pos = 0;
+    for (int c = CODE_MAX; c >= cut; c--) {
+        slot[c] = pos;
+        pos += hist[c];
+    }
+    int need_cut = k - above;
+
+    for (int b = 0; b < Q->stride && need_cut + above > 0; b += 32) {
+        uint32_t mask = mask_at_least(codes, b, (uint8_t)cut);
+        while (mask != 0) {
+            int col = b + __builtin_ctz(mask);
+            mask &= mask - 1;
+            if (col >= Q->size) {
+                break;
+            }
+            uint8_t c = codes[col];
+            if (c > cut) {
+                out[slot[c]++] = col;
+                above--;
+            } else if (need_cut > 0) {
+                out[slot[c]++] = col;
+                need_cut--;
+            }
+        }
+    }
+    return k;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// quant_memory(QuantMarkov* Q)
+//
+//  Counts the bytes used by the compressed chain
+//
+// Returns:
+//    - The number of bytes allocated for the structure and its arrays
+///////////////////////////////////////////////////////////////////////////////
+size_t quant_memory(QuantMarkov* Q) {
+    if (Q == NULL) {
+        return 0;
+    }
+    size_t bytes = sizeof(QuantMarkov);
+    bytes += (size_t)Q->size * Q->stride;
+    bytes += (size_t)Q->size * (sizeof(float) + sizeof(int) + sizeof(uint32_t*));
+    for (int i = 0; i < Q->size; i++) {
+        if (Q->counts[i] != NULL) {
+            bytes += (size_t)(Q->size + 1) * sizeof(uint32_t);
+        }
+    }
+    return bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_quant(QuantMarkov* Q)
+//
+//  Frees the memory allocated for the QuantMarkov structure.
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_quant(QuantMarkov* Q) {
+    if (Q == NULL) return;
+
+    for (int i = 0; i < Q->size; i++) {
+        free(Q->counts[i]);
+    }
+    free(Q->counts);
+    free(Q->codes);
+    free(Q->scale);
+    free(Q->helper);
+    free(Q);
+}
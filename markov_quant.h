@@ -0,0 +1,161 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_quant.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_quant.c compressed chain, which stores each
+//   probability as an 8-bit code instead of a double (8x less memory for the
+//   matrix). Codes are scaled per row: code 255 is the largest probability of
+//   the row and code c stands for c / 255 of it, so the most likely successor
+//   of a row always keeps the top code.
+//
+//   Rows that have been updated at least hot_threshold times also keep exact
+//   transition counts. Their codes are always recomputed from the counts (so
+//   no error accumulates), and ties between equal codes are broken with the
+//   counts, so their argmax is exact. Cold rows are updated by decoding,
+//   applying the same rescale as update_matrix() and encoding again.
+//
+// Usage:
+//   Include this header by using #include "markov_quant.h" and use the
+//   functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the allocated memory for the
+//   compressed chain (see the function "free_quant" below)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_QUANT
+#define MARKOV_QUANT
+
+#include <stdint.h>
+#include <stddef.h>
+#include "markov.h"
+
+// The QuantMarkov structure holds the 8-bit codes of every row, the scale of
+// each row, the helper array and the exact counts of hot rows
+typedef struct QuantMarkov {
+    uint8_t* codes;     // size x stride codes, row major
+    float* scale;       // probability represented by code 255, per row
+    int* helper;        // 1D array to track the number of updates to each row
+    uint32_t** counts;  // exact counts of hot rows (NULL for cold rows)
+    int hot_threshold;  // updates after which a row keeps exact counts
+    int size;           // The number of states
+    int stride;         // bytes per row of codes (size rounded up to 32)
+} QuantMarkov;
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_quant(int size, int hot_threshold)
+//
+//  Initializes an empty compressed chain
+//
+// Parameters:
+//    - size: The number of states
+//    - hot_threshold: number of updates after which a row keeps exact counts
+//                     (0 keeps exact counts for every updated row)
+//
+// Returns:
+//    Pointer to the newly allocated QuantMarkov structure
+///////////////////////////////////////////////////////////////////////////////
+QuantMarkov* initialize_quant(int size, int hot_threshold);
+
+///////////////////////////////////////////////////////////////////////////////
+// quantize_M(Markov* M, int hot_threshold)
+//
+//  Compresses a Markov structure. Rows with at least hot_threshold updates
+//  get exact counts recovered from their probabilities and helper counts
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - hot_threshold: see initialize_quant
+//
+// Returns:
+//    Pointer to the newly allocated QuantMarkov structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+QuantMarkov* quantize_M(Markov* M, int hot_threshold);
+
+///////////////////////////////////////////////////////////////////////////////
+// quant_update(QuantMarkov* Q, int i, int j)
+//
+//  Updates the compressed chain to reflect a state transition from state i
+//  to state j, like update_matrix
+//
+// Parameters:
+//    - Q: Pointer to the QuantMarkov structure
+//    - i: index of the previous state (row)
+//    - j: index of the next state (column)
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+//
+// NOTE:
+//    The helper count saturates at INT_MAX, as in update_matrix. The exact
+//    counts of a hot row are halved when their total reaches UINT32_MAX
+///////////////////////////////////////////////////////////////////////////////
+int quant_update(QuantMarkov* Q, int i, int j);
+
+///////////////////////////////////////////////////////////////////////////////
+// quant_prob(QuantMarkov* Q, int i, int j)
+//
+//  Decodes the probability of the transition from state i to state j
+//
+// Returns:
+//    - The (approximate for cold rows) probability, or -1 for invalid indices
+///////////////////////////////////////////////////////////////////////////////
+double quant_prob(QuantMarkov* Q, int i, int j);
+
+///////////////////////////////////////////////////////////////////////////////
+// quant_max_prob_idx(QuantMarkov* Q, int i)
+//
+//  Finds the index of the maximum probability in row `i`, working directly on
+//  the codes with vector byte compares
+//
+// Returns:
+//    - The column index of the maximum code in the row (exact maximum
+//      probability for hot rows)
+//    - -1 if the input is invalid or the row index is out of bounds.
+//
+// NOTE:
+//    Returns the leftmost index in the event of a tie
+///////////////////////////////////////////////////////////////////////////////
+int quant_max_prob_idx(QuantMarkov* Q, int i);
+
+///////////////////////////////////////////////////////////////////////////////
+// quant_top_k(QuantMarkov* Q, int i, int k, int* out)
+//
+//  Finds the k most probable successors of state i from the codes
+//
+// Parameters:
+//    - Q: Pointer to the QuantMarkov structure
+//    - i: Index of the row to search
+//    - k: Number of successors wanted
+//    - out: Array of at least k entries receiving the column indices, most
+//           probable first (ties in column order)
+//
+// Returns:
+//    - The number of indices written (min(k, size)), or -1 on invalid input
+///////////////////////////////////////////////////////////////////////////////
+int quant_top_k(QuantMarkov* Q, int i, int k, int* out);
+
+///////////////////////////////////////////////////////////////////////////////
+// quant_memory(QuantMarkov* Q)
+//
+//  Counts the bytes used by the compressed chain
+//
+// Returns:
+//    - The number of bytes allocated for the structure and its arrays
+///////////////////////////////////////////////////////////////////////////////
+size_t quant_memory(QuantMarkov* Q);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_quant(QuantMarkov* Q)
+//
+//  Frees the memory allocated for the QuantMarkov structure.
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_quant(QuantMarkov* Q);
+
+#endif
@@ -0,0 +1,268 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_reach.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the k-step reachability queries. The
+//   mass of a step is scattered into a dense array indexed by state, and the
+//   states it touches are listed so that only they are read and cleared
+//   afterwards; a query never sweeps an array of the chain's size. The beam
+//   and the result are chosen with a quickselect over the touched states.
+//
+// Usage:
+//   Include this source code by using #include "markov_reach.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "markov_reach.h"
+
+// Returns 1 if a ranks before b: larger value first, then smaller state
+static inline int ranks_before(const ReachEntry* a, const ReachEntry* b) {
+    return a->value > b->value || (a->value == b->value && a->state < b->state);
+}
+
+static int compare_entries(const void* a, const void* b) {
+    const ReachEntry* x = (const ReachEntry*)a;
+    const ReachEntry* y = (const ReachEntry*)b;
+    return ranks_before(x, y) ? -1 : ranks_before(y, x) ? 1 : 0;
+}
+
+static inline void swap_entries(ReachEntry* a, ReachEntry* b) {
+    ReachEntry t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// Reorders e[0 .. n) so that its first k entries are the k best (unsorted)
+static void select_best(ReachEntry* e, int n, int k) {
+    int lo = 0;
+    int hi = n - 1;
+    while (lo < hi) {
+        // median of three as the pivot, moved to hi
+        int mid = lo + (hi - lo) / 2;
+        if (ranks_before(&e[mid], &e[lo])) swap_entries(&e[mid], &e[lo]);
+        if (ranks_before(&e[hi], &e[lo])) swap_entries(&e[hi], &e[lo]);
+        if (ranks_before(&e[mid], &e[hi])) swap_entries(&e[mid], &e[hi]);
+        ReachEntry pivot = e[hi];
+        int store = lo;
+        for (int i = lo; i < hi; i++) {
+            if (ranks_before(&e[i], &pivot)) {
+                swap_entries(&e[i], &e[store++]);
+            }
+        }
+        swap_entries(&e[store], &e[hi]);
+        if (store == k - 1 || store == k) {
+            return;
+        }
+        if (store < k) {
+            lo = store + 1;
+        } else {
+            hi = store - 1;
+        }
+    }
+}
+
+// Adds v to the mass of state j, listing j the first time it is reached
+static inline void add_mass(MarkovReach* R, int* touched, int j, double v) {
+    if (R->mass[j] == 0.0) {
+        R->touched[(*touched)++] = j;
+    }
+    R->mass[j] += v;
+}
+
+// Runs the beam search over a dense (M) or sparse (S) chain
+static int beam_search(MarkovReach* R, Markov* M, SparseMarkov* S, int start, int k,
+                       int beam, double min_prob, int top, int* states, double* scores) {
+    // Step 1.
+    //   Start with all the mass on the start state
+    // Step 2.
+    //   At each step, push the mass of every frontier state through its row
+    //   and add the mass reaching each state to its score
+    // Step 3.
+    //   Keep the beam states with the most mass (at least min_prob) as the
+    //   next frontier, clearing the mass of the step
+    // Step 4.
+    //   Select and sort the top states by score, clearing the scores
+
+    int size = R->size;
+    int frontier = 1;
+    int scored = 0;
+    R->frontier[0].state = start;
+    R->frontier[0].value = 1.0;
+
+    for (int step = 0; step < k && frontier > 0; step++) {
+        int touched = 0;
+        for (int f = 0; f < frontier; f++) {
+            int s = R->frontier[f].state;
+            double m = R->frontier[f].value;
+            if (S != NULL) {
+                for (long p = S->row_ptr[s]; p < S->row_ptr[s + 1]; p++) {
+                    double v = m * S->values[p];
+                    if (v > 0.0) {
+                        add_mass(R, &touched, S->col_idx[p], v);
+                    }
+                }
+            } else {
+                const double* row = M->matrix[s];
+                for (int j = 0; j < size; j++) {
+                    double v = m * row[j];
+                    if (v > 0.0) {
+                        add_mass(R, &touched, j, v);
+                    }
+                }
+            }
+        }
+
+        int cand = 0;
+        for (int t = 0; t < touched; t++) {
+            int j = R->touched[t];
+            double m = R->mass[j];
+            if (R->score[j] == 0.0) {
+                R->scored[scored++] = j;
+            }
+            R->score[j] += m;
+            if (m >= min_prob) {
+                R->cand[cand].state = j;
+                R->cand[cand].value = m;
+                cand++;
+            }
+            R->mass[j] = 0.0;
+        }
+        if (cand > beam) {
+            select_best(R->cand, cand, beam);
+            cand = beam;
+        }
+        for (int c = 0; c < cand; c++) {
+            R->frontier[c] = R->cand[c];
+        }
+        frontier = cand;
+    }
+
+    for (int s = 0; s < scored; s++) {
+        int j = R->scored[s];
+        R->cand[s].state = j;
+        R->cand[s].value = R->score[j];
+        R->score[j] = 0.0;
+    }
+    int found = scored < top ? scored : top;
+    if (scored > found) {
+        select_best(R->cand, scored, found);
+    }
+    qsort(R->cand, found, sizeof(ReachEntry), compare_entries);
+    for (int f = 0; f < found; f++) {
+        states[f] = R->cand[f].state;
+        if (scores != NULL) {
+            scores[f] = R->cand[f].value;
+        }
+    }
+    return found;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reach_init(int size)
+//
+//  Allocates the scratch space for queries on chains of the given size
+//
+// Returns:
+//    Pointer to the newly allocated MarkovReach structure, or NULL if size
+//    is invalid
+///////////////////////////////////////////////////////////////////////////////
+MarkovReach* reach_init(int size) {
+    if (size < 1) {
+        fprintf(stderr, "Invalid size %d.\n", size);
+        return NULL;
+    }
+
+    MarkovReach* R = (MarkovReach*)malloc(sizeof(MarkovReach));
+    if (R == NULL) {
+        perror("Failed to allocate memory for MarkovReach structure");
+        exit(EXIT_FAILURE);
+    }
+    R->size = size;
+    R->mass = (double*)calloc(size, sizeof(double));
+    R->score = (double*)calloc(size, sizeof(double));
+    R->touched = (int*)malloc(size * sizeof(int));
+    R->scored = (int*)malloc(size * sizeof(int));
+    R->frontier = (ReachEntry*)malloc(size * sizeof(ReachEntry));
+    R->cand = (ReachEntry*)malloc(size * sizeof(ReachEntry));
+    if (R->mass == NULL || R->score == NULL || R->touched == NULL || R->scored == NULL ||
+        R->frontier == NULL || R->cand == NULL) {
+        perror("Failed to allocate memory for reachability scratch space");
+        exit(EXIT_FAILURE);
+    }
+    return R;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reach_top_n(MarkovReach* R, Markov* M, int start, int k, int beam,
+//             double min_prob, int top, int* states, double* scores)
+//
+//  Finds the states with the highest expected number of visits within k
+//  steps from start, with a beam search over the rows of a dense chain
+//
+// Parameters:
+//    - R: Scratch space for chains of M's size
+//    - M: Pointer to the Markov structure
+//    - start: State the walk starts from (step 0 is not counted)
+//    - k: Number of steps
+//    - beam: Number of states expanded at each step
+//    - min_prob: Mass below which a state is not expanded
+//    - top: Number of states wanted
+//    - states, scores: Arrays of top entries receiving the states, by
+//                      decreasing score (ties by increasing state)
+//
+// Returns:
+//    - The number of states written (at most top), or -1 for invalid
+//      parameters
+///////////////////////////////////////////////////////////////////////////////
+int reach_top_n(MarkovReach* R, Markov* M, int start, int k, int beam,
+                double min_prob, int top, int* states, double* scores) {
+    if (R == NULL || M == NULL || M->matrix == NULL || M->size != R->size || start < 0 ||
+        start >= M->size || k < 0 || beam < 1 || top < 0 || states == NULL) {
+        fprintf(stderr, "Invalid reachability query.\n");
+        return -1;
+    }
+    return beam_search(R, M, NULL, start, k, beam, min_prob, top, states, scores);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reach_top_n_sparse(MarkovReach* R, SparseMarkov* S, int start, int k,
+//                    int beam, double min_prob, int top, int* states,
+//                    double* scores)
+//
+//  Same as reach_top_n over a sparse chain, reading only the nonzeros of
+//  each expanded row
+///////////////////////////////////////////////////////////////////////////////
+int reach_top_n_sparse(MarkovReach* R, SparseMarkov* S, int start, int k, int beam,
+                       double min_prob, int top, int* states, double* scores) {
+    if (R == NULL || S == NULL || S->size != R->size || start < 0 || start >= S->size ||
+        k < 0 || beam < 1 || top < 0 || states == NULL) {
+        fprintf(stderr, "Invalid reachability query.\n");
+        return -1;
+    }
+    return beam_search(R, NULL, S, start, k, beam, min_prob, top, states, scores);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_reach(MarkovReach* R)
+//
+//  Frees the scratch space and the MarkovReach structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_reach(MarkovReach* R) {
+    if (R == NULL) return;
+
+    free(R->mass);
+    free(R->score);
+    free(R->touched);
+    free(R->scored);
+    free(R->frontier);
+    free(R->cand);
+    free(R);
+}
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_reach.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_reach.c k-step reachability queries. To find
+//   the states most likely to be visited within the next k steps from a
+//   start state, the chain is not raised to M^k with matrix_mult (n^3 work
+//   per step). Instead the probability mass leaving the start state is
+//   pushed through the successor rows one step at a time, keeping only the
+//   `beam` states holding the most mass (and none below min_prob) after
+//   each step.
+//
+//   The score of a state is its expected number of visits within k steps,
+//   i.e. the sum over t = 1..k of the mass reaching it at step t (row start
+//   of M + M^2 + ... + M^k). With a beam as wide as the chain and min_prob
+//   0 the scores are exact; a narrower beam drops the least likely paths.
+//   A query reads at most beam rows per step, so it costs O(k * beam * row
+//   length) regardless of n, on dense (Markov) or sparse (SparseMarkov)
+//   chains.
+//
+// Usage:
+//   Include this header by using #include "markov_reach.h" and use the
+//   functions below:
+//
+//      MarkovReach* R = reach_init(M->size);
+//      int found = reach_top_n(R, M, state, 4, 32, 1e-4, 8, pages, scores);
+//
+//   The MarkovReach structure holds the scratch space of the queries, so a
+//   query allocates nothing; it is reused across queries, one per thread
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_REACH
+#define MARKOV_REACH
+
+#include "markov.h"
+#include "markov_sparse.h"
+
+// A state and its mass or score
+typedef struct ReachEntry {
+    int state;
+    double value;
+} ReachEntry;
+
+// The MarkovReach structure holds the scratch space of reachability queries
+// on chains of a given size. Every array is left zeroed between queries
+typedef struct MarkovReach {
+    int size;
+    double* mass;          // mass reaching each state at the current step
+    double* score;         // expected visits accumulated so far
+    int* touched;          // states with mass at the current step
+    int* scored;           // states with a score
+    ReachEntry* frontier;  // states expanded at the next step
+    ReachEntry* cand;      // candidates for the frontier or the result
+} MarkovReach;
+
+///////////////////////////////////////////////////////////////////////////////
+// reach_init(int size)
+//
+//  Allocates the scratch space for queries on chains of the given size
+//
+// Returns:
+//    Pointer to the newly allocated MarkovReach structure, or NULL if size
+//    is invalid
+///////////////////////////////////////////////////////////////////////////////
+MarkovReach* reach_init(int size);
+
+///////////////////////////////////////////////////////////////////////////////
+// reach_top_n(MarkovReach* R, Markov* M, int start, int k, int beam,
+//             double min_prob, int top, int* states, double* scores)
+//
+//  Finds the states with the highest expected number of visits within k
+//  steps from start, with a beam search over the rows of a dense chain
+//
+// Parameters:
+//    - R: Scratch space for chains of M's size
+//    - M: Pointer to the Markov structure
+//    - start: State the walk starts from (step 0 is not counted)
+//    - k: Number of steps
+//    - beam: Number of states expanded at each step
+//    - min_prob: Mass below which a state is not expanded
+//    - top: Number of states wanted
+//    - states, scores: Arrays of top entries receiving the states, by
+//                      decreasing score (ties by increasing state)
+//
+// Returns:
+//    - The number of states written (at most top), or -1 for invalid
+//      parameters
+///////////////////////////////////////////////////////////////////////////////
+int reach_top_n(MarkovReach* R, Markov* M, int start, int k, int beam,
+                double min_prob, int top, int* states, double* scores);
+
+///////////////////////////////////////////////////////////////////////////////
+// reach_top_n_sparse(MarkovReach* R, SparseMarkov* S, int start, int k,
+//                    int beam, double min_prob, int top, int* states,
+//                    double* scores)
+//
+//  Same as reach_top_n over a sparse chain, reading only the nonzeros of
+//  each expanded row
+///////////////////////////////////////////////////////////////////////////////
+int reach_top_n_sparse(MarkovReach* R, SparseMarkov* S, int start, int k, int beam,
+                       double min_prob, int top, int* states, double* scores);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_reach(MarkovReach* R)
+//
+//  Frees the scratch space and the MarkovReach structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_reach(MarkovReach* R);
+
+#endif
@@ -0,0 +1,577 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_registry.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the multi-tenant registry. A slot holds
+//   the helper array (padded to 64 bytes) followed by the rows, each padded
+//   to 8 doubles. A slab starts with a 64-byte header and its free slots are
+//   chained through their first bytes. A slab is charged to the budget when
+//   it is carved and released when its last slot is freed.
+//
+//   The clock hand walks the hash table. A tenant that was used since the
+//   hand last passed only loses its referenced flag. The hand first
+//   compacts cold dense chains (those that compacting would shrink), and
+//   evicts cold chains only when every candidate is already compacted. The
+//   tenant being accessed is never picked. If the remaining tenants cannot
+//   make room, the registry goes over budget rather than fail the access.
+//
+// Usage:
+//   Include this source code by using #include "markov_registry.h" and use
+//   the functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "markov_registry.h"
+
+#define SLAB_BYTES (2u << 20)       // largest slab
+#define MIN_SLAB_BYTES 4096u        // smallest slab
+#define SLAB_HEADER 64              // bytes before the first slot of a slab
+#define MIN_SLOT_BYTES 256
+
+_Static_assert(sizeof(RegistrySlab) <= SLAB_HEADER, "slab header does not fit");
+#define PREFETCH_DISTANCE 8
+
+// Mixes a tenant id into a table index (splitmix64 finalizer)
+static inline uint64_t hash_id(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Bytes of the helper section and of the whole chain in a slot
+static size_t helper_bytes(int size) {
+    return ((size_t)size * sizeof(int) + 63) & ~(size_t)63;
+}
+
+static size_t chain_bytes(int size) {
+    size_t stride = ((size_t)size + 7) & ~(size_t)7;
+    return helper_bytes(size) + (size_t)size * stride * sizeof(double);
+}
+
+// Slot sizes grow in quarter steps (256, 320, 384, 448, 512, 640, ...), so a
+// chain wastes at most a fifth of its slot
+static size_t slot_bytes(int cls) {
+    return ((size_t)MIN_SLOT_BYTES << (cls / 4)) * (4 + cls % 4) / 4;
+}
+
+// Smallest size class holding a chain of the given size, or -1
+static int size_class(int size) {
+    size_t bytes = chain_bytes(size);
+    for (int c = 0; c < REGISTRY_CLASSES; c++) {
+        if (slot_bytes(c) >= bytes) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+// Slab size for a budget: the largest power of two up to an eighth of it,
+// within [MIN_SLAB_BYTES, SLAB_BYTES], so one slab never takes most of it
+static size_t slab_size(size_t budget) {
+    size_t slab = MIN_SLAB_BYTES;
+    while (slab < SLAB_BYTES && slab * 2 <= budget / 8) {
+        slab *= 2;
+    }
+    return slab;
+}
+
+// Bytes of a slab of the class (several slab sizes for a slot that does
+// not fit a single slab, which then holds only that slot)
+static size_t class_slab_bytes(const TenantRegistry* R, int cls) {
+    size_t need = SLAB_HEADER + slot_bytes(cls);
+    return need <= R->slab_bytes ? R->slab_bytes
+                                 : (need + R->slab_bytes - 1) & ~(R->slab_bytes - 1);
+}
+
+// Bytes a new slot of the class adds to the budget: none if a slab has a
+// free slot, a whole slab otherwise
+static size_t slot_cost(const TenantRegistry* R, int cls) {
+    return R->classes[cls].partial != NULL ? 0 : class_slab_bytes(R, cls);
+}
+
+static inline RegistrySlab* slab_of(const TenantRegistry* R, void* slot) {
+    return (RegistrySlab*)((uintptr_t)slot & ~(uintptr_t)(R->slab_bytes - 1));
+}
+
+static void unlink_slab(SizeClass* C, RegistrySlab* S) {
+    if (S->prev != NULL) {
+        S->prev->next = S->next;
+    } else {
+        C->partial = S->next;
+    }
+    if (S->next != NULL) {
+        S->next->prev = S->prev;
+    }
+    S->prev = NULL;
+    S->next = NULL;
+}
+
+static void link_slab(SizeClass* C, RegistrySlab* S) {
+    S->prev = NULL;
+    S->next = C->partial;
+    if (C->partial != NULL) {
+        C->partial->prev = S;
+    }
+    C->partial = S;
+}
+
+// Takes a free slot of the class, carving (and charging) a new slab if
+// there is none
+static void* slot_alloc(TenantRegistry* R, int cls) {
+    SizeClass* C = &R->classes[cls];
+    if (C->partial == NULL) {
+        size_t bytes = slot_bytes(cls);
+        size_t len = class_slab_bytes(R, cls);
+        RegistrySlab* S = (RegistrySlab*)aligned_alloc(R->slab_bytes, len);
+        if (S == NULL) {
+            perror("Failed to allocate memory for registry slab");
+            exit(EXIT_FAILURE);
+        }
+        S->bytes = len;
+        S->live = 0;
+        S->free_list = NULL;
+        char* first = (char*)S + SLAB_HEADER;
+        for (size_t s = (len - SLAB_HEADER) / bytes; s-- > 0;) {
+            *(void**)(first + s * bytes) = S->free_list;
+            S->free_list = first + s * bytes;
+        }
+        link_slab(C, S);
+        C->num_slabs++;
+        R->used += len;
+    }
+    RegistrySlab* S = C->partial;
+    void* slot = S->free_list;
+    S->free_list = *(void**)slot;
+    S->live++;
+    if (S->free_list == NULL) {
+        unlink_slab(C, S);
+    }
+    return slot;
+}
+
+// Returns a slot to its slab, releasing the slab once all its slots are free
+static void slot_free(TenantRegistry* R, int cls, void* slot) {
+    SizeClass* C = &R->classes[cls];
+    RegistrySlab* S = slab_of(R, slot);
+    if (S->free_list == NULL) {
+        link_slab(C, S);   // was full
+    }
+    *(void**)slot = S->free_list;
+    S->free_list = slot;
+    if (--S->live == 0) {
+        unlink_slab(C, S);
+        C->num_slabs--;
+        R->used -= S->bytes;
+        free(S);
+    }
+}
+
+// Points the view of a tenant at a zeroed slot
+static void attach_slot(TenantRegistry* R, Tenant* t) {
+    int size = t->view.size;
+    size_t stride = ((size_t)size + 7) & ~(size_t)7;
+    t->slot = slot_alloc(R, t->cls);
+    memset(t->slot, 0, chain_bytes(size));
+    t->view.helper = (int*)t->slot;
+    t->view.block = t->slot;
+    t->view.block_len = slot_bytes(t->cls);
+    double* first = (double*)((char*)t->slot + helper_bytes(size));
+    for (int i = 0; i < size; i++) {
+        t->view.matrix[i] = first + (size_t)i * stride;
+    }
+}
+
+// Index of the table slot holding id, or of the empty slot ending its probe
+static inline size_t find_slot(const TenantRegistry* R, uint64_t id) {
+    size_t mask = R->capacity - 1;
+    size_t idx = hash_id(id) & mask;
+    while (R->table[idx].tenant != NULL && R->table[idx].id != id) {
+        idx = (idx + 1) & mask;
+    }
+    return idx;
+}
+
+static void grow_table(TenantRegistry* R) {
+    TenantSlot* old = R->table;
+    size_t old_capacity = R->capacity;
+    R->capacity *= 2;
+    R->table = (TenantSlot*)calloc(R->capacity, sizeof(TenantSlot));
+    if (R->table == NULL) {
+        perror("Failed to allocate memory for registry table");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t s = 0; s < old_capacity; s++) {
+        if (old[s].tenant != NULL) {
+            R->table[find_slot(R, old[s].id)] = old[s];
+        }
+    }
+    free(old);
+}
+
+// Empties table slot idx, shifting back the entries of its probe run
+static void table_remove(TenantRegistry* R, size_t idx) {
+    size_t mask = R->capacity - 1;
+    size_t hole = idx;
+    R->table[hole].tenant = NULL;
+    for (size_t j = (hole + 1) & mask; R->table[j].tenant != NULL; j = (j + 1) & mask) {
+        size_t home = hash_id(R->table[j].id) & mask;
+        // the entry may move into the hole unless its home lies in (hole, j]
+        int stays = hole <= j ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!stays) {
+            R->table[hole] = R->table[j];
+            R->table[j].tenant = NULL;
+            hole = j;
+        }
+    }
+    R->count--;
+}
+
+static void free_compact(Tenant* t) {
+    free(t->compact_start);
+    free(t->compact_cols);
+    free(t->compact_vals);
+    free(t->compact_helper);
+    t->compact_start = NULL;
+    t->compact_cols = NULL;
+    t->compact_vals = NULL;
+    t->compact_helper = NULL;
+}
+
+// Releases a tenant's memory (the table entry is removed by the caller)
+static void release_tenant(TenantRegistry* R, Tenant* t) {
+    if (t->state == TENANT_DENSE) {
+        slot_free(R, t->cls, t->slot);
+    } else {
+        free_compact(t);
+        R->used -= t->compact_bytes;
+    }
+    free(t->view.matrix);
+    free(t->view.version);
+    free(t);
+}
+
+// Keeps only the nonzero entries of a dense chain. Returns -1 (and leaves
+// the chain dense) when that would not save memory
+static int compact_tenant(TenantRegistry* R, Tenant* t) {
+    int size = t->view.size;
+    long nnz = 0;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            nnz += t->view.matrix[i][j] != 0.0;
+        }
+    }
+    size_t bytes = (size_t)(2 * size + 1) * sizeof(int) + nnz * (sizeof(int) + sizeof(double));
+    if (bytes >= slot_bytes(t->cls)) {
+        return -1;
+    }
+
+    t->compact_start = (int*)malloc((size + 1) * sizeof(int));
+    t->compact_cols = (int*)malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    t->compact_vals = (double*)malloc((nnz > 0 ? nnz : 1) * sizeof(double));
+    t->compact_helper = (int*)malloc(size * sizeof(int));
+    if (t->compact_start == NULL || t->compact_cols == NULL || t->compact_vals == NULL ||
+        t->compact_helper == NULL) {
+        perror("Failed to allocate memory for compacted chain");
+        exit(EXIT_FAILURE);
+    }
+    long k = 0;
+    for (int i = 0; i < size; i++) {
+        t->compact_start[i] = (int)k;
+        t->compact_helper[i] = t->view.helper[i];
+        for (int j = 0; j < size; j++) {
+            if (t->view.matrix[i][j] != 0.0) {
+                t->compact_cols[k] = j;
+                t->compact_vals[k] = t->view.matrix[i][j];
+                k++;
+            }
+        }
+    }
+    t->compact_start[size] = (int)k;
+
+    slot_free(R, t->cls, t->slot);
+    t->slot = NULL;
+    t->compact_bytes = bytes;
+    R->used += bytes;
+    t->state = TENANT_COMPACT;
+    R->compactions++;
+    return 0;
+}
+
+// Frees room for a new slot of class cls: a first sweep compacts cold dense
+// chains, and only if that is not enough a second sweep evicts cold chains.
+// Room is made once the budget covers what the slot costs, which drops to
+// nothing as soon as a slot of the class is freed. The tenant keep is never
+// picked; the loop ends when no tenant is left to pick
+static void ensure_room(TenantRegistry* R, int cls, const Tenant* keep) {
+    for (int pass = 0; pass < 2; pass++) {
+        size_t idle = 0;
+        while (R->used + slot_cost(R, cls) > R->budget && idle <= 2 * R->capacity) {
+            size_t idx = R->hand & (R->capacity - 1);
+            Tenant* t = R->table[idx].tenant;
+            if (t == NULL || t == keep) {
+                R->hand++;
+                idle++;
+            } else if (t->referenced) {
+                t->referenced = 0;
+                R->hand++;
+                idle++;
+            } else if (pass == 0) {
+                if (t->state == TENANT_DENSE && compact_tenant(R, t) == 0) {
+                    idle = 0;
+                } else {
+                    idle++;
+                }
+                R->hand++;
+            } else {
+                // the next entry may shift into idx, so the hand stays
+                table_remove(R, idx);
+                release_tenant(R, t);
+                R->evictions++;
+                idle = 0;
+            }
+        }
+    }
+}
+
+// Turns a compacted chain back into a dense one with the same values
+static void expand_tenant(TenantRegistry* R, Tenant* t) {
+    ensure_room(R, t->cls, t);
+    attach_slot(R, t);
+    for (int i = 0; i < t->view.size; i++) {
+        t->view.helper[i] = t->compact_helper[i];
+        for (int k = t->compact_start[i]; k < t->compact_start[i + 1]; k++) {
+            t->view.matrix[i][t->compact_cols[k]] = t->compact_vals[k];
+        }
+    }
+    free_compact(t);
+    R->used -= t->compact_bytes;
+    t->compact_bytes = 0;
+    t->state = TENANT_DENSE;
+    R->expansions++;
+}
+
+// Returns a usable view of a known tenant
+static inline Markov* use_tenant(TenantRegistry* R, Tenant* t) {
+    if (t->state == TENANT_COMPACT) {
+        expand_tenant(R, t);
+    }
+    t->referenced = 1;
+    return &t->view;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_init(int default_size, size_t budget)
+//
+//  Creates an empty registry
+//
+// Parameters:
+//    - default_size: Size of the chains created on a tenant's first update
+//    - budget: Bytes the chains may hold in total
+//
+// Returns:
+//    Pointer to the newly allocated TenantRegistry structure, or NULL for an
+//    invalid size
+///////////////////////////////////////////////////////////////////////////////
+TenantRegistry* registry_init(int default_size, size_t budget) {
+    if (default_size < 1 || size_class(default_size) < 0) {
+        fprintf(stderr, "Invalid chain size %d.\n", default_size);
+        return NULL;
+    }
+
+    TenantRegistry* R = (TenantRegistry*)calloc(1, sizeof(TenantRegistry));
+    if (R == NULL) {
+        perror("Failed to allocate memory for TenantRegistry structure");
+        exit(EXIT_FAILURE);
+    }
+    R->capacity = 64;
+    R->table = (TenantSlot*)calloc(R->capacity, sizeof(TenantSlot));
+    if (R->table == NULL) {
+        perror("Failed to allocate memory for registry table");
+        exit(EXIT_FAILURE);
+    }
+    R->default_size = default_size;
+    R->slab_bytes = slab_size(budget);
+    R->budget = budget;
+    return R;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_add(TenantRegistry* R, uint64_t id, int size)
+//
+//  Creates an empty chain of the given size for a new tenant
+//
+// Returns:
+//    - The tenant's view, or NULL if the tenant exists or the size is invalid
+///////////////////////////////////////////////////////////////////////////////
+Markov* registry_add(TenantRegistry* R, uint64_t id, int size) {
+    int cls = size < 1 ? -1 : size_class(size);
+    if (R == NULL || cls < 0) {
+        fprintf(stderr, "Invalid registry or chain size %d.\n", size);
+        return NULL;
+    }
+    if (R->table[find_slot(R, id)].tenant != NULL) {
+        fprintf(stderr, "Tenant %llu already has a chain.\n", (unsigned long long)id);
+        return NULL;
+    }
+
+    ensure_room(R, cls, NULL);
+    if ((R->count + 1) * 4 > R->capacity * 3) {
+        grow_table(R);
+    }
+
+    Tenant* t = (Tenant*)calloc(1, sizeof(Tenant));
+    double** rows = (double**)malloc(size * sizeof(double*));
+    unsigned int* version = (unsigned int*)calloc(size, sizeof(unsigned int));
+    if (t == NULL || rows == NULL || version == NULL) {
+        perror("Failed to allocate memory for tenant");
+        exit(EXIT_FAILURE);
+    }
+    t->id = id;
+    t->state = TENANT_DENSE;
+    t->referenced = 1;
+    t->cls = cls;
+    t->view.size = size;
+    t->view.matrix = rows;
+    t->view.version = version;
+    t->view.storage = MARKOV_POOLED;
+    attach_slot(R, t);
+
+    size_t idx = find_slot(R, id);
+    R->table[idx].id = id;
+    R->table[idx].tenant = t;
+    R->count++;
+    return &t->view;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_get(TenantRegistry* R, uint64_t id)
+//
+//  Finds a tenant's chain, expanding it if it was compacted
+//
+// Returns:
+//    - The tenant's view, or NULL if the tenant is unknown or was evicted
+///////////////////////////////////////////////////////////////////////////////
+Markov* registry_get(TenantRegistry* R, uint64_t id) {
+    if (R == NULL) return NULL;
+
+    Tenant* t = R->table[find_slot(R, id)].tenant;
+    return t == NULL ? NULL : use_tenant(R, t);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_update(TenantRegistry* R, uint64_t id, int i, int j)
+//
+//  Applies a transition from state i to state j to a tenant's chain, like
+//  update_matrix, creating the chain (of the default size) if needed
+//
+// Returns:
+//    - 0 on success, -1 for invalid indices
+///////////////////////////////////////////////////////////////////////////////
+int registry_update(TenantRegistry* R, uint64_t id, int i, int j) {
+    if (R == NULL) {
+        fprintf(stderr, "Invalid registry.\n");
+        return -1;
+    }
+
+    Tenant* t = R->table[find_slot(R, id)].tenant;
+    Markov* M = t != NULL ? use_tenant(R, t) : registry_add(R, id, R->default_size);
+    return update_matrix(M, i, j);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_update_bulk(TenantRegistry* R, const uint64_t* ids,
+//                      const int* from, const int* to, long count)
+//
+//  Applies a batch of transitions, event k going to tenant ids[k]. Runs of
+//  events of the same tenant share one lookup, and the table slots of
+//  upcoming events are prefetched
+//
+// Returns:
+//    - The number of transitions applied (invalid ones are skipped)
+///////////////////////////////////////////////////////////////////////////////
+long registry_update_bulk(TenantRegistry* R, const uint64_t* ids,
+                          const int* from, const int* to, long count) {
+    if (R == NULL || ids == NULL || from == NULL || to == NULL || count < 0) {
+        fprintf(stderr, "Invalid registry or batch.\n");
+        return 0;
+    }
+
+    long applied = 0;
+    Markov* M = NULL;
+    uint64_t current = 0;
+    for (long k = 0; k < count; k++) {
+        if (k + PREFETCH_DISTANCE < count) {
+            uint64_t ahead = ids[k + PREFETCH_DISTANCE];
+            __builtin_prefetch(&R->table[hash_id(ahead) & (R->capacity - 1)]);
+        }
+        if (M == NULL || ids[k] != current) {
+            current = ids[k];
+            Tenant* t = R->table[find_slot(R, current)].tenant;
+            M = t != NULL ? use_tenant(R, t) : registry_add(R, current, R->default_size);
+        }
+        if (update_matrix(M, from[k], to[k]) == 0) {
+            applied++;
+        }
+    }
+    return applied;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_remove(TenantRegistry* R, uint64_t id)
+//
+//  Drops a tenant and its chain
+//
+// Returns:
+//    - 0 on success, -1 if the tenant is unknown
+///////////////////////////////////////////////////////////////////////////////
+int registry_remove(TenantRegistry* R, uint64_t id) {
+    if (R == NULL) return -1;
+
+    size_t idx = find_slot(R, id);
+    Tenant* t = R->table[idx].tenant;
+    if (t == NULL) {
+        return -1;
+    }
+    table_remove(R, idx);
+    release_tenant(R, t);
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_memory(TenantRegistry* R)
+//
+// Returns:
+//    - The bytes held by chains, the figure kept under the budget
+///////////////////////////////////////////////////////////////////////////////
+size_t registry_memory(TenantRegistry* R) {
+    return R == NULL ? 0 : R->used;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_registry(TenantRegistry* R)
+//
+//  Frees every chain, the slabs and the TenantRegistry structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_registry(TenantRegistry* R) {
+    if (R == NULL) return;
+
+    // releasing the last tenant of a slab releases the slab
+    for (size_t s = 0; s < R->capacity; s++) {
+        if (R->table[s].tenant != NULL) {
+            release_tenant(R, R->table[s].tenant);
+        }
+    }
+    free(R->table);
+    free(R);
+}
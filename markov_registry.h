@@ -0,0 +1,203 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_registry.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_registry.c multi-tenant registry. It keeps
+//   one chain per tenant (e.g. per process), keyed by a 64-bit tenant id,
+//   in a pooled store instead of one initialize_M() allocation per chain:
+//
+//   - Chains live in slots carved from slabs of an eighth of the budget
+//     (a power of two from 4 KB to 2 MB). Slots come in size classes four
+//     per power of two, and a freed slot is reused by the next chain of its
+//     class, so thousands of chains do not fragment the heap. A slab whose
+//     slots are all free goes back to the heap, where any class can reuse
+//     the memory.
+//   - Tenants are found through an open-addressing hash table (linear
+//     probing, backward-shift deletion), so a lookup is about one probe.
+//   - The registry enforces a global budget on the bytes held by chains:
+//     whole slabs (free slots included) plus the compacted chains, which is
+//     the memory the registry actually holds for them. Over budget, a clock
+//     sweep over the tenants picks cold ones: cold
+//     chains are first compacted (only their nonzero entries are kept,
+//     outside the slabs), and evicted only if compacting is not enough.
+//     A compacted chain is expanded again the next time it is used, with
+//     exactly the same values.
+//
+//   Each tenant is exposed as an ordinary Markov* view (M->storage ==
+//   MARKOV_POOLED) usable with every read-only function of markov.h.
+//
+// Usage:
+//   Include this header by using #include "markov_registry.h" and use the
+//   functions below:
+//
+//      TenantRegistry* R = registry_init(64, 256 << 20);
+//      registry_update(R, pid, prev_state, state);
+//      int next = max_prob_idx(registry_get(R, pid), state);
+//
+// NOTE:
+//   The views belong to the registry and must not be passed to free_M. A
+//   view stays valid until the next registry call that can create, expand,
+//   compact or remove a chain
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_REGISTRY
+#define MARKOV_REGISTRY
+
+#include <stddef.h>
+#include <stdint.h>
+#include "markov.h"
+
+#define REGISTRY_CLASSES 96   // slot sizes from 256 B to 3.5 GB
+
+// State of a tenant's chain
+typedef enum TenantState {
+    TENANT_DENSE = 0,   // rows in a slab slot, view usable
+    TENANT_COMPACT      // only the nonzero entries kept
+} TenantState;
+
+// One tenant's chain
+typedef struct Tenant {
+    uint64_t id;
+    TenantState state;
+    int referenced;       // used since the clock hand last passed
+    int cls;              // size class of its slot
+    void* slot;           // slab slot (TENANT_DENSE)
+    Markov view;          // rows and helper inside the slot
+    int* compact_start;   // row i has entries [start[i], start[i + 1])
+    int* compact_cols;
+    double* compact_vals;
+    int* compact_helper;
+    size_t compact_bytes;
+} Tenant;
+
+// Hash table slot (tenant NULL when empty)
+typedef struct TenantSlot {
+    uint64_t id;
+    Tenant* tenant;
+} TenantSlot;
+
+// Header at the start of a slab, followed by its slots. Slabs are aligned
+// to the registry's slab size, so the slab of a slot is found by masking
+typedef struct RegistrySlab {
+    struct RegistrySlab* prev;   // neighbours in the list of slabs with
+    struct RegistrySlab* next;   // free slots
+    void* free_list;      // next pointer stored in the free slot itself
+    size_t bytes;         // bytes allocated for the slab
+    int live;             // slots in use
+} RegistrySlab;
+
+// Slabs of one size class
+typedef struct SizeClass {
+    RegistrySlab* partial;   // slabs with at least one free slot
+    int num_slabs;
+} SizeClass;
+
+// The TenantRegistry structure holds the tenants, the slabs and the budget
+typedef struct TenantRegistry {
+    TenantSlot* table;
+    size_t capacity;      // power of two
+    size_t count;
+    size_t hand;          // clock hand (table index)
+    SizeClass classes[REGISTRY_CLASSES];
+    int default_size;     // size of chains created by an update
+    size_t slab_bytes;    // size (and alignment) of a slab
+    size_t budget;        // bytes chains may hold
+    size_t used;          // bytes chains hold (slabs and compacted entries)
+    long compactions;
+    long expansions;
+    long evictions;
+} TenantRegistry;
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_init(int default_size, size_t budget)
+//
+//  Creates an empty registry
+//
+// Parameters:
+//    - default_size: Size of the chains created on a tenant's first update
+//    - budget: Bytes the chains may hold in total
+//
+// Returns:
+//    Pointer to the newly allocated TenantRegistry structure, or NULL for an
+//    invalid size
+///////////////////////////////////////////////////////////////////////////////
+TenantRegistry* registry_init(int default_size, size_t budget);
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_add(TenantRegistry* R, uint64_t id, int size)
+//
+//  Creates an empty chain of the given size for a new tenant
+//
+// Returns:
+//    - The tenant's view, or NULL if the tenant exists or the size is invalid
+///////////////////////////////////////////////////////////////////////////////
+Markov* registry_add(TenantRegistry* R, uint64_t id, int size);
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_get(TenantRegistry* R, uint64_t id)
+//
+//  Finds a tenant's chain, expanding it if it was compacted
+//
+// Returns:
+//    - The tenant's view, or NULL if the tenant is unknown or was evicted
+///////////////////////////////////////////////////////////////////////////////
+Markov* registry_get(TenantRegistry* R, uint64_t id);
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_update(TenantRegistry* R, uint64_t id, int i, int j)
+//
+//  Applies a transition from state i to state j to a tenant's chain, like
+//  update_matrix, creating the chain (of the default size) if needed
+//
+// Returns:
+//    - 0 on success, -1 for invalid indices
+///////////////////////////////////////////////////////////////////////////////
+int registry_update(TenantRegistry* R, uint64_t id, int i, int j);
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_update_bulk(TenantRegistry* R, const uint64_t* ids,
+//                      const int* from, const int* to, long count)
+//
+//  Applies a batch of transitions, event k going to tenant ids[k]. Runs of
+//  events of the same tenant share one lookup, and the table slots of
+//  upcoming events are prefetched
+//
+// Returns:
+//    - The number of transitions applied (invalid ones are skipped)
+///////////////////////////////////////////////////////////////////////////////
+long registry_update_bulk(TenantRegistry* R, const uint64_t* ids,
+                          const int* from, const int* to, long count);
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_remove(TenantRegistry* R, uint64_t id)
+//
+//  Drops a tenant and its chain
+//
+// Returns:
+//    - 0 on success, -1 if the tenant is unknown
+///////////////////////////////////////////////////////////////////////////////
+int registry_remove(TenantRegistry* R, uint64_t id);
+
+///////////////////////////////////////////////////////////////////////////////
+// registry_memory(TenantRegistry* R)
+//
+// Returns:
+//    - The bytes held by chains (whole slabs and compacted entries), the
+//      figure kept under the budget
+///////////////////////////////////////////////////////////////////////////////
+size_t registry_memory(TenantRegistry* R);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_registry(TenantRegistry* R)
+//
+//  Frees every chain, the slabs and the TenantRegistry structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_registry(TenantRegistry* R);
+
+#endif
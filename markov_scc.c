@@ -0,0 +1,588 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_scc.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the communicating class decomposition.
+//
+//   Tarjan's search runs on an explicit call stack (a state and the next
+//   edge to follow), so chains of any depth are handled without recursion.
+//   It completes the classes sinks first; numbering them in reverse gives
+//   the topological order. reach_end[c] is then computed from the last class
+//   to the first as the larger of the end of c and the reach_end of every
+//   class c has a transition to.
+//
+//   In scc_matrix_mult the rows of a class can only have nonzeros from the
+//   start of the class to its reach_end, and the same holds for the rows of
+//   P2 that are read, so each product only sweeps those ranges. The sums are
+//   taken over k in increasing order and only skip zero terms, so they match
+//   matrix_mult exactly. The rows are handed out to threads in chunks from a
+//   shared counter, since the classes can have very different sizes.
+//
+// Usage:
+//   Include this source code by using #include "markov_scc.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "markov_scc.h"
+#include "markov_order.h"
+
+#define ROW_CHUNK 16     // rows per work item of scc_matrix_mult
+
+// Allocates memory or exits the program, the same way initialize_M handles a
+// failed allocation
+static void* scc_alloc(size_t bytes) {
+    void* ptr = malloc(bytes > 0 ? bytes : 1);
+    if (ptr == NULL) {
+        perror("Failed to allocate memory for class decomposition");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+// Builds the decomposition of the graph whose edges out of state v are
+// adj[ptr[v] .. ptr[v + 1])
+static MarkovSCC* tarjan(int n, const long* ptr, const int* adj) {
+    // Step 1.
+    //   Run Tarjan's search from every unvisited state, recording for each
+    //   state the component it completes in
+    // Step 2.
+    //   Number the classes in reverse completion order and list the states
+    //   class by class
+    // Step 3.
+    //   Mark the closed classes and compute how far each class reaches
+
+    int* index = (int*)scc_alloc(n * sizeof(int));
+    int* low = (int*)scc_alloc(n * sizeof(int));
+    char* on_stack = (char*)scc_alloc(n);
+    int* stack = (int*)scc_alloc(n * sizeof(int));
+    int* call_v = (int*)scc_alloc(n * sizeof(int));
+    long* call_e = (long*)scc_alloc(n * sizeof(long));
+    int* comp = (int*)scc_alloc(n * sizeof(int));
+    memset(index, -1, n * sizeof(int));
+    memset(on_stack, 0, n);
+    int counter = 0;
+    int sp = 0;
+    int num = 0;
+
+    for (int root = 0; root < n; root++) {
+        if (index[root] >= 0) {
+            continue;
+        }
+        int depth = 0;
+        index[root] = low[root] = counter++;
+        stack[sp++] = root;
+        on_stack[root] = 1;
+        call_v[depth] = root;
+        call_e[depth++] = ptr[root];
+        while (depth > 0) {
+            int v = call_v[depth - 1];
+            long e = call_e[depth - 1];
+            if (e < ptr[v + 1]) {
+                call_e[depth - 1] = e + 1;
+                int w = adj[e];
+                if (index[w] < 0) {
+                    index[w] = low[w] = counter++;
+                    stack[sp++] = w;
+                    on_stack[w] = 1;
+                    call_v[depth] = w;
+                    call_e[depth++] = ptr[w];
+                } else if (on_stack[w] && index[w] < low[v]) {
+                    low[v] = index[w];
+                }
+                continue;
+            }
+            // every edge of v is done: v may close a component
+            if (low[v] == index[v]) {
+                int w;
+                do {
+                    w = stack[--sp];
+                    on_stack[w] = 0;
+                    comp[w] = num;
+                } while (w != v);
+                num++;
+            }
+            depth--;
+            if (depth > 0 && low[v] < low[call_v[depth - 1]]) {
+                low[call_v[depth - 1]] = low[v];
+            }
+        }
+    }
+
+    MarkovSCC* C = (MarkovSCC*)scc_alloc(sizeof(MarkovSCC));
+    C->size = n;
+    C->num_classes = num;
+    C->class_of = (int*)scc_alloc(n * sizeof(int));
+    C->perm = (int*)scc_alloc(n * sizeof(int));
+    C->pos = (int*)scc_alloc(n * sizeof(int));
+    C->class_start = (int*)calloc(num + 1, sizeof(int));
+    C->reach_end = (int*)scc_alloc(num * sizeof(int));
+    C->closed = (char*)scc_alloc(num);
+    if (C->class_start == NULL) {
+        perror("Failed to allocate memory for class decomposition");
+        exit(EXIT_FAILURE);
+    }
+    for (int v = 0; v < n; v++) {
+        C->class_of[v] = num - 1 - comp[v];
+        C->class_start[C->class_of[v] + 1]++;
+    }
+    for (int c = 0; c < num; c++) {
+        C->class_start[c + 1] += C->class_start[c];
+    }
+    int* fill = index;   // reused as the next free position of each class
+    for (int c = 0; c < num; c++) {
+        fill[c] = C->class_start[c];
+    }
+    for (int v = 0; v < n; v++) {
+        int p = fill[C->class_of[v]]++;
+        C->perm[p] = v;
+        C->pos[v] = p;
+    }
+
+    for (int c = num - 1; c >= 0; c--) {
+        C->closed[c] = 1;
+        C->reach_end[c] = C->class_start[c + 1];
+        for (int p = C->class_start[c]; p < C->class_start[c + 1]; p++) {
+            int v = C->perm[p];
+            for (long e = ptr[v]; e < ptr[v + 1]; e++) {
+                int d = C->class_of[adj[e]];
+                if (d != c) {
+                    C->closed[c] = 0;
+                    if (C->reach_end[d] > C->reach_end[c]) {
+                        C->reach_end[c] = C->reach_end[d];
+                    }
+                }
+            }
+        }
+    }
+
+    free(index);
+    free(low);
+    free(on_stack);
+    free(stack);
+    free(call_v);
+    free(call_e);
+    free(comp);
+    return C;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_decompose(Markov* M)
+//
+//  Finds the communicating classes of a dense chain
+//
+// Returns:
+//    Pointer to the newly allocated MarkovSCC structure, or NULL if M is
+//    invalid
+///////////////////////////////////////////////////////////////////////////////
+MarkovSCC* scc_decompose(Markov* M) {
+    if (M == NULL || M->matrix == NULL || M->size < 1) {
+        fprintf(stderr, "Invalid Markov structure.\n");
+        return NULL;
+    }
+
+    // the nonzero entries as adjacency lists
+    int n = M->size;
+    long* ptr = (long*)scc_alloc((n + 1) * sizeof(long));
+    long nnz = 0;
+    for (int i = 0; i < n; i++) {
+        ptr[i] = nnz;
+        for (int j = 0; j < n; j++) {
+            nnz += M->matrix[i][j] != 0.0;
+        }
+    }
+    ptr[n] = nnz;
+    int* adj = (int*)scc_alloc(nnz * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        long e = ptr[i];
+        for (int j = 0; j < n; j++) {
+            if (M->matrix[i][j] != 0.0) {
+                adj[e++] = j;
+            }
+        }
+    }
+
+    MarkovSCC* C = tarjan(n, ptr, adj);
+    free(ptr);
+    free(adj);
+    return C;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_decompose_sparse(SparseMarkov* S)
+//
+//  Finds the communicating classes of a sparse chain
+//
+// Returns:
+//    Pointer to the newly allocated MarkovSCC structure, or NULL if S is
+//    invalid
+///////////////////////////////////////////////////////////////////////////////
+MarkovSCC* scc_decompose_sparse(SparseMarkov* S) {
+    if (S == NULL || S->row_ptr == NULL || S->size < 1) {
+        fprintf(stderr, "Invalid SparseMarkov structure.\n");
+        return NULL;
+    }
+
+    // stored zeros are not transitions
+    int n = S->size;
+    long* ptr = (long*)scc_alloc((n + 1) * sizeof(long));
+    int* adj = (int*)scc_alloc(S->nnz * sizeof(int));
+    long e = 0;
+    for (int i = 0; i < n; i++) {
+        ptr[i] = e;
+        for (long p = S->row_ptr[i]; p < S->row_ptr[i + 1]; p++) {
+            if (S->values[p] != 0.0) {
+                adj[e++] = S->col_idx[p];
+            }
+        }
+    }
+    ptr[n] = e;
+
+    MarkovSCC* C = tarjan(n, ptr, adj);
+    free(ptr);
+    free(adj);
+    return C;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_permute(Markov* M, MarkovSCC* C)
+//
+// Returns:
+//    - A new chain with rows, columns and helper counts in class order
+//      (block upper triangular), or NULL if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* scc_permute(Markov* M, MarkovSCC* C) {
+    if (M == NULL || C == NULL || M->size != C->size) {
+        fprintf(stderr, "Invalid or mismatched Markov structure and decomposition.\n");
+        return NULL;
+    }
+    return permute_M(M, C->perm);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_unpermute(Markov* P, MarkovSCC* C)
+//
+// Returns:
+//    - A new chain in the original state order, or NULL if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* scc_unpermute(Markov* P, MarkovSCC* C) {
+    if (P == NULL || C == NULL || P->size != C->size) {
+        fprintf(stderr, "Invalid or mismatched Markov structure and decomposition.\n");
+        return NULL;
+    }
+    return permute_M(P, C->pos);
+}
+
+// State shared by the threads of a block multiply
+typedef struct BlockMult {
+    Markov* P1;
+    Markov* P2;
+    Markov* result;
+    MarkovSCC* C;
+    const int* class_at;   // class of each position
+    atomic_int next_row;
+} BlockMult;
+
+static void* block_mult_worker(void* arg) {
+    BlockMult* B = (BlockMult*)arg;
+    int n = B->C->size;
+    const int* start = B->C->class_start;
+    const int* end = B->C->reach_end;
+    int r0;
+    while ((r0 = atomic_fetch_add(&B->next_row, ROW_CHUNK)) < n) {
+        int r1 = r0 + ROW_CHUNK < n ? r0 + ROW_CHUNK : n;
+        for (int i = r0; i < r1; i++) {
+            int a = B->class_at[i];
+            const double* row = B->P1->matrix[i];
+            double* out = B->result->matrix[i];
+            for (int k = start[a]; k < end[a]; k++) {
+                double aik = row[k];
+                if (aik == 0.0) {
+                    continue;
+                }
+                int c = B->class_at[k];
+                const double* b = B->P2->matrix[k];
+                for (int j = start[c]; j < end[c]; j++) {
+                    out[j] += aik * b[j];
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_matrix_mult(Markov* P1, Markov* P2, MarkovSCC* C, int num_threads)
+//
+//  Multiplies two permuted chains block by block. Both must have nonzeros
+//  only where a power of the decomposed chain can (e.g. P1 = P^a and
+//  P2 = P^b for the permuted chain P). The result is identical to
+//  matrix_mult(P1, P2)
+//
+// Parameters:
+//    - P1, P2: Pointers to the permuted Markov structures
+//    - C: Decomposition the chains were permuted with
+//    - num_threads: Number of threads sharing the classes
+//
+// Returns:
+//    - A new chain holding P1 P2, or NULL if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* scc_matrix_mult(Markov* P1, Markov* P2, MarkovSCC* C, int num_threads) {
+    if (P1 == NULL || P2 == NULL || C == NULL || P1->size != C->size || P2->size != C->size) {
+        fprintf(stderr, "Invalid or mismatched Markov structures and decomposition.\n");
+        return NULL;
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+
+    int n = C->size;
+    int* class_at = (int*)scc_alloc(n * sizeof(int));
+    for (int c = 0; c < C->num_classes; c++) {
+        for (int p = C->class_start[c]; p < C->class_start[c + 1]; p++) {
+            class_at[p] = c;
+        }
+    }
+    BlockMult B;
+    B.P1 = P1;
+    B.P2 = P2;
+    B.result = initialize_M(n);
+    B.C = C;
+    B.class_at = class_at;
+    atomic_init(&B.next_row, 0);
+
+    pthread_t* threads = (pthread_t*)scc_alloc(num_threads * sizeof(pthread_t));
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, block_mult_worker, &B) != 0) {
+            perror("Failed to create worker thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+    block_mult_worker(&B);
+    for (int t = 1; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    free(threads);
+    free(class_at);
+    return B.result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_matrix_power(Markov* P, MarkovSCC* C, int power, int num_threads)
+//
+//  Raises a permuted chain to a power with repeated scc_matrix_mult calls
+//
+// Returns:
+//    - A new chain holding P^power, or NULL if power < 1 or the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* scc_matrix_power(Markov* P, MarkovSCC* C, int power, int num_threads) {
+    if (P == NULL || C == NULL || P->size != C->size || power < 1) {
+        fprintf(stderr, "Invalid power %d or mismatched decomposition.\n", power);
+        return NULL;
+    }
+
+    Markov* result = initialize_M(P->size);
+    for (int p = 0; p < P->size; p++) {
+        memcpy(result->matrix[p], P->matrix[p], P->size * sizeof(double));
+    }
+    for (int m = 1; m < power; m++) {
+        Markov* next = scc_matrix_mult(result, P, C, num_threads);
+        free_M(result);
+        result = next;
+    }
+    return result;
+}
+
+// Solves the n x n row major system A x = b in place (x in b) by Gaussian
+// elimination with partial pivoting. Returns -1 if A is singular
+static int gauss_solve(double* A, double* b, int n) {
+    for (int k = 0; k < n; k++) {
+        int p = k;
+        for (int r = k + 1; r < n; r++) {
+            if (fabs(A[(size_t)r * n + k]) > fabs(A[(size_t)p * n + k])) {
+                p = r;
+            }
+        }
+        if (A[(size_t)p * n + k] == 0.0) {
+            return -1;
+        }
+        if (p != k) {
+            for (int c = k; c < n; c++) {
+                double tmp = A[(size_t)k * n + c];
+                A[(size_t)k * n + c] = A[(size_t)p * n + c];
+                A[(size_t)p * n + c] = tmp;
+            }
+            double tmp = b[k];
+            b[k] = b[p];
+            b[p] = tmp;
+        }
+        const double* ak = A + (size_t)k * n;
+        for (int r = k + 1; r < n; r++) {
+            double* ar = A + (size_t)r * n;
+            double l = ar[k] / ak[k];
+            if (l == 0.0) {
+                continue;
+            }
+            for (int c = k + 1; c < n; c++) {
+                ar[c] -= l * ak[c];
+            }
+            b[r] -= l * b[k];
+        }
+    }
+    for (int r = n - 1; r >= 0; r--) {
+        const double* ar = A + (size_t)r * n;
+        double s = b[r];
+        for (int c = r + 1; c < n; c++) {
+            s -= ar[c] * b[c];
+        }
+        b[r] = s / ar[r];
+    }
+    return 0;
+}
+
+// State shared by the threads computing stationary distributions
+typedef struct StationaryWork {
+    Markov* M;
+    MarkovSCC* C;
+    double* pi;
+    atomic_int next_class;
+    atomic_int error;
+} StationaryWork;
+
+// Solves pi (P_c - I) = 0, sum(pi) = 1 for the closed class c, as the
+// transposed system with its last equation replaced by the normalization
+static int class_stationary(Markov* M, MarkovSCC* C, int c, double* pi) {
+    int first = C->class_start[c];
+    int b = C->class_start[c + 1] - first;
+    const int* states = C->perm + first;
+    if (b == 1) {
+        pi[states[0]] = 1.0;   // a self loop or an empty row
+        return 0;
+    }
+
+    double* A = (double*)scc_alloc((size_t)b * b * sizeof(double));
+    double* x = (double*)scc_alloc(b * sizeof(double));
+    for (int r = 0; r < b; r++) {
+        for (int s = 0; s < b; s++) {
+            A[(size_t)r * b + s] = M->matrix[states[s]][states[r]] - (r == s ? 1.0 : 0.0);
+        }
+        x[r] = 0.0;
+    }
+    for (int s = 0; s < b; s++) {
+        A[(size_t)(b - 1) * b + s] = 1.0;
+    }
+    x[b - 1] = 1.0;
+
+    int status = gauss_solve(A, x, b);
+    if (status == 0) {
+        for (int s = 0; s < b; s++) {
+            pi[states[s]] = x[s];
+        }
+    }
+    free(A);
+    free(x);
+    return status;
+}
+
+static void* stationary_worker(void* arg) {
+    StationaryWork* W = (StationaryWork*)arg;
+    int c;
+    while ((c = atomic_fetch_add(&W->next_class, 1)) < W->C->num_classes) {
+        if (W->C->closed[c] && class_stationary(W->M, W->C, c, W->pi) != 0) {
+            atomic_store(&W->error, 1);
+        }
+    }
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_stationary(Markov* M, MarkovSCC* C, double* pi, int num_threads)
+//
+//  Computes the stationary distribution of each closed class of M (in the
+//  original state order), solving one linear system per class
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - C: Its decomposition
+//    - pi: Array of size doubles receiving, for each closed class, its
+//          stationary distribution over its states (summing to 1 within the
+//          class); transient states receive 0
+//    - num_threads: Number of threads sharing the classes
+//
+// Returns:
+//    - The number of closed classes, or -1 if a class system is singular
+//      or the sizes differ
+//
+// NOTE:
+//   A state whose row is empty (never updated) is a closed class of its own
+//   and is treated as absorbing (probability 1)
+///////////////////////////////////////////////////////////////////////////////
+int scc_stationary(Markov* M, MarkovSCC* C, double* pi, int num_threads) {
+    if (M == NULL || C == NULL || pi == NULL || M->size != C->size) {
+        fprintf(stderr, "Invalid or mismatched Markov structure and decomposition.\n");
+        return -1;
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+
+    memset(pi, 0, M->size * sizeof(double));
+    StationaryWork W;
+    W.M = M;
+    W.C = C;
+    W.pi = pi;
+    atomic_init(&W.next_class, 0);
+    atomic_init(&W.error, 0);
+
+    pthread_t* threads = (pthread_t*)scc_alloc(num_threads * sizeof(pthread_t));
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, stationary_worker, &W) != 0) {
+            perror("Failed to create worker thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+    stationary_worker(&W);
+    for (int t = 1; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+
+    if (atomic_load(&W.error)) {
+        fprintf(stderr, "Singular system for a closed class.\n");
+        return -1;
+    }
+    int closed = 0;
+    for (int c = 0; c < C->num_classes; c++) {
+        closed += C->closed[c];
+    }
+    return closed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_scc(MarkovSCC* C)
+//
+//  Frees the MarkovSCC structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_scc(MarkovSCC* C) {
+    if (C == NULL) return;
+
+    free(C->class_of);
+    free(C->perm);
+    free(C->pos);
+    free(C->class_start);
+    free(C->reach_end);
+    free(C->closed);
+    free(C);
+}
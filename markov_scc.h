@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_scc.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_scc.c communicating class decomposition. The
+//   states of a chain are split into strongly connected components over the
+//   nonzero entries (its communicating classes) with an iterative Tarjan
+//   search. The classes are numbered in topological order, so a transition
+//   only goes from a class to itself or to a later class, and listing the
+//   states class by class permutes the matrix into block upper triangular
+//   form. A class with no transition out of it is closed (recurrent).
+//
+//   A reducible chain made of clusters that only feed into each other is
+//   then handled a block at a time:
+//   - scc_matrix_mult() multiplies permuted matrices, reading for each class
+//     only the columns its states can reach, with the classes spread over
+//     threads. For k block-diagonal clusters of size b this is k * b^3 work
+//     instead of (k * b)^3.
+//   - scc_stationary() solves for the stationary distribution of every
+//     closed class, each class independently and in parallel.
+//
+// Usage:
+//   Include this header by using #include "markov_scc.h" and use the
+//   functions below:
+//
+//      MarkovSCC* C = scc_decompose(M);
+//      Markov* P = scc_permute(M, C);
+//      Markov* P4 = scc_matrix_power(P, C, 4, 8);
+//      Markov* M4 = scc_unpermute(P4, C);
+//
+// NOTE:
+//   The decomposition describes the nonzero pattern of M at the time it was
+//   computed; it must be recomputed after updates that add transitions
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_SCC
+#define MARKOV_SCC
+
+#include "markov.h"
+#include "markov_sparse.h"
+
+// The MarkovSCC structure holds the classes of a chain and the permutation
+// listing the states class by class
+typedef struct MarkovSCC {
+    int size;            // states in the chain
+    int num_classes;     // communicating classes
+    int* class_of;       // class of each state
+    int* perm;           // perm[p] = state at position p of the permuted chain
+    int* pos;            // pos[i] = position of state i (inverse of perm)
+    int* class_start;    // class c holds positions [start[c], start[c + 1])
+    int* reach_end;      // positions reachable from class c are < reach_end[c]
+    char* closed;        // 1 if no transition leaves class c
+} MarkovSCC;
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_decompose(Markov* M)
+//
+//  Finds the communicating classes of a dense chain
+//
+// Returns:
+//    Pointer to the newly allocated MarkovSCC structure, or NULL if M is
+//    invalid
+///////////////////////////////////////////////////////////////////////////////
+MarkovSCC* scc_decompose(Markov* M);
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_decompose_sparse(SparseMarkov* S)
+//
+//  Finds the communicating classes of a sparse chain
+//
+// Returns:
+//    Pointer to the newly allocated MarkovSCC structure, or NULL if S is
+//    invalid
+///////////////////////////////////////////////////////////////////////////////
+MarkovSCC* scc_decompose_sparse(SparseMarkov* S);
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_permute(Markov* M, MarkovSCC* C)
+//
+// Returns:
+//    - A new chain with rows, columns and helper counts in class order
+//      (block upper triangular), or NULL if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* scc_permute(Markov* M, MarkovSCC* C);
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_unpermute(Markov* P, MarkovSCC* C)
+//
+// Returns:
+//    - A new chain in the original state order, or NULL if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* scc_unpermute(Markov* P, MarkovSCC* C);
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_matrix_mult(Markov* P1, Markov* P2, MarkovSCC* C, int num_threads)
+//
+//  Multiplies two permuted chains block by block. Both must have nonzeros
+//  only where a power of the decomposed chain can (e.g. P1 = P^a and
+//  P2 = P^b for the permuted chain P). The result is identical to
+//  matrix_mult(P1, P2)
+//
+// Parameters:
+//    - P1, P2: Pointers to the permuted Markov structures
+//    - C: Decomposition the chains were permuted with
+//    - num_threads: Number of threads sharing the classes
+//
+// Returns:
+//    - A new chain holding P1 P2, or NULL if the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* scc_matrix_mult(Markov* P1, Markov* P2, MarkovSCC* C, int num_threads);
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_matrix_power(Markov* P, MarkovSCC* C, int power, int num_threads)
+//
+//  Raises a permuted chain to a power with repeated scc_matrix_mult calls
+//
+// Returns:
+//    - A new chain holding P^power, or NULL if power < 1 or the sizes differ
+///////////////////////////////////////////////////////////////////////////////
+Markov* scc_matrix_power(Markov* P, MarkovSCC* C, int power, int num_threads);
+
+///////////////////////////////////////////////////////////////////////////////
+// scc_stationary(Markov* M, MarkovSCC* C, double* pi, int num_threads)
+//
+//  Computes the stationary distribution of each closed class of M (in the
+//  original state order), solving one linear system per class
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - C: Its decomposition
+//    - pi: Array of size doubles receiving, for each closed class, its
+//          stationary distribution over its states (summing to 1 within the
+//          class); transient states receive 0
+//    - num_threads: Number of threads sharing the classes
+//
+// Returns:
+//    - The number of closed classes, or -1 if a class system is singular
+//      or the sizes differ
+//
+// NOTE:
+//   A state whose row is empty (never updated) is a closed class of its own
+//   and is treated as absorbing (probability 1)
+///////////////////////////////////////////////////////////////////////////////
+int scc_stationary(Markov* M, MarkovSCC* C, double* pi, int num_threads);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_scc(MarkovSCC* C)
+//
+//  Frees the MarkovSCC structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_scc(MarkovSCC* C);
+
+#endif
@@ -0,0 +1,308 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_score.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the sequence scoring. The smoothed logs of
+//   every row are cached in one flat row-major array, so the log probability
+//   of transition (s_t -> s_{t+1}) is log_rows[s_t * n + s_{t+1}]. With AVX2
+//   the flat indices of four consecutive transitions are built from two
+//   overlapping loads of the sequence and the four logs are fetched with one
+//   gather; two independent accumulators hide the gather latency. Sequences
+//   are split across threads in contiguous blocks of about equal numbers of
+//   transitions.
+//
+// Usage:
+//   Include this source code by using #include "markov_score.h" and use the
+//   functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the allocated memory for the
+//   scorer (see the function "free_scorer" below). The chain is not freed
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include "markov_score.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Caches the smoothed logs of row i
+static void build_log_row(MarkovScorer* S, int i) {
+    Markov* M = S->M;
+    int n = M->size;
+    double* L = S->log_rows + (size_t)i * n;
+    const double* row = M->matrix[i];
+    double h = M->helper[i];
+
+    if (S->alpha == 0.0) {
+        for (int j = 0; j < n; j++) {
+            L[j] = row[j] > 0.0 ? log(row[j]) : -INFINITY;
+        }
+    } else {
+        double denom = h + S->alpha * n;
+        for (int j = 0; j < n; j++) {
+            L[j] = log((row[j] * h + S->alpha) / denom);
+        }
+    }
+    S->seen[i] = M->version[i];
+}
+
+// Sums the cached logs along one sequence, or returns NAN if a state is out
+// of bounds
+static double score_path(const MarkovScorer* S, const int* seq, int len) {
+    int n = S->M->size;
+    for (int t = 0; t < len; t++) {
+        if (seq[t] < 0 || seq[t] >= n) {
+            return NAN;
+        }
+    }
+
+    const double* L = S->log_rows;
+    double sum = 0.0;
+    int t = 0;
+#ifdef __AVX2__
+    __m256i vn = _mm256_set1_epi64x(n);
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    // eight transitions t .. t + 7 read states t .. t + 8
+    for (; t + 8 < len; t += 8) {
+        __m256i from0 = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(seq + t)));
+        __m256i to0 = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(seq + t + 1)));
+        __m256i from1 = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(seq + t + 4)));
+        __m256i to1 = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(seq + t + 5)));
+        __m256i idx0 = _mm256_add_epi64(_mm256_mul_epu32(from0, vn), to0);
+        __m256i idx1 = _mm256_add_epi64(_mm256_mul_epu32(from1, vn), to1);
+        acc0 = _mm256_add_pd(acc0, _mm256_i64gather_pd(L, idx0, 8));
+        acc1 = _mm256_add_pd(acc1, _mm256_i64gather_pd(L, idx1, 8));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; t + 1 < len; t++) {
+        sum += L[(size_t)seq[t] * n + seq[t + 1]];
+    }
+    return sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// scorer_init(Markov* M, double alpha)
+//
+//  Builds the log cache of a chain
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - alpha: additive smoothing per transition (0 leaves unseen transitions
+//             at -INFINITY, 1 is Laplace smoothing)
+//
+// Returns:
+//    Pointer to the newly allocated MarkovScorer structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+MarkovScorer* scorer_init(Markov* M, double alpha) {
+    if (M == NULL || M->matrix == NULL || !(alpha >= 0.0)) {
+        fprintf(stderr, "Invalid Markov structure or smoothing.\n");
+        return NULL;
+    }
+
+    MarkovScorer* S = (MarkovScorer*)malloc(sizeof(MarkovScorer));
+    if (S == NULL) {
+        perror("Failed to allocate memory for MarkovScorer structure");
+        exit(EXIT_FAILURE);
+    }
+    S->M = M;
+    S->alpha = alpha;
+    S->log_rows = (double*)malloc(((size_t)M->size * M->size + 1) * sizeof(double));
+    S->seen = (unsigned int*)malloc((M->size + 1) * sizeof(unsigned int));
+    if (S->log_rows == NULL || S->seen == NULL) {
+        perror("Failed to allocate memory for log rows");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < M->size; i++) {
+        build_log_row(S, i);
+    }
+    return S;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// scorer_refresh(MarkovScorer* S)
+//
+//  Rebuilds the cached logs of the rows updated since they were cached. The
+//  scoring functions call this first, so it only needs to be called directly
+//  to take the cost up front
+//
+// Returns:
+//    - The number of rows rebuilt, or -1 on invalid input
+///////////////////////////////////////////////////////////////////////////////
+int scorer_refresh(MarkovScorer* S) {
+    if (S == NULL) {
+        fprintf(stderr, "Invalid MarkovScorer structure.\n");
+        return -1;
+    }
+    int rebuilt = 0;
+    for (int i = 0; i < S->M->size; i++) {
+        if (S->seen[i] != S->M->version[i]) {
+            build_log_row(S, i);
+            rebuilt++;
+        }
+    }
+    return rebuilt;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// score_sequence(MarkovScorer* S, const int* seq, int len)
+//
+//  Computes the log-likelihood of one sequence of states
+//
+// Parameters:
+//    - S: Pointer to the MarkovScorer structure
+//    - seq: Array of len state indices
+//    - len: Length of the sequence (len - 1 transitions are scored)
+//
+// Returns:
+//    - The log-likelihood (0 for fewer than two states), or NAN if the input
+//      is invalid or a state is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+double score_sequence(MarkovScorer* S, const int* seq, int len) {
+    if (S == NULL || (seq == NULL && len > 0)) {
+        fprintf(stderr, "Invalid MarkovScorer structure or sequence.\n");
+        return NAN;
+    }
+    scorer_refresh(S);
+    double score = score_path(S, seq, len);
+    if (isnan(score)) {
+        fprintf(stderr, "Sequence state out of bounds.\n");
+    }
+    return score;
+}
+
+// Per-thread block of sequences to score
+typedef struct ScoreWork {
+    const MarkovScorer* S;
+    const int* const* seqs;
+    const int* lens;
+    double* out;
+    int begin;
+    int end;
+    int invalid;    // number of sequences with out of bounds states
+} ScoreWork;
+
+static void* score_block(void* arg) {
+    ScoreWork* w = (ScoreWork*)arg;
+    w->invalid = 0;
+    for (int k = w->begin; k < w->end; k++) {
+        w->out[k] = score_path(w->S, w->seqs[k], w->lens[k]);
+        if (isnan(w->out[k])) {
+            w->invalid++;
+        }
+    }
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// score_sequences(MarkovScorer* S, const int* const* seqs, const int* lens,
+//                 int count, double* out, int num_threads)
+//
+//  Computes the log-likelihood of many sequences, split across threads
+//
+// Parameters:
+//    - S: Pointer to the MarkovScorer structure
+//    - seqs: Array of count sequences
+//    - lens: Array of count sequence lengths
+//    - count: Number of sequences
+//    - out: Array of count entries receiving score_sequence(S, seqs[k], lens[k])
+//    - num_threads: Number of threads (values < 1 use one)
+//
+// Returns:
+//    - 0 on success, -1 if the input is invalid or any sequence holds an out
+//      of bounds state (its score is NAN, the others are valid)
+///////////////////////////////////////////////////////////////////////////////
+int score_sequences(MarkovScorer* S, const int* const* seqs, const int* lens, int count,
+                    double* out, int num_threads) {
+    if (S == NULL || seqs == NULL || lens == NULL || out == NULL || count < 0) {
+        fprintf(stderr, "Invalid MarkovScorer structure or sequences.\n");
+        return -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    scorer_refresh(S);
+
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    if (num_threads > count) {
+        num_threads = count;
+    }
+    ScoreWork* work = (ScoreWork*)malloc(num_threads * sizeof(ScoreWork));
+    pthread_t* threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    if (work == NULL || threads == NULL) {
+        perror("Failed to allocate memory for worker threads");
+        exit(EXIT_FAILURE);
+    }
+
+    // balance the blocks on the number of states (one extra per sequence)
+    long total = 0;
+    for (int k = 0; k < count; k++) {
+        total += (lens[k] > 0 ? lens[k] : 0) + 1;
+    }
+    long done = 0;
+    int k = 0;
+    for (int t = 0; t < num_threads; t++) {
+        long target = total * (t + 1) / num_threads;
+        work[t].S = S;
+        work[t].seqs = seqs;
+        work[t].lens = lens;
+        work[t].out = out;
+        work[t].begin = k;
+        while (k < count && (t == num_threads - 1 || done < target)) {
+            done += (lens[k] > 0 ? lens[k] : 0) + 1;
+            k++;
+        }
+        work[t].end = k;
+    }
+
+    // the calling thread handles the first block itself
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, score_block, &work[t]) != 0) {
+            perror("Failed to create worker thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+    score_block(&work[0]);
+    int invalid = work[0].invalid;
+    for (int t = 1; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+        invalid += work[t].invalid;
+    }
+
+    free(work);
+    free(threads);
+    if (invalid > 0) {
+        fprintf(stderr, "%d sequences hold out of bounds states.\n", invalid);
+        return -1;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_scorer(MarkovScorer* S)
+//
+//  Frees the memory allocated for the MarkovScorer structure.
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_scorer(MarkovScorer* S) {
+    if (S == NULL) return;
+
+    free(S->log_rows);
+    free(S->seen);
+    free(S);
+}
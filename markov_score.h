@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_score.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_score.c sequence scoring, used to spot traces
+//   that deviate from a learned chain. The log-likelihood of a sequence
+//   s_0, s_1, ..., s_{len-1} is the sum of log P(s_t -> s_{t+1}) along the
+//   path; unusually low values flag an anomaly.
+//
+//   Probabilities are smoothed with additive (Laplace) smoothing on the
+//   counts behind each row, so transitions never seen do not score -inf:
+//
+//      P(i -> j) = (M[i][j] * helper[i] + alpha) / (helper[i] + alpha * n)
+//
+//   The logs are cached per row and a row is rebuilt only when its version
+//   (M->version) has changed since it was cached.
+//
+// Usage:
+//   Include this header by using #include "markov_score.h" and use the
+//   functions below. To score sliding windows of a trace, pass pointers into
+//   the trace as the sequences
+//
+// NOTE:
+//   The caller is responsible for freeing the allocated memory for the
+//   scorer (see the function "free_scorer" below). The chain is not freed
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_SCORE
+#define MARKOV_SCORE
+
+#include "markov.h"
+
+// The MarkovScorer structure holds the cached log rows of a chain
+typedef struct MarkovScorer {
+    Markov* M;          // chain being scored against
+    double* log_rows;   // size x size smoothed log probabilities, row major
+    unsigned int* seen; // version of each row when its logs were cached
+    double alpha;       // additive smoothing (0 = none)
+} MarkovScorer;
+
+///////////////////////////////////////////////////////////////////////////////
+// scorer_init(Markov* M, double alpha)
+//
+//  Builds the log cache of a chain
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - alpha: additive smoothing per transition (0 leaves unseen transitions
+//             at -INFINITY, 1 is Laplace smoothing)
+//
+// Returns:
+//    Pointer to the newly allocated MarkovScorer structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+MarkovScorer* scorer_init(Markov* M, double alpha);
+
+///////////////////////////////////////////////////////////////////////////////
+// scorer_refresh(MarkovScorer* S)
+//
+//  Rebuilds the cached logs of the rows updated since they were cached. The
+//  scoring functions call this first, so it only needs to be called directly
+//  to take the cost up front
+//
+// Returns:
+//    - The number of rows rebuilt, or -1 on invalid input
+///////////////////////////////////////////////////////////////////////////////
+int scorer_refresh(MarkovScorer* S);
+
+///////////////////////////////////////////////////////////////////////////////
+// score_sequence(MarkovScorer* S, const int* seq, int len)
+//
+//  Computes the log-likelihood of one sequence of states
+//
+// Parameters:
+//    - S: Pointer to the MarkovScorer structure
+//    - seq: Array of len state indices
+//    - len: Length of the sequence (len - 1 transitions are scored)
+//
+// Returns:
+//    - The log-likelihood (0 for fewer than two states), or NAN if the input
+//      is invalid or a state is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+double score_sequence(MarkovScorer* S, const int* seq, int len);
+
+///////////////////////////////////////////////////////////////////////////////
+// score_sequences(MarkovScorer* S, const int* const* seqs, const int* lens,
+//                 int count, double* out, int num_threads)
+//
+//  Computes the log-likelihood of many sequences, split across threads
+//
+// Parameters:
+//    - S: Pointer to the MarkovScorer structure
+//    - seqs: Array of count sequences
+//    - lens: Array of count sequence lengths
+//    - count: Number of sequences
+//    - out: Array of count entries receiving score_sequence(S, seqs[k], lens[k])
+//    - num_threads: Number of threads (values < 1 use one)
+//
+// Returns:
+//    - 0 on success, -1 if the input is invalid or any sequence holds an out
+//      of bounds state (its score is NAN, the others are valid)
+///////////////////////////////////////////////////////////////////////////////
+int score_sequences(MarkovScorer* S, const int* const* seqs, const int* lens, int count,
+                    double* out, int num_threads);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_scorer(MarkovScorer* S)
+//
+//  Frees the memory allocated for the MarkovScorer structure.
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_scorer(MarkovScorer* S);
+
+#endif
@@ -0,0 +1,374 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_shm.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the shared-memory chains. Each process
+//   rebuilds its own row pointers from the offsets in the header, so S->M is
+//   an ordinary Markov* over the mapping (M->storage == MARKOV_FILE, since a
+//   segment is a file in /dev/shm and is released the same way).
+//
+//   The seqlocks follow the usual fence pattern: the trainer stores the odd
+//   counter, issues a release fence and rewrites the row, then stores the
+//   even counter with release. A reader loads the counter with acquire,
+//   reads the row, issues an acquire fence and loads the counter again.
+//   The header magic is written last, so a reader attaching while the
+//   segment is being created sees either no chain or a complete one.
+//   A reader spinning on an odd counter checks the trainer's pid every
+//   SHM_LIVENESS_SPINS spins; there is no timeout, since a trainer can be
+//   descheduled or stopped for any length of time and still finish the row.
+//
+// Usage:
+//   Include this source code by using #include "markov_shm.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "markov_shm.h"
+
+#define SHM_MAGIC "MARKOVS1"
+#define SHM_VERSION 2
+#define LINE_ALIGN(x) (((x) + 63) & ~(size_t)63)
+
+// Spins on an odd counter between two checks that the trainer is alive
+#define SHM_LIVENESS_SPINS 1024
+
+// Computes the layout of a segment of the given size
+static void shm_layout(int size, SharedMarkovHeader* h, size_t* len) {
+    memset(h, 0, sizeof(SharedMarkovHeader));
+    h->version = SHM_VERSION;
+    h->size = size;
+    h->stride = ((uint64_t)size + 7) & ~(uint64_t)7;
+    h->seq_off = LINE_ALIGN(sizeof(SharedMarkovHeader));
+    h->helper_off = h->seq_off + LINE_ALIGN((size_t)size * sizeof(atomic_uint));
+    h->matrix_off = h->helper_off + LINE_ALIGN((size_t)size * sizeof(int));
+    *len = h->matrix_off + (size_t)size * h->stride * sizeof(double);
+}
+
+// Builds this process's view of a mapped segment
+static SharedMarkov* wrap_segment(void* base, size_t len, int writer) {
+    SharedMarkovHeader* h = (SharedMarkovHeader*)base;
+    SharedMarkov* S = (SharedMarkov*)malloc(sizeof(SharedMarkov));
+    Markov* M = (Markov*)malloc(sizeof(Markov));
+    double** rows = (double**)malloc(h->size * sizeof(double*));
+    // row versions are per process (readers watch the sequence counters)
+    unsigned int* version = (unsigned int*)calloc(h->size > 0 ? h->size : 1,
+                                                  sizeof(unsigned int));
+    if (S == NULL || M == NULL || rows == NULL || version == NULL) {
+        perror("Failed to allocate memory for SharedMarkov structure");
+        exit(EXIT_FAILURE);
+    }
+    M->size = h->size;
+    M->matrix = rows;
+    M->helper = (int*)((char*)base + h->helper_off);
+    M->version = version;
+    M->storage = MARKOV_FILE;
+    M->block = base;
+    M->block_len = len;
+    double* first = (double*)((char*)base + h->matrix_off);
+    for (int i = 0; i < h->size; i++) {
+        M->matrix[i] = first + (size_t)i * h->stride;
+    }
+    S->header = h;
+    S->seq = (atomic_uint*)((char*)base + h->seq_off);
+    S->M = M;
+    S->writer = writer;
+    return S;
+}
+
+// Returns 1 if the trainer process of the segment no longer exists
+static int trainer_gone(SharedMarkov* S) {
+    pid_t pid = (pid_t)S->header->trainer;
+    return pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+// Waits until row i is not being written and stores its counter in *s.
+// Returns 0, or SHM_ROW_STUCK if the row is odd and its trainer has exited.
+// A trainer that is only slow (descheduled, stopped, faulting) is waited for
+static int read_begin(SharedMarkov* S, int i, unsigned* s) {
+    for (long spins = 1; (*s = atomic_load_explicit(&S->seq[i], memory_order_acquire)) & 1; spins++) {
+        // the trainer holds the row for one update only, so the (system
+        // call) liveness check is only made once in a while
+        if (spins % SHM_LIVENESS_SPINS == 0 && trainer_gone(S)) {
+            fprintf(stderr, "Row %d of the shared chain was left mid-update by its trainer.\n", i);
+            return SHM_ROW_STUCK;
+        }
+        sched_yield();
+    }
+    return 0;
+}
+
+// Returns 1 if row i changed since read_begin returned s
+static int read_retry(SharedMarkov* S, int i, unsigned s) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&S->seq[i], memory_order_relaxed) != s;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_M_shm(const char* name, int size)
+//
+//  Creates a shared-memory segment holding an empty chain, replacing any
+//  segment of the same name, and maps it for the trainer
+//
+// Parameters:
+//    - name: Name of the segment ("/name", see shm_open)
+//    - size: The number of rows and columns in the transition matrix
+//
+// Returns:
+//    Pointer to the newly allocated SharedMarkov structure, or NULL if the
+//    segment could not be created or mapped
+///////////////////////////////////////////////////////////////////////////////
+SharedMarkov* initialize_M_shm(const char* name, int size) {
+    if (name == NULL || size < 1) {
+        fprintf(stderr, "Invalid segment name or size %d.\n", size);
+        return NULL;
+    }
+
+    SharedMarkovHeader header;
+    size_t len;
+    shm_layout(size, &header, &len);
+
+    // a new segment, so readers of an old one keep their old chain
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        perror("Failed to create shared segment");
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)len) != 0) {
+        perror("Failed to size shared segment");
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    void* base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map shared segment");
+        shm_unlink(name);
+        return NULL;
+    }
+
+    // the segment starts zeroed: an empty chain with every counter even
+    SharedMarkovHeader* h = (SharedMarkovHeader*)base;
+    h->version = header.version;
+    h->size = header.size;
+    h->stride = header.stride;
+    h->seq_off = header.seq_off;
+    h->helper_off = header.helper_off;
+    h->matrix_off = header.matrix_off;
+    atomic_init(&h->updates, 0);
+    h->trainer = (int32_t)getpid();
+    atomic_thread_fence(memory_order_release);
+    memcpy(h->magic, SHM_MAGIC, 8);
+    return wrap_segment(base, len, 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// attach_M_shm(const char* name)
+//
+//  Maps an existing segment read-only for a reader
+//
+// Parameters:
+//    - name: Name of the segment
+//
+// Returns:
+//    Pointer to the newly allocated SharedMarkov structure, or NULL if the
+//    segment does not exist or does not hold a chain
+///////////////////////////////////////////////////////////////////////////////
+SharedMarkov* attach_M_shm(const char* name) {
+    if (name == NULL) {
+        fprintf(stderr, "Invalid segment name.\n");
+        return NULL;
+    }
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        perror("Failed to open shared segment");
+        return NULL;
+    }
+    struct stat st;
+    SharedMarkovHeader header;
+    if (fstat(fd, &st) != 0 || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        fprintf(stderr, "Failed to read shared segment header.\n");
+        close(fd);
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    // the stored layout must be the one this size produces
+    SharedMarkovHeader expected;
+    size_t len;
+    if (memcmp(header.magic, SHM_MAGIC, 8) != 0 || header.version != SHM_VERSION ||
+        header.size < 1) {
+        fprintf(stderr, "%s does not hold a chain.\n", name);
+        close(fd);
+        return NULL;
+    }
+    shm_layout(header.size, &expected, &len);
+    if (header.stride != expected.stride || header.seq_off != expected.seq_off ||
+        header.helper_off != expected.helper_off || header.matrix_off != expected.matrix_off ||
+        (size_t)st.st_size < len) {
+        fprintf(stderr, "%s has an invalid layout.\n", name);
+        close(fd);
+        return NULL;
+    }
+
+    void* base = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map shared segment");
+        return NULL;
+    }
+    return wrap_segment(base, len, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// shm_update_matrix(SharedMarkov* S, int i, int j)
+//
+//  Applies a transition from state i to state j like update_matrix, inside
+//  the seqlock of row i
+//
+// Returns:
+//    - 0 on success, -1 for invalid indices or a reader's view
+///////////////////////////////////////////////////////////////////////////////
+int shm_update_matrix(SharedMarkov* S, int i, int j) {
+    if (S == NULL || !S->writer) {
+        fprintf(stderr, "Shared chain is not open for training.\n");
+        return -1;
+    }
+    if (i < 0 || j < 0 || i >= S->M->size || j >= S->M->size) {
+        fprintf(stderr, "invalid i, j indices ( %d, %d ) given size of %d.\n", i, j, S->M->size);
+        return -1;
+    }
+
+    unsigned s = atomic_load_explicit(&S->seq[i], memory_order_relaxed);
+    atomic_store_explicit(&S->seq[i], s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    update_matrix(S->M, i, j);
+    atomic_store_explicit(&S->seq[i], s + 2, memory_order_release);
+    atomic_fetch_add_explicit(&S->header->updates, 1, memory_order_release);
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// shm_max_prob_idx(SharedMarkov* S, int i)
+//
+//  Finds the index of the maximum probability in row i, like max_prob_idx,
+//  directly in the shared row; the search is retried if the trainer changed
+//  the row meanwhile
+//
+// Returns:
+//    - The column index of the maximum probability (leftmost on ties)
+//    - -1 if the row index is out of bounds
+//    - SHM_ROW_STUCK if the trainer exited while writing the row
+///////////////////////////////////////////////////////////////////////////////
+int shm_max_prob_idx(SharedMarkov* S, int i) {
+    if (S == NULL || i < 0 || i >= S->M->size) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+        return -1;
+    }
+
+    int size = S->M->size;
+    const double* row = S->M->matrix[i];
+    int max_idx;
+    unsigned s;
+    do {
+        if (read_begin(S, i, &s) != 0) {
+            return SHM_ROW_STUCK;
+        }
+        max_idx = 0;
+        double max_val = row[0];
+        for (int j = 1; j < size; j++) {
+            if (row[j] > max_val) {
+                max_val = row[j];
+                max_idx = j;
+            }
+        }
+    } while (read_retry(S, i, s));
+    return max_idx;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// shm_read_row(SharedMarkov* S, int i, double* out)
+//
+//  Copies a consistent version of row i
+//
+// Parameters:
+//    - S: Pointer to the SharedMarkov structure
+//    - i: Index of the row
+//    - out: Array of size doubles receiving the row
+//
+// Returns:
+//    - The helper count of the copied row, -1 if i is out of bounds, or
+//      SHM_ROW_STUCK if the trainer exited while writing the row
+///////////////////////////////////////////////////////////////////////////////
+int shm_read_row(SharedMarkov* S, int i, double* out) {
+    if (S == NULL || out == NULL || i < 0 || i >= S->M->size) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+        return -1;
+    }
+
+    int helper;
+    unsigned s;
+    do {
+        if (read_begin(S, i, &s) != 0) {
+            return SHM_ROW_STUCK;
+        }
+        memcpy(out, S->M->matrix[i], S->M->size * sizeof(double));
+        helper = S->M->helper[i];
+    } while (read_retry(S, i, s));
+    return helper;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// shm_updates(SharedMarkov* S)
+//
+// Returns:
+//    - The number of transitions applied to the shared chain so far
+///////////////////////////////////////////////////////////////////////////////
+unsigned long shm_updates(SharedMarkov* S) {
+    return atomic_load_explicit(&S->header->updates, memory_order_acquire);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// close_M_shm(SharedMarkov* S)
+//
+//  Unmaps the segment and frees the SharedMarkov structure. The segment
+//  itself is kept
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void close_M_shm(SharedMarkov* S) {
+    if (S == NULL) return;
+
+    free_M(S->M);   // unmaps the whole segment
+    free(S);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// remove_M_shm(const char* name)
+//
+//  Removes a segment; processes that have it mapped keep their mapping
+//
+// Returns:
+//    - 0 on success, -1 if the segment does not exist
+///////////////////////////////////////////////////////////////////////////////
+int remove_M_shm(const char* name) {
+    if (name == NULL || shm_unlink(name) != 0) {
+        return -1;
+    }
+    return 0;
+}
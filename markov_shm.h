@@ -0,0 +1,181 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_shm.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_shm.c shared-memory chains. One trainer
+//   process places the chain in a POSIX shared-memory segment and any number
+//   of reader processes on the same host attach to it and query it in place,
+//   without copies and without their own training.
+//
+//   The segment holds no pointers, only offsets from its start, so it maps
+//   at any address in any process:
+//      header   magic, size, row stride, section offsets, update count
+//      seq      one sequence counter per row
+//      helper   size ints
+//      matrix   size rows of stride doubles (rows padded to 64 bytes)
+//
+//   Each row is protected by a seqlock. The trainer makes the row's counter
+//   odd, rewrites the row and makes it even again; a reader notes the
+//   counter, reads the row and retries if the counter was odd or has moved.
+//   Readers never block the trainer and never observe a torn row. The
+//   header holds the trainer's pid: a reader waiting on an odd counter
+//   checks now and then that the trainer still exists (kill(pid, 0)), and
+//   fails with SHM_ROW_STUCK instead of waiting forever if it does not. A
+//   trainer that is only slow or stopped is waited for. The header's update
+//   count lets a reader tell whether anything changed.
+//
+// Usage:
+//   Include this header by using #include "markov_shm.h" and use the
+//   functions below. In the trainer:
+//
+//      SharedMarkov* S = initialize_M_shm("/pager-model", size);
+//      shm_update_matrix(S, i, j);
+//
+//   and in each reader:
+//
+//      SharedMarkov* S = attach_M_shm("/pager-model");
+//      int next = shm_max_prob_idx(S, i);
+//
+// NOTE:
+//   There must be a single trainer, and it must update the chain with
+//   shm_update_matrix (update_matrix on S->M skips the seqlock). The segment
+//   outlives the processes until remove_M_shm() is called. Readers must
+//   see the trainer's pid (same pid namespace) for the liveness check
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_SHM
+#define MARKOV_SHM
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "markov.h"
+
+// First bytes of a shared segment
+typedef struct SharedMarkovHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t size;
+    uint64_t stride;          // doubles per row
+    uint64_t seq_off;         // byte offsets of the sections
+    uint64_t helper_off;
+    uint64_t matrix_off;
+    atomic_ulong updates;     // transitions applied so far
+    int32_t trainer;          // pid of the trainer process
+} SharedMarkovHeader;
+
+// Returned by the reads of a row that the trainer left mid-update (it exited
+// inside shm_update_matrix)
+#define SHM_ROW_STUCK (-2)
+
+// The SharedMarkov structure is one process's view of a shared segment
+typedef struct SharedMarkov {
+    SharedMarkovHeader* header; // start of the mapping
+    atomic_uint* seq;           // per-row sequence counters
+    Markov* M;                  // rows and helper inside the mapping
+    int writer;                 // 1 in the trainer, 0 in readers
+} SharedMarkov;
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_M_shm(const char* name, int size)
+//
+//  Creates a shared-memory segment holding an empty chain, replacing any
+//  segment of the same name, and maps it for the trainer
+//
+// Parameters:
+//    - name: Name of the segment ("/name", see shm_open)
+//    - size: The number of rows and columns in the transition matrix
+//
+// Returns:
+//    Pointer to the newly allocated SharedMarkov structure, or NULL if the
+//    segment could not be created or mapped
+///////////////////////////////////////////////////////////////////////////////
+SharedMarkov* initialize_M_shm(const char* name, int size);
+
+///////////////////////////////////////////////////////////////////////////////
+// attach_M_shm(const char* name)
+//
+//  Maps an existing segment read-only for a reader
+//
+// Parameters:
+//    - name: Name of the segment
+//
+// Returns:
+//    Pointer to the newly allocated SharedMarkov structure, or NULL if the
+//    segment does not exist or does not hold a chain
+///////////////////////////////////////////////////////////////////////////////
+SharedMarkov* attach_M_shm(const char* name);
+
+///////////////////////////////////////////////////////////////////////////////
+// shm_update_matrix(SharedMarkov* S, int i, int j)
+//
+//  Applies a transition from state i to state j like update_matrix, inside
+//  the seqlock of row i
+//
+// Returns:
+//    - 0 on success, -1 for invalid indices or a reader's view
+///////////////////////////////////////////////////////////////////////////////
+int shm_update_matrix(SharedMarkov* S, int i, int j);
+
+///////////////////////////////////////////////////////////////////////////////
+// shm_max_prob_idx(SharedMarkov* S, int i)
+//
+//  Finds the index of the maximum probability in row i, like max_prob_idx,
+//  directly in the shared row; the search is retried if the trainer changed
+//  the row meanwhile
+//
+// Returns:
+//    - The column index of the maximum probability (leftmost on ties)
+//    - -1 if the row index is out of bounds
+//    - SHM_ROW_STUCK if the trainer exited while writing the row
+///////////////////////////////////////////////////////////////////////////////
+int shm_max_prob_idx(SharedMarkov* S, int i);
+
+///////////////////////////////////////////////////////////////////////////////
+// shm_read_row(SharedMarkov* S, int i, double* out)
+//
+//  Copies a consistent version of row i
+//
+// Parameters:
+//    - S: Pointer to the SharedMarkov structure
+//    - i: Index of the row
+//    - out: Array of size doubles receiving the row
+//
+// Returns:
+//    - The helper count of the copied row, -1 if i is out of bounds, or
+//      SHM_ROW_STUCK if the trainer exited while writing the row
+///////////////////////////////////////////////////////////////////////////////
+int shm_read_row(SharedMarkov* S, int i, double* out);
+
+///////////////////////////////////////////////////////////////////////////////
+// shm_updates(SharedMarkov* S)
+//
+// Returns:
+//    - The number of transitions applied to the shared chain so far
+///////////////////////////////////////////////////////////////////////////////
+unsigned long shm_updates(SharedMarkov* S);
+
+///////////////////////////////////////////////////////////////////////////////
+// close_M_shm(SharedMarkov* S)
+//
+//  Unmaps the segment and frees the SharedMarkov structure. The segment
+//  itself is kept
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void close_M_shm(SharedMarkov* S);
+
+///////////////////////////////////////////////////////////////////////////////
+// remove_M_shm(const char* name)
+//
+//  Removes a segment; processes that have it mapped keep their mapping
+//
+// Returns:
+//    - 0 on success, -1 if the segment does not exist
+///////////////////////////////////////////////////////////////////////////////
+int remove_M_shm(const char* name);
+
+#endif
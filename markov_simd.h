@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_simd.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Vectorized argmax/argmin kernels for a row of the Markov matrix. The
+//   kernels keep the same "leftmost index on a tie" rule as max_prob_idx and
+//   min_prob_idx: each of the four AVX2 lanes keeps the first best value it
+//   sees (strict comparison), and the lanes are then reduced by value with
+//   ties broken by the smallest index.
+//
+//   When the compiler does not target AVX2 the kernels fall back to the same
+//   scalar loop used by max_prob_idx/min_prob_idx.
+//
+// Usage:
+//   Include this header by using #include "markov_simd.h". The functions are
+//   static inline so they can be specialized when the row length is a
+//   compile-time constant (see markov_fixed.h)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_SIMD
+#define MARKOV_SIMD
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// simd_argmax(const double* row, int n)
+//
+//  Finds the index of the maximum value of row[0 .. n - 1]
+//
+// Parameters:
+//    - row: Pointer to the first value of the row
+//    - n: Number of values in the row (must be at least 1)
+//
+// Returns:
+//    - The index of the maximum value (the leftmost one in the event of a tie)
+///////////////////////////////////////////////////////////////////////////////
+static inline int simd_argmax(const double* row, int n) {
+    int j = 0;
+    int best_idx = 0;
+    double best_val = row[0];
+
+#ifdef __AVX2__
+    if (n >= 8) {
+        __m256d best = _mm256_loadu_pd(row);
+        __m256d idx = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+        __m256d best_i = idx;
+        const __m256d step = _mm256_set1_pd(4.0);
+        for (j = 4; j + 4 <= n; j += 4) {
+            __m256d v = _mm256_loadu_pd(row + j);
+            idx = _mm256_add_pd(idx, step);
+            __m256d gt = _mm256_cmp_pd(v, best, _CMP_GT_OQ);
+            best = _mm256_blendv_pd(best, v, gt);
+            best_i = _mm256_blendv_pd(best_i, idx, gt);
+        }
+
+        // reduce the lanes: largest value, then smallest index among equals
+        double vals[4];
+        double idxs[4];
+        _mm256_storeu_pd(vals, best);
+        _mm256_storeu_pd(idxs, best_i);
+        best_val = vals[0];
+        best_idx = (int)idxs[0];
+        for (int l = 1; l < 4; l++) {
+            if (vals[l] > best_val || (vals[l] == best_val && (int)idxs[l] < best_idx)) {
+                best_val = vals[l];
+                best_idx = (int)idxs[l];
+            }
+        }
+    }
+#endif
+
+    // the scalar tail only sees columns to the right of every lane, so a
+    // strict comparison still keeps the leftmost maximum
+    for (j = (j == 0 ? 1 : j); j < n; j++) {
+        if (row[j] > best_val) {
+            best_val = row[j];
+            best_idx = j;
+        }
+    }
+    return best_idx;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// simd_argmin(const double* row, int n)
+//
+//  Finds the index of the minimum value of row[0 .. n - 1]
+//
+// Parameters:
+//    - row: Pointer to the first value of the row
+//    - n: Number of values in the row (must be at least 1)
+//
+// Returns:
+//    - The index of the minimum value (the leftmost one in the event of a tie)
+///////////////////////////////////////////////////////////////////////////////
+static inline int simd_argmin(const double* row, int n) {
+    int j = 0;
+    int best_idx = 0;
+    double best_val = row[0];
+
+#ifdef __AVX2__
+    if (n >= 8) {
+        __m256d best = _mm256_loadu_pd(row);
+        __m256d idx = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+        __m256d best_i = idx;
+        const __m256d step = _mm256_set1_pd(4.0);
+        for (j = 4; j + 4 <= n; j += 4) {
+            __m256d v = _mm256_loadu_pd(row + j);
+            idx = _mm256_add_pd(idx, step);
+            __m256d lt = _mm256_cmp_pd(v, best, _CMP_LT_OQ);
+            best = _mm256_blendv_pd(best, v, lt);
+            best_i = _mm256_blendv_pd(best_i, idx, lt);
+        }
+
+        // reduce the lanes: smallest value, then smallest index among equals
+        double vals[4];
+        double idxs[4];
+        _mm256_storeu_pd(vals, best);
+        _mm256_storeu_pd(idxs, best_i);
+        best_val = vals[0];
+        best_idx = (int)idxs[0];
+        for (int l = 1; l < 4; l++) {
+            if (vals[l] < best_val || (vals[l] == best_val && (int)idxs[l] < best_idx)) {
+                best_val = vals[l];
+                best_idx = (int)idxs[l];
+            }
+        }
+    }
+#endif
+
+    for (j = (j == 0 ? 1 : j); j < n; j++) {
+        if (row[j] < best_val) {
+            best_val = row[j];
+            best_idx = j;
+        }
+    }
+    return best_idx;
+}
+
+#endif
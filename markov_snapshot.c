@@ -0,0 +1,276 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_snapshot.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the publish/snapshot mode.
+//
+//   Publishing swaps the current snapshot pointer and then advances the
+//   global epoch, tagging the replaced snapshot with the new epoch. A reader
+//   announces the global epoch in its slot before loading the pointer. A
+//   reader whose announced epoch is at least the tag of a retired snapshot
+//   read the epoch after the swap, so it can only have loaded a newer
+//   snapshot. A retired snapshot can therefore be reclaimed as soon as every
+//   active slot holds an epoch >= its tag. All the atomics use sequentially
+//   consistent ordering, which also covers a reader that announces a stale
+//   epoch after the writer scanned its slot: its pointer load comes after the
+//   swap in the single total order, so it sees the new snapshot.
+//
+// Usage:
+//   Include this source code by using #include "markov_snapshot.h" and use
+//   the functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the publisher (see the function
+//   "free_publisher" below)
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "markov_snapshot.h"
+
+// Returns a snapshot from the free list, or a new empty one
+static MarkovSnapshot* take_snapshot(MarkovPublisher* P) {
+    MarkovSnapshot* S = P->free_list;
+    if (S != NULL) {
+        P->free_list = S->next;
+        return S;
+    }
+
+    S = (MarkovSnapshot*)malloc(sizeof(MarkovSnapshot));
+    if (S == NULL) {
+        perror("Failed to allocate memory for snapshot");
+        exit(EXIT_FAILURE);
+    }
+    S->model = initialize_M(P->writer->size);
+    S->retire_epoch = 0;
+    S->next = NULL;
+    return S;
+}
+
+// Moves every retired snapshot that no active reader can still hold to the
+// free list
+static void reclaim(MarkovPublisher* P) {
+    unsigned long oldest = atomic_load(&P->epoch);
+    for (int r = 0; r < P->max_readers; r++) {
+        unsigned long e = atomic_load(&P->reader_epochs[r]);
+        if (e != 0 && e < oldest) {
+            oldest = e;
+        }
+    }
+
+    MarkovSnapshot** link = &P->retired;
+    while (*link != NULL) {
+        MarkovSnapshot* S = *link;
+        if (S->retire_epoch <= oldest) {
+            *link = S->next;
+            S->next = P->free_list;
+            P->free_list = S;
+        } else {
+            link = &S->next;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// publisher_init(int size, int max_readers)
+//
+//  Creates a publisher with an empty chain of the given size and publishes
+//  the empty chain as the first snapshot
+//
+// Parameters:
+//    - size: The number of states in the chain
+//    - max_readers: The number of reader threads (each uses its own slot)
+//
+// Returns:
+//    - Pointer to the newly allocated MarkovPublisher structure or NULL on
+//      error
+///////////////////////////////////////////////////////////////////////////////
+MarkovPublisher* publisher_init(int size, int max_readers) {
+    if (size < 1 || max_readers < 1) {
+        fprintf(stderr, "Invalid size %d or reader count %d.\n", size, max_readers);
+        return NULL;
+    }
+
+    MarkovPublisher* P = (MarkovPublisher*)malloc(sizeof(MarkovPublisher));
+    if (P == NULL) {
+        perror("Failed to allocate memory for MarkovPublisher structure");
+        exit(EXIT_FAILURE);
+    }
+    P->writer = initialize_M(size);
+    P->max_readers = max_readers;
+    P->retired = NULL;
+    P->free_list = NULL;
+    atomic_init(&P->epoch, 1);
+
+    P->reader_epochs = (atomic_ulong*)malloc(max_readers * sizeof(atomic_ulong));
+    if (P->reader_epochs == NULL) {
+        perror("Failed to allocate memory for reader slots");
+        exit(EXIT_FAILURE);
+    }
+    for (int r = 0; r < max_readers; r++) {
+        atomic_init(&P->reader_epochs[r], 0);
+    }
+
+    // the first snapshot is the empty chain
+    atomic_init(&P->current, take_snapshot(P));
+    return P;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// publisher_update(MarkovPublisher* P, int i, int j)
+//
+//  Applies update_matrix() to the writer's private chain. The change becomes
+//  visible to readers at the next publisher_publish()
+//
+// Parameters:
+//    - P: Pointer to the MarkovPublisher structure
+//    - i: index of the previous state (row)
+//    - j: index of the next state (column)
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int publisher_update(MarkovPublisher* P, int i, int j) {
+    if (P == NULL) {
+        fprintf(stderr, "Invalid MarkovPublisher structure.\n");
+        return -1;
+    }
+    return update_matrix(P->writer, i, j);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// publisher_publish(MarkovPublisher* P)
+//
+//  Publishes a copy of the writer's chain as the new snapshot and reclaims
+//  any retired snapshot that no reader can still be using. A reclaimed
+//  snapshot is reused by the next publish, in which case only the rows whose
+//  version changed since that snapshot was taken are copied.
+//
+// Parameters:
+//    - P: Pointer to the MarkovPublisher structure
+//
+// Returns:
+//    - The number of rows copied, or -1 on error
+//
+// NOTE:
+//    Must only be called by the thread that updates the chain
+///////////////////////////////////////////////////////////////////////////////
+long publisher_publish(MarkovPublisher* P) {
+    // Step 1.
+    //   Reclaim retired snapshots so one of them can be reused
+    // Step 2.
+    //   Bring the (reused or new) snapshot up to date with the writer. Rows
+    //   only ever change through update_matrix(), which bumps the row's
+    //   version, so rows with an equal version are already identical
+    // Step 3.
+    //   Swap it in as the current snapshot, advance the epoch and retire the
+    //   replaced snapshot with the new epoch
+
+    if (P == NULL) {
+        fprintf(stderr, "Invalid MarkovPublisher structure.\n");
+        return -1;
+    }
+
+    reclaim(P);
+    MarkovSnapshot* S = take_snapshot(P);
+    Markov* W = P->writer;
+    long copied = 0;
+    for (int i = 0; i < W->size; i++) {
+        if (S->model->version[i] != W->version[i]) {
+            memcpy(S->model->matrix[i], W->matrix[i], W->size * sizeof(double));
+            S->model->helper[i] = W->helper[i];
+            S->model->version[i] = W->version[i];
+            copied++;
+        }
+    }
+
+    S->next = NULL;
+    MarkovSnapshot* old = atomic_exchange(&P->current, S);
+    old->retire_epoch = atomic_fetch_add(&P->epoch, 1) + 1;
+    old->next = P->retired;
+    P->retired = old;
+    return copied;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// snapshot_acquire(MarkovPublisher* P, int reader)
+//
+//  Returns the latest published snapshot for reading. The snapshot stays
+//  valid until the same reader calls snapshot_release(). Wait-free: a fixed
+//  number of atomic loads and stores, never blocked by the writer.
+//
+// Parameters:
+//    - P: Pointer to the MarkovPublisher structure
+//    - reader: The reader's slot (0 <= reader < max_readers)
+//
+// Returns:
+//    - Pointer to the read-only snapshot chain, or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+Markov* snapshot_acquire(MarkovPublisher* P, int reader) {
+    if (P == NULL || reader < 0 || reader >= P->max_readers) {
+        fprintf(stderr, "Invalid publisher or reader slot %d.\n", reader);
+        return NULL;
+    }
+
+    // announce the epoch before loading the pointer (see the description at
+    // the top of this file)
+    atomic_store(&P->reader_epochs[reader], atomic_load(&P->epoch));
+    return atomic_load(&P->current)->model;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// snapshot_release(MarkovPublisher* P, int reader)
+//
+//  Ends the reader's use of the snapshot returned by snapshot_acquire()
+//
+// Parameters:
+//    - P: Pointer to the MarkovPublisher structure
+//    - reader: The reader's slot
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void snapshot_release(MarkovPublisher* P, int reader) {
+    if (P == NULL || reader < 0 || reader >= P->max_readers) {
+        return;
+    }
+    atomic_store(&P->reader_epochs[reader], 0);
+}
+
+// Frees every snapshot of a list
+static void free_snapshot_list(MarkovSnapshot* S) {
+    while (S != NULL) {
+        MarkovSnapshot* next = S->next;
+        free_M(S->model);
+        free(S);
+        S = next;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_publisher(MarkovPublisher* P)
+//
+//  Frees the writer's chain and every snapshot
+//
+// Parameters:
+//    - P: Pointer to the MarkovPublisher structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_publisher(MarkovPublisher* P) {
+    if (P == NULL) return;
+
+    MarkovSnapshot* current = atomic_load(&P->current);
+    current->next = NULL;
+    free_snapshot_list(current);
+    free_snapshot_list(P->retired);
+    free_snapshot_list(P->free_list);
+    free_M(P->writer);
+    free(P->reader_epochs);
+    free(P);
+}
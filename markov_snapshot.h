@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_snapshot.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_snapshot.c publish/snapshot mode, which lets
+//   prediction threads query a chain while a training thread keeps updating
+//   it. The training thread updates a private Markov structure and publishes
+//   an immutable copy of it from time to time. Readers pick up the latest
+//   published copy without taking a lock and never see a row in the middle of
+//   an update_matrix() rescale.
+//
+//   Old copies are reclaimed with epochs: each reader announces the epoch it
+//   started reading in, and a retired copy is only freed (or reused for a
+//   later publish) once every active reader has moved past the epoch in which
+//   it was replaced.
+//
+// Usage:
+//   Include this header by using #include "markov_snapshot.h" and use the
+//   functions below. One thread trains and publishes:
+//
+//      publisher_update(P, i, j);      // any number of times
+//      publisher_publish(P);           // make the updates visible
+//
+//   and each reader thread r (0 <= r < max_readers) queries:
+//
+//      Markov* S = snapshot_acquire(P, r);
+//      int next = max_prob_idx(S, i);
+//      snapshot_release(P, r);
+//
+// NOTE:
+//   The caller is responsible for freeing the publisher (see the function
+//   "free_publisher" below) once every reader has stopped. Snapshots must not
+//   be modified or freed by readers
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_SNAPSHOT
+#define MARKOV_SNAPSHOT
+
+#include <stdatomic.h>
+#include "markov.h"
+
+// A published, immutable copy of the chain
+typedef struct MarkovSnapshot {
+    Markov* model;                // The copied chain
+    unsigned long retire_epoch;   // Epoch in which the copy was replaced
+    struct MarkovSnapshot* next;  // Link in the retired or free list
+} MarkovSnapshot;
+
+// The MarkovPublisher structure holds the writer's private chain, the latest
+// published snapshot and the epoch bookkeeping used to reclaim old snapshots
+typedef struct MarkovPublisher {
+    Markov* writer;                     // Private chain updated by the trainer
+    _Atomic(MarkovSnapshot*) current;   // Latest published snapshot
+    atomic_ulong epoch;                 // Global epoch, bumped by each publish
+    atomic_ulong* reader_epochs;        // Epoch announced by each reader (0 = idle)
+    int max_readers;                    // Number of reader slots
+    MarkovSnapshot* retired;            // Replaced snapshots not yet reclaimed
+    MarkovSnapshot* free_list;          // Reclaimed snapshots ready for reuse
+} MarkovPublisher;
+
+///////////////////////////////////////////////////////////////////////////////
+// publisher_init(int size, int max_readers)
+//
+//  Creates a publisher with an empty chain of the given size and publishes
+//  the empty chain as the first snapshot
+//
+// Parameters:
+//    - size: The number of states in the chain
+//    - max_readers: The number of reader threads (each uses its own slot)
+//
+// Returns:
+//    - Pointer to the newly allocated MarkovPublisher structure or NULL on
+//      error
+///////////////////////////////////////////////////////////////////////////////
+MarkovPublisher* publisher_init(int size, int max_readers);
+
+///////////////////////////////////////////////////////////////////////////////
+// publisher_update(MarkovPublisher* P, int i, int j)
+//
+//  Applies update_matrix() to the writer's private chain. The change becomes
+//  visible to readers at the next publisher_publish()
+//
+// Parameters:
+//    - P: Pointer to the MarkovPublisher structure
+//    - i: index of the previous state (row)
+//    - j: index of the next state (column)
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int publisher_update(MarkovPublisher* P, int i, int j);
+
+///////////////////////////////////////////////////////////////////////////////
+// publisher_publish(MarkovPublisher* P)
+//
+//  Publishes a copy of the writer's chain as the new snapshot and reclaims
+//  any retired snapshot that no reader can still be using. A reclaimed
+//  snapshot is reused by the next publish, in which case only the rows whose
+//  version changed since that snapshot was taken are copied.
+//
+// Parameters:
+//    - P: Pointer to the MarkovPublisher structure
+//
+// Returns:
+//    - The number of rows copied, or -1 on error
+//
+// NOTE:
+//    Must only be called by the thread that updates the chain
+///////////////////////////////////////////////////////////////////////////////
+long publisher_publish(MarkovPublisher* P);
+
+///////////////////////////////////////////////////////////////////////////////
+// snapshot_acquire(MarkovPublisher* P, int reader)
+//
+//  Returns the latest published snapshot for reading. The snapshot stays
+//  valid until the same reader calls snapshot_release(). Wait-free: a fixed
+//  number of atomic loads and stores, never blocked by the writer.
+//
+// Parameters:
+//    - P: Pointer to the MarkovPublisher structure
+//    - reader: The reader's slot (0 <= reader < max_readers)
+//
+// Returns:
+//    - Pointer to the read-only snapshot chain, or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+Markov* snapshot_acquire(MarkovPublisher* P, int reader);
+
+///////////////////////////////////////////////////////////////////////////////
+// snapshot_release(MarkovPublisher* P, int reader)
+//
+//  Ends the reader's use of the snapshot returned by snapshot_acquire()
+//
+// Parameters:
+//    - P: Pointer to the MarkovPublisher structure
+//    - reader: The reader's slot
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void snapshot_release(MarkovPublisher* P, int reader);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_publisher(MarkovPublisher* P)
+//
+//  Frees the writer's chain and every snapshot
+//
+// Parameters:
+//    - P: Pointer to the MarkovPublisher structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_publisher(MarkovPublisher* P);
+
+#endif
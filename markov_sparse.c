@@ -0,0 +1,455 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_sparse.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the compressed sparse row (CSR) view of a
+//   Markov chain and the sparse x sparse matrix product used to compute
+//   multi-step transition structure for large chains.
+//
+//   The product uses Gustavson's algorithm. For row i of the result, every
+//   nonzero S1[i][k] scales row k of S2 and adds it into a dense accumulator
+//   the size of one row. A second array remembers which columns were touched
+//   so the accumulator can be collected and cleared in time proportional to
+//   the number of nonzeros produced instead of the size of the matrix.
+//
+// Usage:
+//   Include this source code by using #include "markov_sparse.h" and use the
+//   functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the allocated memory for the sparse
+//   matrix (see the function "free_sparse" below)
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "markov_sparse.h"
+
+// Allocates memory or exits the program, the same way initialize_M handles a
+// failed allocation
+static void* sparse_alloc(size_t bytes, const char* what) {
+    void* ptr = malloc(bytes > 0 ? bytes : 1);
+    if (ptr == NULL) {
+        perror(what);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+// Allocates a SparseMarkov with room for nnz nonzeros and copies the helper
+// array (if one is given)
+static SparseMarkov* alloc_sparse(int size, long nnz, const int* helper) {
+    SparseMarkov* S = (SparseMarkov*)sparse_alloc(sizeof(SparseMarkov),
+        "Failed to allocate memory for SparseMarkov structure");
+    S->size = size;
+    S->nnz = nnz;
+    S->row_ptr = (long*)sparse_alloc((size + 1) * sizeof(long),
+        "Failed to allocate memory for row offsets");
+    S->col_idx = (int*)sparse_alloc(nnz * sizeof(int),
+        "Failed to allocate memory for column indices");
+    S->values = (double*)sparse_alloc(nnz * sizeof(double),
+        "Failed to allocate memory for nonzero values");
+    S->helper = (int*)sparse_alloc(size * sizeof(int),
+        "Failed to allocate memory for helper array");
+    if (helper != NULL) {
+        memcpy(S->helper, helper, size * sizeof(int));
+    } else {
+        memset(S->helper, 0, size * sizeof(int));
+    }
+    return S;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sparse_from_M(Markov* M)
+//
+//  Builds the CSR view of a dense Markov structure, keeping only the nonzero
+//  cells of each row
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//
+// Returns:
+//    - Pointer to the newly allocated SparseMarkov structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+SparseMarkov* sparse_from_M(Markov* M) {
+    // Step 1.
+    //   Count the nonzeros so the CSR arrays can be allocated exactly
+    // Step 2.
+    //   Copy the nonzeros of each row in column order, recording where each
+    //   row starts in row_ptr
+
+    if (M == NULL || M->matrix == NULL) {
+        fprintf(stderr, "Invalid Markov structure.\n");
+        return NULL;
+    }
+
+    long nnz = 0;
+    for (int i = 0; i < M->size; i++) {
+        for (int j = 0; j < M->size; j++) {
+            if (M->matrix[i][j] != 0.0) {
+                nnz++;
+            }
+        }
+    }
+
+    SparseMarkov* S = alloc_sparse(M->size, nnz, M->helper);
+    long pos = 0;
+    for (int i = 0; i < M->size; i++) {
+        S->row_ptr[i] = pos;
+        for (int j = 0; j < M->size; j++) {
+            if (M->matrix[i][j] != 0.0) {
+                S->col_idx[pos] = j;
+                S->values[pos] = M->matrix[i][j];
+                pos++;
+            }
+        }
+    }
+    S->row_ptr[M->size] = pos;
+    return S;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sparse_to_M(SparseMarkov* S)
+//
+//  Expands a sparse matrix back into a dense Markov structure
+//
+// Parameters:
+//    - S: Pointer to the SparseMarkov structure
+//
+// Returns:
+//    - Pointer to the newly allocated Markov structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+Markov* sparse_to_M(SparseMarkov* S) {
+    if (S == NULL) {
+        fprintf(stderr, "Invalid SparseMarkov structure.\n");
+        return NULL;
+    }
+
+    Markov* M = initialize_M(S->size);
+    for (int i = 0; i < S->size; i++) {
+        for (long p = S->row_ptr[i]; p < S->row_ptr[i + 1]; p++) {
+            M->matrix[i][S->col_idx[p]] = S->values[p];
+        }
+        M->helper[i] = S->helper[i];
+    }
+    return M;
+}
+
+// Per-thread state for sparse_mult. Each worker produces the rows
+// [row_begin, row_end) of the product into its own growable arrays, which are
+// stitched together once every worker has finished
+typedef struct SpgemmWork {
+    SparseMarkov* S1;
+    SparseMarkov* S2;
+    double drop_tol;
+    int row_begin;
+    int row_end;
+    long* row_nnz;   // nonzeros produced for each row of the block
+    int* cols;       // produced column indices
+    double* vals;    // produced values
+    long count;      // number of produced nonzeros
+    long capacity;   // allocated length of cols/vals
+} SpgemmWork;
+
+static int compare_int(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts the touched column list of one row. Rows of a transition matrix are
+// usually short, so insertion sort is used until qsort pays off
+static void sort_columns(int* cols, int n) {
+    if (n > 32) {
+        qsort(cols, n, sizeof(int), compare_int);
+        return;
+    }
+    for (int a = 1; a < n; a++) {
+        int key = cols[a];
+        int b = a - 1;
+        while (b >= 0 && cols[b] > key) {
+            cols[b + 1] = cols[b];
+            b--;
+        }
+        cols[b + 1] = key;
+    }
+}
+
+static void* spgemm_worker(void* arg) {
+    SpgemmWork* w = (SpgemmWork*)arg;
+    SparseMarkov* A = w->S1;
+    SparseMarkov* B = w->S2;
+    int n = B->size;
+
+    // the sparse accumulator: dense values, a flag for each column telling
+    // whether it already is in the touched list, and the touched list itself
+    double* acc = (double*)calloc(n, sizeof(double));
+    char* used = (char*)calloc(n, sizeof(char));
+    int* touched = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+    if (acc == NULL || used == NULL || touched == NULL) {
+        perror("Failed to allocate memory for sparse accumulator");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = w->row_begin; i < w->row_end; i++) {
+        int ntouched = 0;
+
+        // acc = sum over k of A[i][k] * B[k][:]
+        for (long p = A->row_ptr[i]; p < A->row_ptr[i + 1]; p++) {
+            int k = A->col_idx[p];
+            double a = A->values[p];
+            for (long q = B->row_ptr[k]; q < B->row_ptr[k + 1]; q++) {
+                int j = B->col_idx[q];
+                if (!used[j]) {
+                    used[j] = 1;
+                    touched[ntouched++] = j;
+                }
+                acc[j] += a * B->values[q];
+            }
+        }
+
+        // make sure the output arrays can hold the whole row
+        if (w->count + ntouched > w->capacity) {
+            long cap = w->capacity * 2;
+            if (cap < w->count + ntouched) {
+                cap = w->count + ntouched;
+            }
+            w->cols = (int*)realloc(w->cols, cap * sizeof(int));
+            w->vals = (double*)realloc(w->vals, cap * sizeof(double));
+            if (w->cols == NULL || w->vals == NULL) {
+                perror("Failed to allocate memory for product row");
+                exit(EXIT_FAILURE);
+            }
+            w->capacity = cap;
+        }
+
+        // gather the row in column order, dropping small entries, and reset
+        // the accumulator for the next row
+        sort_columns(touched, ntouched);
+        long start = w->count;
+        for (int t = 0; t < ntouched; t++) {
+            int j = touched[t];
+            if (acc[j] > w->drop_tol) {
+                w->cols[w->count] = j;
+                w->vals[w->count] = acc[j];
+                w->count++;
+            }
+            acc[j] = 0.0;
+            used[j] = 0;
+        }
+        w->row_nnz[i - w->row_begin] = w->count - start;
+    }
+
+    free(acc);
+    free(used);
+    free(touched);
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sparse_mult(SparseMarkov* S1, SparseMarkov* S2, double drop_tol,
+//             int num_threads)
+//
+//  Multiplies two sparse transition matrices using Gustavson's algorithm:
+//  each row of the result is the sum of the rows of S2 selected by the
+//  nonzeros of the same row of S1, gathered in a dense accumulator with a
+//  list of touched columns. Rows are split across num_threads threads.
+//
+// Parameters:
+//    - S1: Pointer to the first SparseMarkov structure
+//    - S2: Pointer to the second SparseMarkov structure
+//    - drop_tol: entries of the product with a value <= drop_tol are not
+//                stored (pass 0 to keep every nonzero)
+//    - num_threads: number of worker threads (values < 1 use one thread)
+//
+// Returns:
+//    - A pointer to the resulting SparseMarkov structure or NULL on error
+//
+// NOTE:
+//    The helper array of the result is copied from S1
+///////////////////////////////////////////////////////////////////////////////
+SparseMarkov* sparse_mult(SparseMarkov* S1, SparseMarkov* S2, double drop_tol,
+                          int num_threads) {
+    // Step 1.
+    //   Check that both structures have equal sizes
+    // Step 2.
+    //   Split the rows into one contiguous block per thread, balancing the
+    //   blocks by the number of nonzeros of S1 they contain
+    // Step 3.
+    //   Run Gustavson's algorithm for each block in its own thread
+    // Step 4.
+    //   Stitch the blocks together into a single CSR structure
+
+    if (S1 == NULL || S2 == NULL) {
+        fprintf(stderr, "Invalid SparseMarkov structure.\n");
+        return NULL;
+    }
+    if (S1->size != S2->size) {
+        fprintf(stderr, "Both Markov matrices must be of equal size. %d != %d\n",S1->size,S2->size);
+        return NULL;
+    }
+
+    int n = S1->size;
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    if (num_threads > n && n > 0) {
+        num_threads = n;
+    }
+
+    SpgemmWork* work = (SpgemmWork*)sparse_alloc(num_threads * sizeof(SpgemmWork),
+        "Failed to allocate memory for worker state");
+    pthread_t* threads = (pthread_t*)sparse_alloc(num_threads * sizeof(pthread_t),
+        "Failed to allocate memory for worker threads");
+
+    // balance the blocks on the work in S1 (one unit per row plus its nonzeros)
+    long total = S1->nnz + n;
+    int row = 0;
+    for (int t = 0; t < num_threads; t++) {
+        long target = total * (t + 1) / num_threads;
+        SpgemmWork* w = &work[t];
+        w->S1 = S1;
+        w->S2 = S2;
+        w->drop_tol = drop_tol;
+        w->row_begin = row;
+        while (row < n && (t == num_threads - 1 || S1->row_ptr[row] + row < target)) {
+            row++;
+        }
+        w->row_end = row;
+        w->row_nnz = (long*)sparse_alloc((w->row_end - w->row_begin) * sizeof(long),
+            "Failed to allocate memory for row counts");
+        w->capacity = (S1->row_ptr[w->row_end] - S1->row_ptr[w->row_begin]) * 2 + 16;
+        w->cols = (int*)sparse_alloc(w->capacity * sizeof(int),
+            "Failed to allocate memory for product row");
+        w->vals = (double*)sparse_alloc(w->capacity * sizeof(double),
+            "Failed to allocate memory for product row");
+        w->count = 0;
+    }
+
+    // the calling thread handles the first block itself
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, spgemm_worker, &work[t]) != 0) {
+            perror("Failed to create worker thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+    spgemm_worker(&work[0]);
+    for (int t = 1; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    long nnz = 0;
+    for (int t = 0; t < num_threads; t++) {
+        nnz += work[t].count;
+    }
+    SparseMarkov* result = alloc_sparse(n, nnz, S1->helper);
+    long pos = 0;
+    for (int t = 0; t < num_threads; t++) {
+        SpgemmWork* w = &work[t];
+        for (int i = w->row_begin; i < w->row_end; i++) {
+            result->row_ptr[i] = pos;
+            pos += w->row_nnz[i - w->row_begin];
+        }
+        memcpy(result->col_idx + result->row_ptr[w->row_begin], w->cols, w->count * sizeof(int));
+        memcpy(result->values + result->row_ptr[w->row_begin], w->vals, w->count * sizeof(double));
+        free(w->row_nnz);
+        free(w->cols);
+        free(w->vals);
+    }
+    result->row_ptr[n] = pos;
+
+    free(work);
+    free(threads);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sparse_max_prob_idx(SparseMarkov* S, int i)
+//
+//  Finds the index of the maximum probability in row `i` of the sparse matrix.
+//
+// Parameters:
+//    - S: Pointer to the SparseMarkov structure.
+//    - i: Index of the row to search.
+//
+// Returns:
+//    - The column index of the maximum probability in the row (0 for a row
+//      with no nonzeros, matching max_prob_idx on an all-zero row)
+//    - -1 if the input is invalid or the row index is out of bounds.
+//
+// NOTE:
+//    Returns the leftmost index in the event of a tie
+///////////////////////////////////////////////////////////////////////////////
+int sparse_max_prob_idx(SparseMarkov* S, int i) {
+    if (S == NULL || i < 0 || i >= S->size) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+        return -1; // Return an error indicator
+    }
+
+    long begin = S->row_ptr[i];
+    long end = S->row_ptr[i + 1];
+    if (begin == end) {
+        return 0; // every cell is 0, so the first column wins the tie
+    }
+
+    // columns are sorted, so a strict comparison keeps the leftmost maximum
+    int max_idx = S->col_idx[begin];
+    double max_val = S->values[begin];
+    for (long p = begin + 1; p < end; p++) {
+        if (S->values[p] > max_val) {
+            max_val = S->values[p];
+            max_idx = S->col_idx[p];
+        }
+    }
+
+    // stored values are probabilities (> 0), so they always beat the
+    // implicit zeros that are not stored
+    return max_idx;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_sparse(SparseMarkov* S)
+//
+//  Frees the memory allocated for the SparseMarkov structure.
+//
+// Parameters:
+//    - S: Pointer to the SparseMarkov structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_sparse(SparseMarkov* S) {
+    if (S == NULL) return;
+
+    free(S->row_ptr);
+    free(S->col_idx);
+    free(S->values);
+    free(S->helper);
+    free(S);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// print_sparse(SparseMarkov* S)
+//
+//  Prints each stored nonzero as "(row, column) value", one row per line
+//
+// Parameters:
+//    - S: Pointer to the SparseMarkov structure.
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void print_sparse(SparseMarkov* S) {
+    for (int i = 0; i < S->size; i++) {
+        for (long p = S->row_ptr[i]; p < S->row_ptr[i + 1]; p++) {
+            printf("(%d, %d) %.3f ", i, S->col_idx[p], S->values[p]);
+        }
+        // line-feed after each row
+        printf("\n");
+    }
+}
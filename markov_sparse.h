@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_sparse.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_sparse.c compressed sparse row (CSR) view of a
+//   Markov chain. Most rows of a learned transition matrix only contain a few
+//   nonzero entries (a page is usually followed by a handful of other pages),
+//   so storing only the nonzeros lets multi-step products be computed for
+//   chains far too large for the dense matrix_mult().
+//
+//   Functions include conversion to and from the dense Markov structure, a
+//   sparse x sparse product (Gustavson's row-by-row algorithm), freeing memory,
+//   and printing the matrix
+//
+// Usage:
+//   Include this header by using #include "markov_sparse.h" and use the
+//   functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the allocated memory for the sparse
+//   matrix (see the function "free_sparse" below)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_SPARSE
+#define MARKOV_SPARSE
+
+#include "markov.h"
+
+// The SparseMarkov structure stores the matrix in CSR form. The nonzeros of
+// row i are values[row_ptr[i]] .. values[row_ptr[i + 1] - 1], with their
+// column indices in col_idx (sorted ascending within each row). The helper
+// array is carried over from the dense structure so the number of updates to
+// each row is not lost in the conversion
+typedef struct SparseMarkov {
+    long* row_ptr;   // size + 1 offsets into col_idx/values
+    int* col_idx;    // column index of each nonzero
+    double* values;  // probability of each nonzero
+    int* helper;     // 1D array to track the number of updates to each row
+    int size;        // The size of the matrix (size x size)
+    long nnz;        // The number of stored nonzeros
+} SparseMarkov;
+
+///////////////////////////////////////////////////////////////////////////////
+// sparse_from_M(Markov* M)
+//
+//  Builds the CSR view of a dense Markov structure, keeping only the nonzero
+//  cells of each row
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//
+// Returns:
+//    - Pointer to the newly allocated SparseMarkov structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+SparseMarkov* sparse_from_M(Markov* M);
+
+///////////////////////////////////////////////////////////////////////////////
+// sparse_to_M(SparseMarkov* S)
+//
+//  Expands a sparse matrix back into a dense Markov structure
+//
+// Parameters:
+//    - S: Pointer to the SparseMarkov structure
+//
+// Returns:
+//    - Pointer to the newly allocated Markov structure or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+Markov* sparse_to_M(SparseMarkov* S);
+
+///////////////////////////////////////////////////////////////////////////////
+// sparse_mult(SparseMarkov* S1, SparseMarkov* S2, double drop_tol,
+//             int num_threads)
+//
+//  Multiplies two sparse transition matrices using Gustavson's algorithm:
+//  each row of the result is the sum of the rows of S2 selected by the
+//  nonzeros of the same row of S1, gathered in a dense accumulator with a
+//  list of touched columns. Rows are split across num_threads threads.
+//
+// Parameters:
+//    - S1: Pointer to the first SparseMarkov structure
+//    - S2: Pointer to the second SparseMarkov structure
+//    - drop_tol: entries of the product with a value <= drop_tol are not
+//                stored (pass 0 to keep every nonzero)
+//    - num_threads: number of worker threads (values < 1 use one thread)
+//
+// Returns:
+//    - A pointer to the resulting SparseMarkov structure or NULL on error
+//
+// NOTE:
+//    The helper array of the result is copied from S1
+///////////////////////////////////////////////////////////////////////////////
+SparseMarkov* sparse_mult(SparseMarkov* S1, SparseMarkov* S2, double drop_tol,
+                          int num_threads);
+
+///////////////////////////////////////////////////////////////////////////////
+// sparse_max_prob_idx(SparseMarkov* S, int i)
+//
+//  Finds the index of the maximum probability in row `i` of the sparse matrix.
+//
+// Parameters:
+//    - S: Pointer to the SparseMarkov structure.
+//    - i: Index of the row to search.
+//
+// Returns:
+//    - The column index of the maximum probability in the row (0 for a row
+//      with no nonzeros, matching max_prob_idx on an all-zero row)
+//    - -1 if the input is invalid or the row index is out of bounds.
+//
+// NOTE:
+//    Returns the leftmost index in the event of a tie
+///////////////////////////////////////////////////////////////////////////////
+int sparse_max_prob_idx(SparseMarkov* S, int i);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_sparse(SparseMarkov* S)
+//
+//  Frees the memory allocated for the SparseMarkov structure.
+//
+// Parameters:
+//    - S: Pointer to the SparseMarkov structure
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_sparse(SparseMarkov* S);
+
+///////////////////////////////////////////////////////////////////////////////
+// print_sparse(SparseMarkov* S)
+//
+//  Prints each stored nonzero as "(row, column) value", one row per line
+//
+// Parameters:
+//    - S: Pointer to the SparseMarkov structure.
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void print_sparse(SparseMarkov* S);
+
+#endif
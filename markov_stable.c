@@ -0,0 +1,339 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_stable.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the training mode for long runs. The
+//   products are computed row by row (i-k-j order): row i of the result is
+//   the sum over k of M1[i][k] times row k of M2, with a running sum and a
+//   running compensation per column. The compensation holds the low order
+//   bits each add drops, and is folded in once the row is complete.
+//
+// Usage:
+//   Include this source code by using #include "markov_stable.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "markov_stable.h"
+
+// Neumaier's variant of Kahan summation: adds v to *sum, keeping the part
+// lost to rounding in *comp (also when v is larger than the sum so far)
+static inline void neumaier_add(double* sum, double* comp, double v) {
+    double t = *sum + v;
+    if (fabs(*sum) >= fabs(v)) {
+        *comp += (*sum - t) + v;
+    } else {
+        *comp += (v - t) + *sum;
+    }
+    *sum = t;
+}
+
+// Compensated sum of n values
+static double compensated_sum(const double* values, int n) {
+    double sum = 0.0, comp = 0.0;
+    for (int k = 0; k < n; k++) {
+        neumaier_add(&sum, &comp, values[k]);
+    }
+    return sum + comp;
+}
+
+// Writes x * P into out, using comp as scratch (both of n entries)
+static void row_times(const double* x, double** P, int n, double* out, double* comp) {
+    memset(out, 0, n * sizeof(double));
+    memset(comp, 0, n * sizeof(double));
+    for (int k = 0; k < n; k++) {
+        double a = x[k];
+        if (a == 0.0) {
+            continue;
+        }
+        const double* row = P[k];
+        for (int j = 0; j < n; j++) {
+            neumaier_add(&out[j], &comp[j], a * row[j]);
+        }
+    }
+    for (int j = 0; j < n; j++) {
+        out[j] += comp[j];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// stable_init(Markov* M, uint64_t interval)
+//
+//  Starts the training mode on a chain, taking the counts from its helper
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - interval: Number of updates of a row between two renormalizations of
+//                that row (0 leaves them to renormalize_rows)
+//
+// Returns:
+//    Pointer to the newly allocated StableMarkov structure, or NULL for
+//    invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+StableMarkov* stable_init(Markov* M, uint64_t interval) {
+    if (M == NULL || M->matrix == NULL || M->helper == NULL) {
+        fprintf(stderr, "Invalid input for the stable training mode.\n");
+        return NULL;
+    }
+
+    StableMarkov* S = (StableMarkov*)malloc(sizeof(StableMarkov));
+    if (S == NULL) {
+        perror("Failed to allocate memory for StableMarkov structure");
+        exit(EXIT_FAILURE);
+    }
+    S->M = M;
+    S->interval = interval;
+    S->renormalized = 0;
+    S->counts = (uint64_t*)malloc((M->size > 0 ? M->size : 1) * sizeof(uint64_t));
+    S->pending = (uint64_t*)calloc(M->size > 0 ? M->size : 1, sizeof(uint64_t));
+    if (S->counts == NULL || S->pending == NULL) {
+        perror("Failed to allocate memory for the 64-bit counts");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < M->size; i++) {
+        S->counts[i] = M->helper[i] > 0 ? (uint64_t)M->helper[i] : 0;
+    }
+    return S;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// stable_update(StableMarkov* S, int i, int j)
+//
+//  Records a transition from state i to state j, as update_matrix does,
+//  with a 64-bit count and one rounding per cell
+//
+// Parameters:
+//    - S: Pointer to the StableMarkov structure
+//    - i: Index of the previous state (row)
+//    - j: Index of the next state (column)
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int stable_update(StableMarkov* S, int i, int j) {
+    // Step 1.
+    //   Take the 64-bit count alpha of the row before incrementing it, and
+    //   mirror the new count into the chain's helper, saturated at INT_MAX
+    // Step 2.
+    //   Scale every cell by alpha / (alpha + 1) (the update_matrix multiply
+    //   and divide folded into one factor) and add 1 / (alpha + 1) to cell j
+    // Step 3.
+    //   Renormalize the row once it has had `interval` updates since the
+    //   last time
+
+    if (S == NULL || i < 0 || j < 0 || i >= S->M->size || j >= S->M->size) {
+        fprintf(stderr, "invalid i, j indices ( %d, %d ) for the stable update.\n", i, j);
+        return -1;
+    }
+
+    uint64_t alpha = S->counts[i]++;
+    S->M->helper[i] = S->counts[i] < (uint64_t)INT_MAX ? (int)S->counts[i] : INT_MAX;
+    S->M->version[i]++;
+
+    double next = (double)alpha + 1.0;
+    double scale = (double)alpha / next;
+    double* row = S->M->matrix[i];
+    int n = S->M->size;
+    for (int k = 0; k < n; k++) {
+        row[k] *= scale;
+    }
+    row[j] += 1.0 / next;
+
+    if (S->interval > 0 && ++S->pending[i] >= S->interval) {
+        renormalize_row(S->M, i);
+        S->pending[i] = 0;
+        S->renormalized++;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// stable_count(StableMarkov* S, int i)
+//
+// Returns:
+//    - The number of updates of row i, or 0 if i is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+uint64_t stable_count(StableMarkov* S, int i) {
+    if (S == NULL || i < 0 || i >= S->M->size) {
+        return 0;
+    }
+    return S->counts[i];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// renormalize_row(Markov* M, int i)
+//
+//  Scales row i so that it sums to 1, taking the sum with compensated
+//  summation. An all-zero row is left as it is
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - i: Index of the row
+//
+// Returns:
+//    - The sum of the row before scaling, or NAN if i is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+double renormalize_row(Markov* M, int i) {
+    if (M == NULL || M->matrix == NULL || i < 0 || i >= M->size) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+        return NAN;
+    }
+
+    double* row = M->matrix[i];
+    double sum = compensated_sum(row, M->size);
+    if (sum > 0.0 && sum != 1.0) {
+        double inv = 1.0 / sum;
+        for (int k = 0; k < M->size; k++) {
+            row[k] *= inv;
+        }
+        M->version[i]++;
+    }
+    return sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// renormalize_rows(Markov* M)
+//
+//  Renormalizes every row of a chain (the periodic pass)
+//
+// Returns:
+//    - The number of rows whose sum was not already exactly 1, or -1 for
+//      invalid input
+///////////////////////////////////////////////////////////////////////////////
+int renormalize_rows(Markov* M) {
+    if (M == NULL || M->matrix == NULL) {
+        fprintf(stderr, "Invalid input for the renormalization.\n");
+        return -1;
+    }
+
+    int changed = 0;
+    for (int i = 0; i < M->size; i++) {
+        double sum = renormalize_row(M, i);
+        if (sum > 0.0 && sum != 1.0) {
+            changed++;
+        }
+    }
+    return changed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// row_sum_drift(Markov* M)
+//
+// Returns:
+//    - The largest |sum - 1| over the rows that are not all zero, with the
+//      sums taken by compensated summation, or NAN for invalid input
+///////////////////////////////////////////////////////////////////////////////
+double row_sum_drift(Markov* M) {
+    if (M == NULL || M->matrix == NULL) {
+        fprintf(stderr, "Invalid input for the row sum drift.\n");
+        return NAN;
+    }
+
+    double drift = 0.0;
+    for (int i = 0; i < M->size; i++) {
+        double sum = compensated_sum(M->matrix[i], M->size);
+        if (sum != 0.0 && fabs(sum - 1.0) > drift) {
+            drift = fabs(sum - 1.0);
+        }
+    }
+    return drift;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// matrix_mult_compensated(Markov* M1, Markov* M2)
+//
+//  Multiplies two Markov transition matrices as matrix_mult does, with every
+//  cell accumulated by Neumaier summation
+//
+// Parameters:
+//    - M1: Pointer to the first Markov structure
+//    - M2: Pointer to the second Markov structure
+//
+// Returns:
+//    - A pointer to the resulting Markov structure, or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+Markov* matrix_mult_compensated(Markov* M1, Markov* M2) {
+    if (M1 == NULL || M2 == NULL || M1->size != M2->size) {
+        fprintf(stderr, "Both Markov matrices must be given and of equal size.\n");
+        return NULL;
+    }
+
+    int n = M1->size;
+    Markov* result = initialize_M(n);
+    double* comp = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+    if (comp == NULL) {
+        perror("Failed to allocate memory for the compensation terms");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        row_times(M1->matrix[i], M2->matrix, n, result->matrix[i], comp);
+    }
+    free(comp);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// propagate_compensated(Markov* M, const double* x, double* y, int steps)
+//
+//  Pushes a distribution through the chain: y = x * M^steps, with every
+//  step accumulated by Neumaier summation
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - x: Row vector of M->size entries (e.g. a distribution over states)
+//    - y: Array of M->size entries receiving the result (may be x)
+//    - steps: Number of steps (0 copies x)
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int propagate_compensated(Markov* M, const double* x, double* y, int steps) {
+    if (M == NULL || M->matrix == NULL || x == NULL || y == NULL || steps < 0) {
+        fprintf(stderr, "Invalid input for the propagation.\n");
+        return -1;
+    }
+
+    int n = M->size;
+    double* cur = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+    double* next = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+    double* comp = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+    if (cur == NULL || next == NULL || comp == NULL) {
+        perror("Failed to allocate memory for the propagated vectors");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(cur, x, n * sizeof(double));
+    for (int s = 0; s < steps; s++) {
+        row_times(cur, M->matrix, n, next, comp);
+        double* swap = cur;
+        cur = next;
+        next = swap;
+    }
+    memcpy(y, cur, n * sizeof(double));
+    free(cur);
+    free(next);
+    free(comp);
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_stable(StableMarkov* S)
+//
+//  Frees the StableMarkov structure (not the chain)
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_stable(StableMarkov* S) {
+    if (S == NULL) return;
+
+    free(S->counts);
+    free(S->pending);
+    free(S);
+}
@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_stable.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_stable.c training mode for long runs. After
+//   billions of update_matrix() calls two things go wrong:
+//   - the int helper count of a row overflows past INT_MAX (2^31 - 1
+//     updates), and the rescale by a negative alpha wrecks the row
+//   - every update multiplies each cell by alpha and divides it by
+//     alpha + 1, two roundings per cell per update, so the row sums
+//     wander away from 1 and near ties between cells the argmax can flip
+//
+//   A StableMarkov keeps a 64-bit count per row next to a chain and updates
+//   it with a single multiply per cell (by alpha / (alpha + 1)) plus one add
+//   on the observed cell. The chain's own helper is kept as the count
+//   saturated at INT_MAX, so the rest of the library still sees the row as
+//   trained. Every `interval` updates of a row the row is renormalized: its
+//   sum is taken with compensated (Neumaier) summation and the row is
+//   scaled back to 1, which is one pass over the row and needs no rebuild.
+//
+//   For products of chains, matrix_mult_compensated() and
+//   propagate_compensated() accumulate every dot product with Neumaier
+//   summation, so long products and many propagation steps of a
+//   distribution keep their accuracy instead of losing a few bits per step.
+//
+// Usage:
+//   Include this header by using #include "markov_stable.h" and use the
+//   functions below:
+//
+//      StableMarkov* S = stable_init(M, 1 << 16);
+//      stable_update(S, prev, s);          // instead of update_matrix
+//      ...
+//      free_stable(S);
+//
+// NOTE:
+//   The StableMarkov structure updates the chain but does not own it
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_STABLE
+#define MARKOV_STABLE
+
+#include <stdint.h>
+#include "markov.h"
+
+// The StableMarkov structure holds the 64-bit counts of a chain and the
+// updates of each row since it was last renormalized
+typedef struct StableMarkov {
+    Markov* M;                   // chain being trained
+    uint64_t* counts;            // updates of each row
+    uint64_t* pending;           // updates of each row since its renormalization
+    uint64_t interval;           // updates between renormalizations (0 for never)
+    unsigned long renormalized;  // rows renormalized so far
+} StableMarkov;
+
+///////////////////////////////////////////////////////////////////////////////
+// stable_init(Markov* M, uint64_t interval)
+//
+//  Starts the training mode on a chain, taking the counts from its helper
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - interval: Number of updates of a row between two renormalizations of
+//                that row (0 leaves them to renormalize_rows)
+//
+// Returns:
+//    Pointer to the newly allocated StableMarkov structure, or NULL for
+//    invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+StableMarkov* stable_init(Markov* M, uint64_t interval);
+
+///////////////////////////////////////////////////////////////////////////////
+// stable_update(StableMarkov* S, int i, int j)
+//
+//  Records a transition from state i to state j, as update_matrix does,
+//  with a 64-bit count and one rounding per cell
+//
+// Parameters:
+//    - S: Pointer to the StableMarkov structure
+//    - i: Index of the previous state (row)
+//    - j: Index of the next state (column)
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int stable_update(StableMarkov* S, int i, int j);
+
+///////////////////////////////////////////////////////////////////////////////
+// stable_count(StableMarkov* S, int i)
+//
+// Returns:
+//    - The number of updates of row i, or 0 if i is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+uint64_t stable_count(StableMarkov* S, int i);
+
+///////////////////////////////////////////////////////////////////////////////
+// renormalize_row(Markov* M, int i)
+//
+//  Scales row i so that it sums to 1, taking the sum with compensated
+//  summation. An all-zero row is left as it is
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - i: Index of the row
+//
+// Returns:
+//    - The sum of the row before scaling, or NAN if i is out of bounds
+///////////////////////////////////////////////////////////////////////////////
+double renormalize_row(Markov* M, int i);
+
+///////////////////////////////////////////////////////////////////////////////
+// renormalize_rows(Markov* M)
+//
+//  Renormalizes every row of a chain (the periodic pass)
+//
+// Returns:
+//    - The number of rows whose sum was not already exactly 1, or -1 for
+//      invalid input
+///////////////////////////////////////////////////////////////////////////////
+int renormalize_rows(Markov* M);
+
+///////////////////////////////////////////////////////////////////////////////
+// row_sum_drift(Markov* M)
+//
+// Returns:
+//    - The largest |sum - 1| over the rows that are not all zero, with the
+//      sums taken by compensated summation, or NAN for invalid input
+///////////////////////////////////////////////////////////////////////////////
+double row_sum_drift(Markov* M);
+
+///////////////////////////////////////////////////////////////////////////////
+// matrix_mult_compensated(Markov* M1, Markov* M2)
+//
+//  Multiplies two Markov transition matrices as matrix_mult does, with every
+//  cell accumulated by Neumaier summation
+//
+// Parameters:
+//    - M1: Pointer to the first Markov structure
+//    - M2: Pointer to the second Markov structure
+//
+// Returns:
+//    - A pointer to the resulting Markov structure, or NULL on error
+///////////////////////////////////////////////////////////////////////////////
+Markov* matrix_mult_compensated(Markov* M1, Markov* M2);
+
+///////////////////////////////////////////////////////////////////////////////
+// propagate_compensated(Markov* M, const double* x, double* y, int steps)
+//
+//  Pushes a distribution through the chain: y = x * M^steps, with every
+//  step accumulated by Neumaier summation
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - x: Row vector of M->size entries (e.g. a distribution over states)
+//    - y: Array of M->size entries receiving the result (may be x)
+//    - steps: Number of steps (0 copies x)
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+///////////////////////////////////////////////////////////////////////////////
+int propagate_compensated(Markov* M, const double* x, double* y, int steps);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_stable(StableMarkov* S)
+//
+//  Frees the StableMarkov structure (not the chain)
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_stable(StableMarkov* S);
+
+#endif
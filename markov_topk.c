@@ -0,0 +1,315 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_topk.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the bounded-memory chain. Each row is a
+//   Space-Saving summary stored as three parallel arrays of K slots, so one
+//   update is a single scan of the row's slots that both looks for the
+//   successor and remembers the slot with the smallest count:
+//
+//     - successor found:        its count is incremented
+//     - free slot:              the successor takes it with count 1, error 0
+//     - row full:               the successor replaces the smallest count c
+//                               and gets count c + 1, error c
+//
+//   An update costs O(K): it does not depend on the number of states or on
+//   the fan-out of the row, but it is not the O(1) of the stream-summary form
+//   of Space-Saving (slots linked into buckets of equal count). For the K the
+//   summaries are meant for (a few to a few dozen) the row's slots fill one
+//   or two cache lines and the scan is cheaper than following the bucket
+//   links, which would also add two pointers per slot.
+//
+//   The counts of a row sum to its helper count. When that reaches INT_MAX
+//   the row is halved (counts rounded up, errors rounded down) and the
+//   helper count becomes the new sum, so nothing wraps, the probabilities
+//   and the N / K bound hold as before, and old transitions fade like those
+//   of a saturated row of update_matrix.
+//
+// Usage:
+//   Include this source code by using #include "markov_topk.h" and use the
+//   functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the allocated memory for the
+//   summaries (see the function "free_heavy" below)
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "markov_topk.h"
+
+// Returns nonzero if slot a ranks before slot b of the same row
+static inline int ranks_before(const HeavyMarkov* H, size_t a, size_t b) {
+    if (H->counts[a] != H->counts[b]) {
+        return H->counts[a] > H->counts[b];
+    }
+    if (H->errors[a] != H->errors[b]) {
+        return H->errors[a] < H->errors[b];
+    }
+    return H->keys[a] < H->keys[b];
+}
+
+// Halves the counts and errors of row i and sets its helper count to the new
+// sum of the counts
+static void halve_row(HeavyMarkov* H, int i) {
+    size_t base = (size_t)i * H->k;
+    long total = 0;
+    for (int s = 0; s < H->k && H->keys[base + s] >= 0; s++) {
+        H->counts[base + s] = H->counts[base + s] / 2 + (H->counts[base + s] & 1);
+        H->errors[base + s] /= 2;
+        total += H->counts[base + s];
+    }
+    H->helper[i] = (int)total;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_heavy(int size, int k)
+//
+//  Initializes summaries of k successors for each of `size` states
+//
+// Parameters:
+//    - size: The number of states
+//    - k: The number of successors tracked per state
+//
+// Returns:
+//    Pointer to the newly allocated HeavyMarkov structure, or NULL if k < 1
+///////////////////////////////////////////////////////////////////////////////
+HeavyMarkov* initialize_heavy(int size, int k) {
+    if (k < 1) {
+        fprintf(stderr, "Invalid number of tracked successors %d.\n", k);
+        return NULL;
+    }
+
+    HeavyMarkov* H = (HeavyMarkov*)malloc(sizeof(HeavyMarkov));
+    if (H == NULL) {
+        perror("Failed to allocate memory for HeavyMarkov structure");
+        exit(EXIT_FAILURE);
+    }
+    H->size = size;
+    H->k = k;
+
+    size_t slots = (size_t)size * k + 1;
+    H->keys = (int*)malloc(slots * sizeof(int));
+    H->counts = (uint32_t*)calloc(slots, sizeof(uint32_t));
+    H->errors = (uint32_t*)calloc(slots, sizeof(uint32_t));
+    H->helper = (int*)calloc(size + 1, sizeof(int));
+    if (H->keys == NULL || H->counts == NULL || H->errors == NULL || H->helper == NULL) {
+        perror("Failed to allocate memory for summaries");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t s = 0; s < slots; s++) {
+        H->keys[s] = -1;
+    }
+    return H;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// heavy_update(HeavyMarkov* H, int i, int j)
+//
+//  Records a transition from state i to state j. If j is not tracked and the
+//  row is full, j replaces the successor with the smallest count and
+//  inherits that count as its error
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+//
+// NOTE:
+//    Costs one scan of the K slots of row i. A row whose helper count
+//    reaches INT_MAX is halved first
+///////////////////////////////////////////////////////////////////////////////
+int heavy_update(HeavyMarkov* H, int i, int j) {
+    if (H == NULL || i >= H->size || j >= H->size || i < 0 || j < 0) {
+        fprintf(stderr, "invalid i, j indices ( %d, %d ) given size of %d.\n", i, j,
+                H != NULL ? H->size : 0);
+        return -1;
+    }
+
+    size_t base = (size_t)i * H->k;
+    int* keys = H->keys + base;
+    uint32_t* counts = H->counts + base;
+    if (H->helper[i] == INT_MAX) {
+        halve_row(H, i);
+    }
+    H->helper[i]++;
+
+    // slots fill from the left, so the first unused slot ends the search
+    int min_slot = 0;
+    for (int s = 0; s < H->k; s++) {
+        if (keys[s] == j) {
+            counts[s]++;
+            return 0;
+        }
+        if (keys[s] < 0) {
+            keys[s] = j;
+            counts[s] = 1;
+            H->errors[base + s] = 0;
+            return 0;
+        }
+        if (counts[s] < counts[min_slot]) {
+            min_slot = s;
+        }
+    }
+
+    keys[min_slot] = j;
+    H->errors[base + min_slot] = counts[min_slot];
+    counts[min_slot]++;
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// heavy_prob(HeavyMarkov* H, int i, int j, double* lower, double* upper)
+//
+//  Estimates the probability of the transition from state i to state j
+//
+// Parameters:
+//    - H: Pointer to the HeavyMarkov structure
+//    - i, j: Indices of the transition
+//    - lower: If not NULL, receives a lower bound on the true probability
+//    - upper: If not NULL, receives an upper bound on the true probability
+//
+// Returns:
+//    - The estimated probability (0 for untracked successors), or -1 for
+//      invalid indices
+///////////////////////////////////////////////////////////////////////////////
+double heavy_prob(HeavyMarkov* H, int i, int j, double* lower, double* upper) {
+    if (H == NULL || i >= H->size || j >= H->size || i < 0 || j < 0) {
+        fprintf(stderr, "Invalid input or index out of bounds.\n");
+        return -1.0;
+    }
+
+    size_t base = (size_t)i * H->k;
+    double total = H->helper[i];
+    uint32_t min_count = 0;
+    int full = 1;
+    for (int s = 0; s < H->k; s++) {
+        if (H->keys[base + s] == j) {
+            if (lower != NULL) {
+                *lower = (H->counts[base + s] - H->errors[base + s]) / total;
+            }
+            if (upper != NULL) {
+                *upper = H->counts[base + s] / total;
+            }
+            return H->counts[base + s] / total;
+        }
+        if (H->keys[base + s] < 0) {
+            full = 0;
+            break;
+        }
+        if (s == 0 || H->counts[base + s] < min_count) {
+            min_count = H->counts[base + s];
+        }
+    }
+
+    // an untracked successor was seen at most as often as the smallest
+    // tracked count (and never, if the row still has free slots)
+    if (lower != NULL) {
+        *lower = 0.0;
+    }
+    if (upper != NULL) {
+        *upper = full && total > 0 ? min_count / total : 0.0;
+    }
+    return 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// heavy_max_prob_idx(HeavyMarkov* H, int i)
+//
+//  Finds the successor of state i with the largest estimated count
+//
+// Returns:
+//    - The successor index (0 for a row that was never updated, like
+//      max_prob_idx)
+//    - -1 if the input is invalid or the row index is out of bounds.
+//
+// NOTE:
+//    Ties go to the estimate with the smaller error, then to the smaller
+//    index
+///////////////////////////////////////////////////////////////////////////////
+int heavy_max_prob_idx(HeavyMarkov* H, int i) {
+    if (H == NULL || i < 0 || i >= H->size) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+        return -1; // Return an error indicator
+    }
+
+    size_t base = (size_t)i * H->k;
+    if (H->keys[base] < 0) {
+        return 0;
+    }
+    size_t best = base;
+    for (int s = 1; s < H->k && H->keys[base + s] >= 0; s++) {
+        if (ranks_before(H, base + s, best)) {
+            best = base + s;
+        }
+    }
+    return H->keys[best];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// heavy_top_k(HeavyMarkov* H, int i, int k, int* out)
+//
+//  Finds up to k successors of state i with the largest estimated counts
+//
+// Parameters:
+//    - H: Pointer to the HeavyMarkov structure
+//    - i: Index of the row to search
+//    - k: Number of successors wanted
+//    - out: Array of at least k entries receiving the successor indices, most
+//           likely first (same tie rules as heavy_max_prob_idx)
+//
+// Returns:
+//    - The number of indices written (at most min(k, H->k)), or -1 on
+//      invalid input
+///////////////////////////////////////////////////////////////////////////////
+int heavy_top_k(HeavyMarkov* H, int i, int k, int* out) {
+    if (H == NULL || out == NULL || i < 0 || i >= H->size || k < 0) {
+        fprintf(stderr, "Invalid input or row index out of bounds.\n");
+        return -1;
+    }
+
+    // insertion into the (short) output, keeping the best k slots seen
+    size_t base = (size_t)i * H->k;
+    int found = 0;
+    for (int s = 0; s < H->k && H->keys[base + s] >= 0; s++) {
+        int pos = found < k ? found : k;
+        while (pos > 0 && ranks_before(H, base + s, base + out[pos - 1])) {
+            if (pos < k) {
+                out[pos] = out[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < k) {
+            out[pos] = s;
+            if (found < k) {
+                found++;
+            }
+        }
+    }
+
+    // the slots were ranked, report their successors
+    for (int r = 0; r < found; r++) {
+        out[r] = H->keys[base + out[r]];
+    }
+    return found;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free_heavy(HeavyMarkov* H)
+//
+//  Frees the memory allocated for the HeavyMarkov structure.
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_heavy(HeavyMarkov* H) {
+    if (H == NULL) return;
+
+    free(H->keys);
+    free(H->counts);
+    free(H->errors);
+    free(H->helper);
+    free(H);
+}
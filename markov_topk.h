@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_topk.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_topk.c bounded-memory chain. Instead of a full
+//   row of probabilities, each state keeps a Space-Saving summary of at most
+//   K successors (a successor id, an estimated count and the error of that
+//   estimate). Memory is O(n * K) no matter how many different successors a
+//   state has, and an update costs one pass over the K slots of the row:
+//   O(K), not the O(1) of the bucket-list form of Space-Saving, which for
+//   small K spends more on its links than the scan of a cache line or two.
+//
+//   Error bounds (with N = helper[i], the number of updates to row i):
+//     - an estimated count never undercounts, and overcounts by at most its
+//       error, which is at most N / K
+//     - any successor seen more than N / K times is always in the summary
+//   A row is halved when N reaches INT_MAX, so the counts never wrap and
+//   the bounds keep holding as fractions of the new N.
+//
+// Usage:
+//   Include this header by using #include "markov_topk.h" and use the
+//   functions below
+//
+// NOTE:
+//   The caller is responsible for freeing the allocated memory for the
+//   summaries (see the function "free_heavy" below)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_TOPK
+#define MARKOV_TOPK
+
+#include <stdint.h>
+#include "markov.h"
+
+// The HeavyMarkov structure holds the K summary slots of every row
+typedef struct HeavyMarkov {
+    int* keys;          // size x k successor ids, row major (-1 if unused)
+    uint32_t* counts;   // size x k estimated counts
+    uint32_t* errors;   // size x k maximum overcount of each estimate
+    int* helper;        // 1D array to track the number of updates to each row
+    int k;              // slots per row
+    int size;           // The number of states
+} HeavyMarkov;
+
+///////////////////////////////////////////////////////////////////////////////
+// initialize_heavy(int size, int k)
+//
+//  Initializes summaries of k successors for each of `size` states
+//
+// Parameters:
+//    - size: The number of states
+//    - k: The number of successors tracked per state
+//
+// Returns:
+//    Pointer to the newly allocated HeavyMarkov structure, or NULL if k < 1
+///////////////////////////////////////////////////////////////////////////////
+HeavyMarkov* initialize_heavy(int size, int k);
+
+///////////////////////////////////////////////////////////////////////////////
+// heavy_update(HeavyMarkov* H, int i, int j)
+//
+//  Records a transition from state i to state j. If j is not tracked and the
+//  row is full, j replaces the successor with the smallest count and
+//  inherits that count as its error
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters
+//
+// NOTE:
+//    Costs one scan of the K slots of row i. A row whose helper count
+//    reaches INT_MAX is halved first
+///////////////////////////////////////////////////////////////////////////////
+int heavy_update(HeavyMarkov* H, int i, int j);
+
+///////////////////////////////////////////////////////////////////////////////
+// heavy_prob(HeavyMarkov* H, int i, int j, double* lower, double* upper)
+//
+//  Estimates the probability of the transition from state i to state j
+//
+// Parameters:
+//    - H: Pointer to the HeavyMarkov structure
+//    - i, j: Indices of the transition
+//    - lower: If not NULL, receives a lower bound on the true probability
+//    - upper: If not NULL, receives an upper bound on the true probability
+//
+// Returns:
+//    - The estimated probability (0 for untracked successors), or -1 for
+//      invalid indices
+///////////////////////////////////////////////////////////////////////////////
+double heavy_prob(HeavyMarkov* H, int i, int j, double* lower, double* upper);
+
+///////////////////////////////////////////////////////////////////////////////
+// heavy_max_prob_idx(HeavyMarkov* H, int i)
+//
+//  Finds the successor of state i with the largest estimated count
+//
+// Returns:
+//    - The successor index (0 for a row that was never updated, like
+//      max_prob_idx)
+//    - -1 if the input is invalid or the row index is out of bounds.
+//
+// NOTE:
+//    Ties go to the estimate with the smaller error, then to the smaller
+//    index
+///////////////////////////////////////////////////////////////////////////////
+int heavy_max_prob_idx(HeavyMarkov* H, int i);
+
+///////////////////////////////////////////////////////////////////////////////
+// heavy_top_k(HeavyMarkov* H, int i, int k, int* out)
+//
+//  Finds up to k successors of state i with the largest estimated counts
+//
+// Parameters:
+//    - H: Pointer to the HeavyMarkov structure
+//    - i: Index of the row to search
+//    - k: Number of successors wanted
+//    - out: Array of at least k entries receiving the successor indices, most
+//           likely first (same tie rules as heavy_max_prob_idx)
+//
+// Returns:
+//    - The number of indices written (at most min(k, H->k)), or -1 on
+//      invalid input
+///////////////////////////////////////////////////////////////////////////////
+int heavy_top_k(HeavyMarkov* H, int i, int k, int* out);
+
+///////////////////////////////////////////////////////////////////////////////
+// free_heavy(HeavyMarkov* H)
+//
+//  Frees the memory allocated for the HeavyMarkov structure.
+//
+// Returns:
+//    - None
+///////////////////////////////////////////////////////////////////////////////
+void free_heavy(HeavyMarkov* H);
+
+#endif
@@ -0,0 +1,540 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_train.c
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Contains the implementation of the parallel trainer. Training runs in
+//   two phases separated by a join:
+//
+//   Counting. Each thread owns a range of chunk numbers packed in one 64-bit
+//   atomic word (first chunk in the high half, end in the low half). The
+//   owner takes chunks from the front with a CAS; a thread with an empty
+//   range scans the others and steals the back half of the first non-empty
+//   range with a CAS on the same word, so owner and thief can never take
+//   the same chunk. Transitions are counted in a per-thread open addressing
+//   table keyed by (i << 32 | j), which is finally compacted and sorted so
+//   each row's counts are contiguous.
+//
+//   Reduction. Threads split the rows; for each of its rows a thread walks
+//   the matching run of every sorted table. A dense row is converted back
+//   to counts (p * helper), the new counts are added and the row is divided
+//   by the new total. A sparse chain is built in two passes: the number of
+//   distinct successors of each row (merging the runs), then a prefix sum
+//   and the fill.
+//
+// Usage:
+//   Include this source code by using #include "markov_train.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "markov_train.h"
+
+#define EMPTY_KEY UINT64_MAX
+
+// One (transition, count) entry of a worker's table
+typedef struct CountEntry {
+    uint64_t key;   // i << 32 | j
+    long count;
+} CountEntry;
+
+// State shared by every thread of one training call
+typedef struct TrainShared {
+    const int* trace;
+    long len;
+    long chunk_len;
+    long chunks;
+    int size;
+    int num_threads;
+    atomic_ullong* ranges;      // chunk range of each thread (first << 32 | end)
+    atomic_int error;           // set when an out of bounds state is seen
+    struct TrainWorker* workers;
+    Markov* M;                  // dense target (NULL when building sparse)
+    SparseMarkov* S;            // sparse target
+} TrainShared;
+
+// Per-thread state
+typedef struct TrainWorker {
+    TrainShared* sh;
+    int id;
+    CountEntry* table;          // open addressing, then compacted and sorted
+    long capacity;
+    long used;
+    long* cursor;               // reduction: position in each worker's table
+    int row_begin;              // reduction: rows handled by this thread
+    int row_end;
+} TrainWorker;
+
+static void* train_alloc(size_t bytes) {
+    void* ptr = malloc(bytes > 0 ? bytes : 1);
+    if (ptr == NULL) {
+        perror("Failed to allocate memory for training");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static void table_init(TrainWorker* w, long capacity) {
+    w->capacity = capacity;
+    w->used = 0;
+    w->table = (CountEntry*)train_alloc(capacity * sizeof(CountEntry));
+    for (long s = 0; s < capacity; s++) {
+        w->table[s].key = EMPTY_KEY;
+    }
+}
+
+static void table_add(TrainWorker* w, uint64_t key, long count);
+
+// Doubles the table when it is half full
+static void table_grow(TrainWorker* w) {
+    CountEntry* old = w->table;
+    long old_capacity = w->capacity;
+    table_init(w, old_capacity * 2);
+    for (long s = 0; s < old_capacity; s++) {
+        if (old[s].key != EMPTY_KEY) {
+            table_add(w, old[s].key, old[s].count);
+        }
+    }
+    free(old);
+}
+
+static void table_add(TrainWorker* w, uint64_t key, long count) {
+    long mask = w->capacity - 1;
+    long s = (long)(mix64(key) & (uint64_t)mask);
+    while (w->table[s].key != key) {
+        if (w->table[s].key == EMPTY_KEY) {
+            if (2 * (w->used + 1) > w->capacity) {
+                table_grow(w);
+                table_add(w, key, count);
+                return;
+            }
+            w->table[s].key = key;
+            w->table[s].count = 0;
+            w->used++;
+            break;
+        }
+        s = (s + 1) & mask;
+    }
+    w->table[s].count += count;
+}
+
+// Sorts entries by key with an LSD radix sort on 16-bit digits, skipping
+// the digits every key shares (e.g. the high bits of small state indices)
+static void sort_entries(CountEntry* entries, long n) {
+    CountEntry* tmp = (CountEntry*)train_alloc(n * sizeof(CountEntry));
+    long* hist = (long*)train_alloc(65536 * sizeof(long));
+    CountEntry* src = entries;
+    CountEntry* dst = tmp;
+    for (int shift = 0; shift < 64; shift += 16) {
+        for (int d = 0; d < 65536; d++) {
+            hist[d] = 0;
+        }
+        for (long e = 0; e < n; e++) {
+            hist[(src[e].key >> shift) & 0xffff]++;
+        }
+        if (n == 0 || hist[(src[0].key >> shift) & 0xffff] == n) {
+            continue;
+        }
+        long sum = 0;
+        for (int d = 0; d < 65536; d++) {
+            long c = hist[d];
+            hist[d] = sum;
+            sum += c;
+        }
+        for (long e = 0; e < n; e++) {
+            dst[hist[(src[e].key >> shift) & 0xffff]++] = src[e];
+        }
+        CountEntry* swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != entries) {
+        for (long e = 0; e < n; e++) {
+            entries[e] = src[e];
+        }
+    }
+    free(hist);
+    free(tmp);
+}
+
+static inline unsigned long long pack_range(long first, long end) {
+    return ((unsigned long long)first << 32) | (unsigned long long)end;
+}
+
+// Takes the next chunk of thread w, stealing if its range is empty.
+// Returns -1 when no chunk is left anywhere
+static long next_chunk(TrainWorker* w) {
+    TrainShared* sh = w->sh;
+    atomic_ullong* own = &sh->ranges[w->id];
+    unsigned long long r = atomic_load(own);
+    while ((long)(r >> 32) < (long)(r & 0xffffffffULL)) {
+        if (atomic_compare_exchange_weak(own, &r, pack_range((long)(r >> 32) + 1, (long)(r & 0xffffffffULL)))) {
+            return (long)(r >> 32);
+        }
+    }
+
+    for (int k = 1; k < sh->num_threads; k++) {
+        atomic_ullong* victim = &sh->ranges[(w->id + k) % sh->num_threads];
+        unsigned long long v = atomic_load(victim);
+        for (;;) {
+            long first = (long)(v >> 32);
+            long end = (long)(v & 0xffffffffULL);
+            if (first >= end) {
+                break;
+            }
+            long take = (end - first + 1) / 2;
+            if (atomic_compare_exchange_weak(victim, &v, pack_range(first, end - take))) {
+                // run the first stolen chunk now, keep the rest as our range
+                atomic_store(own, pack_range(end - take + 1, end));
+                return end - take;
+            }
+        }
+    }
+    return -1;
+}
+
+static void* count_worker(void* arg) {
+    TrainWorker* w = (TrainWorker*)arg;
+    TrainShared* sh = w->sh;
+    long chunk;
+    while ((chunk = next_chunk(w)) >= 0 && !atomic_load_explicit(&sh->error, memory_order_relaxed)) {
+        long begin = chunk * sh->chunk_len;
+        long end = begin + sh->chunk_len;
+        if (end > sh->len - 1) {
+            end = sh->len - 1;
+        }
+        // transition t reads trace[t + 1], which may lie in the next chunk
+        for (long t = begin; t < end; t++) {
+            int i = sh->trace[t];
+            int j = sh->trace[t + 1];
+            if (i < 0 || j < 0 || i >= sh->size || j >= sh->size) {
+                atomic_store(&sh->error, 1);
+                break;
+            }
+            table_add(w, ((uint64_t)i << 32) | (uint32_t)j, 1);
+        }
+    }
+
+    // compact the used entries to the front and sort them by (i, j)
+    long n = 0;
+    for (long s = 0; s < w->capacity; s++) {
+        if (w->table[s].key != EMPTY_KEY) {
+            w->table[n++] = w->table[s];
+        }
+    }
+    sort_entries(w->table, n);
+    return NULL;
+}
+
+// Positions each cursor of thread w at the first entry of its first row
+static void seek_rows(TrainWorker* w) {
+    TrainShared* sh = w->sh;
+    uint64_t key = (uint64_t)w->row_begin << 32;
+    for (int v = 0; v < sh->num_threads; v++) {
+        const TrainWorker* src = &sh->workers[v];
+        long lo = 0;
+        long hi = src->used;
+        while (lo < hi) {
+            long mid = (lo + hi) / 2;
+            if (src->table[mid].key < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        w->cursor[v] = lo;
+    }
+}
+
+static inline int entry_row(const CountEntry* e) {
+    return (int)(e->key >> 32);
+}
+
+static inline int entry_col(const CountEntry* e) {
+    return (int)(e->key & 0xffffffffULL);
+}
+
+static void* reduce_dense(void* arg) {
+    TrainWorker* w = (TrainWorker*)arg;
+    TrainShared* sh = w->sh;
+    Markov* M = sh->M;
+    seek_rows(w);
+
+    for (int i = w->row_begin; i < w->row_end; i++) {
+        long total = 0;
+        for (int v = 0; v < sh->num_threads; v++) {
+            const TrainWorker* src = &sh->workers[v];
+            for (long e = w->cursor[v]; e < src->used && entry_row(&src->table[e]) == i; e++) {
+                total += src->table[e].count;
+            }
+        }
+        if (total == 0) {
+            continue;
+        }
+
+        // back to counts, add the new ones, renormalize
+        double* row = M->matrix[i];
+        double h = M->helper[i];
+        for (int j = 0; j < M->size; j++) {
+            row[j] *= h;
+        }
+        for (int v = 0; v < sh->num_threads; v++) {
+            const TrainWorker* src = &sh->workers[v];
+            while (w->cursor[v] < src->used && entry_row(&src->table[w->cursor[v]]) == i) {
+                row[entry_col(&src->table[w->cursor[v]])] += src->table[w->cursor[v]].count;
+                w->cursor[v]++;
+            }
+        }
+        double denom = h + total;
+        for (int j = 0; j < M->size; j++) {
+            row[j] /= denom;
+        }
+        // the count saturates at INT_MAX, as in update_matrix
+        M->helper[i] = total < (long)(INT_MAX - M->helper[i]) ? M->helper[i] + (int)total : INT_MAX;
+        M->version[i]++;
+    }
+    return NULL;
+}
+
+// Merges the runs of row i from every table in column order. With fill set
+// the merged entries are written to the sparse chain, otherwise only counted.
+// Returns the number of distinct successors and adds the row total to *total
+static long merge_row(TrainWorker* w, int i, int fill, long* total) {
+    TrainShared* sh = w->sh;
+    SparseMarkov* S = sh->S;
+    long out = fill ? S->row_ptr[i] : 0;
+    long distinct = 0;
+    for (;;) {
+        // smallest column among the heads of the runs
+        int col = -1;
+        for (int v = 0; v < sh->num_threads; v++) {
+            const TrainWorker* src = &sh->workers[v];
+            long e = w->cursor[v];
+            if (e < src->used && entry_row(&src->table[e]) == i &&
+                (col < 0 || entry_col(&src->table[e]) < col)) {
+                col = entry_col(&src->table[e]);
+            }
+        }
+        if (col < 0) {
+            break;
+        }
+        long count = 0;
+        for (int v = 0; v < sh->num_threads; v++) {
+            const TrainWorker* src = &sh->workers[v];
+            long e = w->cursor[v];
+            if (e < src->used && entry_row(&src->table[e]) == i && entry_col(&src->table[e]) == col) {
+                count += src->table[e].count;
+                w->cursor[v]++;
+            }
+        }
+        if (fill) {
+            S->col_idx[out] = col;
+            S->values[out] = (double)count;
+            out++;
+        }
+        *total += count;
+        distinct++;
+    }
+    return distinct;
+}
+
+static void* count_sparse_rows(void* arg) {
+    TrainWorker* w = (TrainWorker*)arg;
+    SparseMarkov* S = w->sh->S;
+    seek_rows(w);
+    for (int i = w->row_begin; i < w->row_end; i++) {
+        long total = 0;
+        // row_ptr[i + 1] temporarily holds the length of row i
+        S->row_ptr[i + 1] = merge_row(w, i, 0, &total);
+        S->helper[i] = total < INT_MAX ? (int)total : INT_MAX;
+    }
+    return NULL;
+}
+
+static void* fill_sparse_rows(void* arg) {
+    TrainWorker* w = (TrainWorker*)arg;
+    SparseMarkov* S = w->sh->S;
+    seek_rows(w);
+    for (int i = w->row_begin; i < w->row_end; i++) {
+        long total = 0;
+        merge_row(w, i, 1, &total);
+        for (long e = S->row_ptr[i]; e < S->row_ptr[i + 1]; e++) {
+            S->values[e] /= (double)total;
+        }
+    }
+    return NULL;
+}
+
+// Runs fn on every worker, the calling thread handling worker 0
+static void run_workers(TrainShared* sh, void* (*fn)(void*)) {
+    pthread_t* threads = (pthread_t*)train_alloc(sh->num_threads * sizeof(pthread_t));
+    for (int t = 1; t < sh->num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, fn, &sh->workers[t]) != 0) {
+            perror("Failed to create worker thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+    fn(&sh->workers[0]);
+    for (int t = 1; t < sh->num_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+}
+
+// Counts every transition of the trace into the workers' sorted tables.
+// Returns 0 on success, -1 if the trace holds an out of bounds state
+static int count_trace(TrainShared* sh, const int* trace, long len, long chunk_len,
+                       int size, int num_threads) {
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    sh->trace = trace;
+    sh->len = len;
+    sh->chunk_len = chunk_len;
+    sh->chunks = len > 1 ? (len - 2) / chunk_len + 1 : 0;
+    sh->size = size;
+    sh->num_threads = num_threads;
+    sh->M = NULL;
+    sh->S = NULL;
+    atomic_init(&sh->error, 0);
+    sh->ranges = (atomic_ullong*)train_alloc(num_threads * sizeof(atomic_ullong));
+    sh->workers = (TrainWorker*)train_alloc(num_threads * sizeof(TrainWorker));
+
+    for (int t = 0; t < num_threads; t++) {
+        TrainWorker* w = &sh->workers[t];
+        w->sh = sh;
+        w->id = t;
+        table_init(w, 1024);
+        w->cursor = (long*)train_alloc(num_threads * sizeof(long));
+        w->row_begin = (int)((long)size * t / num_threads);
+        w->row_end = (int)((long)size * (t + 1) / num_threads);
+        atomic_init(&sh->ranges[t], pack_range(sh->chunks * t / num_threads,
+                                               sh->chunks * (t + 1) / num_threads));
+    }
+    run_workers(sh, count_worker);
+    return atomic_load(&sh->error) ? -1 : 0;
+}
+
+static void free_shared(TrainShared* sh) {
+    for (int t = 0; t < sh->num_threads; t++) {
+        free(sh->workers[t].table);
+        free(sh->workers[t].cursor);
+    }
+    free(sh->workers);
+    free((void*)sh->ranges);
+}
+
+// Checks the parameters shared by both trainers
+static int check_trace(int size, const int* trace, long len, long chunk_len) {
+    // chunk numbers are packed in 32 bits
+    if (size < 1 || len < 0 || (trace == NULL && len > 0) || chunk_len < 1 ||
+        (len > 1 && (len - 2) / chunk_len + 1 > 0xffffffffL)) {
+        fprintf(stderr, "Invalid trace or chunk length.\n");
+        return -1;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// train_dense(Markov* M, const int* trace, long len, long chunk_len,
+//             int num_threads)
+//
+//  Adds every transition of a trace to a dense chain, as if update_matrix
+//  had been called on each of them in order
+//
+// Parameters:
+//    - M: Pointer to the Markov structure (its existing counts are kept)
+//    - trace: Array of len states
+//    - len: Number of states in the trace (len - 1 transitions)
+//    - chunk_len: Number of transitions per scheduled chunk
+//    - num_threads: Number of threads (values < 1 use one)
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters or if the trace holds an out
+//      of bounds state (M is then left unchanged)
+//
+// NOTE:
+//    The helper counts saturate at INT_MAX, as in update_matrix
+///////////////////////////////////////////////////////////////////////////////
+int train_dense(Markov* M, const int* trace, long len, long chunk_len, int num_threads) {
+    if (M == NULL || M->matrix == NULL || check_trace(M->size, trace, len, chunk_len) != 0) {
+        return -1;
+    }
+
+    TrainShared sh;
+    int status = count_trace(&sh, trace, len, chunk_len, M->size, num_threads);
+    if (status == 0) {
+        sh.M = M;
+        run_workers(&sh, reduce_dense);
+    } else {
+        fprintf(stderr, "Trace state out of bounds.\n");
+    }
+    free_shared(&sh);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// train_sparse(int size, const int* trace, long len, long chunk_len,
+//              int num_threads)
+//
+//  Builds a sparse chain directly from a trace, without a dense matrix
+//
+// Parameters:
+//    - size: The number of states
+//    - trace, len, chunk_len, num_threads: see train_dense
+//
+// Returns:
+//    - Pointer to the newly allocated SparseMarkov structure, or NULL for
+//      invalid parameters or if the trace holds an out of bounds state
+//
+// NOTE:
+//    The helper counts saturate at INT_MAX, as in train_dense
+///////////////////////////////////////////////////////////////////////////////
+SparseMarkov* train_sparse(int size, const int* trace, long len, long chunk_len, int num_threads) {
+    if (check_trace(size, trace, len, chunk_len) != 0) {
+        return NULL;
+    }
+
+    TrainShared sh;
+    if (count_trace(&sh, trace, len, chunk_len, size, num_threads) != 0) {
+        fprintf(stderr, "Trace state out of bounds.\n");
+        free_shared(&sh);
+        return NULL;
+    }
+
+    SparseMarkov* S = (SparseMarkov*)train_alloc(sizeof(SparseMarkov));
+    S->size = size;
+    S->row_ptr = (long*)train_alloc((size + 1) * sizeof(long));
+    S->helper = (int*)train_alloc(size * sizeof(int));
+    sh.S = S;
+
+    // row lengths, then offsets, then the rows themselves
+    run_workers(&sh, count_sparse_rows);
+    S->row_ptr[0] = 0;
+    for (int i = 0; i < size; i++) {
+        S->row_ptr[i + 1] += S->row_ptr[i];
+    }
+    S->nnz = S->row_ptr[size];
+    S->col_idx = (int*)train_alloc(S->nnz * sizeof(int));
+    S->values = (double*)train_alloc(S->nnz * sizeof(double));
+    run_workers(&sh, fill_sparse_rows);
+
+    free_shared(&sh);
+    return S;
+}
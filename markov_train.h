@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// markov_train.h
+///////////////////////////////////////////////////////////////////////////////
+// Author:  Seth Ely
+// Date:    10/18/2026
+///////////////////////////////////////////////////////////////////////////////
+// Description:
+//   Header file for the markov_train.c parallel trainer, which learns a chain
+//   from a long recorded trace (an array of states) on every core instead of
+//   calling update_matrix() once per transition.
+//
+//   The trace is cut into chunks of chunk_len transitions. Transition t is
+//   (trace[t], trace[t + 1]), so the transition that spans two chunks simply
+//   belongs to the first one (it reads the first state of the next chunk)
+//   and none is lost or counted twice. Chunks are handed out by a
+//   work-stealing scheduler: each thread starts with an equal share and
+//   steals half of another thread's remaining chunks when it runs out. Each
+//   thread counts its transitions in a private hash table, and the tables
+//   are then reduced into the chain by rows, in parallel.
+//
+//   The result is the maximum likelihood chain of the counts, the same one
+//   repeated update_matrix() calls compute (up to rounding).
+//
+// Usage:
+//   Include this header by using #include "markov_train.h" and use the
+//   functions below
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKOV_TRAIN
+#define MARKOV_TRAIN
+
+#include "markov.h"
+#include "markov_sparse.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// train_dense(Markov* M, const int* trace, long len, long chunk_len,
+//             int num_threads)
+//
+//  Adds every transition of a trace to a dense chain, as if update_matrix
+//  had been called on each of them in order
+//
+// Parameters:
+//    - M: Pointer to the Markov structure (its existing counts are kept)
+//    - trace: Array of len states
+//    - len: Number of states in the trace (len - 1 transitions)
+//    - chunk_len: Number of transitions per scheduled chunk
+//    - num_threads: Number of threads (values < 1 use one)
+//
+// Returns:
+//    - 0 on success, -1 for invalid parameters or if the trace holds an out
+//      of bounds state (M is then left unchanged)
+//
+// NOTE:
+//    The helper counts saturate at INT_MAX, as in update_matrix
+///////////////////////////////////////////////////////////////////////////////
+int train_dense(Markov* M, const int* trace, long len, long chunk_len, int num_threads);
+
+///////////////////////////////////////////////////////////////////////////////
+// train_sparse(int size, const int* trace, long len, long chunk_len,
+//              int num_threads)
+//
+//  Builds a sparse chain directly from a trace, without a dense matrix
+//
+// Parameters:
+//    - size: The number of states
+//    - trace, len, chunk_len, num_threads: see train_dense
+//
+// Returns:
+//    - Pointer to the newly allocated SparseMarkov structure, or NULL for
+//      invalid parameters or if the trace holds an out of bounds state
+//
+// NOTE:
+//    The helper counts saturate at INT_MAX, as in train_dense
+///////////////////////////////////////////////////////////////////////////////
+SparseMarkov* train_sparse(int size, const int* trace, long len, long chunk_len, int num_threads);
+
+#endif
@@ -32,8 +32,2359 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "markov.h"
+#include "markov_sparse.h"
+#include "markov_fixed.h"
+#include "markov_batch.h"
+#include "markov_power.h"
+#include "markov_snapshot.h"
+#include "markov_huge.h"
+#include "markov_absorb.h"
+#include "markov_quant.h"
+#include "markov_topk.h"
+#include "markov_cms.h"
+#include "markov_score.h"
+#include "markov_pipeline.h"
+#include "markov_train.h"
+#include "markov_mmap.h"
+#include "markov_ckpt.h"
+#include "markov_shm.h"
+#include "markov_registry.h"
+#include "markov_delta.h"
+#include "markov_reach.h"
+#include "markov_scc.h"
+#include "markov_order.h"
+#include "markov_export.h"
+#include "markov_prefetch.h"
+#include "markov_perf.h"
+#include "markov_stable.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// test_sparse(Markov* M, Markov* M2)
+//
+//  Converts M to its sparse (CSR) view, squares it with sparse_mult and
+//  checks the product against the dense M2 = matrix_mult(M, M)
+//
+// Parameters:
+//    - M: Pointer to the Markov structure
+//    - M2: Pointer to the dense square of M
+//
+// Returns:
+//    - 0 if the sparse product matches, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_sparse(Markov* M, Markov* M2) {
+    int status = 0;
+    SparseMarkov* S = sparse_from_M(M);
+    SparseMarkov* S2 = sparse_mult(S, S, 0.0, 2);
+
+    printf("Sparse Matrix Raised to Power 2 (%ld nonzeros):\n", S2->nnz);
+    print_sparse(S2);
+
+    Markov* D = sparse_to_M(S2);
+    for (int i = 0; i < M->size; i++) {
+        for (int j = 0; j < M->size; j++) {
+            if (fabs(D->matrix[i][j] - M2->matrix[i][j]) > 1e-12) {
+                status = -1;
+            }
+        }
+        if (sparse_max_prob_idx(S2, i) != max_prob_idx(M2, i)) {
+            status = -1;
+        }
+    }
+    printf("Sparse product matches dense product: %s\n", status == 0 ? "yes" : "no");
+
+    free_M(D);
+    free_sparse(S);
+    free_sparse(S2);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_fixed()
+//
+//  Trains a 16-state fixed-size chain and a Markov structure with the same
+//  transitions (including one into a row whose count is saturated) and
+//  checks that they hold identical values and agree on the max/min
+//  probability index of every row
+//
+// Parameters:
+//    - None
+//
+// Returns:
+//    - 0 if both chains agree, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_fixed(void) {
+    int status = 0;
+    FixedMarkov16 F;
+    Markov* M = initialize_M(16);
+    initialize_fixed_M16(&F);
+
+    // a deterministic walk with repeated transitions and ties
+    int state = 0;
+    for (int u = 0; u < 500; u++) {
+        int next = (state * 7 + u % 5) % 16;
+        update_matrix(M, state, next);
+        update_fixed_matrix16(&F, state, next);
+        state = next;
+    }
+    // both counts saturate at INT_MAX instead of overflowing
+    M->helper[3] = INT_MAX;
+    F.helper[3] = INT_MAX;
+    update_matrix(M, 3, 4);
+    update_fixed_matrix16(&F, 3, 4);
+
+    for (int i = 0; i < 16; i++) {
+        if (memcmp(M->matrix[i], F.matrix[i], sizeof(F.matrix[i])) != 0 ||
+            M->helper[i] != F.helper[i] ||
+            max_prob_idx(M, i) != max_prob_idx_fixed16(&F, i) ||
+            min_prob_idx(M, i) != min_prob_idx_fixed16(&F, i)) {
+            status = -1;
+        }
+    }
+    if (update_fixed_matrix16(&F, 16, 0) != -1 || max_prob_idx_fixed16(&F, -1) != -1) {
+        status = -1;
+    }
+    printf("Fixed-size chain matches Markov structure: %s\n", status == 0 ? "yes" : "no");
+
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_batch()
+//
+//  Runs batched max/min queries over chains of several sizes (including ones
+//  that are not a multiple of the vector width) and checks every answer
+//  against max_prob_idx and min_prob_idx
+//
+// Parameters:
+//    - None
+//
+// Returns:
+//    - 0 if every batched answer matches, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_batch(void) {
+    int status = 0;
+    int sizes[] = { 3, 8, 13, 37 };
+
+    for (int s = 0; s < 4; s++) {
+        int size = sizes[s];
+        Markov* M = initialize_M(size);
+
+        // few distinct successors per row so rows contain many ties
+        int state = 0;
+        for (int u = 0; u < size * 6; u++) {
+            int next = (state * 3 + (u % 4) * 5) % size;
+            update_matrix(M, state, next);
+            state = next;
+        }
+
+        int rows[64];
+        int max_out[64];
+        int min_out[64];
+        for (int r = 0; r < 64; r++) {
+            rows[r] = (r * 11) % size;
+        }
+        batch_prob_idx(M, rows, 64, max_out, min_out);
+        for (int r = 0; r < 64; r++) {
+            if (max_out[r] != max_prob_idx(M, rows[r]) || min_out[r] != min_prob_idx(M, rows[r])) {
+                status = -1;
+            }
+        }
+        free_M(M);
+    }
+    printf("Batched queries match max/min_prob_idx: %s\n", status == 0 ? "yes" : "no");
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_power_cache()
+//
+//  Keeps a cache of M^3 while the chain is updated and checks that the
+//  refreshed cache matches M^3 recomputed with matrix_mult, and that queries
+//  within the staleness bound are served without a refresh
+//
+// Parameters:
+//    - None
+//
+// Returns:
+//    - 0 if the cache behaves as expected, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_power_cache(void) {
+    int status = 0;
+    int size = 12;
+    Markov* M = initialize_M(size);
+    for (int i = 0; i < size; i++) {
+        update_matrix(M, i, (i + 1) % size);
+    }
+
+    MarkovPower* P = power_cache_init(M, 3, 4);
+    for (int round = 0; round < 5; round++) {
+        // a few updates stay within the staleness bound
+        update_matrix(M, round, (round * 5) % size);
+        update_matrix(M, round + 6, (round + 2) % size);
+        if (power_cache_pending(P) != 2) {
+            status = -1;
+        }
+        power_cache_get(P);
+        if (power_cache_pending(P) != 2) {
+            status = -1;
+        }
+
+        // a forced refresh brings M^3 up to date
+        power_cache_refresh(P);
+        Markov* M2 = matrix_mult(M, M);
+        Markov* M3 = matrix_mult(M, M2);
+        Markov* C = power_cache_get(P);
+        for (int i = 0; i < size; i++) {
+            if (memcmp(C->matrix[i], M3->matrix[i], size * sizeof(double)) != 0) {
+                status = -1;
+            }
+        }
+        free_M(M2);
+        free_M(M3);
+    }
+    printf("Cached M^3 matches matrix_mult: %s\n", status == 0 ? "yes" : "no");
+
+    free_power_cache(P);
+    free_M(M);
+    return status;
+}
+
+// Reader thread for test_snapshot: repeatedly checks that every row of the
+// current snapshot is either empty or sums to 1
+static void* snapshot_reader(void* arg) {
+    MarkovPublisher* P = (MarkovPublisher*)arg;
+    long bad = 0;
+    for (int round = 0; round < 2000; round++) {
+        Markov* S = snapshot_acquire(P, 0);
+        for (int i = 0; i < S->size; i++) {
+            double sum = 0.0;
+            for (int j = 0; j < S->size; j++) {
+                sum += S->matrix[i][j];
+            }
+            if (S->helper[i] > 0 ? fabs(sum - 1.0) > 1e-9 : sum != 0.0) {
+                bad++;
+            }
+        }
+        snapshot_release(P, 0);
+    }
+    return (void*)bad;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_snapshot()
+//
+//  Trains a chain through a publisher while a reader thread checks the
+//  published snapshots, then checks that the last snapshot matches the
+//  writer's chain
+//
+// Parameters:
+//    - None
+//
+// Returns:
+//    - 0 if no reader saw a torn row and the snapshot is current, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_snapshot(void) {
+    int status = 0;
+    int size = 16;
+    MarkovPublisher* P = publisher_init(size, 1);
+    pthread_t reader;
+    pthread_create(&reader, NULL, snapshot_reader, P);
+
+    int state = 0;
+    for (int u = 0; u < 20000; u++) {
+        int next = (state * 3 + u) % size;
+        publisher_update(P, state, next);
+        state = next;
+        if (u % 50 == 0) {
+            publisher_publish(P);
+        }
+    }
+    void* bad;
+    pthread_join(reader, &bad);
+    if (bad != NULL) {
+        status = -1;
+    }
+
+    publisher_publish(P);
+    Markov* S = snapshot_acquire(P, 0);
+    for (int i = 0; i < size; i++) {
+        if (memcmp(S->matrix[i], P->writer->matrix[i], size * sizeof(double)) != 0 ||
+            max_prob_idx(S, i) != max_prob_idx(P->writer, i)) {
+            status = -1;
+        }
+    }
+    snapshot_release(P, 0);
+    printf("Snapshots are consistent and current: %s\n", status == 0 ? "yes" : "no");
+
+    free_publisher(P);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_huge()
+//
+//  Builds chains in each huge page allocation mode, trains them alongside a
+//  regular chain and checks that they hold the same values
+//
+// Parameters:
+//    - None
+//
+// Returns:
+//    - 0 if every allocation mode behaves like initialize_M, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_huge(void) {
+    int status = 0;
+    int size = 21;
+    HugeMode modes[] = { HUGE_NONE, HUGE_TRANSPARENT, HUGE_EXPLICIT };
+
+    for (int m = 0; m < 3; m++) {
+        Markov* M = initialize_M(size);
+        Markov* H = initialize_M_huge(size, modes[m], 3);
+        int state = 0;
+        for (int u = 0; u < 300; u++) {
+            int next = (state * 5 + u % 7) % size;
+            update_matrix(M, state, next);
+            update_matrix(H, state, next);
+            state = next;
+        }
+        Markov* P = matrix_mult(H, M);
+        Markov* Q = matrix_mult(M, M);
+        for (int i = 0; i < size; i++) {
+            if (memcmp(M->matrix[i], H->matrix[i], size * sizeof(double)) != 0 ||
+                memcmp(P->matrix[i], Q->matrix[i], size * sizeof(double)) != 0) {
+                status = -1;
+            }
+        }
+        free_M(M);
+        free_M(H);
+        free_M(P);
+        free_M(Q);
+    }
+    printf("Huge page chains match initialize_M: %s\n", status == 0 ? "yes" : "no");
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_absorb()
+//
+//  Checks hitting times and absorption probabilities on a small chain with
+//  known answers, then compares the dense (blocked LU) and sparse
+//  (Gauss-Seidel) solvers on a larger chain
+//
+// Parameters:
+//    - None
+//
+// Returns:
+//    - 0 if every result matches, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_absorb(void) {
+    int status = 0;
+
+    // 0 -> 1, 1 -> {0, 2}, 2 -> 3, 4 -> 4 (never reaches 3), 5 -> {3, 4}
+    Markov* M = initialize_M(6);
+    update_matrix(M, 0, 1);
+    update_matrix(M, 1, 0);
+    update_matrix(M, 1, 2);
+    update_matrix(M, 2, 3);
+    update_matrix(M, 4, 4);
+    update_matrix(M, 5, 3);
+    update_matrix(M, 5, 4);
+
+    int target = 3;
+    double expected[] = { 5.0, 4.0, 1.0, 0.0, INFINITY, INFINITY };
+    double times[6];
+    hitting_times(M, &target, 1, times, 1);
+    for (int i = 0; i < 6; i++) {
+        if (isinf(expected[i]) ? !isinf(times[i]) : fabs(times[i] - expected[i]) > 1e-12) {
+            status = -1;
+        }
+    }
+
+    int targets[] = { 3, 4 };
+    double probs[12];
+    absorption_probs(M, targets, 2, probs, 1);
+    if (fabs(probs[0] - 1.0) > 1e-12 || fabs(probs[10] - 0.5) > 1e-12 || fabs(probs[11] - 0.5) > 1e-12) {
+        status = -1;
+    }
+    free_M(M);
+
+    // larger chain: every state drifts towards state 0 with random detours
+    int size = 150;
+    M = initialize_M(size);
+    int state = size - 1;
+    for (int u = 0; u < 20000; u++) {
+        int next = (state * 7 + u) % 5 == 0 ? (state + 3) % size : (state > 0 ? state - 1 : size - 1);
+        update_matrix(M, state, next);
+        state = next;
+    }
+    target = 0;
+    double* dense = (double*)malloc(size * sizeof(double));
+    double* iterative = (double*)malloc(size * sizeof(double));
+    hitting_times(M, &target, 1, dense, 3);
+    SparseMarkov* S = sparse_from_M(M);
+    if (hitting_times_iterative(S, &target, 1, iterative, 1e-12, 100000) < 0) {
+        status = -1;
+    }
+    for (int i = 0; i < size; i++) {
+        if (fabs(dense[i] - iterative[i]) > 1e-6 * (1.0 + dense[i])) {
+            status = -1;
+        }
+    }
+    printf("Hitting times and absorption probabilities match: %s\n", status == 0 ? "yes" : "no");
+
+    free(dense);
+    free(iterative);
+    free_sparse(S);
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_quant()
+//
+//  Trains a Markov structure and two compressed chains (every row hot, every
+//  row cold) with the same transitions. Hot rows must find an exact argmax;
+//  cold rows must stay within the quantization error of update_matrix.
+//  Also checks quantize_M, the ordering of quant_top_k and the saturation of
+//  the counts
+//
+// Returns:
+//    - 0 if the compressed chains agree with the Markov structure, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_quant(void) {
+    int status = 0;
+    int size = 100;
+    Markov* M = initialize_M(size);
+    QuantMarkov* hot = initialize_quant(size, 0);
+    QuantMarkov* cold = initialize_quant(size, 1 << 30);
+
+    unsigned int seed = 7;
+    int state = 0;
+    for (int u = 0; u < 20000; u++) {
+        seed = seed * 1103515245u + 12345u;
+        int next = (state * 3 + (int)((seed >> 16) % 9)) % size;
+        update_matrix(M, state, next);
+        quant_update(hot, state, next);
+        quant_update(cold, state, next);
+        state = next;
+    }
+
+    QuantMarkov* Q = quantize_M(M, 1);
+    int top[5];
+    for (int i = 0; i < size; i++) {
+        double best = M->matrix[i][max_prob_idx(M, i)];
+        if (fabs(M->matrix[i][quant_max_prob_idx(hot, i)] - best) > 1e-12 ||
+            fabs(M->matrix[i][quant_max_prob_idx(Q, i)] - best) > 1e-12 ||
+            M->matrix[i][quant_max_prob_idx(cold, i)] < best - 0.02) {
+            status = -1;
+        }
+        for (int j = 0; j < size; j++) {
+            if (fabs(quant_prob(cold, i, j) - M->matrix[i][j]) > 0.02 ||
+                fabs(quant_prob(hot, i, j) - M->matrix[i][j]) > 1e-12) {
+                status = -1;
+            }
+        }
+        if (quant_top_k(cold, i, 5, top) != 5 || top[0] != quant_max_prob_idx(cold, i)) {
+            status = -1;
+        }
+        for (int k = 1; k < 5; k++) {
+            if (quant_prob(cold, i, top[k]) > quant_prob(cold, i, top[k - 1])) {
+                status = -1;
+            }
+        }
+    }
+    // a cold row at INT_MAX updates saturates, and a hot row whose counts
+    // reach UINT32_MAX halves them instead of wrapping
+    cold->helper[1] = INT_MAX - 1;
+    memset(hot->counts[2], 0, (size + 1) * sizeof(uint32_t));
+    hot->counts[2][3] = UINT32_MAX - 1;
+    hot->counts[2][4] = 1;
+    hot->counts[2][size] = UINT32_MAX;
+    for (int u = 0; u < 3; u++) {
+        quant_update(cold, 1, 5);
+        quant_update(hot, 2, 4);
+    }
+    for (int j = 0; j < size; j++) {
+        if (quant_prob(cold, 1, j) < 0.0) {
+            status = -1;
+        }
+    }
+    if (cold->helper[1] != INT_MAX || M->matrix[1][quant_max_prob_idx(cold, 1)] < M->matrix[1][max_prob_idx(M, 1)] - 0.02 ||
+        hot->counts[2][size] != UINT32_MAX / 2 + 4 || quant_max_prob_idx(hot, 2) != 3 ||
+        fabs(quant_prob(hot, 2, 4) - 4.0 / (UINT32_MAX / 2 + 4)) > 1e-15) {
+        status = -1;
+    }
+    printf("Quantized chain matches the Markov structure: %s (%zu vs %zu bytes)\n",
+           status == 0 ? "yes" : "no", quant_memory(cold),
+           (size_t)size * size * sizeof(double));
+
+    free_quant(Q);
+    free_quant(hot);
+    free_quant(cold);
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_heavy()
+//
+//  Trains a Markov structure and heavy-hitter summaries with the same walk.
+//  With fewer successors than slots the summaries are exact, so they must
+//  agree with the Markov structure. A dispatcher state with thousands of
+//  successors must still report its dominant successor, with bounds that
+//  hold the true probabilities, and a row at INT_MAX updates is halved
+//
+// Returns:
+//    - 0 if the summaries agree with the expected results, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_heavy(void) {
+    int status = 0;
+    int size = 200;
+    Markov* M = initialize_M(size);
+    HeavyMarkov* H = initialize_heavy(size, 8);
+
+    unsigned int seed = 11;
+    int state = 0;
+    for (int u = 0; u < 20000; u++) {
+        seed = seed * 1103515245u + 12345u;
+        int next = (state + 1 + (int)((seed >> 16) % 6)) % size;
+        update_matrix(M, state, next);
+        heavy_update(H, state, next);
+        state = next;
+    }
+    int top[3];
+    for (int i = 0; i < size; i++) {
+        double best = M->matrix[i][max_prob_idx(M, i)];
+        if (fabs(M->matrix[i][heavy_max_prob_idx(H, i)] - best) > 1e-12) {
+            status = -1;
+        }
+        if (heavy_top_k(H, i, 3, top) != 3 || top[0] != heavy_max_prob_idx(H, i)) {
+            status = -1;
+        }
+        for (int j = 0; j < size; j++) {
+            if (fabs(heavy_prob(H, i, j, NULL, NULL) - M->matrix[i][j]) > 1e-12) {
+                status = -1;
+            }
+        }
+    }
+    free_heavy(H);
+    free_M(M);
+
+    // dispatcher: state 0 goes to 1 a third of the time, otherwise anywhere
+    int pages = 5000;
+    H = initialize_heavy(pages, 16);
+    int* truth = (int*)calloc(pages, sizeof(int));
+    for (int u = 0; u < 60000; u++) {
+        seed = seed * 1103515245u + 12345u;
+        int next = u % 3 == 0 ? 1 : 2 + (int)((seed >> 8) % (pages - 2));
+        heavy_update(H, 0, next);
+        truth[next]++;
+    }
+    if (heavy_max_prob_idx(H, 0) != 1) {
+        status = -1;
+    }
+    for (int j = 0; j < pages; j++) {
+        double lower;
+        double upper;
+        double p = (double)truth[j] / 60000;
+        heavy_prob(H, 0, j, &lower, &upper);
+        if (p < lower - 1e-12 || p > upper + 1e-12 || upper > p + 1.0 / 16 + 1e-12) {
+            status = -1;
+        }
+    }
+    // a row at INT_MAX updates is halved instead of wrapping
+    free_heavy(H);
+    H = initialize_heavy(4, 2);
+    H->keys[2] = 0;
+    H->counts[2] = INT_MAX - 10;
+    H->keys[3] = 1;
+    H->counts[3] = 10;
+    H->helper[1] = INT_MAX;
+    heavy_update(H, 1, 1);
+    double p0 = heavy_prob(H, 1, 0, NULL, NULL);
+    double p1 = heavy_prob(H, 1, 1, NULL, NULL);
+    if (H->helper[1] != (INT_MAX - 9) / 2 + 6 || fabs(p0 + p1 - 1.0) > 1e-12 ||
+        !(p1 > 0.0) || heavy_max_prob_idx(H, 1) != 0) {
+        status = -1;
+    }
+    printf("Heavy-hitter summaries match the Markov structure: %s\n", status == 0 ? "yes" : "no");
+
+    free(truth);
+    free_heavy(H);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_sketch()
+//
+//  Trains a Markov structure and a sketched chain with the same walk, the
+//  sketch seeing large 64-bit ids instead of row indices. Estimated counts
+//  must never be below the true counts, and with a roomy sketch the most
+//  likely successors must agree
+//
+// Returns:
+//    - 0 if the sketch agrees with the Markov structure, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_sketch(void) {
+    int status = 0;
+    int size = 200;
+    const int64_t base = 5000000000000LL;
+    Markov* M = initialize_M(size);
+    SketchMarkov* SK = initialize_sketch(1 << 14, 4, 1024, 8);
+
+    unsigned int seed = 3;
+    int state = 0;
+    for (int u = 0; u < 20000; u++) {
+        seed = seed * 1103515245u + 12345u;
+        int next = (state + 1 + (int)((seed >> 16) % 6)) % size;
+        update_matrix(M, state, next);
+        sketch_update(SK, base + state * 1000003LL, base + next * 1000003LL);
+        state = next;
+    }
+
+    for (int i = 0; i < size; i++) {
+        int64_t id = base + i * 1000003LL;
+        for (int j = 0; j < size; j++) {
+            long truth = lround(M->matrix[i][j] * M->helper[i]);
+            if ((long)sketch_count(SK, id, base + j * 1000003LL) < truth) {
+                status = -1;
+            }
+        }
+        int64_t best = sketch_max_prob_idx(SK, id);
+        int col = (int)((best - base) / 1000003LL);
+        if (best < 0 || M->matrix[i][col] < M->matrix[i][max_prob_idx(M, i)] - 1e-12) {
+            status = -1;
+        }
+    }
+    if (sketch_max_prob_idx(SK, base - 1) != -1) {
+        status = -1;
+    }
+    printf("Sketched chain matches the Markov structure: %s\n", status == 0 ? "yes" : "no");
+
+    free_sketch(SK);
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_sketch_reclaim()
+//
+//  Evicts a state from its bucket and brings it back. Its probabilities
+//  must still be its counts over all of its updates, not over the updates
+//  since it claimed the bucket again
+//
+// Returns:
+//    - 0 if the probabilities are right, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_sketch_reclaim(void) {
+    int status = 0;
+
+    // a single set of buckets, so the fifth state evicts the quietest one
+    SketchMarkov* SK = initialize_sketch(1 << 12, 4, SKETCH_WAYS, 2);
+    for (int u = 0; u < 10; u++) {
+        sketch_update(SK, 1, 100);
+    }
+    for (int64_t s = 2; s <= SKETCH_WAYS + 1; s++) {
+        for (int u = 0; u < 20; u++) {
+            sketch_update(SK, s, 100 + s);
+        }
+    }
+    if (sketch_prob(SK, 1, 100) != 0.0) {
+        status = -1;
+    }
+
+    // state 1 takes back its bucket (held by state 5, first of the ties)
+    sketch_update(SK, 1, 101);
+    if (fabs(sketch_prob(SK, 1, 100) - 10.0 / 11.0) > 1e-12 ||
+        fabs(sketch_prob(SK, 1, 101) - 1.0 / 11.0) > 1e-12 ||
+        sketch_prob(SK, 5, 105) != 0.0) {
+        status = -1;
+    }
+
+    // state 5 comes back with its own total, then state 1 again after a
+    // second eviction
+    sketch_update(SK, 5, 103);
+    if (fabs(sketch_prob(SK, 5, 105) - 20.0 / 21.0) > 1e-12 ||
+        fabs(sketch_prob(SK, 5, 103) - 1.0 / 21.0) > 1e-12 ||
+        sketch_prob(SK, 1, 100) != 0.0) {
+        status = -1;
+    }
+    sketch_update(SK, 1, 100);
+    if (fabs(sketch_prob(SK, 1, 100) - 11.0 / 12.0) > 1e-12 ||
+        fabs(sketch_prob(SK, 1, 101) - 1.0 / 12.0) > 1e-12) {
+        status = -1;
+    }
+    printf("Sketched chain keeps the totals of evicted states: %s\n", status == 0 ? "yes" : "no");
+
+    free_sketch(SK);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_score()
+//
+//  Scores sequences against a trained chain and checks the log-likelihoods
+//  against sums of log probabilities computed directly from the matrix,
+//  with and without smoothing, before and after further training
+//
+// Returns:
+//    - 0 if the scores match, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_score(void) {
+    int status = 0;
+    int size = 50;
+    int count = 8;
+    int len = 300;
+    Markov* M = initialize_M(size);
+    unsigned int seed = 5;
+    int state = 0;
+    for (int u = 0; u < 5000; u++) {
+        seed = seed * 1103515245u + 12345u;
+        int next = (state + 1 + (int)((seed >> 16) % 4)) % size;
+        update_matrix(M, state, next);
+        state = next;
+    }
+
+    // sequences follow the training walk, the last one repeats a state once
+    // (never seen until it is trained on after the first round)
+    int* data = (int*)malloc(count * len * sizeof(int));
+    const int* seqs[8];
+    int lens[8];
+    for (int k = 0; k < count; k++) {
+        int* seq = data + k * len;
+        seq[0] = k;
+        for (int t = 1; t < len; t++) {
+            seed = seed * 1103515245u + 12345u;
+            seq[t] = (seq[t - 1] + 1 + (int)((seed >> 16) % 4)) % size;
+        }
+        seqs[k] = seq;
+        lens[k] = len - k;
+    }
+    data[(count - 1) * len + 10] = data[(count - 1) * len + 9];
+
+    MarkovScorer* raw = scorer_init(M, 0.0);
+    MarkovScorer* smooth = scorer_init(M, 1.0);
+    double scores[8];
+    for (int round = 0; round < 2; round++) {
+        score_sequences(smooth, seqs, lens, count, scores, 3);
+        for (int k = 0; k < count; k++) {
+            double expected = 0.0;
+            double expected_raw = 0.0;
+            for (int t = 0; t + 1 < lens[k]; t++) {
+                int i = seqs[k][t];
+                int j = seqs[k][t + 1];
+                expected += log((M->matrix[i][j] * M->helper[i] + 1.0) / (M->helper[i] + size));
+                expected_raw += log(M->matrix[i][j]);
+            }
+            double raw_score = score_sequence(raw, seqs[k], lens[k]);
+            if (fabs(scores[k] - expected) > 1e-9 * fabs(expected) ||
+                (k == count - 1 && round == 0 ? !isinf(raw_score)
+                                : fabs(raw_score - expected_raw) > 1e-9 * fabs(expected_raw))) {
+                status = -1;
+            }
+        }
+        // train on the last sequence so the cached rows must be refreshed
+        for (int t = 0; t + 1 < lens[count - 1]; t++) {
+            update_matrix(M, seqs[count - 1][t], seqs[count - 1][t + 1]);
+        }
+    }
+    if (!isnan(score_sequence(raw, (const int[]){ 0, size }, 2))) {
+        status = -1;
+    }
+    printf("Sequence log-likelihoods match: %s\n", status == 0 ? "yes" : "no");
+
+    free(data);
+    free_scorer(raw);
+    free_scorer(smooth);
+    free_M(M);
+    return status;
+}
+
+// Producer thread for test_pipeline: pushes a fixed walk of transitions
+static void* pipeline_producer(void* arg) {
+    MarkovPipeline* P = (MarkovPipeline*)arg;
+    int state = 0;
+    for (int u = 0; u < 20000; u++) {
+        int next = (state * 5 + u) % P->M->size;
+        pipeline_push(P, state, next);
+        state = next;
+    }
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_pipeline()
+//
+//  Trains one chain through the pipeline and one with update_matrix on the
+//  same walk; with one producer they must match exactly and the published
+//  predictions must equal max_prob_idx. Then two producers push through a
+//  tiny blocking ring and no event may be lost
+//
+// Returns:
+//    - 0 if the pipeline trained the chain correctly, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_pipeline(void) {
+    int status = 0;
+    int size = 64;
+    Markov* ref = initialize_M(size);
+    Markov* M = initialize_M(size);
+    MarkovPipeline* P = pipeline_start(M, 256, 32, PIPELINE_BLOCK);
+
+    int state = 0;
+    for (int u = 0; u < 10000; u++) {
+        int next = (state * 3 + u / 7) % size;
+        update_matrix(ref, state, next);
+        pipeline_push(P, state, next);
+        state = next;
+    }
+    pipeline_flush(P);
+    for (int i = 0; i < size; i++) {
+        if (pipeline_predict(P, i) != max_prob_idx(ref, i)) {
+            status = -1;
+        }
+    }
+    if (pipeline_stop(P) != 0) {
+        status = -1;
+    }
+    for (int i = 0; i < size; i++) {
+        if (M->helper[i] != ref->helper[i] ||
+            memcmp(M->matrix[i], ref->matrix[i], size * sizeof(double)) != 0) {
+            status = -1;
+        }
+    }
+    free_M(M);
+
+    M = initialize_M(size);
+    P = pipeline_start(M, 8, 4, PIPELINE_BLOCK);
+    pthread_t producers[2];
+    for (int t = 0; t < 2; t++) {
+        pthread_create(&producers[t], NULL, pipeline_producer, P);
+    }
+    for (int t = 0; t < 2; t++) {
+        pthread_join(producers[t], NULL);
+    }
+    pipeline_stop(P);
+    long total = 0;
+    for (int i = 0; i < size; i++) {
+        total += M->helper[i];
+    }
+    if (total != 40000) {
+        status = -1;
+    }
+    printf("Pipelined training matches update_matrix: %s\n", status == 0 ? "yes" : "no");
+
+    free_M(M);
+    free_M(ref);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_train()
+//
+//  Trains chains from one trace with update_matrix and with the parallel
+//  trainers (small chunks, so many transitions span chunk boundaries),
+//  including continuing the training of a chain that already has counts
+//  and one whose count saturates
+//
+// Returns:
+//    - 0 if the trained chains match, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_train(void) {
+    int status = 0;
+    int size = 100;
+    long len = 30000;
+    int* trace = (int*)malloc(len * sizeof(int));
+    unsigned int seed = 9;
+    trace[0] = 0;
+    for (long t = 1; t < len; t++) {
+        seed = seed * 1103515245u + 12345u;
+        trace[t] = (trace[t - 1] + 1 + (int)((seed >> 16) % 12)) % size;
+    }
+
+    Markov* ref = initialize_M(size);
+    for (long t = 0; t + 1 < len; t++) {
+        update_matrix(ref, trace[t], trace[t + 1]);
+    }
+
+    // the first half with update_matrix, the rest (from the shared state on)
+    // with the trainer
+    Markov* M = initialize_M(size);
+    long half = len / 2;
+    for (long t = 0; t + 1 < half; t++) {
+        update_matrix(M, trace[t], trace[t + 1]);
+    }
+    train_dense(M, trace + half - 1, len - half + 1, 7, 3);
+
+    Markov* fresh = initialize_M(size);
+    train_dense(fresh, trace, len, 1000, 4);
+    SparseMarkov* S = train_sparse(size, trace, len, 13, 3);
+    Markov* D = sparse_to_M(S);
+
+    for (int i = 0; i < size; i++) {
+        if (M->helper[i] != ref->helper[i] || fresh->helper[i] != ref->helper[i] ||
+            D->helper[i] != ref->helper[i]) {
+            status = -1;
+        }
+        for (int j = 0; j < size; j++) {
+            if (fabs(M->matrix[i][j] - ref->matrix[i][j]) > 1e-12 ||
+                fabs(fresh->matrix[i][j] - ref->matrix[i][j]) > 1e-12 ||
+                fabs(D->matrix[i][j] - ref->matrix[i][j]) > 1e-12) {
+                status = -1;
+            }
+        }
+    }
+
+    // a row close to INT_MAX updates saturates instead of wrapping
+    Markov* full = initialize_M(4);
+    full->matrix[1][0] = 1.0;
+    full->helper[1] = INT_MAX - 5;
+    int loop[21];
+    for (int t = 0; t < 21; t++) {
+        loop[t] = t % 2 == 0 ? 1 : 2;
+    }
+    unsigned int before = full->version[1];
+    if (train_dense(full, loop, 21, 4, 2) != 0 || full->helper[1] != INT_MAX ||
+        full->version[1] == before || !(full->matrix[1][2] > 0.0) ||
+        fabs(full->matrix[1][0] + full->matrix[1][2] - 1.0) > 1e-12) {
+        status = -1;
+    }
+    free_M(full);
+
+    trace[len / 3] = size;
+    if (train_dense(fresh, trace, len, 1000, 2) != -1 || train_sparse(size, trace, len, 100, 2) != NULL) {
+        status = -1;
+    }
+    printf("Parallel training matches update_matrix: %s\n", status == 0 ? "yes" : "no");
+
+    free(trace);
+    free_sparse(S);
+    free_M(D);
+    free_M(fresh);
+    free_M(M);
+    free_M(ref);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_mmap()
+//
+//  Trains a file-backed chain, reopens the file and compares it against the
+//  same chain in memory, then checks the out-of-core product (with a budget
+//  of a few rows) against matrix_mult, and that a power cache on the result
+//  picks it up
+//
+// Returns:
+//    - 0 if the file-backed chain and product match, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_mmap(void) {
+    int status = 0;
+    int size = 70;
+    char path[] = "/tmp/test_markov_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("File-backed chain matches the Markov structure: no (no temporary file)\n");
+        return -1;
+    }
+    close(fd);
+
+    Markov* ref = initialize_M(size);
+    Markov* F = initialize_M_file(path, size);
+    int state = 0;
+    for (int u = 0; u < 5000; u++) {
+        int next = (state * 11 + u / 3) % size;
+        update_matrix(ref, state, next);
+        update_matrix(F, state, next);
+        state = next;
+    }
+    if (sync_M_file(F) != 0) {
+        status = -1;
+    }
+    free_M(F);
+
+    F = open_M_file(path);
+    if (F == NULL || F->size != size || F->storage != MARKOV_FILE) {
+        status = -1;
+    } else {
+        advise_M(F, ACCESS_RANDOM);
+        for (int i = 0; i < size; i++) {
+            if (F->helper[i] != ref->helper[i] ||
+                memcmp(F->matrix[i], ref->matrix[i], size * sizeof(double)) != 0) {
+                status = -1;
+            }
+        }
+
+        // a power cache on the result sees the rows the multiply rewrote,
+        // and the rows it recomputes advance in its own powers
+        Markov* product = matrix_mult(ref, ref);
+        Markov* ooc = initialize_M(size);
+        MarkovPower* cache = power_cache_init(ooc, 2, 0);
+        unsigned int cached_version = power_cache_get(cache)->version[0];
+        matrix_mult_ooc(F, F, ooc, 3 * size * sizeof(double) * 2);
+        Markov* square = matrix_mult(product, product);
+        Markov* cached = power_cache_get(cache);
+        if (cached->version[0] == cached_version) {
+            status = -1;
+        }
+        for (int i = 0; i < size; i++) {
+            if (memcmp(ooc->matrix[i], product->matrix[i], size * sizeof(double)) != 0 ||
+                memcmp(cached->matrix[i], square->matrix[i], size * sizeof(double)) != 0) {
+                status = -1;
+            }
+        }
+        free_power_cache(cache);
+        free_M(square);
+        free_M(product);
+        free_M(ooc);
+        free_M(F);
+    }
+
+    // a file that is not a chain is rejected
+    FILE* junk = fopen(path, "w");
+    fputs("not a chain", junk);
+    fclose(junk);
+    if (open_M_file(path) != NULL) {
+        status = -1;
+    }
+    unlink(path);
+    printf("File-backed chain matches the Markov structure: %s\n", status == 0 ? "yes" : "no");
+
+    free_M(ref);
+    return status;
+}
+
+// Returns 1 if two chains hold identical rows and helper counts
+static int same_chain(Markov* A, Markov* B) {
+    if (A == NULL || B == NULL || A->size != B->size) {
+        return 0;
+    }
+    for (int i = 0; i < A->size; i++) {
+        if (A->helper[i] != B->helper[i] ||
+            memcmp(A->matrix[i], B->matrix[i], A->size * sizeof(double)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_checkpoint()
+//
+//  Checkpoints a chain, checks that only the updated rows are appended,
+//  simulates a crash in the middle of a record and resumes from the log,
+//  then compacts the log and resumes again
+//
+// Returns:
+//    - 0 if every resumed chain matches the checkpointed one, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_checkpoint(void) {
+    int status = 0;
+    int size = 40;
+    char path[] = "/tmp/test_markov_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("Checkpoint log replays the chain: no (no temporary file)\n");
+        return -1;
+    }
+    close(fd);
+
+    Markov* M = initialize_M(size);
+    int state = 0;
+    for (int u = 0; u < 2000; u++) {
+        int next = (state * 7 + u / 5) % size;
+        update_matrix(M, state, next);
+        state = next;
+    }
+    MarkovCheckpoint* C = checkpoint_create(M, path);
+    if (C == NULL) {
+        printf("Checkpoint log replays the chain: no (could not create log)\n");
+        free_M(M);
+        unlink(path);
+        return -1;
+    }
+
+    // nothing changed, then three rows changed
+    if (checkpoint_save(C) != 0) {
+        status = -1;
+    }
+    update_matrix(M, 1, 2);
+    update_matrix(M, 1, 3);
+    update_matrix(M, 5, 0);
+    update_matrix(M, 39, 39);
+    if (checkpoint_save(C) != 3) {
+        status = -1;
+    }
+
+    Markov* at_save = initialize_M(size);
+    for (int i = 0; i < size; i++) {
+        memcpy(at_save->matrix[i], M->matrix[i], size * sizeof(double));
+        at_save->helper[i] = M->helper[i];
+    }
+
+    // a crash while appending leaves half a record at the end of the log
+    update_matrix(M, 2, 2);
+    FILE* f = fopen(path, "ab");
+    int torn[3] = { 2, 1, 0 };
+    fwrite(torn, sizeof(torn), 1, f);
+    fclose(f);
+    checkpoint_close(C);
+
+    MarkovCheckpoint* R = checkpoint_resume(path);
+    if (R == NULL) {
+        status = -1;
+    } else {
+        if (!same_chain(R->M, at_save)) {
+            status = -1;
+        }
+
+        // the resumed log keeps appending, and survives compaction
+        update_matrix(R->M, 2, 2);
+        if (checkpoint_save(R) != 1 || checkpoint_compact(R) != 0 || !same_chain(R->M, M)) {
+            status = -1;
+        }
+        Markov* resumed = R->M;
+        checkpoint_close(R);
+        R = checkpoint_resume(path);
+        if (R == NULL || !same_chain(R->M, M)) {
+            status = -1;
+        }
+        if (R != NULL) {
+            free_M(R->M);
+            checkpoint_close(R);
+        }
+        free_M(resumed);
+    }
+
+    // a file that is not a log is rejected
+    f = fopen(path, "w");
+    fputs("not a log", f);
+    fclose(f);
+    if (checkpoint_resume(path) != NULL) {
+        status = -1;
+    }
+    unlink(path);
+    printf("Checkpoint log replays the chain: %s\n", status == 0 ? "yes" : "no");
+
+    free_M(at_save);
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_checkpoint_failure()
+//
+//  Makes a checkpoint fail halfway through its records (with a file size
+//  limit), then checks that the log was cut back to its previous length and
+//  that the next checkpoint still writes every dirty row, so the replayed
+//  chain matches. A compaction that fails after the append is counted and
+//  does not fail the save
+//
+// Returns:
+//    - 0 if no record is lost, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_checkpoint_failure(void) {
+    int status = 0;
+    int size = 64;
+    char path[] = "/tmp/test_markov_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("Failed checkpoint leaves the log intact: no (no temporary file)\n");
+        return -1;
+    }
+    close(fd);
+
+    Markov* M = initialize_M(size);
+    for (int i = 0; i < size; i++) {
+        update_matrix(M, i, (i * 5) % size);
+    }
+    MarkovCheckpoint* C = checkpoint_create(M, path);
+    struct stat st;
+    if (C == NULL || stat(path, &st) != 0) {
+        printf("Failed checkpoint leaves the log intact: no (could not create log)\n");
+        free_M(M);
+        unlink(path);
+        return -1;
+    }
+    C->compact_factor = 1000;
+    off_t before = st.st_size;
+
+    // room for less than two of the twenty records
+    for (int i = 0; i < 20; i++) {
+        update_matrix(M, i, (i * 3) % size);
+    }
+    struct rlimit old_limit, limit;
+    getrlimit(RLIMIT_FSIZE, &old_limit);
+    limit = old_limit;
+    limit.rlim_cur = before + 1000;
+    void (*old_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+    setrlimit(RLIMIT_FSIZE, &limit);
+    long failed = checkpoint_save(C);
+    setrlimit(RLIMIT_FSIZE, &old_limit);
+    signal(SIGXFSZ, old_handler);
+    if (failed != -1 || stat(path, &st) != 0 || st.st_size != before) {
+        status = -1;
+    }
+
+    // the next checkpoint writes every row the failed one did not commit
+    update_matrix(M, 40, 41);
+    if (checkpoint_save(C) != 21) {
+        status = -1;
+    }
+
+    // a compaction that cannot write its new log does not fail the save
+    char tmp[sizeof(path) + 4];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    mkdir(tmp, 0700);
+    C->compact_factor = 0;
+    update_matrix(M, 50, 51);
+    if (checkpoint_save(C) != 1 || C->compact_failures != 1) {
+        status = -1;
+    }
+    rmdir(tmp);
+    update_matrix(M, 52, 53);
+    if (checkpoint_save(C) != 1 || C->compact_failures != 1 || C->records != size) {
+        status = -1;
+    }
+    checkpoint_close(C);
+    MarkovCheckpoint* R = checkpoint_resume(path);
+    if (R == NULL || !same_chain(R->M, M)) {
+        status = -1;
+    }
+    if (R != NULL) {
+        free_M(R->M);
+        checkpoint_close(R);
+    }
+    unlink(path);
+    printf("Failed checkpoint leaves the log intact: %s\n", status == 0 ? "yes" : "no");
+
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_shm()
+//
+//  Trains a chain in a shared segment while a forked reader process checks
+//  every row it reads (probabilities summing to 1, in multiples of 1/helper),
+//  then checks the final shared chain against update_matrix. A row held by
+//  a slow trainer is waited for, and one left mid-update by a trainer that
+//  exited fails its reads
+//
+// Returns:
+//    - 0 if the reader never saw a torn row and the chains match, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_shm(void) {
+    int status = 0;
+    int size = 24;
+    int updates = 20000;
+    char name[64];
+    snprintf(name, sizeof(name), "/test_markov_%d", (int)getpid());
+
+    SharedMarkov* S = initialize_M_shm(name, size);
+    if (S == NULL) {
+        printf("Shared chain readers see whole rows: no (no shared segment)\n");
+        return -1;
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+        SharedMarkov* R = attach_M_shm(name);
+        int bad = R == NULL;
+        double row[24];
+        for (int q = 0; !bad && shm_updates(R) < (unsigned long)updates; q++) {
+            int i = q % size;
+            int helper = shm_read_row(R, i, row);
+            double sum = 0.0;
+            for (int j = 0; j < size; j++) {
+                double count = row[j] * helper;
+                if (fabs(count - round(count)) > 1e-6) {
+                    bad = 1;
+                }
+                sum += row[j];
+            }
+            if ((helper > 0 && fabs(sum - 1.0) > 1e-9) || shm_max_prob_idx(R, i) < 0) {
+                bad = 1;
+            }
+        }
+        close_M_shm(R);
+        _exit(bad);
+    }
+
+    Markov* ref = initialize_M(size);
+    int state = 0;
+    for (int u = 0; u < updates; u++) {
+        int next = (state * 5 + u / 7) % size;
+        shm_update_matrix(S, state, next);
+        update_matrix(ref, state, next);
+        state = next;
+    }
+    int child_status = -1;
+    if (child < 0 || waitpid(child, &child_status, 0) != child ||
+        !WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0) {
+        status = -1;
+    }
+
+    SharedMarkov* R = attach_M_shm(name);
+    if (R == NULL || shm_updates(R) != (unsigned long)updates || shm_update_matrix(R, 0, 0) != -1) {
+        status = -1;
+    } else {
+        for (int i = 0; i < size; i++) {
+            if (R->M->helper[i] != ref->helper[i] ||
+                memcmp(R->M->matrix[i], ref->matrix[i], size * sizeof(double)) != 0 ||
+                shm_max_prob_idx(R, i) != max_prob_idx(ref, i)) {
+                status = -1;
+            }
+        }
+    }
+
+    // a trainer that is only slow to finish a row is waited for, while one
+    // that exited mid-update leaves the row's counter odd for good and the
+    // reads of that row fail instead of waiting forever
+    if (R != NULL) {
+        double row[24];
+        unsigned seq = atomic_load(&S->seq[3]);
+        atomic_store(&S->seq[3], seq + 1);
+        pid_t slow = fork();
+        if (slow == 0) {
+            usleep(200000);
+            atomic_store(&S->seq[3], seq + 2);
+            _exit(0);
+        }
+        if (slow < 0 || shm_max_prob_idx(R, 3) != max_prob_idx(ref, 3)) {
+            status = -1;
+        }
+        waitpid(slow, NULL, 0);
+
+        pid_t dead = fork();
+        if (dead == 0) {
+            _exit(0);
+        }
+        waitpid(dead, NULL, 0);
+        S->header->trainer = dead;
+        atomic_store(&S->seq[3], seq + 3);
+        if (shm_max_prob_idx(R, 3) != SHM_ROW_STUCK || shm_read_row(R, 3, row) != SHM_ROW_STUCK ||
+            shm_read_row(R, 4, row) != ref->helper[4]) {
+            status = -1;
+        }
+        S->header->trainer = getpid();
+        atomic_store(&S->seq[3], seq + 4);
+        if (shm_max_prob_idx(R, 3) != max_prob_idx(ref, 3)) {
+            status = -1;
+        }
+    }
+    close_M_shm(R);
+    close_M_shm(S);
+    remove_M_shm(name);
+    if (attach_M_shm(name) != NULL) {
+        status = -1;
+    }
+    printf("Shared chain readers see whole rows: %s\n", status == 0 ? "yes" : "no");
+
+    free_M(ref);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_registry()
+//
+//  Trains one chain per tenant through the registry, with a budget that
+//  forces compactions, and checks every tenant against its own Markov
+//  structure; then shrinks the budget until tenants are evicted
+//
+// Returns:
+//    - 0 if every tenant matches and the budget holds, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_registry(void) {
+    int status = 0;
+    int size = 16;
+    int tenants = 200;
+
+    // room for about 80 dense chains, but all of them fit compacted
+    TenantRegistry* R = registry_init(size, 50 * 4096);
+    Markov** ref = (Markov**)malloc(tenants * sizeof(Markov*));
+    for (int t = 0; t < tenants; t++) {
+        ref[t] = initialize_M(size);
+    }
+
+    uint64_t ids[256];
+    int from[256];
+    int to[256];
+    int state[200] = { 0 };
+    for (int round = 0; round < 40; round++) {
+        for (int e = 0; e < 256; e++) {
+            int t = (round * 37 + e / 4) % tenants;   // runs of 4 events per tenant
+            int next = (state[t] * 3 + t + e) % size;
+            ids[e] = 1000003ULL * t;
+            from[e] = state[t];
+            to[e] = next;
+            update_matrix(ref[t], state[t], next);
+            state[t] = next;
+        }
+        if (round % 2 == 0) {
+            if (registry_update_bulk(R, ids, from, to, 256) != 256) {
+                status = -1;
+            }
+        } else {
+            for (int e = 0; e < 256; e++) {
+                registry_update(R, ids[e], from[e], to[e]);
+            }
+        }
+    }
+    if (R->compactions == 0 || R->evictions != 0 || registry_memory(R) > R->budget) {
+        status = -1;
+    }
+    for (int t = 0; t < tenants; t++) {
+        Markov* M = registry_get(R, 1000003ULL * t);
+        if (M == NULL || !same_chain(M, ref[t]) || max_prob_idx(M, 0) != max_prob_idx(ref[t], 0)) {
+            status = -1;
+        }
+    }
+    if (registry_add(R, 0, size) != NULL || registry_update(R, 0, size, 0) != -1) {
+        status = -1;   // tenant 0 exists
+    }
+
+    // with room for a handful of chains, cold tenants are evicted
+    R->budget = 8 * 4096;
+    for (int t = 0; t < tenants; t++) {
+        registry_update(R, 77 + 1000003ULL * t, 0, 1);
+    }
+    if (R->evictions == 0 || registry_memory(R) > R->budget || R->count >= (size_t)(2 * tenants)) {
+        status = -1;
+    }
+    if (registry_remove(R, 77 + 1000003ULL * (tenants - 1)) != 0 ||
+        registry_get(R, 77 + 1000003ULL * (tenants - 1)) != NULL) {
+        status = -1;
+    }
+    printf("Registry tenants match their own chains: %s\n", status == 0 ? "yes" : "no");
+
+    for (int t = 0; t < tenants; t++) {
+        free_M(ref[t]);
+    }
+    free(ref);
+    free_registry(R);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_registry_footprint()
+//
+//  Fills the budget with chains of one size class, then with chains of
+//  another, and checks that the slabs of the first class were given back
+//  and that the slabs actually allocated stay within the budget
+//
+// Returns:
+//    - 0 if the budget bounds the real footprint, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_registry_footprint(void) {
+    int status = 0;
+    size_t budget = 256 * 1024;
+    TenantRegistry* R = registry_init(16, budget);
+    int small_cls = -1;
+    for (uint64_t id = 1; id <= 400; id++) {
+        registry_update(R, id, 0, (int)(id % 16));
+    }
+    for (int c = 0; c < REGISTRY_CLASSES; c++) {
+        if (R->classes[c].num_slabs > 0) {
+            small_cls = c;
+        }
+    }
+
+    for (uint64_t id = 1001; id <= 1400; id++) {
+        Markov* M = registry_add(R, id, 48);
+        if (M == NULL || update_matrix(M, 1, (int)(id % 48)) != 0) {
+            status = -1;
+        }
+    }
+
+    size_t slabs = 0;
+    for (int c = 0; c < REGISTRY_CLASSES; c++) {
+        slabs += (size_t)R->classes[c].num_slabs * R->slab_bytes;
+    }
+    if (small_cls < 0 || R->classes[small_cls].num_slabs != 0 || slabs > budget ||
+        registry_memory(R) > budget) {
+        status = -1;
+    }
+    printf("Registry budget bounds its slabs: %s\n", status == 0 ? "yes" : "no");
+
+    free_registry(R);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_delta()
+//
+//  Checks the delta states (exact, bucketed, negative and wrapping deltas)
+//  and that a delta chain predicts sequential, strided and alternating scans
+//  over pages that a page-indexed chain would never have seen
+//
+// Returns:
+//    - 0 if the states and predictions are as expected, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_delta(void) {
+    int status = 0;
+    DeltaMarkov* D = initialize_delta(8);
+    if (D == NULL || D->M->size != 17 + 128 || initialize_delta(-1) != NULL) {
+        printf("Delta chain predicts scans: no (bad initialization)\n");
+        free_delta(D);
+        return -1;
+    }
+    if (delta_state(D, 0) != 8 || delta_state(D, -8) != 0 || delta_state(D, 8) != 16 ||
+        delta_state(D, 9) != delta_state(D, 15) || delta_state(D, 16) == delta_state(D, 15) ||
+        delta_state(D, -9) == delta_state(D, 9) || delta_state(D, INT64_MIN) >= D->M->size) {
+        status = -1;
+    }
+
+    // a sequential scan: every page is new, the delta is always +1
+    uint64_t page = 1ULL << 40;
+    int hits = 0;
+    for (int a = 0; a < 1000; a++) {
+        if (delta_predict(D) == (int64_t)page) {
+            hits++;
+        }
+        delta_observe(D, page);
+        page++;
+    }
+    if (hits < 997) {
+        status = -1;
+    }
+
+    // a large stride backwards, then a +3/+5000 pattern
+    hits = 0;
+    for (int a = 0; a < 500; a++) {
+        page -= 70000;
+        if (a > 2 && delta_predict(D) != (int64_t)page) {
+            status = -1;
+        }
+        delta_observe(D, page);
+    }
+    for (int a = 0; a < 1000; a++) {
+        page += a % 2 == 0 ? 3 : 5000;
+        if (delta_predict(D) == (int64_t)page) {
+            hits++;
+        }
+        delta_observe(D, page);
+    }
+    if (hits < 990) {
+        status = -1;
+    }
+    printf("Delta chain predicts scans: %s\n", status == 0 ? "yes" : "no");
+
+    free_delta(D);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_reach()
+//
+//  Compares unpruned beam searches over dense and sparse chains against
+//  row start of M + M^2 + M^3 computed with matrix_mult, and checks that a
+//  narrow beam still finds the most visited state
+//
+// Returns:
+//    - 0 if the scores and rankings match, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_reach(void) {
+    int status = 0;
+    int size = 30;
+    int k = 3;
+    Markov* M = initialize_M(size);
+    int state = 0;
+    for (int u = 0; u < 3000; u++) {
+        int next = (state * 7 + 1 + u % 4) % size;
+        update_matrix(M, state, next);
+        state = next;
+    }
+    SparseMarkov* S = sparse_from_M(M);
+
+    // expected visits within k steps, from matrix powers
+    Markov* P2 = matrix_mult(M, M);
+    Markov* P3 = matrix_mult(P2, M);
+    MarkovReach* R = reach_init(size);
+    int states[30];
+    double scores[30];
+    for (int start = 0; start < size; start += 7) {
+        for (int mode = 0; mode < 2; mode++) {
+            int found = mode == 0
+                ? reach_top_n(R, M, start, k, size, 0.0, size, states, scores)
+                : reach_top_n_sparse(R, S, start, k, size, 0.0, size, states, scores);
+            double total = 0.0;
+            for (int f = 0; f < found; f++) {
+                int j = states[f];
+                double expected = M->matrix[start][j] + P2->matrix[start][j] + P3->matrix[start][j];
+                if (fabs(scores[f] - expected) > 1e-12 || (f > 0 && scores[f] > scores[f - 1])) {
+                    status = -1;
+                }
+                total += scores[f];
+            }
+            if (found < 1 || fabs(total - k) > 1e-9) {
+                status = -1;   // k steps of mass 1, unless a row is empty
+            }
+        }
+
+        // a narrow, pruned beam agrees on the most visited state
+        int best;
+        if (reach_top_n(R, M, start, k, 2, 1e-3, 1, &best, NULL) != 1 || best != states[0]) {
+            status = -1;
+        }
+    }
+    if (reach_top_n(R, M, size, k, 4, 0.0, 4, states, scores) != -1) {
+        status = -1;
+    }
+    printf("Beam search matches matrix powers: %s\n", status == 0 ? "yes" : "no");
+
+    free_reach(R);
+    free_M(P2);
+    free_M(P3);
+    free_sparse(S);
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_scc()
+//
+//  Builds a reducible chain of three cycles fed by transient states, and
+//  checks the classes and their order, that scc_matrix_mult and
+//  scc_matrix_power match matrix_mult, and that scc_stationary gives each
+//  closed class a distribution fixed by the chain
+//
+// Returns:
+//    - 0 if every check passes, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_scc(void) {
+    int status = 0;
+    int size = 24;
+    Markov* M = initialize_M(size);
+
+    // states 0..5: transient, 6..11, 12..17, 18..23: closed clusters where
+    // state s steps to s + 1 or s + 2 within its cluster (so it is aperiodic)
+    for (int s = 6; s < size; s++) {
+        int base = s / 6 * 6;
+        update_matrix(M, s, base + (s - base + 1) % 6);
+        update_matrix(M, s, base + (s - base + 2) % 6);
+        update_matrix(M, s, base + (s - base + 1) % 6);
+    }
+    for (int s = 0; s < 6; s++) {
+        update_matrix(M, s, (s + 1) % 6);
+        update_matrix(M, s, 6 + 6 * (s % 3) + s);
+    }
+    MarkovSCC* C = scc_decompose(M);
+    if (C == NULL || C->num_classes != 4) {
+        printf("Communicating classes found: no\n");
+        free_scc(C);
+        free_M(M);
+        return -1;
+    }
+
+    // one transient class first, then the three closed clusters
+    int closed = 0;
+    for (int c = 0; c < C->num_classes; c++) {
+        closed += C->closed[c];
+        if (C->closed[c] != (c > 0) || C->class_start[c + 1] - C->class_start[c] != 6) {
+            status = -1;
+        }
+    }
+    for (int i = 0; i < size; i++) {
+        if (C->perm[C->pos[i]] != i || C->class_of[i] != (i < 6 ? 0 : C->class_of[i / 6 * 6])) {
+            status = -1;
+        }
+    }
+
+    // block upper triangular, and the decomposition of the sparse chain agrees
+    Markov* P = scc_permute(M, C);
+    for (int i = 0; i < size; i++) {
+        int a = C->class_of[C->perm[i]];
+        for (int j = 0; j < size; j++) {
+            if (P->matrix[i][j] != 0.0 && (j < C->class_start[a] || j >= C->reach_end[a])) {
+                status = -1;
+            }
+        }
+    }
+    SparseMarkov* S = sparse_from_M(M);
+    MarkovSCC* CS = scc_decompose_sparse(S);
+    if (CS == NULL || CS->num_classes != C->num_classes ||
+        memcmp(CS->perm, C->perm, size * sizeof(int)) != 0) {
+        status = -1;
+    }
+
+    // products match matrix_mult exactly; powers match in the original order
+    Markov* P2 = matrix_mult(P, P);
+    Markov* B2 = scc_matrix_mult(P, P, C, 3);
+    for (int i = 0; i < size; i++) {
+        if (memcmp(P2->matrix[i], B2->matrix[i], size * sizeof(double)) != 0) {
+            status = -1;
+        }
+    }
+    Markov* M4 = matrix_mult(M, M);
+    for (int m = 2; m < 4; m++) {
+        Markov* next = matrix_mult(M4, M);
+        free_M(M4);
+        M4 = next;
+    }
+    Markov* B4 = scc_matrix_power(P, C, 4, 2);
+    Markov* U4 = scc_unpermute(B4, C);
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            if (fabs(U4->matrix[i][j] - M4->matrix[i][j]) > 1e-12) {
+                status = -1;
+            }
+        }
+        if (U4->helper[i] != 0) {
+            status = -1;
+        }
+    }
+
+    // pi P = pi on each closed class, summing to 1 there, and 0 elsewhere
+    double pi[24];
+    if (scc_stationary(M, C, pi, 2) != closed) {
+        status = -1;
+    }
+    for (int c = 0; c < C->num_classes; c++) {
+        double total = 0.0;
+        for (int p = C->class_start[c]; p < C->class_start[c + 1]; p++) {
+            int j = C->perm[p];
+            double flow = 0.0;
+            for (int q = C->class_start[c]; q < C->class_start[c + 1]; q++) {
+                flow += pi[C->perm[q]] * M->matrix[C->perm[q]][j];
+            }
+            if (C->closed[c] ? fabs(flow - pi[j]) > 1e-12 : pi[j] != 0.0) {
+                status = -1;
+            }
+            total += pi[j];
+        }
+        if (C->closed[c] && fabs(total - 1.0) > 1e-12) {
+            status = -1;
+        }
+    }
+    printf("Communicating classes found: %s\n", status == 0 ? "yes" : "no");
+
+    free_M(P);
+    free_M(P2);
+    free_M(B2);
+    free_M(M4);
+    free_M(B4);
+    free_M(U4);
+    free_scc(CS);
+    free_sparse(S);
+    free_scc(C);
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_order()
+//
+//  Scrambles the labels of a banded chain and checks that RCM brings the
+//  transitions back near the diagonal, that frequency order puts a state
+//  visited from everywhere first, and that an OrderedMarkov answers in the original
+//  indices exactly like the original chain, updates and ties included. RCM
+//  breaks ties on degree by the lower state
+//
+// Returns:
+//    - 0 if every check passes, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_order(void) {
+    int status = 0;
+    int size = 64;
+
+    // state s steps to s + 1 .. s + 3 (mod size), under scrambled labels
+    int label[64];
+    for (int s = 0; s < size; s++) {
+        label[s] = (s * 37 + 11) % size;
+    }
+    Markov* M = initialize_M(size);
+    for (int u = 0; u < 3000; u++) {
+        int s = (u * 7) % size;
+        update_matrix(M, label[s], label[(s + 1 + u % 3) % size]);
+    }
+    MarkovOrder* R = order_rcm(M);
+    if (R == NULL || !(order_mean_distance(M, R) < order_mean_distance(M, NULL) / 4)) {
+        status = -1;
+    }
+
+    // ties on degree go to the lower state: a star starts from leaf 1 and
+    // then visits the other leaves in increasing order, reversed at the end
+    Markov* star = initialize_M(5);
+    for (int s = 1; s < 5; s++) {
+        update_matrix(star, 0, s);
+    }
+    MarkovOrder* SR = order_rcm(star);
+    int star_perm[5] = {4, 3, 2, 0, 1};
+    if (SR == NULL || memcmp(SR->perm, star_perm, sizeof(star_perm)) != 0) {
+        status = -1;
+    }
+    free_order(SR);
+    free_M(star);
+
+    // label[0] is then visited from every state as well
+    for (int u = 0; u < 1000; u++) {
+        update_matrix(M, label[(u * 7) % size], label[0]);
+    }
+    MarkovOrder* F = order_by_frequency(M);
+    if (F == NULL || F->perm[0] != label[0]) {
+        status = -1;
+    }
+    for (int i = 0; R != NULL && F != NULL && i < size; i++) {
+        if (R->perm[R->pos[i]] != i || F->perm[F->pos[i]] != i) {
+            status = -1;
+        }
+    }
+    free_order(R);
+    R = order_rcm(M);
+
+    // the sparse order and layout agree with the dense ones
+    SparseMarkov* S = sparse_from_M(M);
+    MarkovOrder* RS = order_rcm_sparse(S);
+    Markov* P = order_apply(M, R);
+    SparseMarkov* PS = order_apply_sparse(S, R);
+    SparseMarkov* expected = sparse_from_M(P);
+    if (RS == NULL || memcmp(RS->perm, R->perm, size * sizeof(int)) != 0 ||
+        PS->nnz != expected->nnz ||
+        memcmp(PS->col_idx, expected->col_idx, PS->nnz * sizeof(int)) != 0 ||
+        memcmp(PS->values, expected->values, PS->nnz * sizeof(double)) != 0) {
+        status = -1;
+    }
+
+    // an ordered chain follows the original through more updates, including
+    // a row of ties and an empty row
+    OrderedMarkov* OM = ordered_init(M, F);
+    for (int u = 0; u < 500; u++) {
+        int i = (u * 13) % (size - 1);
+        int j = (u * 29 + 3) % size;
+        update_matrix(M, i, j);
+        ordered_update(OM, i, j);
+    }
+    update_matrix(M, size - 2, 9);
+    ordered_update(OM, size - 2, 9);
+    update_matrix(M, size - 2, 4);
+    ordered_update(OM, size - 2, 4);
+    for (int i = 0; i < size; i++) {
+        if (ordered_max_prob_idx(OM, i) != max_prob_idx(M, i)) {
+            status = -1;
+        }
+        for (int j = 0; j < size; j++) {
+            if (ordered_prob(OM, i, j) != M->matrix[i][j]) {
+                status = -1;
+            }
+        }
+    }
+    Markov* back = ordered_to_M(OM);
+    if (!same_chain(back, M) || ordered_update(OM, size, 0) != -1) {
+        status = -1;
+    }
+    printf("Reordered chain matches the original: %s\n", status == 0 ? "yes" : "no");
+
+    free_M(back);
+    free_ordered(OM);
+    free_sparse(expected);
+    free_sparse(PS);
+    free_M(P);
+    free_order(RS);
+    free_sparse(S);
+    free_order(R);
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_ordered_row_sums()
+//
+//  Checks ordered_max_prob_idx on rows that do not sum to 1: the rows of a
+//  product (nonzero cells under a helper count of 0), a row summing past 1
+//  with its largest cell stored last, a row with a negative cell and an
+//  empty row, before and after updates
+//
+// Returns:
+//    - 0 if every check passes, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_ordered_row_sums(void) {
+    int status = 0;
+    int size = 16;
+
+    // state size - 1 is never left, so its row of the product stays empty
+    Markov* M = initialize_M(size);
+    for (int u = 0; u < 400; u++) {
+        int s = (u * 5) % (size - 1);
+        update_matrix(M, s, (s * 3 + 1 + u % 4) % size);
+    }
+    Markov* P = matrix_mult(M, M);
+    MarkovOrder* O = order_rcm(P);
+    int first = O->perm[0];
+    int second = O->perm[1];
+    int last = O->perm[size - 1];
+    for (int j = 0; j < size; j++) {
+        P->matrix[7][j] = 0.0;
+        P->matrix[9][j] = 0.0;
+    }
+    P->matrix[7][first] = 0.6;
+    P->matrix[7][last] = 0.7;
+    P->matrix[9][first] = 0.5;
+    P->matrix[9][second] = -1.0;
+    P->matrix[9][last] = 0.8;
+
+    OrderedMarkov* OM = ordered_init(P, O);
+    for (int i = 0; i < size; i++) {
+        if (P->helper[i] != 0 || ordered_max_prob_idx(OM, i) != max_prob_idx(P, i)) {
+            status = -1;
+        }
+    }
+    if (ordered_max_prob_idx(OM, 7) != last || ordered_max_prob_idx(OM, 9) != last ||
+        ordered_max_prob_idx(OM, size - 1) != 0) {
+        status = -1;
+    }
+
+    // the sums follow the updates, including the first one of a product row
+    for (int u = 0; u < 60; u++) {
+        int i = (u * 7) % size;
+        int j = (u * 11 + 2) % size;
+        update_matrix(P, i, j);
+        ordered_update(OM, i, j);
+    }
+    for (int i = 0; i < size; i++) {
+        if (ordered_max_prob_idx(OM, i) != max_prob_idx(P, i)) {
+            status = -1;
+        }
+    }
+    printf("Ordered argmax follows rows that do not sum to 1: %s\n", status == 0 ? "yes" : "no");
+
+    free_ordered(OM);
+    free_M(P);
+    free_M(M);
+    return status;
+}
+
+// Reads the whole file behind fd from its start into a new string
+static char* read_back(int fd, long* len) {
+    *len = lseek(fd, 0, SEEK_END);
+    char* data = (char*)malloc(*len + 1);
+    if (pread(fd, data, *len, 0) != *len) {
+        *len = -1;
+    }
+    data[*len > 0 ? *len : 0] = '\0';
+    return data;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_export()
+//
+//  Exports a chain holding rounding ties and awkward values in every format,
+//  with one and several threads, and compares the text formats with the
+//  same cells printed by snprintf and the binary format with the chain
+//
+// Returns:
+//    - 0 if every export matches, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_export(void) {
+    int status = 0;
+    int size = 40;
+    Markov* M = initialize_M(size);
+    for (int u = 0; u < 3000; u++) {
+        update_matrix(M, (u * 7) % size, (u * u + 3) % (size / 2));
+    }
+    // values on and near rounding ties, and an empty row
+    double awkward[] = { 0.125, 0.0005, 0.0015, 0.9995, 2.5e-10, 1.0 / 3.0, 0.999999, 1.0 };
+    for (int a = 0; a < 8; a++) {
+        M->matrix[1][a] = awkward[a];
+    }
+    memset(M->matrix[2], 0, size * sizeof(double));
+
+    char path[] = "/tmp/test_markov_XXXXXX";
+    int fd = mkstemp(path);
+    unlink(path);
+    char cell[64];
+    int decimals[] = { 3, 2, 9 };
+    for (int d = 0; d < 3; d++) {
+        for (int format = EXPORT_TEXT; format <= EXPORT_MATRIX_MARKET; format++) {
+            // the expected output, one snprintf per cell
+            char* expected = (char*)malloc((size_t)size * size * 40 + 256);
+            long len = 0;
+            if (format == EXPORT_MATRIX_MARKET) {
+                long nnz = 0;
+                for (int i = 0; i < size; i++) {
+                    for (int j = 0; j < size; j++) {
+                        nnz += M->matrix[i][j] != 0.0;
+                    }
+                }
+                len += sprintf(expected + len, "%%%%MatrixMarket matrix coordinate real general\n%d %d %ld\n",
+                               size, size, nnz);
+            }
+            for (int i = 0; i < size; i++) {
+                for (int j = 0; j < size; j++) {
+                    snprintf(cell, sizeof(cell), "%.*f", decimals[d], M->matrix[i][j]);
+                    if (format == EXPORT_TEXT) {
+                        len += sprintf(expected + len, "%s ", cell);
+                    } else if (format == EXPORT_CSV) {
+                        len += sprintf(expected + len, j + 1 < size ? "%s," : "%s", cell);
+                    } else if (M->matrix[i][j] != 0.0) {
+                        len += sprintf(expected + len, "%d %d %s\n", i + 1, j + 1, cell);
+                    }
+                }
+                if (format != EXPORT_MATRIX_MARKET) {
+                    expected[len++] = '\n';
+                }
+            }
+
+            for (int threads = 1; threads <= 3; threads += 2) {
+                if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0) {
+                    status = -1;
+                }
+                long written = export_M_fd(M, fd, (ExportFormat)format, decimals[d], threads);
+                long got_len;
+                char* got = read_back(fd, &got_len);
+                if (written != len || got_len != len || memcmp(got, expected, len) != 0) {
+                    status = -1;
+                }
+                free(got);
+            }
+            free(expected);
+        }
+    }
+
+    // the stream form, and the binary round trip
+    if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0) {
+        status = -1;
+    }
+    FILE* f = fdopen(dup(fd), "w+");
+    if (f == NULL ||
+        export_M(M, f, EXPORT_BINARY, 0, 1) <= 0 || fflush(f) != 0) {
+        status = -1;
+    }
+    lseek(fd, 0, SEEK_SET);
+    Markov* back = import_M_binary(fd);
+    if (!same_chain(back, M) || export_M_fd(M, fd, EXPORT_TEXT, 12, 1) != -1) {
+        status = -1;
+    }
+    printf("Exports match printf and the chain: %s\n", status == 0 ? "yes" : "no");
+
+    if (f != NULL) {
+        fclose(f);
+    }
+    close(fd);
+    free_M(back);
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_prefetch()
+//
+//  Checks that rows with too few updates or no likely successor predict
+//  nothing, that a predictable walk raises the degree and uses all its
+//  prefetches, and that a walk with three equally likely successors lowers
+//  the degree back to 1 and counts the waste
+//
+// Returns:
+//    - 0 if every check passes, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_prefetch(void) {
+    int status = 0;
+    int size = 32;
+    int states[4];
+    Markov* M = initialize_M(size);
+
+    // state 0 was updated once, state 1 spreads over 10 successors
+    update_matrix(M, 0, 5);
+    for (int u = 0; u < 100; u++) {
+        update_matrix(M, 1, 2 + u % 10);
+    }
+    PrefetchPolicy* P = prefetch_init(M, 0.3, 8, 3, 1);
+    if (prefetch_predict(P, 0, states) != 0 || prefetch_predict(P, 1, states) != 0 ||
+        P->suppressed != 2 || max_prob_idx(M, 1) != 2) {
+        status = -1;
+    }
+
+    // states 16..31 form a cycle: every prefetch is used and the degree
+    // grows to its maximum
+    int s = 16;
+    for (int u = 0; u < 3000; u++) {
+        int next = 16 + (s - 16 + 1) % 16;
+        prefetch_observe(P, next);
+        update_matrix(M, s, next);
+        prefetch_predict(P, next, states);
+        s = next;
+    }
+    if (P->degree != 3 || P->used < 2800 || P->wasted != 0) {
+        status = -1;
+    }
+
+    // states 2..13: each one goes to one of three next states, picked by a
+    // hash of the step, so one prefetch in three is used and the degree
+    // drops to 1
+    free_prefetch(P);
+    P = prefetch_init(M, 0.3, 8, 3, 1);
+    P->degree = 3;
+    s = 2;
+    for (unsigned int u = 0; u < 6000; u++) {
+        int next = 2 + (s - 2 + 1 + 4 * (int)((u * 2654435761u >> 16) % 3)) % 12;
+        prefetch_observe(P, next);
+        update_matrix(M, s, next);
+        prefetch_predict(P, next, states);
+        s = next;
+    }
+    unsigned long outstanding = 0;
+    for (int i = 0; i < size; i++) {
+        outstanding += P->expires[i] != 0;
+    }
+    if (P->degree != 1 || P->wasted == 0 || P->issued != P->used + P->wasted + outstanding) {
+        status = -1;
+    }
+    if (prefetch_predict(P, size, states) != -1 || prefetch_init(M, 0.0, 1, 1, 1) != NULL) {
+        status = -1;
+    }
+    printf("Prefetch policy adapts to feedback: %s\n", status == 0 ? "yes" : "no");
+
+    free_prefetch(P);
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_perf()
+//
+//  Opens the counters around a few row scans and checks that every event
+//  reports either a count per operation or NAN when it is unavailable, and
+//  that the report names every event
+//
+// Returns:
+//    - 0 if the counters behave, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_perf(void) {
+    int status = 0;
+    Markov* M = initialize_M(256);
+    PerfCounters* C = perf_open();
+    if (C == NULL || !isnan(perf_per_op(C, PERF_CYCLES))) {
+        status = -1;   // no operation measured yet
+    }
+
+    volatile int sink = 0;
+    perf_start(C);
+    for (int i = 0; i < 256; i++) {
+        sink += max_prob_idx(M, i);
+    }
+    perf_stop(C, 256);
+    char report[512];
+    perf_format(C, report, sizeof(report));
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        double v = perf_per_op(C, (PerfEvent)e);
+        if (perf_available(C, (PerfEvent)e) ? !(v >= 0.0) : !isnan(v)) {
+            status = -1;
+        }
+        if (strstr(report, perf_event_name((PerfEvent)e)) == NULL) {
+            status = -1;
+        }
+    }
+    perf_reset(C);
+    if (C->ops != 0 || perf_format(C, report, 8) <= 8) {
+        status = -1;   // a short buffer still reports the full length
+    }
+    printf("Performance counters degrade gracefully: %s\n", status == 0 ? "yes" : "no");
+
+    perf_close(C);
+    free_M(M);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_stable()
+//
+//  Trains the same transitions with update_matrix and with the stable mode
+//  and checks that they agree, that the 64-bit counts go past INT_MAX while
+//  the helper saturates, that renormalization restores the row sums, and
+//  that the compensated product and propagation match a long double
+//  reference
+//
+// Returns:
+//    - 0 if the stable mode behaves, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_stable(void) {
+    int status = 0;
+    int n = 48;
+    Markov* A = initialize_M(n);
+    Markov* B = initialize_M(n);
+    StableMarkov* S = stable_init(B, 0);
+    unsigned int seed = 12345;
+    for (int t = 0; t < 20000; t++) {
+        seed = seed * 1103515245u + 12345u;
+        int i = (seed >> 16) % n;
+        int j = ((seed >> 8) % 7 + i) % n;
+        update_matrix(A, i, j);
+        stable_update(S, i, j);
+    }
+    for (int i = 0; i < n; i++) {
+        if (A->helper[i] != B->helper[i] || stable_count(S, i) != (uint64_t)B->helper[i]) {
+            status = -1;
+        }
+        for (int j = 0; j < n; j++) {
+            if (fabs(A->matrix[i][j] - B->matrix[i][j]) > 1e-12) {
+                status = -1;
+            }
+        }
+    }
+
+    // counts past INT_MAX: the helper saturates, the row still sums to 1
+    S->counts[0] = (uint64_t)INT_MAX + 5;
+    stable_update(S, 0, 1);
+    if (B->helper[0] != INT_MAX || stable_count(S, 0) != (uint64_t)INT_MAX + 6 ||
+        !(row_sum_drift(B) < 1e-12)) {
+        status = -1;
+    }
+    A->helper[0] = INT_MAX;
+    update_matrix(A, 0, 1);
+    if (A->helper[0] != INT_MAX || !(row_sum_drift(A) < 1e-12)) {
+        status = -1;
+    }
+
+    // renormalization, by hand and every `interval` updates
+    for (int j = 0; j < n; j++) {
+        B->matrix[2][j] *= 1.001;
+    }
+    if (renormalize_rows(B) < 1 || !(row_sum_drift(B) <= 1e-15)) {
+        status = -1;
+    }
+    StableMarkov* T = stable_init(B, 16);
+    for (int t = 0; t < 32; t++) {
+        stable_update(T, 3, t % 5);
+    }
+    if (T->renormalized != 2 || T->counts[3] != S->counts[3] + 32) {
+        status = -1;
+    }
+
+    // compensated product against a long double reference
+    Markov* R = matrix_mult_compensated(A, A);
+    Markov* P = matrix_mult(A, A);
+    for (int i = 0; i < n && R != NULL; i++) {
+        for (int j = 0; j < n; j++) {
+            long double ref = 0.0L;
+            for (int k = 0; k < n; k++) {
+                ref += (long double)A->matrix[i][k] * (long double)A->matrix[k][j];
+            }
+            if (fabsl(R->matrix[i][j] - ref) > 3e-16L * ref ||
+                fabs(R->matrix[i][j] - P->matrix[i][j]) > 1e-13) {
+                status = -1;
+            }
+        }
+    }
+
+    // propagation of a point mass equals the rows of the powers
+    double* x = (double*)calloc(n, sizeof(double));
+    x[5] = 1.0;
+    Markov* power = matrix_mult_compensated(R, A);   // A^3
+    if (propagate_compensated(A, x, x, 3) != 0) {
+        status = -1;
+    }
+    for (int j = 0; j < n; j++) {
+        if (fabs(x[j] - power->matrix[5][j]) > 1e-15) {
+            status = -1;
+        }
+    }
+    Markov* small = initialize_M(2);
+    if (propagate_compensated(A, x, x, -1) != -1 || stable_update(S, -1, 0) != -1 ||
+        !isnan(renormalize_row(A, n)) || matrix_mult_compensated(A, small) != NULL) {
+        status = -1;
+    }
+    free_M(small);
+    printf("Stable training keeps rows normalized: %s\n", status == 0 ? "yes" : "no");
+
+    free(x);
+    free_M(power);
+    free_M(P);
+    free_M(R);
+    free_stable(T);
+    free_stable(S);
+    free_M(A);
+    free_M(B);
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test_saturated_versions()
+//
+//  Saturates the helper count of a row and updates it again, checking that
+//  the power cache, the snapshot publisher, the checkpoint log and the
+//  scorer all still see the change through the row's version
+//
+// Returns:
+//    - 0 if every consumer sees the update, -1 otherwise
+///////////////////////////////////////////////////////////////////////////////
+static int test_saturated_versions(void) {
+    int status = 0;
+    int size = 8;
+    char path[] = "/tmp/test_markov_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("Saturated rows still invalidate caches: no (no temporary file)\n");
+        return -1;
+    }
+    close(fd);
+
+    Markov* M = initialize_M(size);
+    MarkovPublisher* P = publisher_init(size, 1);
+    for (int i = 0; i < size; i++) {
+        update_matrix(M, i, (i + 1) % size);
+        publisher_update(P, i, (i + 1) % size);
+    }
+    M->helper[2] = INT_MAX;
+    P->writer->helper[2] = INT_MAX;
+    MarkovPower* cache = power_cache_init(M, 2, 0);
+    MarkovScorer* scorer = scorer_init(M, 0.0);
+    MarkovCheckpoint* C = checkpoint_create(M, path);
+    publisher_publish(P);
+    if (cache == NULL || scorer == NULL || C == NULL) {
+        status = -1;
+    }
+
+    // the count stays at INT_MAX, but the row changes
+    unsigned int before = M->version[2];
+    update_matrix(M, 2, 5);
+    publisher_update(P, 2, 5);
+    if (M->helper[2] != INT_MAX || M->version[2] != before + 1) {
+        status = -1;
+    }
+    if (status == 0) {
+        if (power_cache_pending(cache) != 1 || power_cache_refresh(cache) < 1) {
+            status = -1;
+        }
+        Markov* squared = matrix_mult(M, M);
+        if (!same_chain(squared, power_cache_get(cache))) {
+            status = -1;
+        }
+        free_M(squared);
+        if (scorer_refresh(scorer) != 1) {
+            status = -1;
+        }
+        if (checkpoint_save(C) != 1) {
+            status = -1;
+        }
+        if (publisher_publish(P) < 1) {
+            status = -1;
+        }
+        Markov* snap = snapshot_acquire(P, 0);
+        if (snap->matrix[2][5] != P->writer->matrix[2][5] || snap->matrix[2][5] == 0.0) {
+            status = -1;
+        }
+        snapshot_release(P, 0);
+    }
+    printf("Saturated rows still invalidate caches: %s\n", status == 0 ? "yes" : "no");
+
+    checkpoint_close(C);
+    free_scorer(scorer);
+    free_power_cache(cache);
+    free_publisher(P);
+    free_M(M);
+    unlink(path);
+    return status;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // main()
@@ -46,7 +2397,7 @@
 //    - None
 //
 // Returns:
-//    - 0 if the program runs successfully.
+//    - 0 if the program runs successfully, 1 if any check failed.
 ///////////////////////////////////////////////////////////////////////////////
 int main() {
     int size = 3;   // Size of the matrix
@@ -55,6 +2406,7 @@ int main() {
     int max_row_1;
     int max_row_2;
     int min_row_2;
+    int failures = 0;
 
     // Initialize a Markov structure
     Markov* M = initialize_M(size);
@@ -172,6 +2524,157 @@ int main() {
     // Print the resulting matrix
     printf("Matrix Raised to Power %d:\n", power);
     print_M(result);
+    printf("\n");
+
+    // Compare against the sparse product
+    if (test_sparse(M, result) != 0) {
+        failures++;
+    }
+
+    // Compare a fixed-size chain against the Markov structure
+    if (test_fixed() != 0) {
+        failures++;
+    }
+
+    // Compare batched queries against the single-row queries
+    if (test_batch() != 0) {
+        failures++;
+    }
+
+    // Compare the cached M^3 against matrix_mult
+    if (test_power_cache() != 0) {
+        failures++;
+    }
+
+    // Read published snapshots while the chain is trained
+    if (test_snapshot() != 0) {
+        failures++;
+    }
+
+    // Compare huge page backed chains against initialize_M
+    if (test_huge() != 0) {
+        failures++;
+    }
+
+    // Solve for hitting times and absorption probabilities
+    if (test_absorb() != 0) {
+        failures++;
+    }
+
+    // Compare the 8-bit compressed chain against the Markov structure
+    if (test_quant() != 0) {
+        failures++;
+    }
+
+    // Compare the heavy-hitter summaries against the Markov structure
+    if (test_heavy() != 0) {
+        failures++;
+    }
+
+    // Compare the Count-Min sketched chain against the Markov structure
+    if (test_sketch() != 0) {
+        failures++;
+    }
+
+    // Sketched probabilities after a state loses and reclaims its bucket
+    if (test_sketch_reclaim() != 0) {
+        failures++;
+    }
+
+    // Compare sequence scores against sums of log probabilities
+    if (test_score() != 0) {
+        failures++;
+    }
+
+    // Train through the ring buffer pipeline
+    if (test_pipeline() != 0) {
+        failures++;
+    }
+
+    // Compare the parallel trainers against update_matrix
+    if (test_train() != 0) {
+        failures++;
+    }
+
+    // Reopen a file-backed chain and multiply it out of core
+    if (test_mmap() != 0) {
+        failures++;
+    }
+
+    // Resume a chain from a checkpoint log with a torn tail
+    if (test_checkpoint() != 0) {
+        failures++;
+    }
+
+    // Cut a failed checkpoint back off the log
+    if (test_checkpoint_failure() != 0) {
+        failures++;
+    }
+
+    // Train a shared chain while another process reads it
+    if (test_shm() != 0) {
+        failures++;
+    }
+
+    // Keep one chain per tenant under a memory budget
+    if (test_registry() != 0) {
+        failures++;
+    }
+
+    // Charge whole slabs to the registry budget
+    if (test_registry_footprint() != 0) {
+        failures++;
+    }
+
+    // Predict scans with a chain over page deltas
+    if (test_delta() != 0) {
+        failures++;
+    }
+
+    // Rank the states reachable within k steps without M^k
+    if (test_reach() != 0) {
+        failures++;
+    }
+
+    // Split a reducible chain into communicating classes
+    if (test_scc() != 0) {
+        failures++;
+    }
+
+    // Relabel states for locality behind the original indices
+    if (test_order() != 0) {
+        failures++;
+    }
+
+    // Ordered argmax on rows that do not sum to 1
+    if (test_ordered_row_sums() != 0) {
+        failures++;
+    }
+
+    // Dump a chain in bulk in every export format
+    if (test_export() != 0) {
+        failures++;
+    }
+
+    // Gate prefetches on confidence and adapt their degree
+    if (test_prefetch() != 0) {
+        failures++;
+    }
+
+    // Count hardware events around measured operations
+    if (test_perf() != 0) {
+        failures++;
+    }
+
+    // Train with 64-bit counts and compensated accumulation
+    if (test_stable() != 0) {
+        failures++;
+    }
+
+    // Keep caches in step with rows whose helper count saturated
+    if (test_saturated_versions() != 0) {
+        failures++;
+    }
 
     // Free memory
     free_M(M);
@@ -179,5 +2682,5 @@ int main() {
     free_M(result);
     result = NULL;
 
-    return 0;
+    return failures == 0 ? 0 : 1;
 }
\ No newline at end of file